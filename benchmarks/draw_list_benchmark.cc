@@ -0,0 +1,143 @@
+// Compares the CPU cost of drawing a large RenderableNode tree by walking it
+// versus through a compiled DrawList. Renderables do no GL work, so only the
+// traversal and transform math are measured.
+
+#include <qrk/draw_list.h>
+#include <qrk/mesh.h>
+#include <qrk/shader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(int, nodes, 20000, "Number of nodes in the tree");
+ABSL_FLAG(int, passes, 3, "Number of times the tree is drawn per frame");
+ABSL_FLAG(double, moving, 0.01,
+          "Fraction of nodes that are moved every frame in the dynamic case");
+ABSL_FLAG(int, iterations, 50, "Number of timed frames per case");
+
+namespace {
+
+// A renderable that only consumes its transform.
+class NullRenderable : public qrk::Renderable {
+ public:
+  void drawWithTransform(const glm::mat4& transform, qrk::Shader& shader,
+                         qrk::TextureRegistry* textureRegistry) override {
+    sum_ += transform[3];
+  }
+  glm::vec4 getSum() const { return sum_; }
+
+ private:
+  glm::vec4 sum_ = glm::vec4(0.0f);
+};
+
+// A shader that doesn't need a GL context.
+class NullShader : public qrk::Shader {};
+
+double measureMedianMs(int iterations, const std::function<void()>& fn) {
+  std::vector<double> samples;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+glm::mat4 randomTransform(std::mt19937& rng) {
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  return glm::rotate(
+      glm::translate(glm::mat4(1.0f),
+                     glm::vec3(dist(rng), dist(rng), dist(rng))),
+      dist(rng), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const int numNodes = std::max(1, absl::GetFlag(FLAGS_nodes));
+  const int passes = std::max(1, absl::GetFlag(FLAGS_passes));
+  const int numMoving = std::clamp(
+      static_cast<int>(numNodes * absl::GetFlag(FLAGS_moving)), 0, numNodes);
+  const int iterations = std::max(1, absl::GetFlag(FLAGS_iterations));
+
+  // Attach each node to a random earlier one, so that the tree's depth-first
+  // order doesn't match the order that its nodes were allocated in.
+  std::mt19937 rng(42);
+  auto root = std::make_unique<qrk::RenderableNode>();
+  std::vector<qrk::RenderableNode*> nodes = {root.get()};
+  std::vector<std::shared_ptr<NullRenderable>> renderables;
+  for (int i = 1; i < numNodes; i++) {
+    auto node = std::make_unique<qrk::RenderableNode>();
+    node->setModelTransform(randomTransform(rng));
+    renderables.push_back(std::make_shared<NullRenderable>());
+    node->addRenderable(renderables.back());
+    nodes.push_back(node.get());
+    std::uniform_int_distribution<size_t> parentDist(0, nodes.size() - 2);
+    nodes[parentDist(rng)]->addChildNode(std::move(node));
+  }
+
+  NullShader shader;
+  qrk::DrawList drawList(*root);
+  double compileMs = measureMedianMs(1, [&]() { drawList.update(); });
+
+  std::printf("%d nodes, %d passes per frame, %d iterations\n", numNodes,
+              passes, iterations);
+  std::printf("%-22s median %9.3f ms\n", "draw list compile", compileMs);
+
+  auto moveNodes = [&]() {
+    std::uniform_int_distribution<size_t> nodeDist(1, nodes.size() - 1);
+    for (int i = 0; i < numMoving; i++) {
+      nodes[nodeDist(rng)]->setModelTransform(randomTransform(rng));
+    }
+  };
+  auto drawTree = [&]() {
+    for (int i = 0; i < passes; i++) root->draw(shader);
+  };
+  auto drawFlat = [&]() {
+    for (int i = 0; i < passes; i++) drawList.draw(shader);
+  };
+
+  // Warm up.
+  drawTree();
+  drawFlat();
+
+  double treeStaticMs = measureMedianMs(iterations, drawTree);
+  double flatStaticMs = measureMedianMs(iterations, drawFlat);
+  std::printf("%-22s median %9.3f ms\n", "tree, static", treeStaticMs);
+  std::printf("%-22s median %9.3f ms  (%.2fx)\n", "draw list, static",
+              flatStaticMs, treeStaticMs / flatStaticMs);
+
+  // Moving nodes costs the same for both, but only the draw list has to
+  // propagate the change.
+  double treeDynamicMs = measureMedianMs(iterations, [&]() {
+    moveNodes();
+    drawTree();
+  });
+  double flatDynamicMs = measureMedianMs(iterations, [&]() {
+    moveNodes();
+    drawFlat();
+  });
+  std::printf("%-22s median %9.3f ms\n", "tree, dynamic", treeDynamicMs);
+  std::printf("%-22s median %9.3f ms  (%.2fx)\n", "draw list, dynamic",
+              flatDynamicMs, treeDynamicMs / flatDynamicMs);
+
+  // Keep the draws from being optimized away.
+  glm::vec4 sum(0.0f);
+  for (const auto& renderable : renderables) sum += renderable->getSum();
+  std::printf("(checksum %g)\n", sum.x + sum.y + sum.z);
+  return 0;
+}
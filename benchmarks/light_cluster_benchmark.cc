@@ -0,0 +1,168 @@
+// Compares shading every fragment with every light against shading it with only
+// the lights in its cluster, for increasing light counts. Runs the CPU
+// reference of the binning and a minimal point light falloff in place of the
+// GPU passes, so only the cost of culling and the number of lights evaluated
+// are measured.
+
+#include <qrk/bounds.h>
+#include <qrk/light.h>
+#include <qrk/light_clusters.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(int, min_lights, 16, "Number of lights in the first case");
+ABSL_FLAG(int, max_lights, 4096,
+          "Number of lights in the last case; counts double between cases");
+ABSL_FLAG(int, width, 160, "Horizontal number of fragments shaded");
+ABSL_FLAG(int, height, 90, "Vertical number of fragments shaded");
+ABSL_FLAG(int, max_lights_per_cluster, 128,
+          "Lights past this many in a cluster are dropped");
+ABSL_FLAG(int, iterations, 5, "Number of timed runs per case");
+
+namespace {
+
+constexpr float NEAR = 0.1f;
+constexpr float FAR = 100.0f;
+constexpr qrk::Attenuation ATTENUATION = {1.0f, 0.0f, 25.0f};
+
+double measureMedianMs(int iterations, const std::function<void()>& fn) {
+  std::vector<double> samples;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// Returns the view space point at the given NDC coordinates and depth.
+glm::vec3 unproject(const glm::mat4& inverseProjection, glm::vec2 ndc,
+                    float depth) {
+  glm::vec4 point = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+  return glm::vec3(point) / point.w * (depth / NEAR);
+}
+
+// A diffuse point light falloff, for a surface facing the camera.
+float shade(const glm::vec3& fragPos, const glm::vec3& lightPos) {
+  glm::vec3 toLight = lightPos - fragPos;
+  float distance = glm::length(toLight);
+  float falloff = ATTENUATION.constant + ATTENUATION.linear * distance +
+                  ATTENUATION.quadratic * distance * distance;
+  return std::max(toLight.z / distance, 0.0f) / falloff;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const int minLights = std::max(1, absl::GetFlag(FLAGS_min_lights));
+  const int maxLights = std::max(minLights, absl::GetFlag(FLAGS_max_lights));
+  const int width = std::max(1, absl::GetFlag(FLAGS_width));
+  const int height = std::max(1, absl::GetFlag(FLAGS_height));
+  const int iterations = std::max(1, absl::GetFlag(FLAGS_iterations));
+
+  qrk::ClusterGrid grid;
+  grid.maxLightsPerCluster =
+      std::max(1, absl::GetFlag(FLAGS_max_lights_per_cluster));
+  const qrk::ClusterView view = {
+      .projection = glm::perspective(glm::radians(60.0f),
+                                     width / static_cast<float>(height), NEAR,
+                                     FAR),
+      .near = NEAR,
+      .far = FAR,
+  };
+  const glm::mat4 inverseProjection = glm::inverse(view.projection);
+  const std::vector<qrk::BoundingBox> clusterBounds =
+      qrk::computeClusterBounds(grid, view);
+  const float radius = qrk::calculateLightRadius(ATTENUATION, 1.0f);
+
+  // Stand in for a G-buffer, with a fragment at a random depth per pixel.
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> ndcDist(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> logDepthDist(std::log(1.0f),
+                                                     std::log(FAR / 2.0f));
+  std::vector<glm::vec3> fragments;
+  std::vector<unsigned int> fragmentClusters;
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      glm::vec2 ndc((x + 0.5f) / width * 2.0f - 1.0f,
+                    (y + 0.5f) / height * 2.0f - 1.0f);
+      fragments.push_back(
+          unproject(inverseProjection, ndc, std::exp(logDepthDist(rng))));
+      fragmentClusters.push_back(grid.getClusterIndex(
+          qrk::findCluster(grid, view, fragments.back())));
+    }
+  }
+
+  std::printf("%d x %d fragments, %u clusters, light radius %.2f, %d "
+              "iterations\n",
+              width, height, grid.getClusterCount(), radius, iterations);
+  std::printf("%6s %10s %12s %12s %9s %14s %10s\n", "lights", "bin ms",
+              "all ms", "clustered ms", "speedup", "lights/frag", "dropped");
+
+  // Spread lights evenly through the scene's depth, rather than evenly across
+  // slices, so that nearby clusters aren't crowded.
+  std::uniform_real_distribution<float> depthDist(1.0f, FAR / 2.0f);
+  std::vector<qrk::BoundingSphere> lights;
+  for (int numLights = minLights; numLights <= maxLights; numLights *= 2) {
+    while (lights.size() < static_cast<size_t>(numLights)) {
+      glm::vec3 position =
+          unproject(inverseProjection, glm::vec2(ndcDist(rng), ndcDist(rng)),
+                    depthDist(rng));
+      lights.push_back({position, radius});
+    }
+
+    qrk::LightClusterLists lists;
+    double binMs = measureMedianMs(iterations, [&]() {
+      lists = qrk::binLights(grid, clusterBounds, lights);
+    });
+
+    float allSum = 0.0f;
+    double allMs = measureMedianMs(iterations, [&]() {
+      allSum = 0.0f;
+      for (const glm::vec3& fragPos : fragments) {
+        for (const qrk::BoundingSphere& light : lights) {
+          allSum += shade(fragPos, light.center);
+        }
+      }
+    });
+
+    float clusteredSum = 0.0f;
+    size_t lightsEvaluated = 0;
+    double clusteredMs = measureMedianMs(iterations, [&]() {
+      clusteredSum = 0.0f;
+      lightsEvaluated = 0;
+      for (size_t i = 0; i < fragments.size(); i++) {
+        unsigned int cluster = fragmentClusters[i];
+        unsigned int count = lists.counts[cluster];
+        const unsigned int* indices =
+            &lists.indices[cluster * grid.maxLightsPerCluster];
+        for (unsigned int j = 0; j < count; j++) {
+          clusteredSum += shade(fragments[i], lights[indices[j]].center);
+        }
+        lightsEvaluated += count;
+      }
+    });
+
+    // Light beyond the radius, and from lights past full clusters, is dropped.
+    std::printf("%6d %10.3f %12.3f %12.3f %8.2fx %14.1f %9.3f%%\n", numLights,
+                binMs, allMs, clusteredMs, allMs / (binMs + clusteredMs),
+                lightsEvaluated / static_cast<double>(fragments.size()),
+                100.0 * (allSum - clusteredSum) / allSum);
+  }
+  return 0;
+}
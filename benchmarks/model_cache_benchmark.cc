@@ -0,0 +1,121 @@
+// Compares cold model loads (a full Assimp import) against warm loads from the
+// model cache. Only the CPU side of loading is measured; GPU uploads are the
+// same in both cases.
+
+#include <qrk/model.h>
+#include <qrk/model_cache.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(std::string, model,
+          "examples/assets/DamagedHelmet/DamagedHelmet.gltf",
+          "Path to the model file to load");
+ABSL_FLAG(int, iterations, 10, "Number of timed iterations per case");
+
+namespace {
+
+struct Timing {
+  double minMs;
+  double medianMs;
+};
+
+Timing measure(int iterations, const std::function<void()>& fn) {
+  std::vector<double> samples;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return {samples.front(), samples[samples.size() / 2]};
+}
+
+void report(const char* name, const Timing& timing) {
+  std::printf("%-24s min %9.3f ms   median %9.3f ms\n", name, timing.minMs,
+              timing.medianMs);
+}
+
+// Reads every vertex and index, as an upload would. Mapped pages are faulted
+// in lazily, so without this the warm case would be unfairly cheap.
+uint64_t touch(const qrk::ModelDataView& view) {
+  uint64_t checksum = 0;
+  const auto* bytes =
+      reinterpret_cast<const unsigned char*>(view.vertices.data());
+  for (size_t i = 0; i < view.vertices.size_bytes(); i += 64) {
+    checksum += bytes[i];
+  }
+  for (uint32_t index : view.indices) checksum += index;
+  return checksum;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const std::string path = absl::GetFlag(FLAGS_model);
+  const int iterations = std::max(1, absl::GetFlag(FLAGS_iterations));
+
+  // Use a private cache directory so that results are independent of any
+  // existing cache.
+  const std::filesystem::path cacheDir =
+      std::filesystem::temp_directory_path() / "quarkgl_model_cache_benchmark";
+  std::filesystem::remove_all(cacheDir);
+  qrk::ModelCache cache(cacheDir.string());
+
+  std::printf("Model: %s (%d iterations)\n", path.c_str(), iterations);
+
+  qrk::ModelData data;
+  Timing cold = measure(iterations, [&]() {
+    data = qrk::importModelData(path, qrk::DEFAULT_LOAD_FLAGS);
+  });
+  std::printf("%zu vertices, %zu indices, %zu meshes, %zu nodes\n",
+              data.vertices.size(), data.indices.size(), data.meshes.size(),
+              data.nodes.size());
+
+  const qrk::ModelCacheKey key =
+      qrk::computeModelCacheKey(path, qrk::DEFAULT_LOAD_FLAGS);
+  Timing store = measure(1, [&]() {
+    if (!cache.store(key, data)) {
+      std::fprintf(stderr, "Failed to write cache entry\n");
+      std::exit(1);
+    }
+  });
+  std::printf("Cache entry: %s (%ju bytes)\n", cache.getEntryPath(key).c_str(),
+              static_cast<uintmax_t>(
+                  std::filesystem::file_size(cache.getEntryPath(key))));
+
+  uint64_t checksum = 0;
+  Timing warm = measure(iterations, [&]() {
+    // Includes key computation, since a real load has to stat the source.
+    auto mapped =
+        cache.load(qrk::computeModelCacheKey(path, qrk::DEFAULT_LOAD_FLAGS));
+    if (!mapped) {
+      std::fprintf(stderr, "Unexpected cache miss\n");
+      std::exit(1);
+    }
+    checksum += touch(mapped->view());
+  });
+
+  report("cold (Assimp import)", cold);
+  report("cache store", store);
+  report("warm (mapped cache)", warm);
+  std::printf("Speedup (median): %.1fx  [checksum %ju]\n",
+              cold.medianMs / warm.medianMs,
+              static_cast<uintmax_t>(checksum));
+
+  std::filesystem::remove_all(cacheDir);
+  return 0;
+}
@@ -0,0 +1,175 @@
+// Compares preprocessing every shader in quarkgl/shaders and examples/shaders
+// with a std::regex based loader, the way ShaderLoader used to work, against
+// the current line scanner. The scanner is measured both cold (every file read
+// from disk) and warm (every file in the process-wide include cache).
+
+#include <qrk/shader_loader.h>
+#include <qrk/utils.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(int, iterations, 10, "Number of timed runs per case");
+
+namespace {
+
+struct ShaderFile {
+  std::string path;
+  qrk::ShaderType type;
+};
+
+double measureMedianMs(int iterations, const std::function<void()>& fn) {
+  std::vector<double> samples;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// Finds every shader, with its stage taken from its extension. Stage-agnostic
+// includes are loaded as fragment shaders.
+std::vector<ShaderFile> findShaders(const std::vector<std::string>& roots) {
+  std::vector<ShaderFile> shaders;
+  for (const std::string& root : roots) {
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator(root)) {
+      std::string extension = entry.path().extension().string();
+      qrk::ShaderType type;
+      if (extension == ".vert") {
+        type = qrk::ShaderType::VERTEX;
+      } else if (extension == ".frag" || extension == ".glsl") {
+        type = qrk::ShaderType::FRAGMENT;
+      } else if (extension == ".geom") {
+        type = qrk::ShaderType::GEOMETRY;
+      } else if (extension == ".comp") {
+        type = qrk::ShaderType::COMPUTE;
+      } else {
+        continue;
+      }
+      shaders.push_back({entry.path().string(), type});
+    }
+  }
+  std::sort(shaders.begin(), shaders.end(),
+            [](const ShaderFile& a, const ShaderFile& b) {
+              return a.path < b.path;
+            });
+  return shaders;
+}
+
+// The regex based preprocessor that the scanner replaced, reduced to its
+// include handling. Every file is read and matched anew on each load.
+class RegexShaderLoader {
+ public:
+  std::string load(const std::string& shaderPath) {
+    onceCache_.clear();
+    return loadFile(shaderPath);
+  }
+
+ private:
+  std::string loadFile(const std::string& shaderPath) {
+    std::string resolvedPath = qrk::resolvePath(shaderPath);
+    if (onceCache_.contains(resolvedPath)) return "";
+
+    std::ifstream file(shaderPath);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string code = buffer.str();
+
+    std::regex oncePattern(R"(((^|\r?\n)\s*)#pragma\s+once\s*(?=\r?\n|$))");
+    if (std::regex_search(code, oncePattern)) onceCache_.insert(resolvedPath);
+
+    std::regex includePattern(
+        R"(((^|\r?\n)\s*)#pragma\s+qrk_include\s+(".*"|<.*>)(?=\r?\n|$))");
+    std::string out;
+    auto last = code.cbegin();
+    for (std::sregex_iterator it(code.cbegin(), code.cend(), includePattern),
+         end;
+         it != end; ++it) {
+      const std::smatch& m = *it;
+      out.append(last, m[0].first);
+      out += m[1].str();
+
+      std::string include = m[3].str();
+      std::string path = qrk::trim(include.substr(1, include.size() - 2));
+      if (include[0] == '<') {
+        out += loadFile("quarkgl/shaders/" + path);
+      } else {
+        size_t i = shaderPath.find_last_of("/");
+        std::string prefix =
+            i != std::string::npos ? shaderPath.substr(0, i + 1) : "";
+        out += loadFile(prefix + path);
+      }
+      last = m[0].second;
+    }
+    out.append(last, code.cend());
+    return out;
+  }
+
+  std::unordered_set<std::string> onceCache_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const int iterations = std::max(1, absl::GetFlag(FLAGS_iterations));
+
+  std::vector<ShaderFile> shaders =
+      findShaders({"quarkgl/shaders", "examples/shaders"});
+  if (shaders.empty()) {
+    std::fprintf(stderr, "No shaders found; run from the workspace root\n");
+    return 1;
+  }
+
+  size_t regexBytes = 0;
+  double regexMs = measureMedianMs(iterations, [&]() {
+    regexBytes = 0;
+    for (const ShaderFile& shader : shaders) {
+      RegexShaderLoader loader;
+      regexBytes += loader.load(shader.path).size();
+    }
+  });
+
+  size_t scannerBytes = 0;
+  auto loadAll = [&]() {
+    scannerBytes = 0;
+    for (const ShaderFile& shader : shaders) {
+      qrk::ShaderPath source(shader.path.c_str());
+      qrk::ShaderLoader loader(&source, shader.type);
+      scannerBytes += loader.load().size();
+    }
+  };
+  double coldMs = measureMedianMs(iterations, [&]() {
+    qrk::ShaderLoader::clearCache();
+    loadAll();
+  });
+  double warmMs = measureMedianMs(iterations, loadAll);
+
+  std::printf("%zu shaders, %d iterations\n", shaders.size(), iterations);
+  std::printf("%-16s %10s %12s %9s\n", "loader", "total ms", "output KiB",
+              "speedup");
+  std::printf("%-16s %10.3f %12.1f %8.2fx\n", "regex", regexMs,
+              regexBytes / 1024.0, 1.0);
+  std::printf("%-16s %10.3f %12.1f %8.2fx\n", "scanner (cold)", coldMs,
+              scannerBytes / 1024.0, regexMs / coldMs);
+  std::printf("%-16s %10.3f %12.1f %8.2fx\n", "scanner (warm)", warmMs,
+              scannerBytes / 1024.0, regexMs / warmMs);
+  return 0;
+}
@@ -0,0 +1,157 @@
+// Compares loading a model's textures by decoding their source images against
+// loading block-compressed versions from the compressed texture cache, and
+// compares the memory that each takes up once uploaded. Only the CPU side of
+// loading is measured; upload sizes are computed rather than read back from
+// the driver.
+
+#include <qrk/block_compression.h>
+#include <qrk/compressed_texture.h>
+#include <qrk/model.h>
+#include <qrk/texture.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(std::string, model,
+          "examples/assets/DamagedHelmet/DamagedHelmet.gltf",
+          "Path to the model whose textures to load");
+ABSL_FLAG(int, iterations, 5, "Number of timed iterations per case");
+
+namespace {
+
+struct Timing {
+  double minMs;
+  double medianMs;
+};
+
+Timing measure(int iterations, const std::function<void()>& fn) {
+  std::vector<double> samples;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return {samples.front(), samples[samples.size() / 2]};
+}
+
+void report(const char* name, const Timing& timing) {
+  std::printf("%-24s min %9.3f ms   median %9.3f ms\n", name, timing.minMs,
+              timing.medianMs);
+}
+
+// Returns the size of an uncompressed texture once uploaded, including its
+// mips. Drivers pad RGB textures out to RGBA.
+size_t getUploadedSizeBytes(const qrk::ImageData& image) {
+  const int bytesPerPixel = image.numChannels == 3 ? 4 : image.numChannels;
+  size_t size = 0;
+  const int numMips = qrk::calculateNumMips(image.width, image.height);
+  for (int level = 0; level < numMips; level++) {
+    qrk::ImageSize mip =
+        qrk::calculateMipLevel(image.width, image.height, level);
+    size += static_cast<size_t>(mip.width) * mip.height * bytesPerPixel;
+  }
+  return size;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const std::string path = absl::GetFlag(FLAGS_model);
+  const int iterations = std::max(1, absl::GetFlag(FLAGS_iterations));
+
+  // Use a private cache directory so that results are independent of any
+  // existing cache.
+  const std::filesystem::path cacheDir =
+      std::filesystem::temp_directory_path() /
+      "quarkgl_texture_cache_benchmark";
+  std::filesystem::remove_all(cacheDir);
+  const qrk::ModelParams params = {.textureCacheDirectory = cacheDir.string()};
+  const qrk::ModelParams uncompressedParams = {.useCompressedTextures = false};
+
+  // Texture paths are relative to the model's directory, as in Model.
+  const size_t slash = path.find_last_of('/');
+  const std::string directory =
+      slash != std::string::npos ? path.substr(0, slash) : "";
+  std::vector<std::pair<std::string, qrk::TextureMapType>> textures;
+  std::set<std::string> seen;
+  qrk::ModelData data = qrk::importModelData(path);
+  const qrk::ModelDataView view = data.view();
+  for (const qrk::ModelTextureBinding& binding : view.textureBindings) {
+    std::string fullPath =
+        directory + "/" + std::string(view.getTexturePath(binding));
+    if (qrk::isCompressedImagePath(fullPath)) continue;
+    if (seen.insert(fullPath).second) {
+      textures.emplace_back(fullPath, binding.type);
+    }
+  }
+  std::printf("Model: %s (%zu textures, %d iterations)\n", path.c_str(),
+              textures.size(), iterations);
+
+  // Build the cache, like //tools:texture_compressor would.
+  qrk::CompressedTextureCache cache(cacheDir.string());
+  size_t uncompressedBytes = 0;
+  for (const auto& [fullPath, type] : textures) {
+    qrk::ImageData image = qrk::decodeImage(fullPath.c_str());
+    uncompressedBytes += getUploadedSizeBytes(image);
+    const bool isSRGB = qrk::isSRGBTextureMapType(type);
+    const qrk::BlockFormat format =
+        type == qrk::TextureMapType::NORMAL ? qrk::BlockFormat::BC5
+        : image.numChannels == 1            ? qrk::BlockFormat::BC4
+        : image.numChannels == 4            ? qrk::BlockFormat::BC3
+                                            : qrk::BlockFormat::BC1;
+    qrk::CompressedImageData compressed = qrk::compressImage(
+        image.pixels.get(), image.width, image.height, image.numChannels,
+        format, isSRGB, /*generateMips=*/true, /*flippedVertically=*/true);
+    if (!cache.store(qrk::computeCompressedTextureKey(fullPath, isSRGB),
+                     compressed)) {
+      std::fprintf(stderr, "Failed to write cache entry for %s\n",
+                   fullPath.c_str());
+      return 1;
+    }
+  }
+
+  size_t compressedBytes = 0;
+  Timing decode = measure(iterations, [&]() {
+    for (const auto& [fullPath, type] : textures) {
+      qrk::decodeTextureMap(fullPath, type, uncompressedParams);
+    }
+  });
+  Timing load = measure(iterations, [&]() {
+    compressedBytes = 0;
+    for (const auto& [fullPath, type] : textures) {
+      qrk::ImageData image = qrk::decodeTextureMap(fullPath, type, params);
+      if (!image.compressed) {
+        std::fprintf(stderr, "Unexpected cache miss for %s\n",
+                     fullPath.c_str());
+        std::exit(1);
+      }
+      compressedBytes += image.getSizeBytes();
+    }
+  });
+
+  // Uncompressed textures only get their mips once uploaded, so the decode
+  // case doesn't include the cost of generating them.
+  report("decode (stb_image)", decode);
+  report("load (compressed cache)", load);
+  std::printf("Speedup (median): %.1fx\n", decode.medianMs / load.medianMs);
+  std::printf("VRAM with mips: %zu -> %zu bytes (%.1fx smaller)\n",
+              uncompressedBytes, compressedBytes,
+              static_cast<double>(uncompressedBytes) / compressedBytes);
+
+  std::filesystem::remove_all(cacheDir);
+  return 0;
+}
@@ -0,0 +1,140 @@
+// Compares GPU draw times for each ModelVertexFormat on a vertex-fetch-bound
+// workload: a large triangle soup with no vertex reuse, drawn with
+// rasterization disabled and a vertex shader that does little more than read
+// every attribute.
+
+#include <qrk/model.h>
+#include <qrk/shader.h>
+#include <qrk/vertex_format.h>
+#include <qrk/window.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(int, triangles, 2000000, "Number of triangles to draw");
+ABSL_FLAG(int, draws, 10, "Number of draws per timed iteration");
+ABSL_FLAG(int, iterations, 20, "Number of timed iterations per format");
+
+namespace {
+
+constexpr char VERTEX_SHADER[] = R"(
+#version 460 core
+layout(location = 0) in vec3 vertexPos;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec3 vertexTangent;
+layout(location = 3) in vec2 vertexTexCoords;
+
+uniform mat4 model;
+
+void main() {
+  // Fold every attribute into the output so that none are optimized away.
+  vec3 pos = vec3(model * vec4(vertexPos, 1.0));
+  pos += 1e-3 * (vertexNormal + vertexTangent + vec3(vertexTexCoords, 0.0));
+  gl_Position = vec4(pos, 1.0);
+}
+)";
+
+constexpr char FRAGMENT_SHADER[] = R"(
+#version 460 core
+out vec4 fragColor;
+void main() { fragColor = vec4(1.0); }
+)";
+
+std::vector<qrk::ModelVertex> makeTriangleSoup(int numTriangles) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  auto randomVec3 = [&]() {
+    return glm::vec3(dist(rng), dist(rng), dist(rng));
+  };
+
+  std::vector<qrk::ModelVertex> vertices(numTriangles * 3);
+  for (qrk::ModelVertex& vertex : vertices) {
+    vertex.position = randomVec3() * 10.0f;
+    vertex.normal = glm::normalize(randomVec3() + glm::vec3(0.0f, 0.0f, 2.0f));
+    vertex.tangent = glm::normalize(randomVec3() + glm::vec3(2.0f, 0.0f, 0.0f));
+    vertex.texCoords = glm::vec2(dist(rng), dist(rng)) * 0.5f + 0.5f;
+  }
+  return vertices;
+}
+
+const char* getFormatName(qrk::ModelVertexFormat format) {
+  switch (format) {
+    case qrk::ModelVertexFormat::FULL:
+      return "full";
+    case qrk::ModelVertexFormat::COMPACT:
+      return "compact";
+    case qrk::ModelVertexFormat::QUANTIZED:
+      return "quantized";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const int numTriangles = std::max(1, absl::GetFlag(FLAGS_triangles));
+  const int draws = std::max(1, absl::GetFlag(FLAGS_draws));
+  const int iterations = std::max(1, absl::GetFlag(FLAGS_iterations));
+
+  qrk::Window win(256, 256, "Vertex format benchmark");
+  win.disableVsync();
+  // Keep the workload bound on vertex fetch rather than on rasterization.
+  glEnable(GL_RASTERIZER_DISCARD);
+
+  qrk::Shader shader{qrk::ShaderInline(VERTEX_SHADER),
+                     qrk::ShaderInline(FRAGMENT_SHADER)};
+
+  const std::vector<qrk::ModelVertex> vertices =
+      makeTriangleSoup(numTriangles);
+  std::vector<uint32_t> indices(vertices.size());
+  for (uint32_t i = 0; i < indices.size(); i++) indices[i] = i;
+
+  std::printf("%d triangles, %d draws per iteration, %d iterations\n",
+              numTriangles, draws, iterations);
+
+  unsigned int query;
+  glGenQueries(1, &query);
+
+  double fullMedianMs = 0.0;
+  for (auto format :
+       {qrk::ModelVertexFormat::FULL, qrk::ModelVertexFormat::COMPACT,
+        qrk::ModelVertexFormat::QUANTIZED}) {
+    qrk::ModelMesh mesh(vertices, indices, /*textureMaps=*/{},
+                        {.vertexFormat = format});
+    // Warm up.
+    mesh.draw(shader);
+    glFinish();
+
+    std::vector<double> samples;
+    for (int i = 0; i < iterations; i++) {
+      glBeginQuery(GL_TIME_ELAPSED, query);
+      for (int j = 0; j < draws; j++) {
+        mesh.draw(shader);
+      }
+      glEndQuery(GL_TIME_ELAPSED);
+      GLuint64 elapsedNs = 0;
+      glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+      samples.push_back(elapsedNs / 1e6);
+    }
+    std::sort(samples.begin(), samples.end());
+    const double medianMs = samples[samples.size() / 2];
+    if (format == qrk::ModelVertexFormat::FULL) fullMedianMs = medianMs;
+
+    const unsigned int vertexBytes = qrk::getVertexSizeBytes(format);
+    std::printf(
+        "%-10s %2u B/vertex  %7.1f MB  min %8.3f ms  median %8.3f ms  "
+        "(%.2fx)\n",
+        getFormatName(format), vertexBytes,
+        vertices.size() * vertexBytes / (1024.0 * 1024.0), samples.front(),
+        medianMs, fullMedianMs / medianMs);
+  }
+
+  glDeleteQueries(1, &query);
+  return 0;
+}
@@ -95,7 +95,6 @@ int main() {
 
   // Build the G-Buffer and prepare deferred shading.
   qrk::DeferredGeometryPassShader geometryPassShader;
-  geometryPassShader.addUniformSource(camera);
 
   auto gBuffer = std::make_shared<qrk::GBuffer>(win.getSize());
   auto textureRegistry = std::make_shared<qrk::TextureRegistry>();
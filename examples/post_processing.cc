@@ -199,8 +199,6 @@ int main() {
   auto colorAttachment = fb.attachTexture(qrk::BufferType::COLOR);
   fb.attachRenderbuffer(qrk::BufferType::DEPTH_AND_STENCIL);
 
-  screenShader.addUniformSource(win);
-
   printf("Controls:\n");
   printf("- WASD: movement\n");
   printf("- Mouse: camera\n");
@@ -247,7 +245,8 @@ int main() {
     screenShader.activate();
     screenShader.setInt("screenTexture", 0);
     quadVarray.activate();
-    glBindTexture(GL_TEXTURE_2D, colorAttachment.id);
+    qrk::GlState::current().bindTextureToUnit(0, GL_TEXTURE_2D,
+                                              colorAttachment.id);
     win->disableDepthTest();
     glDrawArrays(GL_TRIANGLES, 0, 6);
     win->enableDepthTest();
@@ -1,5 +1,4 @@
 #version 460 core
-#define QRK_MAX_POINT_LIGHTS 32
 #pragma qrk_include < gamma.frag>
 #pragma qrk_include < tone_mapping.frag>
 #pragma qrk_include < standard_lights_pbr.frag>
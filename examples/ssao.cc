@@ -76,13 +76,11 @@ int main() {
 
   // Build the G-Buffer and prepare deferred shading.
   qrk::DeferredGeometryPassShader geometryPassShader;
-  geometryPassShader.addUniformSource(camera);
 
   auto gBuffer = std::make_shared<qrk::GBuffer>(win.getSize());
 
   // Build SSAO buffers.
   qrk::SsaoShader ssaoShader;
-  ssaoShader.addUniformSource(camera);
 
   auto ssaoKernel = std::make_shared<qrk::SsaoKernel>();
   ssaoShader.addUniformSource(ssaoKernel);
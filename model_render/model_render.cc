@@ -3,9 +3,11 @@
 #include <qrk/quarkgl.h>
 // clang-format on
 
+#include <chrono>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <optional>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
@@ -16,6 +18,14 @@
 #include "imgui_impl_opengl3.h"
 
 ABSL_FLAG(std::string, model, "", "Path to a model file");
+ABSL_FLAG(bool, batch_shaders, true,
+          "Build startup shaders together, preprocessing them on worker "
+          "threads and submitting them all before waiting on any");
+ABSL_FLAG(bool, watch_shaders, true,
+          "Reload shaders when their files, or any files they include, change");
+ABSL_FLAG(bool, virtual_textures, false,
+          "Stream diffuse maps that have been tiled (see "
+          "//tools:texture_tiler) in through virtual textures");
 
 const char* lampShaderSource = R"SHADER(
 #version 460 core
@@ -73,11 +83,16 @@ enum class ToneMapping {
 // Options for the model render UI. The defaults here are used at startup.
 struct ModelRenderOptions {
   // Model.
+  char modelPath[256] = "";
+  bool loadModel = false;
+  float modelLoadProgress = 1.0f;
+  std::string modelLoadError;
   glm::quat modelRotation = glm::identity<glm::quat>();
   float modelScale = 1.0f;
 
   // Rendering.
   LightingModel lightingModel = LightingModel::COOK_TORRANCE_GGX;
+  bool clusteredLighting = true;
 
   glm::vec3 directionalDiffuse = glm::vec3(0.5f);
   glm::vec3 directionalSpecular = glm::vec3(0.5f);
@@ -132,6 +147,13 @@ struct ModelRenderOptions {
   int frameDeltasOffset = 0;
   float avgFPS = 0;
   bool enableVsync = true;
+  float lodPixelError = qrk::DEFAULT_LOD_PIXEL_ERROR;
+  bool frustumCulling = true;
+  qrk::CullingStats shadowCulling;
+  qrk::CullingStats geometryCulling;
+  qrk::GlStateStats glStats;
+  qrk::TextureResidencyStats textureStats;
+  std::optional<qrk::VirtualTextureStats> virtualTextureStats;
 };
 
 // Helper to display a little (?) mark which shows a tooltip when hovered.
@@ -187,6 +209,17 @@ void renderImGuiUI(ModelRenderOptions& opts, UIContext ctx) {
   constexpr float IMAGE_BASE_SIZE = 160.0f;
 
   if (ImGui::CollapsingHeader("Model", ImGuiTreeNodeFlags_DefaultOpen)) {
+    ImGui::InputText("Model path", opts.modelPath, sizeof(opts.modelPath));
+    ImGui::SameLine();
+    opts.loadModel = ImGui::Button("Load");
+    if (opts.modelLoadProgress < 1.0f) {
+      ImGui::ProgressBar(opts.modelLoadProgress);
+    }
+    if (!opts.modelLoadError.empty()) {
+      ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s",
+                         opts.modelLoadError.c_str());
+    }
+
     // Perform some shenanigans so that the gizmo rotates along with the
     // camera while still representing the same model rotation.
     glm::quat rotViewSpace =
@@ -228,6 +261,15 @@ void renderImGuiUI(ModelRenderOptions& opts, UIContext ctx) {
                  "Blinn-Phong\0Cook-Torrance GGX\0\0");
     ImGui::SameLine();
     imguiHelpMarker("Which lighting model to use for shading.");
+    ImGui::BeginDisabled(opts.lightingModel !=
+                         LightingModel::COOK_TORRANCE_GGX);
+    ImGui::Checkbox("Clustered lighting", &opts.clusteredLighting);
+    ImGui::SameLine();
+    imguiHelpMarker(
+        "Whether to bin point and spot lights into clusters of the view "
+        "frustum, and only shade each fragment with the lights in its "
+        "cluster. Only supported by Cook-Torrance GGX.");
+    ImGui::EndDisabled();
 
     ImGui::Separator();
     if (ImGui::TreeNode("Directional light")) {
@@ -421,6 +463,58 @@ void renderImGuiUI(ModelRenderOptions& opts, UIContext ctx) {
                      ImVec2(0, 80.0f));
 
     ImGui::Checkbox("Enable VSync", &opts.enableVsync);
+    imguiFloatSlider("LOD pixel error", &opts.lodPixelError, 0.0f, 32.0f,
+                     "%.01f");
+    ImGui::SameLine();
+    imguiHelpMarker(
+        "The largest on-screen error, in pixels, allowed when picking each "
+        "mesh's level of detail. 0 always draws full detail.");
+
+    ImGui::Checkbox("Frustum culling", &opts.frustumCulling);
+    ImGui::Text("Shadow pass: %u drawn, %u culled", opts.shadowCulling.visible,
+                opts.shadowCulling.culled);
+    ImGui::Text("Geometry pass: %u drawn, %u culled",
+                opts.geometryCulling.visible, opts.geometryCulling.culled);
+
+    const qrk::GlStateStats& glStats = opts.glStats;
+    ImGui::Text("Redundant binds skipped: %u", glStats.getTotalSkipped());
+    ImGui::SameLine();
+    imguiHelpMarker("Binds that didn't change GL state, as of last frame.");
+    ImGui::Text("Programs: %u bound, %u skipped", glStats.programBinds,
+                glStats.programBindsSkipped);
+    ImGui::Text("Vertex arrays: %u bound, %u skipped",
+                glStats.vertexArrayBinds, glStats.vertexArrayBindsSkipped);
+    ImGui::Text("Texture units: %u changed, %u skipped",
+                glStats.activeTextureChanges,
+                glStats.activeTextureChangesSkipped);
+    ImGui::Text("Textures: %u bound, %u skipped", glStats.textureBinds,
+                glStats.textureBindsSkipped);
+
+    const qrk::TextureResidencyStats& textureStats = opts.textureStats;
+    constexpr float MB = 1024.0f * 1024.0f;
+    ImGui::Text("Resident textures: %u, %.1f MB (%.1f MB unused)",
+                textureStats.numResident, textureStats.residentBytes / MB,
+                textureStats.unreferencedBytes / MB);
+    ImGui::SameLine();
+    imguiHelpMarker(
+        "Textures shared between loaded models. Unused textures are kept "
+        "until they don't fit in the budget.");
+    ImGui::Text("Texture cache: %.0f%% hit rate, %u evicted",
+                textureStats.getHitRate() * 100.0f, textureStats.evictions);
+
+    if (opts.virtualTextureStats) {
+      const qrk::VirtualTextureStats& vtStats = *opts.virtualTextureStats;
+      ImGui::Text("Virtual textures: %u, %u / %u pages resident",
+                  vtStats.numTextures, vtStats.residentPages,
+                  vtStats.cachePages);
+      ImGui::SameLine();
+      imguiHelpMarker(
+          "Pages of tiled diffuse maps are streamed in as the feedback pass "
+          "requests them, and evicted from the page cache when it's full.");
+      ImGui::Text("Pages: %u requested, %u loading, %u uploaded, %u evicted",
+                  vtStats.requestedPages, vtStats.loadingPages,
+                  vtStats.uploadedPages, vtStats.evictedPages);
+    }
   }
 
   ImGui::EndChild();
@@ -429,18 +523,50 @@ void renderImGuiUI(ModelRenderOptions& opts, UIContext ctx) {
   ImGui::Render();
 }
 
-/** Loads a model based on command line flag, or a default. */
-std::unique_ptr<qrk::Model> loadModelOrDefault() {
+/** Returns the model path from the command line flag, or a default. */
+std::string getModelPathOrDefault() {
   std::string modelPath = absl::GetFlag(FLAGS_model);
 
   if (!modelPath.empty()) {
-    return std::make_unique<qrk::Model>(modelPath.c_str());
+    return modelPath;
   }
 
   // Default to the gltf DamagedHelmet.
-  auto helmet = std::make_unique<qrk::Model>(
-      "examples/assets/DamagedHelmet/DamagedHelmet.gltf");
-  return helmet;
+  return "examples/assets/DamagedHelmet/DamagedHelmet.gltf";
+}
+
+/** Returns the defines that select the lighting pass variant for options. */
+qrk::ShaderDefines getLightingPassDefines(const ModelRenderOptions& opts) {
+  const bool ggx = opts.lightingModel == LightingModel::COOK_TORRANCE_GGX;
+  return qrk::ShaderDefines()
+      .define("LIGHTING_MODEL", static_cast<int>(opts.lightingModel))
+      .defineIf("CLUSTERED_LIGHTING", ggx && opts.clusteredLighting)
+      .defineIf("SHADOW_MAPPING", opts.shadowMapping)
+      .defineIf("SSAO", opts.ssao)
+      .defineIf("USE_IBL", ggx && opts.useIBL);
+}
+
+/**
+ * Prefetches the lighting pass variants that are one UI toggle away from the
+ * options, so that switching features doesn't stall on a compile. Only done
+ * when the driver can compile them in the background.
+ */
+void prefetchLightingPassVariants(qrk::ShaderVariantCache& shaders,
+                                  const ModelRenderOptions& opts) {
+  if (!qrk::ShaderCompiler::isParallelCompileSupported()) return;
+
+  std::vector<ModelRenderOptions> neighbors(5, opts);
+  neighbors[0].lightingModel =
+      opts.lightingModel == LightingModel::BLINN_PHONG
+          ? LightingModel::COOK_TORRANCE_GGX
+          : LightingModel::BLINN_PHONG;
+  neighbors[1].clusteredLighting = !opts.clusteredLighting;
+  neighbors[2].shadowMapping = !opts.shadowMapping;
+  neighbors[3].ssao = !opts.ssao;
+  neighbors[4].useIBL = !opts.useIBL;
+  for (const ModelRenderOptions& neighbor : neighbors) {
+    shaders.prefetch(getLightingPassDefines(neighbor));
+  }
 }
 
 /** Loads a skybox image as a cubemap and generates IBL info. */
@@ -501,6 +627,7 @@ int main(int argc, char** argv) {
   absl::SetProgramUsageMessage(
       "quarkGL model viewer. Usage:\n  model_render --model path/to/model.obj");
   absl::ParseCommandLine(argc, argv);
+  const auto startTime = std::chrono::steady_clock::now();
 
   qrk::Window win(1920, 1080, "Model Render", /* fullscreen */ false,
                   /* samples */ 0);
@@ -555,9 +682,26 @@ int main(int argc, char** argv) {
   auto finalColorAttachment =
       finalFb.attachTexture(qrk::BufferType::COLOR_ALPHA);
 
+  // Build the startup shaders together, up until the first one is needed for
+  // drawing.
+  qrk::ThreadPool shaderPool;
+  std::optional<qrk::ShaderBatch> shaderBatch;
+  if (absl::GetFlag(FLAGS_batch_shaders)) shaderBatch.emplace(shaderPool);
+
   // Build the G-Buffer and prepare deferred shading.
-  qrk::DeferredGeometryPassShader geometryPassShader;
-  geometryPassShader.addUniformSource(camera);
+  // Shaders drawn from the main camera get its transforms from the per-frame
+  // uniform block, which the window writes from the bound camera.
+  // Virtual textures are sampled through their page tables, so the geometry
+  // pass needs a variant that supports them. Declared before the models, which
+  // hold onto its textures.
+  std::unique_ptr<qrk::VirtualTextureSystem> virtualTextures;
+  if (absl::GetFlag(FLAGS_virtual_textures)) {
+    virtualTextures =
+        std::make_unique<qrk::VirtualTextureSystem>(win.getSize());
+  }
+  qrk::DeferredGeometryPassShader geometryPassShader(
+      qrk::ShaderDefines().defineIf("QRK_VIRTUAL_TEXTURES",
+                                    virtualTextures != nullptr));
 
   auto gBuffer = std::make_shared<qrk::GBuffer>(win.getSize());
   auto lightingTextureRegistry = std::make_shared<qrk::TextureRegistry>();
@@ -567,11 +711,19 @@ int main(int argc, char** argv) {
   qrk::ScreenShader gBufferVisShader(
       qrk::ShaderPath("model_render/shaders/gbuffer_vis.frag"));
 
-  qrk::ScreenShader lightingPassShader(
-      qrk::ShaderPath("model_render/shaders/lighting_pass.frag"));
-  lightingPassShader.addUniformSource(camera);
-  lightingPassShader.addUniformSource(lightingTextureRegistry);
-  lightingPassShader.addUniformSource(lightRegistry);
+  // The lighting pass is built in variants, one per combination of features,
+  // so that disabled features cost nothing.
+  qrk::ShaderVariantCache lightingPassShaders(
+      [](const qrk::ShaderDefines& defines) {
+        return std::make_unique<qrk::ScreenShader>(qrk::ShaderPath(
+            "model_render/shaders/lighting_pass.frag", defines));
+      });
+  lightingPassShaders.addUniformSource(lightingTextureRegistry);
+  lightingPassShaders.addUniformSource(lightRegistry);
+
+  // Setup clustered light culling.
+  auto lightClusterPass = std::make_shared<qrk::LightClusterPass>();
+  lightingPassShaders.addUniformSource(lightClusterPass);
 
   // Setup shadow mapping.
   constexpr int SHADOW_MAP_SIZE = 2048;
@@ -582,11 +734,10 @@ int main(int argc, char** argv) {
   qrk::ShadowMapShader shadowShader;
   auto shadowCamera = std::make_shared<qrk::ShadowCamera>(directionalLight);
   shadowShader.addUniformSource(shadowCamera);
-  lightingPassShader.addUniformSource(shadowCamera);
+  lightingPassShaders.addUniformSource(shadowCamera);
 
   // Setup SSAO.
   qrk::SsaoShader ssaoShader;
-  ssaoShader.addUniformSource(camera);
 
   auto ssaoKernel = std::make_shared<qrk::SsaoKernel>();
   ssaoShader.addUniformSource(ssaoKernel);
@@ -634,37 +785,97 @@ int main(int argc, char** argv) {
                                                             CUBEMAP_SIZE);
   auto prefilteredEnvMap = prefilteredEnvMapCalculator->getPrefilteredEnvMap();
   lightingTextureRegistry->addTextureSource(prefilteredEnvMapCalculator);
-  lightingPassShader.addUniformSource(prefilteredEnvMapCalculator);
+  lightingPassShaders.addUniformSource(prefilteredEnvMapCalculator);
 
   auto brdfLUT = std::make_shared<qrk::GGXBrdfIntegrationCalculator>(
       CUBEMAP_SIZE, CUBEMAP_SIZE);
-  {
-    // Only needs to be calculated once up front.
-    qrk::DebugGroup debugGroup("BRDF LUT calculation");
-    brdfLUT->draw();
-  }
   auto brdfIntegrationMap = brdfLUT->getBrdfIntegrationMap();
   lightingTextureRegistry->addTextureSource(brdfLUT);
 
   qrk::SkyboxMesh skybox;
 
-  // Load the actual env map and generate IBL textures.
-  loadSkyboxImage(opts.skyboxImage, skybox, equirectCubemapConverter,
-                  *irradianceCalculator, *prefilteredEnvMapCalculator);
-
   // Prepare some debug shaders.
   qrk::Shader normalShader(
       qrk::ShaderPath("model_render/shaders/model.vert"),
       qrk::ShaderInline(normalShaderSource),
       qrk::ShaderPath("model_render/shaders/model_normals.geom"));
-  normalShader.addUniformSource(camera);
 
   qrk::Shader lampShader(qrk::ShaderPath("model_render/shaders/model.vert"),
                          qrk::ShaderInline(lampShaderSource));
-  lampShader.addUniformSource(camera);
 
-  // Load primary model.
-  std::unique_ptr<qrk::Model> model = loadModelOrDefault();
+  // Build the lighting pass for the startup options up front; other variants
+  // are built as options change.
+  lightingPassShaders.get(getLightingPassDefines(opts));
+
+  if (shaderBatch) {
+    shaderBatch->finish();
+    shaderBatch.reset();
+  }
+
+  // Reload shaders as they're edited. Declared after the shaders, so that it's
+  // destroyed before them.
+  std::optional<qrk::ShaderWatcher> shaderWatcher;
+  if (absl::GetFlag(FLAGS_watch_shaders)) {
+    shaderWatcher.emplace();
+    for (qrk::Shader* shader : std::initializer_list<qrk::Shader*>{
+             &geometryPassShader, &gBufferVisShader, &shadowShader,
+             &ssaoShader, &ssaoBlurShader, &postprocessShader, &fxaaShader,
+             &skyboxShader, &normalShader, &lampShader}) {
+      shaderWatcher->watch(*shader);
+    }
+    shaderWatcher->watch(lightingPassShaders);
+    if (virtualTextures) {
+      shaderWatcher->watch(virtualTextures->getFeedbackShader());
+    }
+  }
+
+  {
+    // Only needs to be calculated once up front.
+    qrk::DebugGroup debugGroup("BRDF LUT calculation");
+    brdfLUT->draw();
+  }
+
+  // Load the actual env map and generate IBL textures.
+  loadSkyboxImage(opts.skyboxImage, skybox, equirectCubemapConverter,
+                  *irradianceCalculator, *prefilteredEnvMapCalculator);
+
+  const qrk::ShaderCompilerStats& shaderStats = qrk::ShaderCompiler::getStats();
+  printf("Shaders: %u compiled in %.1f ms, %u loaded from cache in %.1f ms",
+         shaderStats.programsCompiled, shaderStats.compileMillis,
+         shaderStats.programsLoaded, shaderStats.loadMillis);
+  if (shaderStats.binariesRejected > 0) {
+    printf(" (%u cached binaries rejected)", shaderStats.binariesRejected);
+  }
+  printf("\n");
+
+  // Load primary model. Models are streamed in, so that loading doesn't block
+  // the UI.
+  // Textures are decoded straight into staging memory, so that uploading them
+  // doesn't copy from client memory on this thread. Declared before the
+  // loader, so that it outlives the loader's pending uploads.
+  qrk::StagingRing stagingRing;
+  qrk::ModelLoader modelLoader;
+  // Models share textures, so that switching back to a model reuses what's
+  // still resident.
+  auto textureResidency = std::make_shared<qrk::TextureResidencyManager>();
+  // All of the shaders that draw the model support instancing.
+  const qrk::ModelParams modelParams = {
+      .stagingRing = &stagingRing,
+      .textureResidency = textureResidency,
+      .virtualTextures = virtualTextures.get(),
+      .autoInstance = true,
+      .lodCount = 4};
+  auto lodSelector = std::make_shared<qrk::LodSelector>(camera);
+  std::string modelPath = getModelPathOrDefault();
+  snprintf(opts.modelPath, sizeof(opts.modelPath), "%s", modelPath.c_str());
+  std::shared_ptr<qrk::ModelLoadHandle> modelLoad =
+      modelLoader.load(modelPath.c_str(), modelParams);
+  std::shared_ptr<qrk::Model> model = modelLoad->getModel();
+  model->setLodSelector(lodSelector);
+
+  // The variant that was drawn last frame, to notice when options change.
+  qrk::ShaderDefines prevLightingPassDefines;
+  bool firstFrame = true;
 
   win.enableFaceCull();
   win.loop([&](float deltaTime) {
@@ -689,6 +900,12 @@ int main(int argc, char** argv) {
     opts.numFrameDeltas = win.getNumFrameDeltas();
     opts.frameDeltasOffset = win.getFrameDeltasOffset();
     opts.avgFPS = win.getAvgFPS();
+    opts.glStats = qrk::GlState::current().getLastFrameStats();
+    opts.textureStats = textureResidency->getStats();
+    if (virtualTextures) opts.virtualTextureStats = virtualTextures->getStats();
+
+    opts.modelLoadProgress = modelLoad->getProgress();
+    opts.modelLoadError = modelLoad->getError();
 
     // Render UI.
     UIContext ctx = {
@@ -699,6 +916,15 @@ int main(int argc, char** argv) {
     renderImGuiUI(opts, ctx);
 
     // Post-process options. Some option values are used later during rendering.
+    if (opts.loadModel) {
+      modelLoad = modelLoader.load(opts.modelPath, modelParams);
+      model = modelLoad->getModel();
+      model->setLodSelector(lodSelector);
+    }
+    modelLoader.processUploads();
+    if (shaderWatcher) shaderWatcher->update();
+    lodSelector->setMaxPixelError(opts.lodPixelError);
+    lodSelector->setViewportHeight(win.getSize().height);
     model->setModelTransform(glm::scale(glm::mat4_cast(opts.modelRotation),
                                         glm::vec3(opts.modelScale)));
 
@@ -756,17 +982,36 @@ int main(int argc, char** argv) {
 
       shadowMap->activate();
       shadowMap->clear();
+      shadowShader.setFrustumSource(opts.frustumCulling ? shadowCamera
+                                                        : nullptr);
       shadowShader.updateUniforms();
       model->draw(shadowShader);
+      opts.shadowCulling = shadowShader.getCullingStats();
       shadowMap->deactivate();
     }
 
-    // Step 1: geometry pass. Build the G-Buffer.
+    // Step 1a: optional virtual texture feedback pass. Records which pages of
+    // virtual textures are visible, so that they're streamed in.
+    if (virtualTextures) {
+      qrk::DebugGroup debugGroup("Virtual texture feedback");
+      qrk::VirtualTextureFeedbackShader& feedbackShader =
+          virtualTextures->getFeedbackShader();
+      virtualTextures->beginFeedback();
+      feedbackShader.setFrustumSource(opts.frustumCulling ? camera : nullptr);
+      feedbackShader.updateUniforms();
+      model->draw(feedbackShader);
+      virtualTextures->endFeedback();
+      virtualTextures->update();
+    }
+
+    // Step 1b: geometry pass. Build the G-Buffer.
     {
       qrk::DebugGroup debugGroup("Geometry pass");
       gBuffer->activate();
       gBuffer->clear();
 
+      geometryPassShader.setFrustumSource(opts.frustumCulling ? camera
+                                                              : nullptr);
       geometryPassShader.updateUniforms();
 
       // Draw model.
@@ -774,6 +1019,7 @@ int main(int argc, char** argv) {
         win.enableWireframe();
       }
       model->draw(geometryPassShader);
+      opts.geometryCulling = geometryPassShader.getCullingStats();
       if (opts.wireframe) {
         win.disableWireframe();
       }
@@ -846,18 +1092,29 @@ int main(int argc, char** argv) {
     // Step 2: lighting pass. Draw to the main framebuffer.
     {
       qrk::DebugGroup debugGroup("Deferred lighting pass");
+      const bool clusteredLighting =
+          opts.clusteredLighting &&
+          opts.lightingModel == LightingModel::COOK_TORRANCE_GGX;
+      if (clusteredLighting) {
+        lightClusterPass->cull(*lightRegistry, *camera);
+      }
+
       mainFb.activate();
       mainFb.clear();
 
+      const qrk::ShaderDefines lightingPassDefines =
+          getLightingPassDefines(opts);
+      if (lightingPassDefines != prevLightingPassDefines) {
+        prefetchLightingPassVariants(lightingPassShaders, opts);
+        prevLightingPassDefines = lightingPassDefines;
+      }
+      qrk::Shader& lightingPassShader =
+          lightingPassShaders.get(lightingPassDefines);
+
       // TODO: Set up environment mapping with the skybox.
       lightingPassShader.updateUniforms();
-      lightingPassShader.setBool("shadowMapping", opts.shadowMapping);
       lightingPassShader.setFloat("shadowBiasMin", opts.shadowBiasMin);
       lightingPassShader.setFloat("shadowBiasMax", opts.shadowBiasMax);
-      lightingPassShader.setBool("useIBL", opts.useIBL);
-      lightingPassShader.setBool("ssao", opts.ssao);
-      lightingPassShader.setInt("lightingModel",
-                                static_cast<int>(opts.lightingModel));
       // TODO: Pull this out into a material class.
       lightingPassShader.setVec3("ambient", opts.ambientColor);
       lightingPassShader.setFloat("shininess", opts.shininess);
@@ -951,6 +1208,16 @@ int main(int argc, char** argv) {
       qrk::DebugGroup debugGroup("Imgui pass");
       ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
+
+    if (firstFrame) {
+      // Wait for the GPU, so that the time includes the frame's rendering.
+      glFinish();
+      printf("Time to first frame: %.1f ms\n",
+             std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - startTime)
+                 .count());
+      firstFrame = false;
+    }
   });
 
   // Cleanup.
@@ -1,8 +1,10 @@
 #version 460 core
+#pragma qrk_include < transforms.glsl>
 layout(location = 0) in vec3 vertexPos;
 layout(location = 1) in vec3 vertexNormal;
 layout(location = 2) in vec3 vertexTangent;
 layout(location = 3) in vec2 vertexTexCoords;
+layout(location = 4) in mat4 instanceModel;
 
 // An example simple vertex shader.
 // TODO: Pull this into a base shader.
@@ -15,16 +17,18 @@ out VS_OUT {
 vs_out;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+uniform bool instanced;
 
 uniform bool inverseNormals;
 
 void main() {
-  gl_Position = projection * view * model * vec4(vertexPos, 1.0);
+  mat4 modelView =
+      instanced ? qrk_view * model * instanceModel : qrk_view * model;
+  gl_Position = qrk_projection * modelView * vec4(vertexPos, 1.0);
 
   vs_out.texCoords = vertexTexCoords;
-  vs_out.fragPos = vec3(view * model * vec4(vertexPos, 1.0));
-  vs_out.fragNormal = mat3(transpose(inverse(view * model))) *
+  vs_out.fragPos = vec3(modelView * vec4(vertexPos, 1.0));
+  vs_out.fragNormal = mat3(transpose(inverse(modelView))) *
                       (inverseNormals ? -vertexNormal : vertexNormal);
 }
@@ -0,0 +1,584 @@
+#include <qrk/block_compression.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace qrk {
+namespace {
+constexpr int BLOCK_SIZE = 4;
+constexpr int TEXELS_PER_BLOCK = BLOCK_SIZE * BLOCK_SIZE;
+
+// A block of texels, in RGBA.
+using Block = std::array<std::array<uint8_t, 4>, TEXELS_PER_BLOCK>;
+
+int getNumBlocks(int size) { return (size + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+
+Block fetchBlock(const unsigned char* pixels, int width, int height,
+                 int numChannels, int blockX, int blockY) {
+  Block block;
+  for (int y = 0; y < BLOCK_SIZE; y++) {
+    int sourceY = std::min(blockY * BLOCK_SIZE + y, height - 1);
+    for (int x = 0; x < BLOCK_SIZE; x++) {
+      int sourceX = std::min(blockX * BLOCK_SIZE + x, width - 1);
+      const unsigned char* pixel =
+          pixels + (static_cast<size_t>(sourceY) * width + sourceX) *
+                       numChannels;
+      std::array<uint8_t, 4>& texel = block[y * BLOCK_SIZE + x];
+      for (int c = 0; c < 4; c++) {
+        texel[c] = c < numChannels ? pixel[c] : (c == 3 ? 255 : 0);
+      }
+    }
+  }
+  return block;
+}
+
+void writeUint16(unsigned char* out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+uint16_t readUint16(const unsigned char* in) { return in[0] | (in[1] << 8); }
+
+// ============================== BC1 color ==============================
+
+uint16_t packColor565(const float color[3]) {
+  auto quantize = [](float value, int maxValue) {
+    return static_cast<uint16_t>(std::clamp(
+        static_cast<int>(std::round(value * maxValue / 255.0f)), 0, maxValue));
+  };
+  return (quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5) |
+         quantize(color[2], 31);
+}
+
+std::array<int, 3> unpackColor565(uint16_t color) {
+  int r = (color >> 11) & 31;
+  int g = (color >> 5) & 63;
+  int b = color & 31;
+  return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+// Returns the 4 colors of a block's palette. Only the 4-color mode is used
+// when encoding, but both modes are decoded.
+std::array<std::array<int, 3>, 4> getColorPalette(uint16_t color0,
+                                                  uint16_t color1,
+                                                  bool allowThreeColor) {
+  std::array<std::array<int, 3>, 4> palette;
+  palette[0] = unpackColor565(color0);
+  palette[1] = unpackColor565(color1);
+  for (int c = 0; c < 3; c++) {
+    if (color0 > color1 || !allowThreeColor) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  return palette;
+}
+
+// Picks the nearest palette entry for each texel. Returns the packed indices,
+// and adds the squared error to `error`.
+uint32_t pickColorIndices(const Block& block,
+                          const std::array<std::array<int, 3>, 4>& palette,
+                          int* error) {
+  uint32_t indices = 0;
+  for (int i = 0; i < TEXELS_PER_BLOCK; i++) {
+    int bestIndex = 0;
+    int bestError = std::numeric_limits<int>::max();
+    for (int p = 0; p < 4; p++) {
+      int texelError = 0;
+      for (int c = 0; c < 3; c++) {
+        int d = block[i][c] - palette[p][c];
+        texelError += d * d;
+      }
+      if (texelError < bestError) {
+        bestError = texelError;
+        bestIndex = p;
+      }
+    }
+    indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+    *error += bestError;
+  }
+  return indices;
+}
+
+// Refits the endpoints to the texels, by least squares, given the palette
+// entry that each texel was assigned. Returns false if the fit is degenerate.
+bool refitColorEndpoints(const Block& block, uint32_t indices,
+                         float endpoint0[3], float endpoint1[3]) {
+  // The weight of endpoint 0 for each palette entry.
+  constexpr float WEIGHTS[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[3] = {}, bx[3] = {};
+  for (int i = 0; i < TEXELS_PER_BLOCK; i++) {
+    float a = WEIGHTS[(indices >> (2 * i)) & 3];
+    float b = 1.0f - a;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < 3; c++) {
+      ax[c] += a * block[i][c];
+      bx[c] += b * block[i][c];
+    }
+  }
+  float determinant = aa * bb - ab * ab;
+  if (std::abs(determinant) < 1e-6f) return false;
+  for (int c = 0; c < 3; c++) {
+    endpoint0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f,
+                              255.0f);
+    endpoint1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f,
+                              255.0f);
+  }
+  return true;
+}
+
+// Encodes a block's endpoints and indices in 4-color mode. Returns the
+// squared error.
+int encodeColorEndpoints(const Block& block, const float endpoint0[3],
+                         const float endpoint1[3], unsigned char* out) {
+  uint16_t color0 = packColor565(endpoint0);
+  uint16_t color1 = packColor565(endpoint1);
+  if (color0 < color1) std::swap(color0, color1);
+  int error = 0;
+  uint32_t indices = 0;
+  if (color0 != color1) {
+    indices = pickColorIndices(
+        block, getColorPalette(color0, color1, /*allowThreeColor=*/false),
+        &error);
+  } else {
+    // Equal colors select the 3-color mode, whose index 0 is still color0.
+    std::array<int, 3> color = unpackColor565(color0);
+    for (int i = 0; i < TEXELS_PER_BLOCK; i++) {
+      for (int c = 0; c < 3; c++) {
+        int d = block[i][c] - color[c];
+        error += d * d;
+      }
+    }
+  }
+  writeUint16(out, color0);
+  writeUint16(out + 2, color1);
+  for (int i = 0; i < 4; i++) {
+    out[4 + i] = (indices >> (8 * i)) & 0xFF;
+  }
+  return error;
+}
+
+// Encodes the RGB of a block. Endpoints start at the extremes of the texels
+// along their principal axis, and are then refit to the texels a few times.
+void encodeColorBlock(const Block& block, unsigned char* out) {
+  float mean[3] = {};
+  for (const auto& texel : block) {
+    for (int c = 0; c < 3; c++) mean[c] += texel[c];
+  }
+  for (int c = 0; c < 3; c++) mean[c] /= TEXELS_PER_BLOCK;
+
+  float covariance[6] = {};
+  for (const auto& texel : block) {
+    float d[3] = {texel[0] - mean[0], texel[1] - mean[1], texel[2] - mean[2]};
+    covariance[0] += d[0] * d[0];
+    covariance[1] += d[0] * d[1];
+    covariance[2] += d[0] * d[2];
+    covariance[3] += d[1] * d[1];
+    covariance[4] += d[1] * d[2];
+    covariance[5] += d[2] * d[2];
+  }
+
+  // Find the principal axis by power iteration.
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[3] = {
+        covariance[0] * axis[0] + covariance[1] * axis[1] +
+            covariance[2] * axis[2],
+        covariance[1] * axis[0] + covariance[3] * axis[1] +
+            covariance[4] * axis[2],
+        covariance[2] * axis[0] + covariance[4] * axis[1] +
+            covariance[5] * axis[2],
+    };
+    float length = std::sqrt(next[0] * next[0] + next[1] * next[1] +
+                             next[2] * next[2]);
+    if (length < 1e-6f) break;
+    for (int c = 0; c < 3; c++) axis[c] = next[c] / length;
+  }
+
+  float minProjection = std::numeric_limits<float>::max();
+  float maxProjection = std::numeric_limits<float>::lowest();
+  for (const auto& texel : block) {
+    float projection = 0.0f;
+    for (int c = 0; c < 3; c++) projection += (texel[c] - mean[c]) * axis[c];
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+  float endpoint0[3], endpoint1[3];
+  for (int c = 0; c < 3; c++) {
+    endpoint0[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+    endpoint1[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+  }
+
+  unsigned char best[8];
+  int bestError = encodeColorEndpoints(block, endpoint0, endpoint1, best);
+  for (int iteration = 0; iteration < 2; iteration++) {
+    uint16_t color0 = readUint16(best);
+    uint16_t color1 = readUint16(best + 2);
+    if (color0 == color1) break;
+    uint32_t indices =
+        best[4] | (best[5] << 8) | (best[6] << 16) | (best[7] << 24);
+    if (!refitColorEndpoints(block, indices, endpoint0, endpoint1)) break;
+    unsigned char candidate[8];
+    int error = encodeColorEndpoints(block, endpoint0, endpoint1, candidate);
+    if (error >= bestError) break;
+    bestError = error;
+    std::copy(candidate, candidate + 8, best);
+  }
+  std::copy(best, best + 8, out);
+}
+
+void decodeColorBlock(const unsigned char* in, bool allowThreeColor,
+                      Block& block) {
+  uint16_t color0 = readUint16(in);
+  uint16_t color1 = readUint16(in + 2);
+  auto palette = getColorPalette(color0, color1, allowThreeColor);
+  bool transparentBlack = allowThreeColor && color0 <= color1;
+  for (int i = 0; i < TEXELS_PER_BLOCK; i++) {
+    int index = (in[4 + i / 4] >> (2 * (i % 4))) & 3;
+    for (int c = 0; c < 3; c++) block[i][c] = palette[index][c];
+    block[i][3] = transparentBlack && index == 3 ? 0 : 255;
+  }
+}
+
+// ============================ BC4 channel ============================
+
+// Returns the 8 values of a single-channel block's palette.
+std::array<int, 8> getChannelPalette(int value0, int value1) {
+  std::array<int, 8> palette = {value0, value1};
+  if (value0 > value1) {
+    for (int i = 1; i <= 6; i++) {
+      palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+    }
+  } else {
+    for (int i = 1; i <= 4; i++) {
+      palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  return palette;
+}
+
+// Encodes a block with the given endpoints. Returns the squared error.
+int encodeChannelEndpoints(const uint8_t values[TEXELS_PER_BLOCK], int value0,
+                           int value1, unsigned char* out) {
+  std::array<int, 8> palette = getChannelPalette(value0, value1);
+  uint64_t indices = 0;
+  int error = 0;
+  for (int i = 0; i < TEXELS_PER_BLOCK; i++) {
+    int bestIndex = 0;
+    int bestError = std::numeric_limits<int>::max();
+    for (int p = 0; p < 8; p++) {
+      int d = values[i] - palette[p];
+      if (d * d < bestError) {
+        bestError = d * d;
+        bestIndex = p;
+      }
+    }
+    indices |= static_cast<uint64_t>(bestIndex) << (3 * i);
+    error += bestError;
+  }
+  out[0] = value0;
+  out[1] = value1;
+  for (int i = 0; i < 6; i++) {
+    out[2 + i] = (indices >> (8 * i)) & 0xFF;
+  }
+  return error;
+}
+
+// Encodes a single channel. Both modes are tried: 8 values spanning the
+// block's range, or 6 values spanning the range without any exact 0s and
+// 255s, which get their own entries.
+void encodeChannelBlock(const uint8_t values[TEXELS_PER_BLOCK],
+                        unsigned char* out) {
+  int minValue = 255, maxValue = 0;
+  int minInner = 255, maxInner = 0;
+  for (int i = 0; i < TEXELS_PER_BLOCK; i++) {
+    minValue = std::min<int>(minValue, values[i]);
+    maxValue = std::max<int>(maxValue, values[i]);
+    if (values[i] != 0 && values[i] != 255) {
+      minInner = std::min<int>(minInner, values[i]);
+      maxInner = std::max<int>(maxInner, values[i]);
+    }
+  }
+
+  int error = encodeChannelEndpoints(values, maxValue, minValue, out);
+  if (error == 0 || minInner > maxInner) return;
+  unsigned char candidate[8];
+  if (encodeChannelEndpoints(values, minInner, maxInner, candidate) < error) {
+    std::copy(candidate, candidate + 8, out);
+  }
+}
+
+void encodeChannelBlock(const Block& block, int channel, unsigned char* out) {
+  uint8_t values[TEXELS_PER_BLOCK];
+  for (int i = 0; i < TEXELS_PER_BLOCK; i++) values[i] = block[i][channel];
+  encodeChannelBlock(values, out);
+}
+
+void decodeChannelBlock(const unsigned char* in, int channel, Block& block) {
+  std::array<int, 8> palette = getChannelPalette(in[0], in[1]);
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; i++) {
+    indices |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+  }
+  for (int i = 0; i < TEXELS_PER_BLOCK; i++) {
+    block[i][channel] = palette[(indices >> (3 * i)) & 7];
+  }
+}
+
+// ============================== Flipping ==============================
+
+// Reverses the first numRows rows of BC1 color indices.
+void flipColorIndices(unsigned char* in, int numRows) {
+  std::reverse(in + 4, in + 4 + numRows);
+}
+
+// Reverses the first numRows rows of BC4 channel indices.
+void flipChannelIndices(unsigned char* in, int numRows) {
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; i++) {
+    indices |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+  }
+  // Each row is 4 3-bit indices.
+  uint64_t rows[BLOCK_SIZE];
+  for (int row = 0; row < BLOCK_SIZE; row++) {
+    rows[row] = (indices >> (12 * row)) & 0xFFF;
+  }
+  std::reverse(rows, rows + numRows);
+  indices = 0;
+  for (int row = 0; row < BLOCK_SIZE; row++) {
+    indices |= rows[row] << (12 * row);
+  }
+  for (int i = 0; i < 6; i++) {
+    in[2 + i] = (indices >> (8 * i)) & 0xFF;
+  }
+}
+}  // namespace
+
+const char* blockFormatToString(BlockFormat format) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return "BC1";
+    case BlockFormat::BC3:
+      return "BC3";
+    case BlockFormat::BC4:
+      return "BC4";
+    case BlockFormat::BC5:
+      return "BC5";
+    case BlockFormat::BC7:
+      return "BC7";
+  }
+  throw BlockCompressionException(
+      "ERROR::BLOCK_COMPRESSION::INVALID_FORMAT\n" +
+      std::to_string(static_cast<int>(format)));
+}
+
+size_t getBlockSizeBytes(BlockFormat format) {
+  switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC4:
+      return 8;
+    case BlockFormat::BC3:
+    case BlockFormat::BC5:
+    case BlockFormat::BC7:
+      return 16;
+  }
+  throw BlockCompressionException(
+      "ERROR::BLOCK_COMPRESSION::INVALID_FORMAT\n" +
+      std::to_string(static_cast<int>(format)));
+}
+
+size_t getCompressedSizeBytes(BlockFormat format, int width, int height) {
+  return static_cast<size_t>(getNumBlocks(width)) * getNumBlocks(height) *
+         getBlockSizeBytes(format);
+}
+
+int getNumChannels(BlockFormat format) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return 3;
+    case BlockFormat::BC4:
+      return 1;
+    case BlockFormat::BC5:
+      return 2;
+    case BlockFormat::BC3:
+    case BlockFormat::BC7:
+      return 4;
+  }
+  throw BlockCompressionException(
+      "ERROR::BLOCK_COMPRESSION::INVALID_FORMAT\n" +
+      std::to_string(static_cast<int>(format)));
+}
+
+std::vector<unsigned char> encodeBlocks(BlockFormat format,
+                                        const unsigned char* pixels,
+                                        int width, int height,
+                                        int numChannels) {
+  if (format == BlockFormat::BC7) {
+    throw BlockCompressionException(
+        "ERROR::BLOCK_COMPRESSION::UNSUPPORTED_FORMAT\n"
+        "BC7 can't be encoded");
+  }
+  if (numChannels < 1 || numChannels > 4) {
+    throw BlockCompressionException(
+        "ERROR::BLOCK_COMPRESSION::UNSUPPORTED_CHANNELS\n" +
+        std::to_string(numChannels));
+  }
+
+  const size_t blockBytes = getBlockSizeBytes(format);
+  std::vector<unsigned char> blocks(
+      getCompressedSizeBytes(format, width, height));
+  unsigned char* out = blocks.data();
+  for (int blockY = 0; blockY < getNumBlocks(height); blockY++) {
+    for (int blockX = 0; blockX < getNumBlocks(width); blockX++) {
+      Block block =
+          fetchBlock(pixels, width, height, numChannels, blockX, blockY);
+      switch (format) {
+        case BlockFormat::BC1:
+          encodeColorBlock(block, out);
+          break;
+        case BlockFormat::BC3:
+          encodeChannelBlock(block, /*channel=*/3, out);
+          encodeColorBlock(block, out + 8);
+          break;
+        case BlockFormat::BC4:
+          encodeChannelBlock(block, /*channel=*/0, out);
+          break;
+        case BlockFormat::BC5:
+          encodeChannelBlock(block, /*channel=*/0, out);
+          encodeChannelBlock(block, /*channel=*/1, out + 8);
+          break;
+        case BlockFormat::BC7:
+          break;
+      }
+      out += blockBytes;
+    }
+  }
+  return blocks;
+}
+
+std::vector<unsigned char> decodeBlocks(BlockFormat format,
+                                        const unsigned char* blocks, int width,
+                                        int height) {
+  if (format == BlockFormat::BC7) {
+    throw BlockCompressionException(
+        "ERROR::BLOCK_COMPRESSION::UNSUPPORTED_FORMAT\n"
+        "BC7 can't be decoded");
+  }
+
+  const size_t blockBytes = getBlockSizeBytes(format);
+  std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+  const unsigned char* in = blocks;
+  for (int blockY = 0; blockY < getNumBlocks(height); blockY++) {
+    for (int blockX = 0; blockX < getNumBlocks(width); blockX++) {
+      Block block = {};
+      for (auto& texel : block) texel[3] = 255;
+      switch (format) {
+        case BlockFormat::BC1:
+          decodeColorBlock(in, /*allowThreeColor=*/true, block);
+          break;
+        case BlockFormat::BC3:
+          decodeColorBlock(in + 8, /*allowThreeColor=*/false, block);
+          decodeChannelBlock(in, /*channel=*/3, block);
+          break;
+        case BlockFormat::BC4:
+          decodeChannelBlock(in, /*channel=*/0, block);
+          break;
+        case BlockFormat::BC5:
+          decodeChannelBlock(in, /*channel=*/0, block);
+          decodeChannelBlock(in + 8, /*channel=*/1, block);
+          break;
+        case BlockFormat::BC7:
+          break;
+      }
+      in += blockBytes;
+
+      for (int y = 0; y < BLOCK_SIZE; y++) {
+        int pixelY = blockY * BLOCK_SIZE + y;
+        if (pixelY >= height) break;
+        for (int x = 0; x < BLOCK_SIZE; x++) {
+          int pixelX = blockX * BLOCK_SIZE + x;
+          if (pixelX >= width) break;
+          std::copy(block[y * BLOCK_SIZE + x].begin(),
+                    block[y * BLOCK_SIZE + x].end(),
+                    pixels.begin() +
+                        (static_cast<size_t>(pixelY) * width + pixelX) * 4);
+        }
+      }
+    }
+  }
+  return pixels;
+}
+
+void flipBlocksVertically(BlockFormat format, unsigned char* blocks,
+                          int width, int height) {
+  if (format == BlockFormat::BC7) {
+    throw BlockCompressionException(
+        "ERROR::BLOCK_COMPRESSION::UNSUPPORTED_FORMAT\n"
+        "BC7 can't be flipped");
+  }
+
+  // Flip the texel rows within each block, then the order of block rows.
+  const int numRows = std::min(height, BLOCK_SIZE);
+  const size_t blockBytes = getBlockSizeBytes(format);
+  const size_t rowBytes = getNumBlocks(width) * blockBytes;
+  const int numBlockRows = getNumBlocks(height);
+  for (int blockY = 0; blockY < numBlockRows; blockY++) {
+    for (int blockX = 0; blockX < getNumBlocks(width); blockX++) {
+      unsigned char* block = blocks + blockY * rowBytes + blockX * blockBytes;
+      switch (format) {
+        case BlockFormat::BC1:
+          flipColorIndices(block, numRows);
+          break;
+        case BlockFormat::BC3:
+          flipChannelIndices(block, numRows);
+          flipColorIndices(block + 8, numRows);
+          break;
+        case BlockFormat::BC4:
+          flipChannelIndices(block, numRows);
+          break;
+        case BlockFormat::BC5:
+          flipChannelIndices(block, numRows);
+          flipChannelIndices(block + 8, numRows);
+          break;
+        case BlockFormat::BC7:
+          break;
+      }
+    }
+  }
+  for (int blockY = 0; blockY < numBlockRows / 2; blockY++) {
+    unsigned char* top = blocks + blockY * rowBytes;
+    unsigned char* bottom = blocks + (numBlockRows - 1 - blockY) * rowBytes;
+    std::swap_ranges(top, top + rowBytes, bottom);
+  }
+}
+
+double computePsnr(const unsigned char* original, int numChannels,
+                   const unsigned char* decoded, int width, int height,
+                   int numComparedChannels) {
+  double squaredError = 0.0;
+  const size_t numPixels = static_cast<size_t>(width) * height;
+  for (size_t i = 0; i < numPixels; i++) {
+    for (int c = 0; c < numComparedChannels; c++) {
+      double d = static_cast<double>(original[i * numChannels + c]) -
+                 decoded[i * 4 + c];
+      squaredError += d * d;
+    }
+  }
+  if (squaredError == 0.0) return std::numeric_limits<double>::infinity();
+  double meanSquaredError = squaredError / (numPixels * numComparedChannels);
+  return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+}  // namespace qrk
@@ -0,0 +1,67 @@
+#ifndef QUARKGL_BLOCK_COMPRESSION_H_
+#define QUARKGL_BLOCK_COMPRESSION_H_
+
+#include <qrk/exceptions.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace qrk {
+
+class BlockCompressionException : public QuarkException {
+  using QuarkException::QuarkException;
+};
+
+// The GPU block compression formats. Each compresses every 4x4 block of texels
+// into a fixed number of bytes, which the GPU samples from directly.
+enum class BlockFormat {
+  // RGB in 8 bytes per block, i.e. 4 bits per texel.
+  BC1 = 0,
+  // RGBA in 16 bytes per block; BC1 color with BC4 alpha.
+  BC3,
+  // A single channel in 8 bytes per block.
+  BC4,
+  // Two channels in 16 bytes per block, each compressed like BC4. Suited to
+  // normal maps, which only need X and Y.
+  BC5,
+  // RGBA in 16 bytes per block, at a higher quality than BC1 and BC3. Can be
+  // loaded, but not encoded or decoded on the CPU.
+  BC7,
+};
+
+const char* blockFormatToString(BlockFormat format);
+// Returns the number of bytes in each compressed block.
+size_t getBlockSizeBytes(BlockFormat format);
+// Returns the number of bytes of an image of the given size.
+size_t getCompressedSizeBytes(BlockFormat format, int width, int height);
+// Returns the number of channels that the format stores.
+int getNumChannels(BlockFormat format);
+
+// Compresses an 8-bit image with 1 to 4 channels. Missing channels read like
+// they do from a texture, i.e. as 0, or as 1 for alpha. Edge blocks of images
+// whose size isn't a multiple of 4 repeat the last row and column.
+std::vector<unsigned char> encodeBlocks(BlockFormat format,
+                                        const unsigned char* pixels,
+                                        int width, int height,
+                                        int numChannels);
+
+// Decompresses an image into 8-bit RGBA, as the GPU would sample it.
+std::vector<unsigned char> decodeBlocks(BlockFormat format,
+                                        const unsigned char* blocks, int width,
+                                        int height);
+
+// Flips a compressed image vertically, in place, without decompressing it.
+// Exact for images whose height is a multiple of 4, or less than 4.
+void flipBlocksVertically(BlockFormat format, unsigned char* blocks,
+                          int width, int height);
+
+// Returns the peak signal-to-noise ratio, in dB, between the first
+// numComparedChannels channels of an image and its decoded RGBA version.
+// Returns infinity for identical images.
+double computePsnr(const unsigned char* original, int numChannels,
+                   const unsigned char* decoded, int width, int height,
+                   int numComparedChannels);
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <qrk/block_compression.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// A smooth gradient with some noise, like a typical texture.
+std::vector<unsigned char> makeImage(int width, int height, int numChannels) {
+  std::vector<unsigned char> pixels(width * height * numChannels);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      for (int c = 0; c < numChannels; c++) {
+        int value = (x * 255 / width + y * 128 / height + c * 60 +
+                     ((x * 7 + y * 13 + c * 3) % 11)) %
+                    256;
+        pixels[(y * width + x) * numChannels + c] = value;
+      }
+    }
+  }
+  return pixels;
+}
+
+double roundTripPsnr(qrk::BlockFormat format, int numChannels) {
+  constexpr int width = 64, height = 32;
+  std::vector<unsigned char> pixels = makeImage(width, height, numChannels);
+  std::vector<unsigned char> blocks =
+      qrk::encodeBlocks(format, pixels.data(), width, height, numChannels);
+  EXPECT_EQ(blocks.size(),
+            qrk::getCompressedSizeBytes(format, width, height));
+  std::vector<unsigned char> decoded =
+      qrk::decodeBlocks(format, blocks.data(), width, height);
+  return qrk::computePsnr(pixels.data(), numChannels, decoded.data(), width,
+                          height, numChannels);
+}
+
+TEST(BlockCompressionTest, GetsCompressedSizes) {
+  EXPECT_EQ(qrk::getCompressedSizeBytes(qrk::BlockFormat::BC1, 16, 16), 128);
+  EXPECT_EQ(qrk::getCompressedSizeBytes(qrk::BlockFormat::BC3, 16, 16), 256);
+  // Partial blocks still take up a whole block.
+  EXPECT_EQ(qrk::getCompressedSizeBytes(qrk::BlockFormat::BC4, 5, 1), 16);
+  EXPECT_EQ(qrk::getCompressedSizeBytes(qrk::BlockFormat::BC5, 1, 1), 16);
+}
+
+TEST(BlockCompressionTest, RoundTripsWithinQuality) {
+  EXPECT_GT(roundTripPsnr(qrk::BlockFormat::BC1, 3), 30.0);
+  EXPECT_GT(roundTripPsnr(qrk::BlockFormat::BC3, 4), 30.0);
+  EXPECT_GT(roundTripPsnr(qrk::BlockFormat::BC4, 1), 38.0);
+  EXPECT_GT(roundTripPsnr(qrk::BlockFormat::BC5, 2), 38.0);
+}
+
+TEST(BlockCompressionTest, RoundTripsExactValues) {
+  // 565 colors, and single channels that only use 0 and 255 besides two
+  // values, are represented exactly.
+  constexpr int width = 4, height = 4;
+  std::vector<unsigned char> pixels(width * height * 4);
+  for (int i = 0; i < width * height; i++) {
+    pixels[i * 4 + 0] = 0xF7;
+    pixels[i * 4 + 1] = 0x82;
+    pixels[i * 4 + 2] = 0x00;
+    pixels[i * 4 + 3] = i % 4 == 0 ? 0 : (i % 4 == 1 ? 255 : 100 + i % 2);
+  }
+  std::vector<unsigned char> blocks = qrk::encodeBlocks(
+      qrk::BlockFormat::BC3, pixels.data(), width, height, 4);
+  std::vector<unsigned char> decoded =
+      qrk::decodeBlocks(qrk::BlockFormat::BC3, blocks.data(), width, height);
+  EXPECT_EQ(decoded, pixels);
+}
+
+TEST(BlockCompressionTest, FillsMissingChannels) {
+  std::vector<unsigned char> pixels(8 * 8, 200);
+  std::vector<unsigned char> blocks =
+      qrk::encodeBlocks(qrk::BlockFormat::BC3, pixels.data(), 8, 8, 1);
+  std::vector<unsigned char> decoded =
+      qrk::decodeBlocks(qrk::BlockFormat::BC3, blocks.data(), 8, 8);
+  EXPECT_NEAR(decoded[0], 200, 4);
+  EXPECT_EQ(decoded[1], 0);
+  EXPECT_EQ(decoded[2], 0);
+  EXPECT_EQ(decoded[3], 255);
+}
+
+TEST(BlockCompressionTest, FlipsLikeTheDecodedImage) {
+  for (qrk::BlockFormat format :
+       {qrk::BlockFormat::BC1, qrk::BlockFormat::BC3, qrk::BlockFormat::BC4,
+        qrk::BlockFormat::BC5}) {
+    for (int height : {2, 16}) {
+      constexpr int width = 8;
+      int numChannels = qrk::getNumChannels(format);
+      std::vector<unsigned char> pixels =
+          makeImage(width, height, numChannels);
+      std::vector<unsigned char> blocks = qrk::encodeBlocks(
+          format, pixels.data(), width, height, numChannels);
+      std::vector<unsigned char> decoded =
+          qrk::decodeBlocks(format, blocks.data(), width, height);
+
+      qrk::flipBlocksVertically(format, blocks.data(), width, height);
+      std::vector<unsigned char> flipped =
+          qrk::decodeBlocks(format, blocks.data(), width, height);
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width * 4; x++) {
+          ASSERT_EQ(flipped[y * width * 4 + x],
+                    decoded[(height - 1 - y) * width * 4 + x])
+              << qrk::blockFormatToString(format) << " height " << height;
+        }
+      }
+    }
+  }
+}
+
+TEST(BlockCompressionTest, ComputesPsnr) {
+  std::vector<unsigned char> original = {10, 20, 30, 255};
+  std::vector<unsigned char> decoded = {10, 20, 30, 0};
+  // Only compared channels count.
+  EXPECT_TRUE(std::isinf(qrk::computePsnr(original.data(), 4, decoded.data(),
+                                          1, 1, 3)));
+  decoded[0] = 11;
+  EXPECT_NEAR(qrk::computePsnr(original.data(), 4, decoded.data(), 1, 1, 3),
+              10.0 * std::log10(255.0 * 255.0 * 3), 1e-9);
+}
+
+}  // namespace
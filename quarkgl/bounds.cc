@@ -0,0 +1,125 @@
+#include <qrk/bounds.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace qrk {
+namespace {
+glm::vec3 getPosition(const float* positions, size_t strideBytes,
+                      size_t vertex) {
+  const float* p = reinterpret_cast<const float*>(
+      reinterpret_cast<const char*>(positions) + vertex * strideBytes);
+  return glm::vec3(p[0], p[1], p[2]);
+}
+}  // namespace
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+  // GLM matrices are column-major, so each row is a column index.
+  auto row = [&](int i) {
+    return glm::vec4(viewProjection[0][i], viewProjection[1][i],
+                     viewProjection[2][i], viewProjection[3][i]);
+  };
+  // Left, right, bottom, top, near, far.
+  planes_[0] = row(3) + row(0);
+  planes_[1] = row(3) - row(0);
+  planes_[2] = row(3) + row(1);
+  planes_[3] = row(3) - row(1);
+  planes_[4] = row(3) + row(2);
+  planes_[5] = row(3) - row(2);
+  for (glm::vec4& plane : planes_) {
+    float length = glm::length(glm::vec3(plane));
+    if (length > 0.0f) plane /= length;
+  }
+}
+
+bool Frustum::intersects(const BoundingBox& box) const {
+  if (box.isEmpty()) return false;
+  const glm::vec3 center = box.getCenter();
+  const glm::vec3 extents = box.getExtents();
+  for (const glm::vec4& plane : planes_) {
+    const glm::vec3 normal(plane);
+    // The box's projected radius onto the plane's normal.
+    const float radius = glm::dot(glm::abs(normal), extents);
+    if (glm::dot(normal, center) + plane.w + radius < 0.0f) return false;
+  }
+  return true;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+  for (const glm::vec4& plane : planes_) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Frustum Frustum::toLocalSpace(const glm::mat4& transform) const {
+  Frustum local = *this;
+  for (glm::vec4& plane : local.planes_) {
+    // Planes transform as row vectors: dot(plane, M * p) == dot(plane * M, p).
+    plane = plane * transform;
+    float length = glm::length(glm::vec3(plane));
+    if (length > 0.0f) plane /= length;
+  }
+  return local;
+}
+
+BoundingBox computeBoundingBox(const float* positions, size_t vertexCount,
+                               size_t positionStrideBytes) {
+  BoundingBox box;
+  for (size_t i = 0; i < vertexCount; i++) {
+    box.expand(getPosition(positions, positionStrideBytes, i));
+  }
+  return box;
+}
+
+BoundingSphere computeBoundingSphere(const float* positions,
+                                     size_t vertexCount,
+                                     size_t positionStrideBytes) {
+  if (vertexCount == 0) return {};
+  BoundingSphere sphere = {
+      .center = computeBoundingBox(positions, vertexCount, positionStrideBytes)
+                    .getCenter(),
+  };
+  float radiusSquared = 0.0f;
+  for (size_t i = 0; i < vertexCount; i++) {
+    glm::vec3 offset =
+        getPosition(positions, positionStrideBytes, i) - sphere.center;
+    radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+  }
+  sphere.radius = std::sqrt(radiusSquared);
+  return sphere;
+}
+
+float getMaxScale(const glm::mat4& transform) {
+  return std::sqrt(std::max({
+      glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+      glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+      glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])),
+  }));
+}
+
+BoundingBox transformBoundingBox(const BoundingBox& box,
+                                 const glm::mat4& transform) {
+  if (box.isEmpty()) return box;
+  // Transform the center, and take the extents' projection onto each axis
+  // (Arvo, "Transforming Axis-Aligned Bounding Boxes").
+  const glm::vec3 center =
+      glm::vec3(transform * glm::vec4(box.getCenter(), 1.0f));
+  const glm::mat3 linear(transform);
+  const glm::vec3 extents = glm::mat3(glm::abs(linear[0]), glm::abs(linear[1]),
+                                      glm::abs(linear[2])) *
+                            box.getExtents();
+  return {.min = center - extents, .max = center + extents};
+}
+
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere,
+                                       const glm::mat4& transform) {
+  return {
+      .center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f)),
+      .radius = sphere.radius * getMaxScale(transform),
+  };
+}
+
+}  // namespace qrk
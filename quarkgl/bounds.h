@@ -0,0 +1,97 @@
+#ifndef QUARKGL_BOUNDS_H_
+#define QUARKGL_BOUNDS_H_
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <limits>
+
+namespace qrk {
+
+struct BoundingSphere {
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = 0.0f;
+};
+
+// An axis-aligned bounding box. Default-constructed boxes are empty, and
+// bound nothing.
+struct BoundingBox {
+  glm::vec3 min = glm::vec3(std::numeric_limits<float>::infinity());
+  glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+
+  bool isEmpty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+  glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+  glm::vec3 getExtents() const { return (max - min) * 0.5f; }
+
+  void expand(const glm::vec3& point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+  void merge(const BoundingBox& other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+  }
+};
+
+// A view frustum, as six inward-facing planes.
+class Frustum {
+ public:
+  // Extracts the frustum's planes from a combined view-projection transform
+  // (Gribb and Hartmann, "Fast Extraction of Viewing Frustum Planes from the
+  // World-View-Projection Matrix"). Bounds tested against the frustum must be
+  // in the space that the transform maps from, usually world space.
+  explicit Frustum(const glm::mat4& viewProjection);
+
+  // Returns whether the bounds are at least partially inside the frustum.
+  // Both tests are conservative: bounds near the frustum's corners may be
+  // reported as intersecting when they're actually outside.
+  bool intersects(const BoundingBox& box) const;
+  bool intersects(const BoundingSphere& sphere) const;
+
+  // Returns the frustum in the space that the given affine transform maps
+  // from, so that bounds in that space can be tested without transforming
+  // each of them.
+  Frustum toLocalSpace(const glm::mat4& transform) const;
+
+ private:
+  // Each plane is (normal, distance), with dot(normal, p) + distance >= 0 for
+  // points inside.
+  glm::vec4 planes_[6];
+};
+
+// An interface for anything that can provide a frustum to cull against, such
+// as a camera.
+class FrustumSource {
+ public:
+  virtual Frustum getFrustum() const = 0;
+};
+
+// Computes the bounding box of the given positions. Positions are read as 3
+// floats every positionStrideBytes bytes.
+BoundingBox computeBoundingBox(const float* positions, size_t vertexCount,
+                               size_t positionStrideBytes);
+
+// Computes a sphere that bounds the given positions, centered on their
+// bounding box. Positions are read as 3 floats every positionStrideBytes
+// bytes.
+BoundingSphere computeBoundingSphere(const float* positions,
+                                     size_t vertexCount,
+                                     size_t positionStrideBytes);
+
+// Returns the largest factor by which the transform scales any axis.
+float getMaxScale(const glm::mat4& transform);
+
+// Returns the bounding box of an affine-transformed box. Empty boxes stay
+// empty.
+BoundingBox transformBoundingBox(const BoundingBox& box,
+                                 const glm::mat4& transform);
+
+// Transforms a bounding sphere by an affine transform. Non-uniform scales grow
+// the sphere to fit their largest axis.
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere,
+                                       const glm::mat4& transform);
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <qrk/bounds.h>
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+namespace {
+
+qrk::BoundingBox makeBox(glm::vec3 min, glm::vec3 max) {
+  return {.min = min, .max = max};
+}
+
+// A camera at the origin looking down -Z.
+qrk::Frustum makePerspectiveFrustum() {
+  glm::mat4 projection =
+      glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  return qrk::Frustum(projection * view);
+}
+
+TEST(BoundsTest, ComputesBoundsOfPositions) {
+  std::vector<glm::vec3> positions = {
+      {-1.0f, 0.0f, 2.0f}, {3.0f, -2.0f, 0.0f}, {1.0f, 2.0f, 1.0f}};
+  auto box = qrk::computeBoundingBox(&positions[0].x, positions.size(),
+                                     sizeof(glm::vec3));
+  EXPECT_EQ(box.min, glm::vec3(-1.0f, -2.0f, 0.0f));
+  EXPECT_EQ(box.max, glm::vec3(3.0f, 2.0f, 2.0f));
+
+  auto sphere = qrk::computeBoundingSphere(&positions[0].x, positions.size(),
+                                           sizeof(glm::vec3));
+  EXPECT_EQ(sphere.center, glm::vec3(1.0f, 0.0f, 1.0f));
+  for (const glm::vec3& p : positions) {
+    EXPECT_LE(glm::length(p - sphere.center), sphere.radius + 1e-5f);
+  }
+}
+
+TEST(BoundsTest, DefaultBoxIsEmpty) {
+  qrk::BoundingBox box;
+  EXPECT_TRUE(box.isEmpty());
+  EXPECT_TRUE(qrk::transformBoundingBox(box, glm::mat4(2.0f)).isEmpty());
+
+  box.expand(glm::vec3(1.0f));
+  EXPECT_FALSE(box.isEmpty());
+  EXPECT_EQ(box.min, box.max);
+}
+
+TEST(BoundsTest, TransformsBox) {
+  auto box = makeBox(glm::vec3(-1.0f), glm::vec3(1.0f));
+  glm::mat4 transform =
+      glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 0.0f, 0.0f)) *
+      glm::rotate(glm::mat4(1.0f), glm::radians(45.0f),
+                  glm::vec3(0.0f, 0.0f, 1.0f)) *
+      glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+  auto transformed = qrk::transformBoundingBox(box, transform);
+
+  const float halfDiagonal = 2.0f * std::sqrt(2.0f);
+  EXPECT_NEAR(transformed.min.x, 10.0f - halfDiagonal, 1e-4f);
+  EXPECT_NEAR(transformed.max.x, 10.0f + halfDiagonal, 1e-4f);
+  EXPECT_NEAR(transformed.min.y, -halfDiagonal, 1e-4f);
+  EXPECT_NEAR(transformed.max.y, halfDiagonal, 1e-4f);
+  EXPECT_NEAR(transformed.min.z, -2.0f, 1e-4f);
+  EXPECT_NEAR(transformed.max.z, 2.0f, 1e-4f);
+}
+
+TEST(BoundsTest, TransformsSphereByLargestScale) {
+  qrk::BoundingSphere sphere = {.center = glm::vec3(1.0f), .radius = 1.0f};
+  auto transformed = qrk::transformBoundingSphere(
+      sphere, glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 3.0f, 2.0f)));
+  EXPECT_EQ(transformed.center, glm::vec3(1.0f, 3.0f, 2.0f));
+  EXPECT_FLOAT_EQ(transformed.radius, 3.0f);
+}
+
+TEST(BoundsTest, FrustumCullsBoxes) {
+  qrk::Frustum frustum = makePerspectiveFrustum();
+  // In front of the camera.
+  EXPECT_TRUE(frustum.intersects(
+      makeBox(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f))));
+  // Straddling the left plane.
+  EXPECT_TRUE(frustum.intersects(makeBox(glm::vec3(-7.0f, -1.0f, -6.0f),
+                                         glm::vec3(-4.0f, 1.0f, -4.0f))));
+  // Behind the camera.
+  EXPECT_FALSE(frustum.intersects(
+      makeBox(glm::vec3(-1.0f, -1.0f, 4.0f), glm::vec3(1.0f, 1.0f, 6.0f))));
+  // Off to the side.
+  EXPECT_FALSE(frustum.intersects(makeBox(glm::vec3(10.0f, -1.0f, -6.0f),
+                                          glm::vec3(12.0f, 1.0f, -4.0f))));
+  // Past the far plane.
+  EXPECT_FALSE(frustum.intersects(makeBox(glm::vec3(-1.0f, -1.0f, -200.0f),
+                                          glm::vec3(1.0f, 1.0f, -150.0f))));
+  EXPECT_FALSE(frustum.intersects(qrk::BoundingBox()));
+}
+
+TEST(BoundsTest, FrustumCullsSpheres) {
+  qrk::Frustum frustum = makePerspectiveFrustum();
+  EXPECT_TRUE(frustum.intersects(
+      qrk::BoundingSphere{.center = glm::vec3(0.0f, 0.0f, -5.0f),
+                          .radius = 1.0f}));
+  EXPECT_TRUE(frustum.intersects(
+      qrk::BoundingSphere{.center = glm::vec3(0.0f, 0.0f, 1.0f),
+                          .radius = 2.0f}));
+  EXPECT_FALSE(frustum.intersects(
+      qrk::BoundingSphere{.center = glm::vec3(0.0f, 0.0f, 5.0f),
+                          .radius = 1.0f}));
+}
+
+TEST(BoundsTest, FrustumInLocalSpace) {
+  qrk::Frustum frustum = makePerspectiveFrustum();
+  glm::mat4 transform =
+      glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f)) *
+      glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+  qrk::Frustum local = frustum.toLocalSpace(transform);
+  for (glm::vec3 center : {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 6.0f),
+                           glm::vec3(8.0f, 0.0f, 0.0f)}) {
+    auto box = makeBox(center - 0.5f, center + 0.5f);
+    EXPECT_EQ(local.intersects(box),
+              frustum.intersects(qrk::transformBoundingBox(box, transform)))
+        << center.x << ", " << center.z;
+  }
+}
+
+TEST(BoundsTest, OrthographicFrustum) {
+  glm::mat4 projection = glm::ortho(-2.0f, 2.0f, -2.0f, 2.0f, 0.1f, 10.0f);
+  qrk::Frustum frustum(projection);
+  EXPECT_TRUE(frustum.intersects(
+      makeBox(glm::vec3(1.5f, 1.5f, -5.0f), glm::vec3(3.0f, 3.0f, -4.0f))));
+  EXPECT_FALSE(frustum.intersects(
+      makeBox(glm::vec3(2.5f, -1.0f, -5.0f), glm::vec3(3.0f, 1.0f, -4.0f))));
+}
+
+}  // namespace
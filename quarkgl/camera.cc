@@ -47,6 +47,10 @@ glm::mat4 Camera::getProjectionTransform() const {
   return glm::perspective(glm::radians(getFov()), aspectRatio_, near_, far_);
 }
 
+Frustum Camera::getFrustum() const {
+  return Frustum(getProjectionTransform() * getViewTransform());
+}
+
 void Camera::updateUniforms(Shader& shader) {
   shader.setMat4("view", getViewTransform());
   shader.setMat4("projection", getProjectionTransform());
@@ -8,6 +8,7 @@
 
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
+#include <qrk/bounds.h>
 #include <qrk/light.h>
 #include <qrk/screen.h>
 #include <qrk/shader.h>
@@ -37,7 +38,9 @@ constexpr float DEFAULT_ASPECT_RATIO = 4.0f / 3.0f;
 constexpr float MIN_FOV = 1.0f;
 constexpr float MAX_FOV = 135.0f;
 
-class Camera : public UniformSource, public ViewSource {
+class Camera : public UniformSource,
+               public ViewSource,
+               public FrustumSource {
  public:
   // Constructs a new Camera. Angular values should be provided in degrees.
   Camera(glm::vec3 position = glm::vec3(0.0f),
@@ -77,6 +80,7 @@ class Camera : public UniformSource, public ViewSource {
 
   glm::mat4 getViewTransform() const override;
   glm::mat4 getProjectionTransform() const;
+  Frustum getFrustum() const override;
 
   void updateUniforms(Shader& shader) override;
 
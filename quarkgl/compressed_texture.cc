@@ -0,0 +1,568 @@
+#include <qrk/compressed_texture.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace qrk {
+namespace {
+constexpr char CACHE_MAGIC[8] = {'Q', 'R', 'K', 'T', 'E', 'X', 'B', 'C'};
+constexpr char CACHE_EXTENSION[] = ".qtc";
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t format;
+  int64_t modifiedTime;
+  int32_t width;
+  int32_t height;
+  uint32_t numMips;
+  uint8_t isSRGB;
+  uint8_t flippedVertically;
+  uint8_t padding[2];
+  // The source path immediately follows the header, and is used to detect
+  // hash collisions. The mips follow the path, in order.
+  uint32_t sourcePathLength;
+};
+
+// ================================ DDS ================================
+
+constexpr uint32_t DDS_MAGIC = 0x20534444;  // "DDS ".
+
+constexpr uint32_t makeFourCC(char a, char b, char c, char d) {
+  return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+         (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+struct DdsPixelFormat {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t masks[4];
+};
+
+struct DdsHeader {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11];
+  DdsPixelFormat pixelFormat;
+  uint32_t caps[4];
+  uint32_t reserved2;
+};
+
+struct DdsHeaderDx10 {
+  uint32_t dxgiFormat;
+  uint32_t resourceDimension;
+  uint32_t miscFlag;
+  uint32_t arraySize;
+  uint32_t miscFlags2;
+};
+
+std::optional<BlockFormat> fourCCToBlockFormat(uint32_t fourCC) {
+  switch (fourCC) {
+    case makeFourCC('D', 'X', 'T', '1'):
+      return BlockFormat::BC1;
+    case makeFourCC('D', 'X', 'T', '5'):
+      return BlockFormat::BC3;
+    case makeFourCC('A', 'T', 'I', '1'):
+    case makeFourCC('B', 'C', '4', 'U'):
+      return BlockFormat::BC4;
+    case makeFourCC('A', 'T', 'I', '2'):
+    case makeFourCC('B', 'C', '5', 'U'):
+      return BlockFormat::BC5;
+  }
+  return std::nullopt;
+}
+
+std::optional<BlockFormat> dxgiToBlockFormat(uint32_t dxgiFormat) {
+  switch (dxgiFormat) {
+    case 71:  // DXGI_FORMAT_BC1_UNORM.
+    case 72:  // DXGI_FORMAT_BC1_UNORM_SRGB.
+      return BlockFormat::BC1;
+    case 77:  // DXGI_FORMAT_BC3_UNORM.
+    case 78:  // DXGI_FORMAT_BC3_UNORM_SRGB.
+      return BlockFormat::BC3;
+    case 80:  // DXGI_FORMAT_BC4_UNORM.
+      return BlockFormat::BC4;
+    case 83:  // DXGI_FORMAT_BC5_UNORM.
+      return BlockFormat::BC5;
+    case 98:  // DXGI_FORMAT_BC7_UNORM.
+    case 99:  // DXGI_FORMAT_BC7_UNORM_SRGB.
+      return BlockFormat::BC7;
+  }
+  return std::nullopt;
+}
+
+uint32_t blockFormatToDxgi(BlockFormat format) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return 71;
+    case BlockFormat::BC3:
+      return 77;
+    case BlockFormat::BC4:
+      return 80;
+    case BlockFormat::BC5:
+      return 83;
+    case BlockFormat::BC7:
+      return 98;
+  }
+  return 0;
+}
+
+// ================================ KTX2 ================================
+
+constexpr unsigned char KTX2_IDENTIFIER[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct Ktx2Header {
+  unsigned char identifier[12];
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+  uint32_t dfdByteOffset;
+  uint32_t dfdByteLength;
+  uint32_t kvdByteOffset;
+  uint32_t kvdByteLength;
+  uint64_t sgdByteOffset;
+  uint64_t sgdByteLength;
+};
+
+struct Ktx2Level {
+  uint64_t byteOffset;
+  uint64_t byteLength;
+  uint64_t uncompressedByteLength;
+};
+
+std::optional<BlockFormat> vkFormatToBlockFormat(uint32_t vkFormat) {
+  switch (vkFormat) {
+    case 131:  // VK_FORMAT_BC1_RGB_UNORM_BLOCK.
+    case 132:  // VK_FORMAT_BC1_RGB_SRGB_BLOCK.
+    case 133:  // VK_FORMAT_BC1_RGBA_UNORM_BLOCK.
+    case 134:  // VK_FORMAT_BC1_RGBA_SRGB_BLOCK.
+      return BlockFormat::BC1;
+    case 137:  // VK_FORMAT_BC3_UNORM_BLOCK.
+    case 138:  // VK_FORMAT_BC3_SRGB_BLOCK.
+      return BlockFormat::BC3;
+    case 139:  // VK_FORMAT_BC4_UNORM_BLOCK.
+      return BlockFormat::BC4;
+    case 141:  // VK_FORMAT_BC5_UNORM_BLOCK.
+      return BlockFormat::BC5;
+    case 145:  // VK_FORMAT_BC7_UNORM_BLOCK.
+    case 146:  // VK_FORMAT_BC7_SRGB_BLOCK.
+      return BlockFormat::BC7;
+  }
+  return std::nullopt;
+}
+
+// ============================== Helpers ==============================
+
+[[noreturn]] void throwInvalidFile(const std::string& path,
+                                   const std::string& reason) {
+  throw CompressedTextureException(
+      "ERROR::COMPRESSED_TEXTURE::INVALID_FILE\n" + path + ": " + reason);
+}
+
+std::vector<unsigned char> readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw CompressedTextureException(
+        "ERROR::COMPRESSED_TEXTURE::LOAD_FAILED\n" + path);
+  }
+  return std::vector<unsigned char>(std::istreambuf_iterator<char>(in), {});
+}
+
+template <typename T>
+T readStruct(const std::vector<unsigned char>& file, size_t offset,
+             const std::string& path) {
+  if (offset > file.size() || file.size() - offset < sizeof(T)) {
+    throwInvalidFile(path, "file is truncated");
+  }
+  T value;
+  std::memcpy(&value, file.data() + offset, sizeof(T));
+  return value;
+}
+
+// Lays out a mip chain of the given length contiguously, and sizes `data` to
+// fit it.
+void layoutMips(CompressedImageData& image, int numMips) {
+  image.mips.clear();
+  size_t offset = 0;
+  int width = image.width;
+  int height = image.height;
+  for (int level = 0; level < numMips; level++) {
+    size_t size = getCompressedSizeBytes(image.format, width, height);
+    image.mips.push_back({width, height, offset, size});
+    offset += size;
+    width = std::max(width / 2, 1);
+    height = std::max(height / 2, 1);
+  }
+  image.data.resize(offset);
+}
+
+int getMaxNumMips(int width, int height) {
+  return 1 + static_cast<int>(std::floor(std::log2(std::max(width, height))));
+}
+
+void validateSize(const std::string& path, uint32_t width, uint32_t height,
+                  uint32_t numMips) {
+  constexpr uint32_t MAX_SIZE = 1 << 16;
+  if (width == 0 || height == 0 || width > MAX_SIZE || height > MAX_SIZE) {
+    throwInvalidFile(path, "invalid size");
+  }
+  if (numMips == 0 || numMips > static_cast<uint32_t>(getMaxNumMips(
+                                    width, height))) {
+    throwInvalidFile(path, "invalid mip count");
+  }
+}
+
+CompressedImageData readDds(const std::string& path,
+                            const std::vector<unsigned char>& file) {
+  auto header = readStruct<DdsHeader>(file, sizeof(uint32_t), path);
+  size_t offset = sizeof(uint32_t) + sizeof(DdsHeader);
+  if (!(header.pixelFormat.flags & DDPF_FOURCC)) {
+    throwInvalidFile(path, "not block-compressed");
+  }
+
+  std::optional<BlockFormat> format;
+  if (header.pixelFormat.fourCC == makeFourCC('D', 'X', '1', '0')) {
+    auto dx10 = readStruct<DdsHeaderDx10>(file, offset, path);
+    offset += sizeof(DdsHeaderDx10);
+    if (dx10.resourceDimension != DDS_DIMENSION_TEXTURE2D ||
+        dx10.arraySize > 1) {
+      throwInvalidFile(path, "not a 2D texture");
+    }
+    format = dxgiToBlockFormat(dx10.dxgiFormat);
+  } else {
+    format = fourCCToBlockFormat(header.pixelFormat.fourCC);
+  }
+  if (!format) throwInvalidFile(path, "unsupported format");
+
+  uint32_t numMips =
+      (header.flags & DDSD_MIPMAPCOUNT) ? std::max(header.mipMapCount, 1u) : 1;
+  validateSize(path, header.width, header.height, numMips);
+
+  CompressedImageData image;
+  image.path = path;
+  image.width = header.width;
+  image.height = header.height;
+  image.format = *format;
+  layoutMips(image, numMips);
+  if (file.size() - offset < image.data.size()) {
+    throwInvalidFile(path, "file is truncated");
+  }
+  std::copy_n(file.begin() + offset, image.data.size(), image.data.begin());
+  return image;
+}
+
+CompressedImageData readKtx2(const std::string& path,
+                             const std::vector<unsigned char>& file) {
+  auto header = readStruct<Ktx2Header>(file, 0, path);
+  if (header.supercompressionScheme != 0) {
+    throwInvalidFile(path, "supercompression is unsupported");
+  }
+  if (header.pixelDepth > 1 || header.layerCount > 1 ||
+      header.faceCount != 1) {
+    throwInvalidFile(path, "not a 2D texture");
+  }
+  std::optional<BlockFormat> format = vkFormatToBlockFormat(header.vkFormat);
+  if (!format) throwInvalidFile(path, "unsupported format");
+
+  // A level count of 0 asks the loader to generate mips, which we leave to
+  // the caller.
+  uint32_t numMips = std::max(header.levelCount, 1u);
+  validateSize(path, header.pixelWidth, header.pixelHeight, numMips);
+
+  CompressedImageData image;
+  image.path = path;
+  image.width = header.pixelWidth;
+  image.height = header.pixelHeight;
+  image.format = *format;
+  layoutMips(image, numMips);
+  for (uint32_t level = 0; level < numMips; level++) {
+    auto index = readStruct<Ktx2Level>(
+        file, sizeof(Ktx2Header) + level * sizeof(Ktx2Level), path);
+    const CompressedImageData::Mip& mip = image.mips[level];
+    if (index.byteLength != mip.size || index.byteOffset > file.size() ||
+        file.size() - index.byteOffset < mip.size) {
+      throwInvalidFile(path, "invalid level index");
+    }
+    std::copy_n(file.begin() + index.byteOffset, mip.size,
+                image.data.begin() + mip.offset);
+  }
+  return image;
+}
+
+int64_t toTicks(std::filesystem::file_time_type time) {
+  return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+// 64-bit FNV-1a. Unlike std::hash, this is stable across runs and platforms.
+uint64_t hashString(const std::string& str) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+}  // namespace
+
+CompressedImageData compressImage(const unsigned char* pixels, int width,
+                                  int height, int numChannels,
+                                  BlockFormat format, bool isSRGB,
+                                  bool generateMips, bool flippedVertically,
+                                  MipFilter mipFilter) {
+  CompressedImageData image;
+  image.width = width;
+  image.height = height;
+  image.format = format;
+  image.flippedVertically = flippedVertically;
+  std::vector<ImageMip> mips;
+  if (generateMips) {
+    mips = generateImageMips(pixels, width, height, numChannels, isSRGB,
+                             mipFilter);
+  }
+  layoutMips(image, 1 + static_cast<int>(mips.size()));
+
+  for (size_t i = 0; i < image.mips.size(); i++) {
+    const CompressedImageData::Mip& mip = image.mips[i];
+    std::vector<unsigned char> blocks =
+        encodeBlocks(format, i == 0 ? pixels : mips[i - 1].pixels.data(),
+                     mip.width, mip.height, numChannels);
+    std::copy(blocks.begin(), blocks.end(), image.data.begin() + mip.offset);
+  }
+  return image;
+}
+
+bool isCompressedImagePath(const std::string& path) {
+  std::string extension = std::filesystem::path(path).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return extension == ".dds" || extension == ".ktx2";
+}
+
+CompressedImageData readCompressedImage(const std::string& path,
+                                        bool flipVertically) {
+  std::vector<unsigned char> file = readFile(path);
+  CompressedImageData image;
+  if (file.size() >= sizeof(KTX2_IDENTIFIER) &&
+      std::memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) ==
+          0) {
+    image = readKtx2(path, file);
+  } else if (file.size() >= sizeof(uint32_t) &&
+             readStruct<uint32_t>(file, 0, path) == DDS_MAGIC) {
+    image = readDds(path, file);
+  } else {
+    throwInvalidFile(path, "not a DDS or KTX2 file");
+  }
+  // Both formats store rows top to bottom.
+  if (flipVertically) flipCompressedImage(image);
+  return image;
+}
+
+void flipCompressedImage(CompressedImageData& image) {
+  for (const CompressedImageData::Mip& mip : image.mips) {
+    flipBlocksVertically(image.format, image.data.data() + mip.offset,
+                         mip.width, mip.height);
+  }
+  image.flippedVertically = !image.flippedVertically;
+}
+
+void writeDds(const std::string& path, const CompressedImageData& image) {
+  CompressedImageData flipped;
+  const CompressedImageData* source = &image;
+  if (image.flippedVertically) {
+    flipped = image;
+    flipCompressedImage(flipped);
+    source = &flipped;
+  }
+
+  DdsHeader header = {};
+  header.size = sizeof(DdsHeader);
+  header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT |
+                 DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+  header.height = image.height;
+  header.width = image.width;
+  header.pitchOrLinearSize = image.mips.empty() ? 0 : image.mips[0].size;
+  header.mipMapCount = image.mips.size();
+  header.pixelFormat.size = sizeof(DdsPixelFormat);
+  header.pixelFormat.flags = DDPF_FOURCC;
+  header.pixelFormat.fourCC = makeFourCC('D', 'X', '1', '0');
+  header.caps[0] = DDSCAPS_TEXTURE;
+  if (image.mips.size() > 1) header.caps[0] |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+
+  DdsHeaderDx10 dx10 = {};
+  dx10.dxgiFormat = blockFormatToDxgi(image.format);
+  dx10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+  dx10.arraySize = 1;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+  out.write(reinterpret_cast<const char*>(source->data.data()),
+            source->data.size());
+  if (!out) {
+    throw CompressedTextureException(
+        "ERROR::COMPRESSED_TEXTURE::WRITE_FAILED\n" + path);
+  }
+}
+
+CompressedTextureKey computeCompressedTextureKey(const std::string& path,
+                                                 bool isSRGB) {
+  std::error_code ec;
+  // Resolve symlinks, so that a source reached through Bazel's runfiles has
+  // the same key as the file itself.
+  std::filesystem::path sourcePath =
+      std::filesystem::weakly_canonical(path, ec);
+  if (ec) sourcePath = std::filesystem::absolute(path, ec);
+  // A missing source just produces a key that never matches anything.
+  int64_t modifiedTime =
+      toTicks(std::filesystem::last_write_time(sourcePath, ec));
+  return {
+      .sourcePath = sourcePath.string(),
+      .modifiedTime = modifiedTime,
+      .isSRGB = isSRGB,
+  };
+}
+
+std::string CompressedTextureCache::getDefaultDirectory() {
+  std::error_code ec;
+  std::filesystem::path tempDir = std::filesystem::temp_directory_path(ec);
+  if (ec) tempDir = ".";
+  return (tempDir / "quarkgl_texture_cache").string();
+}
+
+std::string CompressedTextureCache::getEntryPath(
+    const CompressedTextureKey& key) const {
+  char name[40];
+  std::snprintf(name, sizeof(name), "%016llx%s%s",
+                static_cast<unsigned long long>(hashString(key.sourcePath)),
+                key.isSRGB ? "_srgb" : "", CACHE_EXTENSION);
+  return (std::filesystem::path(directory_) / name).string();
+}
+
+std::optional<CompressedImageData> CompressedTextureCache::load(
+    const CompressedTextureKey& key, bool flipVertically) {
+  std::string entryPath = getEntryPath(key);
+  std::error_code ec;
+  if (!std::filesystem::exists(entryPath, ec)) return std::nullopt;
+
+  std::vector<unsigned char> file;
+  try {
+    file = readFile(entryPath);
+  } catch (const CompressedTextureException&) {
+    return std::nullopt;
+  }
+
+  // Validate that the entry matches the requested key.
+  if (file.size() < sizeof(CacheHeader)) return std::nullopt;
+  CacheHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != COMPRESSED_TEXTURE_CACHE_VERSION ||
+      header.modifiedTime != key.modifiedTime ||
+      header.isSRGB != key.isSRGB ||
+      header.format > static_cast<uint32_t>(BlockFormat::BC7) ||
+      header.sourcePathLength != key.sourcePath.size() ||
+      file.size() - sizeof(header) < header.sourcePathLength ||
+      std::memcmp(file.data() + sizeof(header), key.sourcePath.data(),
+                  key.sourcePath.size()) != 0) {
+    return std::nullopt;
+  }
+
+  CompressedImageData image;
+  image.path = key.sourcePath;
+  image.width = header.width;
+  image.height = header.height;
+  image.format = static_cast<BlockFormat>(header.format);
+  image.flippedVertically = header.flippedVertically;
+  if (image.width <= 0 || image.height <= 0 || header.numMips == 0 ||
+      header.numMips > static_cast<uint32_t>(
+                           getMaxNumMips(image.width, image.height))) {
+    return std::nullopt;
+  }
+  layoutMips(image, header.numMips);
+  size_t offset = sizeof(header) + header.sourcePathLength;
+  if (file.size() - offset != image.data.size()) return std::nullopt;
+  std::copy(file.begin() + offset, file.end(), image.data.begin());
+
+  if (image.flippedVertically != flipVertically) flipCompressedImage(image);
+  return image;
+}
+
+bool CompressedTextureCache::store(const CompressedTextureKey& key,
+                                   const CompressedImageData& image) {
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec) return false;
+
+  // Write to a temporary file first, and then move it into place, so that
+  // readers never observe a partially written entry.
+  std::string entryPath = getEntryPath(key);
+  std::string tempPath = entryPath + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = COMPRESSED_TEXTURE_CACHE_VERSION;
+    header.format = static_cast<uint32_t>(image.format);
+    header.modifiedTime = key.modifiedTime;
+    header.width = image.width;
+    header.height = image.height;
+    header.numMips = image.mips.size();
+    header.isSRGB = key.isSRGB;
+    header.flippedVertically = image.flippedVertically;
+    header.sourcePathLength = static_cast<uint32_t>(key.sourcePath.size());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(key.sourcePath.data(), key.sourcePath.size());
+    out.write(reinterpret_cast<const char*>(image.data.data()),
+              image.data.size());
+    if (!out) {
+      out.close();
+      std::filesystem::remove(tempPath, ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tempPath, entryPath, ec);
+  if (ec) {
+    std::filesystem::remove(tempPath, ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace qrk
@@ -0,0 +1,120 @@
+#ifndef QUARKGL_COMPRESSED_TEXTURE_H_
+#define QUARKGL_COMPRESSED_TEXTURE_H_
+
+#include <qrk/block_compression.h>
+#include <qrk/exceptions.h>
+#include <qrk/image_mips.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace qrk {
+
+class CompressedTextureException : public QuarkException {
+  using QuarkException::QuarkException;
+};
+
+// CPU-side block-compressed image data, with its mip chain, ready to be
+// uploaded to a texture without any further decoding.
+struct CompressedImageData {
+  struct Mip {
+    int width;
+    int height;
+    // The byte range of the mip within `data`.
+    size_t offset;
+    size_t size;
+  };
+
+  std::string path;
+  int width = 0;
+  int height = 0;
+  BlockFormat format = BlockFormat::BC1;
+  // Whether the rows are in OpenGL's bottom-to-top order, rather than the
+  // top-to-bottom order that image files use.
+  bool flippedVertically = false;
+  std::vector<Mip> mips;
+  std::vector<unsigned char> data;
+
+  size_t getSizeBytes() const { return data.size(); }
+  const unsigned char* getMipData(int level) const {
+    return data.data() + mips[level].offset;
+  }
+};
+
+// Compresses an 8-bit image with 1 to 4 channels, optionally along with a full
+// mip chain (see generateImageMips()). The image's rows are kept in the given
+// order.
+CompressedImageData compressImage(const unsigned char* pixels, int width,
+                                  int height, int numChannels,
+                                  BlockFormat format, bool isSRGB,
+                                  bool generateMips = true,
+                                  bool flippedVertically = false,
+                                  MipFilter mipFilter = MipFilter::BOX);
+
+// Returns whether the path names a block-compressed image file (.dds or
+// .ktx2).
+bool isCompressedImagePath(const std::string& path);
+
+// Reads a block-compressed DDS or KTX2 file, in any of the formats in
+// BlockFormat. Only 2D textures without supercompression are supported. Flips
+// the image if requested; see flipBlocksVertically() for caveats. Doesn't
+// touch any GL state, so this is safe to call from any thread.
+CompressedImageData readCompressedImage(const std::string& path,
+                                        bool flipVertically = true);
+
+// Flips every mip of a compressed image vertically, in place.
+void flipCompressedImage(CompressedImageData& image);
+
+// Writes a compressed image as a DDS file, with a DX10 header. Throws on
+// failure.
+void writeDds(const std::string& path, const CompressedImageData& image);
+
+// Bump this whenever the layout of the cache file changes, or the encoder
+// changes its output.
+constexpr uint32_t COMPRESSED_TEXTURE_CACHE_VERSION = 2;
+
+// Identifies a single version of a source image, as compressed for a
+// particular color space.
+struct CompressedTextureKey {
+  // The canonical path to the source image.
+  std::string sourcePath;
+  int64_t modifiedTime;
+  bool isSRGB;
+};
+
+CompressedTextureKey computeCompressedTextureKey(const std::string& path,
+                                                 bool isSRGB);
+
+// An on-disk cache of block-compressed textures, which are built offline (see
+// //tools:texture_compressor) from the source images that models reference.
+// Each source image gets an entry per color space, which is replaced whenever
+// the source changes.
+//
+// Cache failures are never fatal; a bad or stale entry is treated as a miss.
+class CompressedTextureCache {
+ public:
+  explicit CompressedTextureCache(std::string directory = getDefaultDirectory())
+      : directory_(std::move(directory)) {}
+
+  // Reads the cache entry for the given key, flipped as requested. Returns
+  // nullopt on a cache miss.
+  std::optional<CompressedImageData> load(const CompressedTextureKey& key,
+                                          bool flipVertically = true);
+  // Writes a cache entry for the given key. Returns false on failure.
+  bool store(const CompressedTextureKey& key,
+             const CompressedImageData& image);
+
+  std::string getEntryPath(const CompressedTextureKey& key) const;
+  const std::string& getDirectory() const { return directory_; }
+
+  static std::string getDefaultDirectory();
+
+ private:
+  std::string directory_;
+};
+
+}  // namespace qrk
+
+#endif
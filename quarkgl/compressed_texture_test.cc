@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <qrk/compressed_texture.h>
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+class CompressedTextureTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::path(testing::TempDir()) /
+                 testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::filesystem::remove_all(directory_);
+    std::filesystem::create_directories(directory_);
+  }
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  std::string writeSource(const std::string& name) {
+    std::string path = (directory_ / name).string();
+    std::ofstream(path) << "source";
+    return path;
+  }
+
+  std::filesystem::path directory_;
+};
+
+std::vector<unsigned char> makeImage(int width, int height) {
+  std::vector<unsigned char> pixels(width * height * 4);
+  for (size_t i = 0; i < pixels.size(); i++) pixels[i] = (i * 37) % 256;
+  return pixels;
+}
+
+TEST_F(CompressedTextureTest, CompressesMipChain) {
+  std::vector<unsigned char> pixels = makeImage(16, 8);
+  qrk::CompressedImageData image = qrk::compressImage(
+      pixels.data(), 16, 8, 4, qrk::BlockFormat::BC3, /*isSRGB=*/true);
+  ASSERT_EQ(image.mips.size(), 5);
+  EXPECT_EQ(image.mips[4].width, 1);
+  EXPECT_EQ(image.mips[4].height, 1);
+  // 16x8, 8x4, 4x2, 2x1, and 1x1 take 8, 2, 1, 1, and 1 blocks.
+  EXPECT_EQ(image.getSizeBytes(), 13 * 16);
+
+  qrk::CompressedImageData single = qrk::compressImage(
+      pixels.data(), 16, 8, 4, qrk::BlockFormat::BC1, /*isSRGB=*/false,
+      /*generateMips=*/false);
+  EXPECT_EQ(single.mips.size(), 1);
+  EXPECT_EQ(single.getSizeBytes(), 8 * 8);
+}
+
+TEST_F(CompressedTextureTest, DdsRoundTrips) {
+  std::vector<unsigned char> pixels = makeImage(16, 16);
+  qrk::CompressedImageData image = qrk::compressImage(
+      pixels.data(), 16, 16, 2, qrk::BlockFormat::BC5, /*isSRGB=*/false);
+  std::string path = (directory_ / "image.dds").string();
+  qrk::writeDds(path, image);
+
+  ASSERT_TRUE(qrk::isCompressedImagePath(path));
+  qrk::CompressedImageData read =
+      qrk::readCompressedImage(path, /*flipVertically=*/false);
+  EXPECT_EQ(read.width, 16);
+  EXPECT_EQ(read.height, 16);
+  EXPECT_EQ(read.format, qrk::BlockFormat::BC5);
+  EXPECT_EQ(read.mips.size(), image.mips.size());
+  EXPECT_EQ(read.data, image.data);
+
+  // Flipping twice is the identity for power-of-two images.
+  qrk::CompressedImageData flipped = qrk::readCompressedImage(path);
+  EXPECT_TRUE(flipped.flippedVertically);
+  EXPECT_NE(flipped.data, image.data);
+  qrk::flipCompressedImage(flipped);
+  EXPECT_EQ(flipped.data, image.data);
+}
+
+TEST_F(CompressedTextureTest, RejectsInvalidFiles) {
+  std::string path = (directory_ / "image.dds").string();
+  std::ofstream(path) << "DDS not really";
+  EXPECT_THROW(qrk::readCompressedImage(path),
+               qrk::CompressedTextureException);
+  EXPECT_THROW(qrk::readCompressedImage((directory_ / "missing.ktx2").string()),
+               qrk::CompressedTextureException);
+}
+
+TEST_F(CompressedTextureTest, CacheHitsOnlyMatchingKeys) {
+  std::string source = writeSource("albedo.png");
+  std::vector<unsigned char> pixels = makeImage(8, 8);
+  qrk::CompressedImageData image = qrk::compressImage(
+      pixels.data(), 8, 8, 4, qrk::BlockFormat::BC1, /*isSRGB=*/true,
+      /*generateMips=*/true, /*flippedVertically=*/true);
+
+  qrk::CompressedTextureCache cache((directory_ / "cache").string());
+  qrk::CompressedTextureKey key =
+      qrk::computeCompressedTextureKey(source, /*isSRGB=*/true);
+  EXPECT_FALSE(cache.load(key).has_value());
+  ASSERT_TRUE(cache.store(key, image));
+
+  std::optional<qrk::CompressedImageData> loaded = cache.load(key);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->data, image.data);
+  EXPECT_EQ(loaded->mips.size(), image.mips.size());
+
+  // Entries are flipped to the requested orientation.
+  loaded = cache.load(key, /*flipVertically=*/false);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_FALSE(loaded->flippedVertically);
+
+  // Linear and sRGB versions of a source are separate entries.
+  EXPECT_FALSE(cache.load(qrk::computeCompressedTextureKey(source, false)));
+
+  qrk::CompressedTextureKey stale = key;
+  stale.modifiedTime++;
+  EXPECT_FALSE(cache.load(stale).has_value());
+}
+
+}  // namespace
@@ -2,9 +2,10 @@
 
 namespace qrk {
 
-DeferredGeometryPassShader::DeferredGeometryPassShader()
+DeferredGeometryPassShader::DeferredGeometryPassShader(
+    const ShaderDefines& defines)
     : Shader(ShaderPath("quarkgl/shaders/builtin/deferred.vert"),
-             ShaderPath("quarkgl/shaders/builtin/deferred.frag")) {}
+             ShaderPath("quarkgl/shaders/builtin/deferred.frag", defines)) {}
 
 GBuffer::GBuffer(int width, int height) : Framebuffer(width, height) {
   // Need to use a zero clear color, or else the G-Buffer won't work properly.
@@ -17,7 +17,9 @@ class DeferredShadingException : public QuarkException {
 
 class DeferredGeometryPassShader : public Shader {
  public:
-  DeferredGeometryPassShader();
+  // Defines are passed to the fragment shader, e.g. QRK_VIRTUAL_TEXTURES to
+  // sample virtual diffuse maps.
+  explicit DeferredGeometryPassShader(const ShaderDefines& defines = {});
 };
 
 class GBuffer : public Framebuffer, public TextureSource {
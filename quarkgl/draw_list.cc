@@ -0,0 +1,114 @@
+#include <qrk/draw_list.h>
+
+#include <optional>
+
+namespace qrk {
+
+void DrawList::update() {
+  if (!compiled_ || root_->getStructureVersion() != structureVersion_) {
+    compile();
+    return;
+  }
+  if (root_->getTransformVersion() == transformVersion_) return;
+
+  // Only descend into subtrees in which something has moved since the last
+  // update, and recompute everything below each moved node.
+  uint32_t i = 0;
+  while (i < nodes_.size()) {
+    const RenderableNode* node = nodes_[i];
+    if (node->subtreeTransformVersion_ <= transformVersion_) {
+      i = subtreeEnds_[i];
+    } else if (node->transformVersion_ > transformVersion_) {
+      updateWorldTransforms(i, subtreeEnds_[i]);
+      i = subtreeEnds_[i];
+    } else {
+      i++;
+    }
+  }
+  transformVersion_ = root_->getTransformVersion();
+}
+
+void DrawList::drawWithTransform(const glm::mat4& transform, Shader& shader,
+                                 TextureRegistry* textureRegistry) {
+  update();
+
+  // Cull in the list's own space, rather than transforming every record.
+  std::optional<Frustum> frustum;
+  if (const Frustum* shaderFrustum = shader.getCullingFrustum()) {
+    frustum = shaderFrustum->toLocalSpace(transform);
+  }
+  CullingStats& stats = shader.getCullingStats();
+
+  for (size_t i = 0; i < records_.size(); i++) {
+    const DrawRecord& record = records_[i];
+    if (frustum) {
+      if (record.bounded && !frustum->intersects(worldBounds_[i])) {
+        stats.culled++;
+        continue;
+      }
+      stats.visible++;
+    }
+    record.renderable->drawWithTransform(
+        transform * worldTransforms_[record.nodeIndex], shader,
+        textureRegistry);
+  }
+}
+
+void DrawList::compile() {
+  nodes_.clear();
+  parents_.clear();
+  subtreeEnds_.clear();
+  recordBegins_.clear();
+  worldTransforms_.clear();
+  records_.clear();
+  localBounds_.clear();
+
+  addNode(root_, -1);
+  recordBegins_.push_back(records_.size());
+  worldBounds_.resize(records_.size());
+  updateWorldTransforms(0, nodes_.size());
+
+  compiled_ = true;
+  structureVersion_ = root_->getStructureVersion();
+  transformVersion_ = root_->getTransformVersion();
+}
+
+void DrawList::addNode(const RenderableNode* node, int32_t parent) {
+  const uint32_t index = nodes_.size();
+  nodes_.push_back(node);
+  parents_.push_back(parent);
+  subtreeEnds_.push_back(0);
+  recordBegins_.push_back(records_.size());
+  worldTransforms_.emplace_back(1.0f);
+
+  for (const auto& renderable : node->renderables_) {
+    std::optional<BoundingBox> bounds = renderable->getLocalBounds();
+    records_.push_back({
+        .renderable = renderable.get(),
+        .nodeIndex = index,
+        .bounded = bounds.has_value(),
+    });
+    localBounds_.push_back(
+        bounds ? transformBoundingBox(*bounds, renderable->getModelTransform())
+               : BoundingBox());
+  }
+  for (const auto& childNode : node->childNodes_) {
+    addNode(childNode.get(), index);
+  }
+  subtreeEnds_[index] = nodes_.size();
+}
+
+void DrawList::updateWorldTransforms(uint32_t begin, uint32_t end) {
+  for (uint32_t i = begin; i < end; i++) {
+    const glm::mat4 local = nodes_[i]->getModelTransform();
+    worldTransforms_[i] =
+        parents_[i] < 0 ? local : worldTransforms_[parents_[i]] * local;
+  }
+  for (uint32_t i = recordBegins_[begin]; i < recordBegins_[end]; i++) {
+    if (!records_[i].bounded) continue;
+    worldBounds_[i] = transformBoundingBox(
+        localBounds_[i], worldTransforms_[records_[i].nodeIndex]);
+  }
+}
+
+}  // namespace qrk
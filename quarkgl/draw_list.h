@@ -0,0 +1,95 @@
+#ifndef QUARKGL_DRAW_LIST_H_
+#define QUARKGL_DRAW_LIST_H_
+
+#include <qrk/bounds.h>
+#include <qrk/mesh.h>
+#include <qrk/shader.h>
+#include <qrk/texture_registry.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace qrk {
+
+// A single draw in a DrawList.
+struct DrawRecord {
+  Renderable* renderable;
+  // The index of the node that holds the renderable, which is also the index
+  // of its world transform.
+  uint32_t nodeIndex;
+  // Whether the renderable has bounds, and so can be culled.
+  bool bounded;
+};
+
+// A compiled form of a tree of RenderableNodes, which can be drawn by
+// iterating over flat arrays rather than by walking the tree.
+//
+// Each node's transform, combined with those of its ancestors, is stored in a
+// contiguous array of world transforms (relative to the root's parent), and
+// only recomputed for subtrees in which a node was moved. Each renderable in
+// the tree becomes a DrawRecord that refers to its node's world transform.
+// The list recompiles itself whenever the tree changes shape.
+//
+// The tree must outlive the list. Like RenderableNode's own bounds, moving a
+// renderable that isn't a node isn't detected, and requires calling
+// invalidate().
+class DrawList {
+ public:
+  explicit DrawList(const RenderableNode& root) : root_(&root) {}
+
+  // Brings the list up to date with the tree. Called automatically by draw().
+  void update();
+  // Forces the list to be recompiled on the next update.
+  void invalidate() { compiled_ = false; }
+
+  void draw(Shader& shader, TextureRegistry* textureRegistry = nullptr) {
+    drawWithTransform(glm::mat4(1.0f), shader, textureRegistry);
+  }
+  // Draws every record, as if drawing the tree with the given transform. If
+  // the shader has a culling frustum, records whose bounds are outside of it
+  // are skipped.
+  void drawWithTransform(const glm::mat4& transform, Shader& shader,
+                         TextureRegistry* textureRegistry = nullptr);
+
+  size_t getNodeCount() const { return nodes_.size(); }
+  const std::vector<DrawRecord>& getRecords() const { return records_; }
+  // Returns the world transform of each node, in depth-first order.
+  const std::vector<glm::mat4>& getWorldTransforms() const {
+    return worldTransforms_;
+  }
+
+ private:
+  void compile();
+  void addNode(const RenderableNode* node, int32_t parent);
+  // Recomputes the world transforms of a contiguous range of nodes, along
+  // with the bounds of their records. Parents must precede their children.
+  void updateWorldTransforms(uint32_t begin, uint32_t end);
+
+  const RenderableNode* root_;
+  bool compiled_ = false;
+  // The root's versions as of the last update.
+  uint64_t structureVersion_ = 0;
+  uint64_t transformVersion_ = 0;
+
+  // The nodes of the tree, in depth-first order, so that every subtree is a
+  // contiguous range.
+  std::vector<const RenderableNode*> nodes_;
+  std::vector<int32_t> parents_;
+  // One past the last node in each node's subtree.
+  std::vector<uint32_t> subtreeEnds_;
+  // The first record of each node, plus a final entry for the end of the
+  // records, so that the records of a subtree are also a contiguous range.
+  std::vector<uint32_t> recordBegins_;
+  std::vector<glm::mat4> worldTransforms_;
+
+  std::vector<DrawRecord> records_;
+  // The bounds of each record, relative to its node and in world space. Only
+  // valid for bounded records.
+  std::vector<BoundingBox> localBounds_;
+  std::vector<BoundingBox> worldBounds_;
+};
+
+}  // namespace qrk
+
+#endif
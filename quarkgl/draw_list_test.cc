@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <qrk/draw_list.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// A renderable that records the transforms it's drawn with.
+class RecordingRenderable : public qrk::Renderable {
+ public:
+  void drawWithTransform(const glm::mat4& transform, qrk::Shader& shader,
+                         qrk::TextureRegistry* textureRegistry) override {
+    transforms.push_back(transform * getModelTransform());
+  }
+
+  std::vector<glm::mat4> transforms;
+};
+
+// A shader that doesn't need a GL context.
+class FakeShader : public qrk::Shader {};
+
+glm::mat4 translate(float x) {
+  return glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, 0.0f));
+}
+
+// Draws the tree both directly and through the list, and checks that every
+// renderable received the same transforms.
+void expectSameDraws(qrk::RenderableNode& root, qrk::DrawList& drawList,
+                     std::vector<std::shared_ptr<RecordingRenderable>>& leaves,
+                     const glm::mat4& transform = glm::mat4(1.0f)) {
+  FakeShader shader;
+  for (auto& leaf : leaves) leaf->transforms.clear();
+  root.drawWithTransform(transform, shader);
+  std::vector<std::vector<glm::mat4>> expected;
+  for (auto& leaf : leaves) {
+    expected.push_back(leaf->transforms);
+    leaf->transforms.clear();
+  }
+
+  drawList.drawWithTransform(transform, shader);
+  for (size_t i = 0; i < leaves.size(); i++) {
+    EXPECT_EQ(leaves[i]->transforms, expected[i]) << "leaf " << i;
+  }
+}
+
+TEST(DrawListTest, FlattensTree) {
+  qrk::RenderableNode root;
+  root.setModelTransform(translate(1.0f));
+  auto leaf = std::make_shared<RecordingRenderable>();
+  leaf->setModelTransform(translate(100.0f));
+  root.addRenderable(leaf);
+  auto child = std::make_unique<qrk::RenderableNode>();
+  child->setModelTransform(translate(10.0f));
+  child->addRenderable(leaf);
+  auto grandchild = std::make_unique<qrk::RenderableNode>();
+  grandchild->setModelTransform(glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)));
+  grandchild->addRenderable(leaf);
+  child->addChildNode(std::move(grandchild));
+  root.addChildNode(std::move(child));
+
+  qrk::DrawList drawList(root);
+  std::vector<std::shared_ptr<RecordingRenderable>> leaves = {leaf};
+  expectSameDraws(root, drawList, leaves, translate(1000.0f));
+
+  EXPECT_EQ(drawList.getNodeCount(), 3);
+  ASSERT_EQ(drawList.getRecords().size(), 3);
+  EXPECT_EQ(drawList.getRecords()[2].nodeIndex, 2);
+  EXPECT_EQ(drawList.getWorldTransforms()[1], translate(11.0f));
+}
+
+TEST(DrawListTest, UpdatesMovedSubtrees) {
+  qrk::RenderableNode root;
+  std::vector<std::shared_ptr<RecordingRenderable>> leaves;
+  std::vector<qrk::RenderableNode*> nodes;
+  for (int i = 0; i < 4; i++) {
+    auto child = std::make_unique<qrk::RenderableNode>();
+    auto grandchild = std::make_unique<qrk::RenderableNode>();
+    leaves.push_back(std::make_shared<RecordingRenderable>());
+    grandchild->addRenderable(leaves.back());
+    nodes.push_back(child.get());
+    nodes.push_back(grandchild.get());
+    child->addChildNode(std::move(grandchild));
+    root.addChildNode(std::move(child));
+  }
+
+  qrk::DrawList drawList(root);
+  expectSameDraws(root, drawList, leaves);
+
+  nodes[2]->setModelTransform(translate(5.0f));
+  nodes[7]->setModelTransform(translate(-3.0f));
+  expectSameDraws(root, drawList, leaves);
+  EXPECT_EQ(leaves[1]->transforms[0], translate(5.0f));
+  EXPECT_EQ(leaves[3]->transforms[0], translate(-3.0f));
+
+  root.setModelTransform(translate(1.0f));
+  expectSameDraws(root, drawList, leaves);
+  EXPECT_EQ(leaves[1]->transforms[0], translate(6.0f));
+}
+
+TEST(DrawListTest, RecompilesWhenTreeChanges) {
+  qrk::RenderableNode root;
+  std::vector<std::shared_ptr<RecordingRenderable>> leaves = {
+      std::make_shared<RecordingRenderable>()};
+  root.addRenderable(leaves[0]);
+
+  qrk::DrawList drawList(root);
+  expectSameDraws(root, drawList, leaves);
+  EXPECT_EQ(drawList.getRecords().size(), 1);
+
+  auto child = std::make_unique<qrk::RenderableNode>();
+  child->setModelTransform(translate(2.0f));
+  auto* childPtr = child.get();
+  root.addChildNode(std::move(child));
+  leaves.push_back(std::make_shared<RecordingRenderable>());
+  childPtr->addRenderable(leaves[1]);
+  expectSameDraws(root, drawList, leaves);
+  EXPECT_EQ(drawList.getNodeCount(), 2);
+  EXPECT_EQ(drawList.getRecords().size(), 2);
+  EXPECT_EQ(leaves[1]->transforms[0], translate(2.0f));
+}
+
+}  // namespace
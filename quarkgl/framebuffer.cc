@@ -1,5 +1,6 @@
 #include <glad/glad.h>
 #include <qrk/framebuffer.h>
+#include <qrk/gl_state.h>
 
 namespace qrk {
 
@@ -23,7 +24,14 @@ Framebuffer::Framebuffer(int width, int height, int samples)
 
 Framebuffer::~Framebuffer() {
   glDeleteFramebuffers(1, &fbo_);
-  // TODO: Delete attachments.
+  for (const Attachment& attachment : attachments_) {
+    if (attachment.target == AttachmentTarget::TEXTURE) {
+      glDeleteTextures(1, &attachment.id);
+      GlState::current().onTextureDeleted(attachment.id);
+    } else {
+      glDeleteRenderbuffers(1, &attachment.id);
+    }
+  }
 }
 
 void Framebuffer::activate(int mipLevel, int cubemapFace) {
@@ -99,7 +107,7 @@ Attachment Framebuffer::attachTexture(BufferType type,
   // instead?
   unsigned int texture;
   glGenTextures(1, &texture);
-  glBindTexture(textureTarget, texture);
+  GlState::current().bindTexture(textureTarget, texture);
 
   GLenum internalFormat = bufferTypeToGlInternalFormat(type);
 
@@ -138,7 +146,7 @@ Attachment Framebuffer::attachTexture(BufferType type,
   updateFlags(type);
   updateBufferSources();
 
-  glBindTexture(textureTarget, 0);
+  GlState::current().bindTexture(textureTarget, 0);
   deactivate();
 
   return saveAttachment(texture, numMips, AttachmentTarget::TEXTURE, type,
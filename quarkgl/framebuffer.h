@@ -165,7 +165,11 @@ class Framebuffer {
   Framebuffer(int width, int height, int samples = 0);
   explicit Framebuffer(ImageSize size, int samples = 0)
       : Framebuffer(size.width, size.height, samples) {}
+  // Deletes the framebuffer along with its attachments, so textures taken from
+  // them (e.g. with Attachment::asTexture()) must not outlive it.
   virtual ~Framebuffer();
+  Framebuffer(const Framebuffer&) = delete;
+  Framebuffer& operator=(const Framebuffer&) = delete;
 
   // Activates the current framebuffer. Optionally specify a mipmap level to
   // draw to, and a cubemap face (0 means GL_TEXTURE_CUBE_MAP_POSITIVE_X, etc).
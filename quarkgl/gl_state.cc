@@ -0,0 +1,109 @@
+#include <qrk/gl_state.h>
+
+#include <algorithm>
+
+namespace qrk {
+
+GlState& GlState::current() {
+  // Only a single context is supported.
+  static GlState state;
+  return state;
+}
+
+void GlState::useProgram(unsigned int program) {
+  if (program_ == program) {
+    stats_.programBindsSkipped++;
+    return;
+  }
+  glUseProgram(program);
+  program_ = program;
+  stats_.programBinds++;
+}
+
+void GlState::bindVertexArray(unsigned int vao) {
+  if (vao_ == vao) {
+    stats_.vertexArrayBindsSkipped++;
+    return;
+  }
+  glBindVertexArray(vao);
+  vao_ = vao;
+  stats_.vertexArrayBinds++;
+}
+
+void GlState::activeTexture(unsigned int unit) {
+  if (activeUnit_ == unit) {
+    stats_.activeTextureChangesSkipped++;
+    return;
+  }
+  glActiveTexture(GL_TEXTURE0 + unit);
+  activeUnit_ = unit;
+  stats_.activeTextureChanges++;
+}
+
+void GlState::bindTexture(GLenum target, unsigned int texture) {
+  unsigned int* binding = activeUnit_ == UNKNOWN
+                              ? nullptr
+                              : getTextureBinding(activeUnit_, target);
+  if (binding && *binding == texture) {
+    stats_.textureBindsSkipped++;
+    return;
+  }
+  glBindTexture(target, texture);
+  if (binding) *binding = texture;
+  stats_.textureBinds++;
+}
+
+void GlState::bindTextureToUnit(unsigned int unit, GLenum target,
+                                unsigned int texture) {
+  unsigned int* binding = getTextureBinding(unit, target);
+  if (binding && *binding == texture) {
+    stats_.textureBindsSkipped++;
+    return;
+  }
+  activeTexture(unit);
+  bindTexture(target, texture);
+}
+
+unsigned int* GlState::getTextureBinding(unsigned int unit, GLenum target) {
+  auto it = std::find(CACHED_TEXTURE_TARGETS.begin(),
+                      CACHED_TEXTURE_TARGETS.end(), target);
+  if (it == CACHED_TEXTURE_TARGETS.end()) return nullptr;
+  if (unit >= textureUnits_.size()) {
+    TextureUnitBindings unknown;
+    unknown.fill(UNKNOWN);
+    textureUnits_.resize(unit + 1, unknown);
+  }
+  return &textureUnits_[unit][it - CACHED_TEXTURE_TARGETS.begin()];
+}
+
+void GlState::onProgramDeleted(unsigned int program) {
+  // Deleting the current program only flags it for deletion, but its name may
+  // still be reused once it's no longer current.
+  if (program_ == program) program_ = UNKNOWN;
+}
+
+void GlState::onVertexArrayDeleted(unsigned int vao) {
+  if (vao_ == vao) vao_ = 0;
+}
+
+void GlState::onTextureDeleted(unsigned int texture) {
+  for (TextureUnitBindings& bindings : textureUnits_) {
+    for (unsigned int& binding : bindings) {
+      if (binding == texture) binding = 0;
+    }
+  }
+}
+
+void GlState::invalidate() {
+  program_ = UNKNOWN;
+  vao_ = UNKNOWN;
+  activeUnit_ = UNKNOWN;
+  textureUnits_.clear();
+}
+
+void GlState::beginFrame() {
+  lastFrameStats_ = stats_;
+  stats_ = {};
+}
+
+}  // namespace qrk
@@ -0,0 +1,90 @@
+#ifndef QUARKGL_GL_STATE_H_
+#define QUARKGL_GL_STATE_H_
+
+#include <glad/glad.h>
+
+#include <array>
+#include <vector>
+
+namespace qrk {
+
+// Counts of the binds made through GlState, and of the redundant ones that it
+// skipped.
+struct GlStateStats {
+  unsigned int programBinds = 0;
+  unsigned int programBindsSkipped = 0;
+  unsigned int vertexArrayBinds = 0;
+  unsigned int vertexArrayBindsSkipped = 0;
+  unsigned int activeTextureChanges = 0;
+  unsigned int activeTextureChangesSkipped = 0;
+  unsigned int textureBinds = 0;
+  unsigned int textureBindsSkipped = 0;
+
+  unsigned int getTotalSkipped() const {
+    return programBindsSkipped + vertexArrayBindsSkipped +
+           activeTextureChangesSkipped + textureBindsSkipped;
+  }
+};
+
+// A cache of the GL context's binding state, which skips calls that wouldn't
+// change it. All program, vertex array, and texture binds should go through
+// it; code that binds objects directly (e.g. third party renderers that don't
+// restore state) must call invalidate() afterwards.
+class GlState {
+ public:
+  // Returns the state of the current context.
+  static GlState& current();
+
+  void useProgram(unsigned int program);
+  void bindVertexArray(unsigned int vao);
+  // Sets the active texture unit, by index (rather than GL_TEXTUREi).
+  void activeTexture(unsigned int unit);
+  // Binds a texture to the active texture unit.
+  void bindTexture(GLenum target, unsigned int texture);
+  // Binds a texture to the given texture unit, changing the active unit only
+  // if it needs to.
+  void bindTextureToUnit(unsigned int unit, GLenum target,
+                         unsigned int texture);
+
+  // Must be called when objects are deleted, since GL unbinds them, and their
+  // names may be reused.
+  void onProgramDeleted(unsigned int program);
+  void onVertexArrayDeleted(unsigned int vao);
+  void onTextureDeleted(unsigned int texture);
+
+  // Forgets all cached state, so that the next binds are always made.
+  void invalidate();
+
+  // Stats are accumulated until the next frame begins.
+  void beginFrame();
+  const GlStateStats& getStats() const { return stats_; }
+  const GlStateStats& getLastFrameStats() const { return lastFrameStats_; }
+
+ private:
+  // Marks a binding whose value isn't known.
+  static constexpr unsigned int UNKNOWN = ~0u;
+  // The texture targets whose bindings are cached. Binds to other targets are
+  // always made.
+  static constexpr std::array<GLenum, 5> CACHED_TEXTURE_TARGETS = {
+      GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_MULTISAMPLE,
+      GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D};
+  using TextureUnitBindings =
+      std::array<unsigned int, CACHED_TEXTURE_TARGETS.size()>;
+
+  // Returns the cached binding of the target on the active unit, or nullptr
+  // if the target isn't cached.
+  unsigned int* getTextureBinding(unsigned int unit, GLenum target);
+
+  unsigned int program_ = UNKNOWN;
+  unsigned int vao_ = UNKNOWN;
+  unsigned int activeUnit_ = UNKNOWN;
+  // The bound textures of each unit, grown as units are used.
+  std::vector<TextureUnitBindings> textureUnits_;
+
+  GlStateStats stats_;
+  GlStateStats lastFrameStats_;
+};
+
+}  // namespace qrk
+
+#endif
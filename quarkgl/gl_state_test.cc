@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <qrk/gl_state.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// The GL calls that reach the driver, recorded in place of a real context.
+std::vector<std::string> calls;
+
+void APIENTRY fakeUseProgram(GLuint program) {
+  calls.push_back("useProgram " + std::to_string(program));
+}
+void APIENTRY fakeBindVertexArray(GLuint vao) {
+  calls.push_back("bindVertexArray " + std::to_string(vao));
+}
+void APIENTRY fakeActiveTexture(GLenum unit) {
+  calls.push_back("activeTexture " + std::to_string(unit - GL_TEXTURE0));
+}
+void APIENTRY fakeBindTexture(GLenum target, GLuint texture) {
+  calls.push_back("bindTexture " + std::to_string(texture));
+}
+
+class GlStateTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    glad_glUseProgram = fakeUseProgram;
+    glad_glBindVertexArray = fakeBindVertexArray;
+    glad_glActiveTexture = fakeActiveTexture;
+    glad_glBindTexture = fakeBindTexture;
+    calls.clear();
+  }
+
+  qrk::GlState state_;
+};
+
+TEST_F(GlStateTest, SkipsRedundantBinds) {
+  state_.useProgram(1);
+  state_.useProgram(1);
+  state_.bindVertexArray(2);
+  state_.bindVertexArray(2);
+  state_.useProgram(3);
+  EXPECT_EQ(calls, (std::vector<std::string>{
+                       "useProgram 1", "bindVertexArray 2", "useProgram 3"}));
+
+  const qrk::GlStateStats& stats = state_.getStats();
+  EXPECT_EQ(stats.programBinds, 2);
+  EXPECT_EQ(stats.programBindsSkipped, 1);
+  EXPECT_EQ(stats.vertexArrayBinds, 1);
+  EXPECT_EQ(stats.vertexArrayBindsSkipped, 1);
+  EXPECT_EQ(stats.getTotalSkipped(), 2);
+}
+
+TEST_F(GlStateTest, TracksTexturesPerUnitAndTarget) {
+  state_.bindTextureToUnit(0, GL_TEXTURE_2D, 5);
+  state_.bindTextureToUnit(1, GL_TEXTURE_2D, 6);
+  state_.bindTextureToUnit(1, GL_TEXTURE_CUBE_MAP, 7);
+  calls.clear();
+
+  // Already bound, so neither the unit nor the binding changes.
+  state_.bindTextureToUnit(0, GL_TEXTURE_2D, 5);
+  state_.bindTextureToUnit(1, GL_TEXTURE_CUBE_MAP, 7);
+  EXPECT_TRUE(calls.empty());
+
+  state_.bindTextureToUnit(1, GL_TEXTURE_2D, 8);
+  state_.bindTextureToUnit(0, GL_TEXTURE_2D, 8);
+  EXPECT_EQ(calls, (std::vector<std::string>{"bindTexture 8", "activeTexture 0",
+                                             "bindTexture 8"}));
+}
+
+TEST_F(GlStateTest, ForgetsDeletedTextures) {
+  state_.bindTextureToUnit(2, GL_TEXTURE_2D, 5);
+  state_.onTextureDeleted(5);
+  calls.clear();
+
+  // The name may be reused for a new texture, which must be bound.
+  state_.bindTextureToUnit(2, GL_TEXTURE_2D, 5);
+  EXPECT_EQ(calls, (std::vector<std::string>{"bindTexture 5"}));
+}
+
+TEST_F(GlStateTest, BindsEverythingAfterInvalidate) {
+  state_.useProgram(1);
+  state_.bindTextureToUnit(0, GL_TEXTURE_2D, 5);
+  state_.invalidate();
+  calls.clear();
+
+  state_.useProgram(1);
+  state_.bindTextureToUnit(0, GL_TEXTURE_2D, 5);
+  EXPECT_EQ(calls,
+            (std::vector<std::string>{"useProgram 1", "activeTexture 0",
+                                      "bindTexture 5"}));
+}
+
+TEST_F(GlStateTest, KeepsLastFrameStats) {
+  state_.useProgram(1);
+  state_.useProgram(1);
+  state_.beginFrame();
+  EXPECT_EQ(state_.getLastFrameStats().programBindsSkipped, 1);
+  EXPECT_EQ(state_.getStats().programBindsSkipped, 0);
+}
+
+}  // namespace
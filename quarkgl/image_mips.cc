@@ -0,0 +1,189 @@
+#include <qrk/image_mips.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace qrk {
+namespace {
+// The Kaiser filter's radius, in texels of the destination level, and its
+// window shape. These match common offline mip generators.
+constexpr float KAISER_RADIUS = 3.0f;
+constexpr float KAISER_ALPHA = 4.0f;
+constexpr float PI = 3.14159265358979f;
+
+float srgbToLinear(float value) {
+  return value <= 0.04045f ? value / 12.92f
+                           : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float value) {
+  return value <= 0.0031308f ? value * 12.92f
+                             : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// The zeroth-order modified Bessel function of the first kind.
+float besselI0(float x) {
+  float sum = 1.0f;
+  float term = 1.0f;
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2.0f * k)) * (x / (2.0f * k));
+    sum += term;
+    if (term < sum * 1e-7f) break;
+  }
+  return sum;
+}
+
+// Evaluates the filter at a distance t, in destination texels.
+float evaluateFilter(MipFilter filter, float t) {
+  switch (filter) {
+    case MipFilter::BOX:
+      return std::abs(t) < 0.5f ? 1.0f : 0.0f;
+    case MipFilter::KAISER: {
+      if (std::abs(t) >= KAISER_RADIUS) return 0.0f;
+      float sinc = t == 0.0f ? 1.0f : std::sin(PI * t) / (PI * t);
+      float window = t / KAISER_RADIUS;
+      return sinc *
+             besselI0(KAISER_ALPHA * std::sqrt(1.0f - window * window)) /
+             besselI0(KAISER_ALPHA);
+    }
+  }
+  return 0.0f;
+}
+
+float getFilterRadius(MipFilter filter) {
+  return filter == MipFilter::BOX ? 0.5f : KAISER_RADIUS;
+}
+
+// The source texels, and their weights, that make up one destination texel
+// along an axis.
+struct Taps {
+  int first;
+  std::vector<float> weights;
+};
+
+// Computes the taps for downsampling an axis from srcSize to dstSize texels.
+// Taps that fall off the edge are clamped onto it.
+std::vector<Taps> computeTaps(MipFilter filter, int srcSize, int dstSize) {
+  const float scale = static_cast<float>(srcSize) / dstSize;
+  const float radius = getFilterRadius(filter) * scale;
+  std::vector<Taps> taps(dstSize);
+  for (int dst = 0; dst < dstSize; dst++) {
+    const float center = (dst + 0.5f) * scale;
+    const int first = static_cast<int>(std::floor(center - radius));
+    const int last = static_cast<int>(std::ceil(center + radius));
+    const int begin = std::max(first, 0);
+    const int end = std::min(last, srcSize - 1);
+    std::vector<float> weights(end - begin + 1, 0.0f);
+    float total = 0.0f;
+    for (int src = first; src <= last; src++) {
+      float weight = evaluateFilter(filter, (src + 0.5f - center) / scale);
+      weights[std::clamp(src, begin, end) - begin] += weight;
+      total += weight;
+    }
+    // Trim source texels that don't contribute.
+    size_t trimBegin = 0, trimEnd = weights.size();
+    while (trimBegin < trimEnd && weights[trimBegin] == 0.0f) trimBegin++;
+    while (trimEnd > trimBegin && weights[trimEnd - 1] == 0.0f) trimEnd--;
+    taps[dst].first = begin + static_cast<int>(trimBegin);
+    taps[dst].weights.assign(weights.begin() + trimBegin,
+                             weights.begin() + trimEnd);
+    for (float& weight : taps[dst].weights) weight /= total;
+  }
+  return taps;
+}
+
+// Downsamples a floating point image. Rows are filtered first, and then
+// columns; the column pass accumulates whole rows at a time, which compilers
+// vectorize well.
+std::vector<float> downsample(const std::vector<float>& src, int srcWidth,
+                              int srcHeight, int dstWidth, int dstHeight,
+                              int numChannels, MipFilter filter) {
+  const std::vector<Taps> xTaps = computeTaps(filter, srcWidth, dstWidth);
+  const std::vector<Taps> yTaps = computeTaps(filter, srcHeight, dstHeight);
+
+  const size_t srcRowSize = static_cast<size_t>(srcWidth) * numChannels;
+  const size_t dstRowSize = static_cast<size_t>(dstWidth) * numChannels;
+  std::vector<float> rows(srcHeight * dstRowSize, 0.0f);
+  for (int y = 0; y < srcHeight; y++) {
+    const float* srcRow = &src[y * srcRowSize];
+    float* dstRow = &rows[y * dstRowSize];
+    for (int x = 0; x < dstWidth; x++) {
+      const Taps& tap = xTaps[x];
+      float* out = dstRow + x * numChannels;
+      for (size_t k = 0; k < tap.weights.size(); k++) {
+        const float* in = srcRow + (tap.first + k) * numChannels;
+        for (int c = 0; c < numChannels; c++) {
+          out[c] += tap.weights[k] * in[c];
+        }
+      }
+    }
+  }
+
+  std::vector<float> dst(dstHeight * dstRowSize, 0.0f);
+  for (int y = 0; y < dstHeight; y++) {
+    const Taps& tap = yTaps[y];
+    float* out = &dst[y * dstRowSize];
+    for (size_t k = 0; k < tap.weights.size(); k++) {
+      const float weight = tap.weights[k];
+      const float* in = &rows[(tap.first + k) * dstRowSize];
+      for (size_t i = 0; i < dstRowSize; i++) {
+        out[i] += weight * in[i];
+      }
+    }
+  }
+  return dst;
+}
+}  // namespace
+
+std::vector<ImageMip> generateImageMips(const unsigned char* pixels, int width,
+                                        int height, int numChannels,
+                                        bool isSRGB, MipFilter filter,
+                                        int maxNumMips) {
+  static const std::array<float, 256> toLinear = [] {
+    std::array<float, 256> table;
+    for (int i = 0; i < 256; i++) table[i] = srgbToLinear(i / 255.0f);
+    return table;
+  }();
+  // Alpha, and the channels of 1- and 2-channel images, are never in sRGB.
+  const int numColorChannels = isSRGB && numChannels >= 3 ? 3 : 0;
+
+  const size_t numValues = static_cast<size_t>(width) * height * numChannels;
+  std::vector<float> level(numValues);
+  for (size_t i = 0; i < numValues; i++) {
+    level[i] = static_cast<int>(i % numChannels) < numColorChannels
+                   ? toLinear[pixels[i]]
+                   : pixels[i] / 255.0f;
+  }
+
+  std::vector<ImageMip> mips;
+  int levelWidth = width;
+  int levelHeight = height;
+  while ((levelWidth > 1 || levelHeight > 1) &&
+         (maxNumMips < 0 || static_cast<int>(mips.size()) + 1 < maxNumMips)) {
+    const int nextWidth = std::max(levelWidth / 2, 1);
+    const int nextHeight = std::max(levelHeight / 2, 1);
+    level = downsample(level, levelWidth, levelHeight, nextWidth, nextHeight,
+                       numChannels, filter);
+    levelWidth = nextWidth;
+    levelHeight = nextHeight;
+
+    ImageMip& mip = mips.emplace_back();
+    mip.width = levelWidth;
+    mip.height = levelHeight;
+    mip.pixels.resize(level.size());
+    for (size_t i = 0; i < level.size(); i++) {
+      // Sharper filters can overshoot, and the overshoot shouldn't carry on
+      // into the next level.
+      level[i] = std::clamp(level[i], 0.0f, 1.0f);
+      float value = level[i];
+      if (static_cast<int>(i % numChannels) < numColorChannels) {
+        value = linearToSrgb(value);
+      }
+      mip.pixels[i] = static_cast<unsigned char>(std::lround(value * 255.0f));
+    }
+  }
+  return mips;
+}
+
+}  // namespace qrk
@@ -0,0 +1,40 @@
+#ifndef QUARKGL_IMAGE_MIPS_H_
+#define QUARKGL_IMAGE_MIPS_H_
+
+#include <vector>
+
+namespace qrk {
+
+// The filter used to downsample CPU-generated mips.
+enum class MipFilter {
+  // Averages each 2x2 block of texels. Cheap, and matches what drivers
+  // typically do for glGenerateMipmap.
+  BOX = 0,
+  // A Kaiser-windowed sinc, which keeps distant mips noticeably sharper than
+  // the box filter, at the cost of a wider footprint.
+  KAISER,
+};
+
+// A single CPU-side mip level of 8-bit image data.
+struct ImageMip {
+  int width;
+  int height;
+  std::vector<unsigned char> pixels;
+};
+
+// Generates the mip levels below an 8-bit image with 1 to 4 channels, down to
+// 1x1, or until the chain (including the image itself) has maxNumMips levels.
+// Each level is filtered from the one above it, in floating point. Color
+// channels of sRGB images (i.e. RGB of 3- and 4-channel images) are filtered
+// in linear space; alpha never is. Image edges are clamped.
+//
+// Doesn't touch any GL state, so this is safe to call from any thread.
+std::vector<ImageMip> generateImageMips(const unsigned char* pixels, int width,
+                                        int height, int numChannels,
+                                        bool isSRGB,
+                                        MipFilter filter = MipFilter::BOX,
+                                        int maxNumMips = -1);
+
+}  // namespace qrk
+
+#endif
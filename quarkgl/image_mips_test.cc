@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <qrk/image_mips.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+TEST(GenerateImageMipsTest, GeneratesFullChain) {
+  std::vector<unsigned char> pixels(16 * 4 * 3, 0);
+  std::vector<qrk::ImageMip> mips =
+      qrk::generateImageMips(pixels.data(), 16, 4, 3, /*isSRGB=*/false);
+  ASSERT_EQ(mips.size(), 4);
+  EXPECT_EQ(mips[0].width, 8);
+  EXPECT_EQ(mips[0].height, 2);
+  EXPECT_EQ(mips[3].width, 1);
+  EXPECT_EQ(mips[3].height, 1);
+  EXPECT_EQ(mips[3].pixels.size(), 3);
+}
+
+TEST(GenerateImageMipsTest, RespectsMaxNumMips) {
+  std::vector<unsigned char> pixels(16 * 16, 0);
+  // The image itself counts as the first mip.
+  EXPECT_EQ(qrk::generateImageMips(pixels.data(), 16, 16, 1, false,
+                                   qrk::MipFilter::BOX, /*maxNumMips=*/3)
+                .size(),
+            2);
+  EXPECT_TRUE(qrk::generateImageMips(pixels.data(), 16, 16, 1, false,
+                                     qrk::MipFilter::BOX, /*maxNumMips=*/1)
+                  .empty());
+}
+
+TEST(GenerateImageMipsTest, BoxAveragesInLinearSpace) {
+  // A checkerboard of black and white, with half-transparent alpha.
+  std::vector<unsigned char> pixels = {
+      0,   0,   0,   0,    255, 255, 255, 255,
+      255, 255, 255, 255,  0,   0,   0,   0,
+  };
+  std::vector<qrk::ImageMip> srgb =
+      qrk::generateImageMips(pixels.data(), 2, 2, 4, /*isSRGB=*/true);
+  ASSERT_EQ(srgb.size(), 1);
+  // Linear 0.5 is about 188 in sRGB, while alpha is averaged as-is.
+  EXPECT_EQ(srgb[0].pixels[0], 188);
+  EXPECT_EQ(srgb[0].pixels[3], 128);
+
+  std::vector<qrk::ImageMip> linear =
+      qrk::generateImageMips(pixels.data(), 2, 2, 4, /*isSRGB=*/false);
+  EXPECT_EQ(linear[0].pixels[0], 128);
+}
+
+TEST(GenerateImageMipsTest, FiltersPreserveFlatImages) {
+  for (qrk::MipFilter filter : {qrk::MipFilter::BOX, qrk::MipFilter::KAISER}) {
+    // Odd sizes exercise uneven footprints.
+    std::vector<unsigned char> pixels(13 * 7 * 2);
+    for (size_t i = 0; i < pixels.size(); i += 2) {
+      pixels[i] = 100;
+      pixels[i + 1] = 200;
+    }
+    for (const qrk::ImageMip& mip :
+         qrk::generateImageMips(pixels.data(), 13, 7, 2, false, filter)) {
+      for (size_t i = 0; i < mip.pixels.size(); i += 2) {
+        ASSERT_EQ(mip.pixels[i], 100);
+        ASSERT_EQ(mip.pixels[i + 1], 200);
+      }
+    }
+  }
+}
+
+TEST(GenerateImageMipsTest, KaiserKeepsMoreContrastThanBox) {
+  // A sine wave with a period of 8 texels, which the box filter noticeably
+  // attenuates, but which the first mip can still represent.
+  constexpr int size = 64;
+  std::vector<unsigned char> pixels(size * size);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      pixels[y * size + x] = static_cast<unsigned char>(
+          std::lround(127.5 + 127.5 * std::sin(2.0 * M_PI * (x + 1) / 8.0)));
+    }
+  }
+  auto contrast = [](const qrk::ImageMip& mip) {
+    int lo = 255, hi = 0;
+    for (unsigned char value : mip.pixels) {
+      lo = std::min<int>(lo, value);
+      hi = std::max<int>(hi, value);
+    }
+    return hi - lo;
+  };
+  std::vector<qrk::ImageMip> box = qrk::generateImageMips(
+      pixels.data(), size, size, 1, false, qrk::MipFilter::BOX);
+  std::vector<qrk::ImageMip> kaiser = qrk::generateImageMips(
+      pixels.data(), size, size, 1, false, qrk::MipFilter::KAISER);
+  EXPECT_GT(contrast(kaiser[0]), contrast(box[0]));
+}
+
+}  // namespace
@@ -1,42 +1,137 @@
 #include <qrk/light.h>
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 namespace qrk {
+namespace {
+
+constexpr uint8_t ALL_REGIONS = (1 << MappedStorageBuffer::REGION_COUNT) - 1;
+// The smallest number of lights that a buffer is allocated for.
+constexpr size_t MIN_LIGHT_CAPACITY = 16;
+
+float getPeakIntensity(glm::vec3 diffuse, glm::vec3 specular) {
+  return std::max({diffuse.r, diffuse.g, diffuse.b, specular.r, specular.g,
+                   specular.b});
+}
+
+}  // namespace
+
+float calculateLightRadius(const Attenuation& attenuation, float intensity) {
+  // Solve intensity / (constant + linear * d + quadratic * d^2) = cutoff.
+  const float c = attenuation.constant - intensity / LIGHT_RADIUS_CUTOFF;
+  if (c >= 0.0f) {
+    // Never reaches the cutoff.
+    return 0.0f;
+  }
+  const float a = attenuation.quadratic;
+  const float b = attenuation.linear;
+  if (a > 0.0f) {
+    return (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+  }
+  if (b > 0.0f) {
+    return -c / b;
+  }
+  return std::numeric_limits<float>::infinity();
+}
+
+LightRegistry::LightRegistry() {
+  lists_[static_cast<int>(LightType::DIRECTIONAL_LIGHT)] = {
+      .binding = DIRECTIONAL_LIGHT_STORAGE_BINDING,
+      .stride = sizeof(DirectionalLightData)};
+  lists_[static_cast<int>(LightType::POINT_LIGHT)] = {
+      .binding = POINT_LIGHT_STORAGE_BINDING, .stride = sizeof(PointLightData)};
+  lists_[static_cast<int>(LightType::SPOT_LIGHT)] = {
+      .binding = SPOT_LIGHT_STORAGE_BINDING, .stride = sizeof(SpotLightData)};
+}
+
 void LightRegistry::addLight(std::shared_ptr<Light> light) {
-  // TODO: Throw an error if this exceeds the max light count supported in the
-  // shader.
+  LightList& list = lists_[static_cast<int>(light->getLightType())];
+  light->setLightIdx(list.lights.size());
+  list.lights.push_back(light.get());
+  list.staleRegions.push_back(ALL_REGIONS);
   lights_.push_back(light);
+}
+
+void LightRegistry::updateUniforms(Shader& shader) { updateLightBuffers(); }
+
+void LightRegistry::updateLightBuffers() {
+  if (viewSource_ != nullptr) {
+    glm::mat4 view = viewSource_->getViewTransform();
+    if (!hasView_ || view != view_) applyViewTransform(view);
+  }
 
-  switch (light->getLightType()) {
-    case LightType::DIRECTIONAL_LIGHT:
-      light->setLightIdx(directionalCount_);
-      directionalCount_++;
-      break;
-    case LightType::POINT_LIGHT:
-      light->setLightIdx(pointCount_);
-      pointCount_++;
-      break;
-    case LightType::SPOT_LIGHT:
-      light->setLightIdx(spotCount_);
-      spotCount_++;
-      break;
+  stats_ = {};
+  for (LightList& list : lists_) {
+    updateLightList(list);
   }
 }
 
-void LightRegistry::updateUniforms(Shader& shader) {
-  if (viewSource_ != nullptr) {
-    applyViewTransform(viewSource_->getViewTransform());
+void LightRegistry::updateLightList(LightList& list) {
+  size_t capacity = 0;
+  if (list.buffer != nullptr) {
+    capacity = (list.buffer->getRegionSize() - LIGHT_STORAGE_HEADER_SIZE) /
+               list.stride;
+  }
+  bool changed = false;
+  if (list.buffer == nullptr || list.lights.size() > capacity) {
+    // Grow geometrically, so that adding lights one at a time doesn't
+    // reallocate every frame. Every light has to be written to the new buffer.
+    const size_t newCapacity =
+        std::max(MIN_LIGHT_CAPACITY, std::bit_ceil(list.lights.size()));
+    list.buffer = std::make_unique<MappedStorageBuffer>(
+        list.binding, LIGHT_STORAGE_HEADER_SIZE + newCapacity * list.stride);
+    std::fill(list.staleRegions.begin(), list.staleRegions.end(), ALL_REGIONS);
+    // Fill a region even if no light changed (e.g. the list is empty), so that
+    // the bound region holds the light count.
+    changed = true;
   }
-  shader.setInt("qrk_directionalLightCount", directionalCount_);
-  shader.setInt("qrk_pointLightCount", pointCount_);
-  shader.setInt("qrk_spotLightCount", spotCount_);
 
-  for (auto light : lights_) {
-    light->updateUniforms(shader);
+  for (size_t i = 0; i < list.lights.size(); i++) {
+    Light* light = list.lights[i];
+    // Lights that moved since the view was last applied need it applied again.
+    if (hasView_ && light->hasViewDependentChanged_ &&
+        !light->hasViewBeenApplied_) {
+      light->applyViewTransform(view_);
+    }
+    if (light->hasChanged()) {
+      light->checkState();
+      light->resetChangeDetection();
+      list.staleRegions[i] = ALL_REGIONS;
+      changed = true;
+    }
+  }
+
+  // The current region may still be read by the GPU, so changes always go to
+  // the next one, which also has to catch up on changes that it missed. The
+  // count is always written, since the region may hold an older one.
+  if (changed) {
+    std::byte* region = list.buffer->nextRegion();
+    const uint8_t regionBit = 1 << list.buffer->getRegion();
+    const int count = list.lights.size();
+    std::memcpy(region, &count, sizeof(count));
+    std::byte* data = region + LIGHT_STORAGE_HEADER_SIZE;
+    for (size_t i = 0; i < list.lights.size(); i++) {
+      if (list.staleRegions[i] & regionBit) {
+        list.lights[i]->writeData(data + i * list.stride);
+        list.staleRegions[i] &= ~regionBit;
+        stats_.lightsWritten++;
+      } else {
+        stats_.lightsSkipped++;
+      }
+    }
+  } else {
+    stats_.lightsSkipped += list.lights.size();
   }
+  list.buffer->bind();
 }
 
 void LightRegistry::applyViewTransform(const glm::mat4& view) {
-  // TODO: Only do this when we need to.
+  view_ = view;
+  hasView_ = true;
   for (auto light : lights_) {
     light->applyViewTransform(view);
   }
@@ -54,20 +149,12 @@ DirectionalLight::DirectionalLight(glm::vec3 direction, glm::vec3 diffuse,
       diffuse_(diffuse),
       specular_(specular) {}
 
-void DirectionalLight::updateUniforms(Shader& shader) {
-  checkState();
-
-  if (hasViewBeenApplied_) {
-    shader.setVec3(uniformName_ + ".direction",
-                   useViewTransform_ ? viewDirection_ : direction_);
-  }
-  if (hasLightChanged_) {
-    shader.setVec3(uniformName_ + ".diffuse", diffuse_);
-    shader.setVec3(uniformName_ + ".specular", specular_);
-  }
-
-  // TODO: Fix change detection to work with >1 shaders.
-  // resetChangeDetection();
+void DirectionalLight::writeData(std::byte* data) {
+  DirectionalLightData lightData;
+  lightData.direction = useViewTransform_ ? viewDirection_ : direction_;
+  lightData.diffuse = diffuse_;
+  lightData.specular = specular_;
+  std::memcpy(data, &lightData, sizeof(lightData));
 }
 
 void DirectionalLight::applyViewTransform(const glm::mat4& view) {
@@ -82,24 +169,15 @@ PointLight::PointLight(glm::vec3 position, glm::vec3 diffuse,
       specular_(specular),
       attenuation_(attenuation) {}
 
-void PointLight::updateUniforms(Shader& shader) {
-  checkState();
-
-  if (hasViewBeenApplied_) {
-    shader.setVec3(uniformName_ + ".position",
-                   useViewTransform_ ? viewPosition_ : position_);
-  }
-  if (hasLightChanged_) {
-    shader.setVec3(uniformName_ + ".diffuse", diffuse_);
-    shader.setVec3(uniformName_ + ".specular", specular_);
-    shader.setFloat(uniformName_ + ".attenuation.constant",
-                    attenuation_.constant);
-    shader.setFloat(uniformName_ + ".attenuation.linear", attenuation_.linear);
-    shader.setFloat(uniformName_ + ".attenuation.quadratic",
-                    attenuation_.quadratic);
-  }
-
-  // resetChangeDetection();
+void PointLight::writeData(std::byte* data) {
+  PointLightData lightData;
+  lightData.position = useViewTransform_ ? viewPosition_ : position_;
+  lightData.diffuse = diffuse_;
+  lightData.specular = specular_;
+  lightData.attenuation = attenuation_;
+  lightData.radius = calculateLightRadius(
+      attenuation_, getPeakIntensity(diffuse_, specular_));
+  std::memcpy(data, &lightData, sizeof(lightData));
 }
 
 void PointLight::applyViewTransform(const glm::mat4& view) {
@@ -118,28 +196,18 @@ SpotLight::SpotLight(glm::vec3 position, glm::vec3 direction, float innerAngle,
       specular_(specular),
       attenuation_(attenuation) {}
 
-void SpotLight::updateUniforms(Shader& shader) {
-  checkState();
-
-  if (hasViewBeenApplied_) {
-    shader.setVec3(uniformName_ + ".position",
-                   useViewTransform_ ? viewPosition_ : position_);
-    shader.setVec3(uniformName_ + ".direction",
-                   useViewTransform_ ? viewDirection_ : direction_);
-  }
-  if (hasLightChanged_) {
-    shader.setFloat(uniformName_ + ".innerAngle", innerAngle_);
-    shader.setFloat(uniformName_ + ".outerAngle", outerAngle_);
-    shader.setVec3(uniformName_ + ".diffuse", diffuse_);
-    shader.setVec3(uniformName_ + ".specular", specular_);
-    shader.setFloat(uniformName_ + ".attenuation.constant",
-                    attenuation_.constant);
-    shader.setFloat(uniformName_ + ".attenuation.linear", attenuation_.linear);
-    shader.setFloat(uniformName_ + ".attenuation.quadratic",
-                    attenuation_.quadratic);
-  }
-
-  // resetChangeDetection();
+void SpotLight::writeData(std::byte* data) {
+  SpotLightData lightData;
+  lightData.position = useViewTransform_ ? viewPosition_ : position_;
+  lightData.direction = useViewTransform_ ? viewDirection_ : direction_;
+  lightData.innerAngle = innerAngle_;
+  lightData.outerAngle = outerAngle_;
+  lightData.diffuse = diffuse_;
+  lightData.specular = specular_;
+  lightData.attenuation = attenuation_;
+  lightData.radius = calculateLightRadius(
+      attenuation_, getPeakIntensity(diffuse_, specular_));
+  std::memcpy(data, &lightData, sizeof(lightData));
 }
 
 void SpotLight::applyViewTransform(const glm::mat4& view) {
@@ -3,9 +3,13 @@
 
 #include <qrk/exceptions.h>
 #include <qrk/shader.h>
+#include <qrk/storage_buffer.h>
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
-#include <string>
+#include <memory>
 #include <vector>
 
 namespace qrk {
@@ -28,6 +32,55 @@ constexpr glm::vec3 DEFAULT_SPECULAR = glm::vec3(1.0f, 1.0f, 1.0f);
 constexpr float DEFAULT_INNER_ANGLE = glm::radians(10.5f);
 constexpr float DEFAULT_OUTER_ANGLE = glm::radians(19.5f);
 
+// std430 layouts of the light structs in lights.glsl. In std430, vec3s are
+// aligned to 16 bytes, but a scalar (or a struct of scalars) may follow a vec3
+// directly. Each struct is padded to its 16 byte alignment.
+struct DirectionalLightData {
+  alignas(16) glm::vec3 direction;
+  alignas(16) glm::vec3 diffuse;
+  alignas(16) glm::vec3 specular;
+};
+
+struct PointLightData {
+  alignas(16) glm::vec3 position;
+  alignas(16) glm::vec3 diffuse;
+  alignas(16) glm::vec3 specular;
+  Attenuation attenuation;
+  float radius;
+};
+
+struct SpotLightData {
+  alignas(16) glm::vec3 position;
+  alignas(16) glm::vec3 direction;
+  float innerAngle;
+  float outerAngle;
+  alignas(16) glm::vec3 diffuse;
+  alignas(16) glm::vec3 specular;
+  Attenuation attenuation;
+  float radius;
+};
+
+static_assert(sizeof(DirectionalLightData) == 48);
+static_assert(sizeof(PointLightData) == 64);
+static_assert(offsetof(PointLightData, attenuation) == 44);
+static_assert(offsetof(PointLightData, radius) == 56);
+static_assert(sizeof(SpotLightData) == 96);
+static_assert(offsetof(SpotLightData, outerAngle) == 32);
+static_assert(offsetof(SpotLightData, attenuation) == 76);
+static_assert(offsetof(SpotLightData, radius) == 88);
+
+// The fraction of a light's peak intensity below which it's considered to have
+// no effect.
+constexpr float LIGHT_RADIUS_CUTOFF = 1.0f / 256.0f;
+
+// Returns the distance at which a light with the given attenuation and peak
+// intensity falls below LIGHT_RADIUS_CUTOFF, or infinity if it never does.
+float calculateLightRadius(const Attenuation& attenuation, float intensity);
+
+// The size of the header that precedes each light array in its storage block,
+// which holds the light count.
+constexpr size_t LIGHT_STORAGE_HEADER_SIZE = 16;
+
 enum class LightType {
   DIRECTIONAL_LIGHT,
   POINT_LIGHT,
@@ -43,15 +96,13 @@ class Light {
 
   void setUseViewTransform(bool useViewTransform) {
     useViewTransform_ = useViewTransform;
+    hasLightChanged_ = true;
   }
 
   friend LightRegistry;
 
  protected:
-  void setLightIdx(unsigned int lightIdx) {
-    lightIdx_ = lightIdx;
-    uniformName_ = getUniformName(lightIdx);
-  }
+  void setLightIdx(unsigned int lightIdx) { lightIdx_ = lightIdx; }
 
   void checkState() {
     if (hasViewDependentChanged_ && !hasViewBeenApplied_) {
@@ -61,23 +112,27 @@ class Light {
     }
   }
 
+  // Whether the light's data needs to be rewritten.
+  bool hasChanged() const {
+    return hasLightChanged_ || hasViewDependentChanged_ || hasViewBeenApplied_;
+  }
+
   void resetChangeDetection() {
     hasViewDependentChanged_ = false;
     hasLightChanged_ = false;
     hasViewBeenApplied_ = false;
   }
 
-  virtual std::string getUniformName(unsigned int lightIdx) const = 0;
-  virtual void updateUniforms(Shader& shader) = 0;
+  // Writes the light's std430 struct to the given storage.
+  virtual void writeData(std::byte* data) = 0;
   virtual void applyViewTransform(const glm::mat4& view) = 0;
 
   unsigned int lightIdx_;
-  std::string uniformName_;
 
   // Whether the light's position uniforms should be in view space. If false,
   // the positions are instead in world space.
   bool useViewTransform_ = true;
-  // Start as `true` so that initial uniform values get set.
+  // Start as `true` so that initial values get written.
   bool hasViewDependentChanged_ = true;
   bool hasLightChanged_ = true;
 
@@ -90,8 +145,20 @@ class ViewSource {
   virtual glm::mat4 getViewTransform() const = 0;
 };
 
+// Counts of the lights written by the last update, and of the ones that were
+// skipped because they hadn't changed.
+struct LightUploadStats {
+  unsigned int lightsWritten = 0;
+  unsigned int lightsSkipped = 0;
+};
+
+// Holds the lights of a scene, and writes them to a shader storage block per
+// light type. The blocks are shared by all programs, and persistently mapped,
+// so only lights that have changed (including by the view moving) are written,
+// and only once rather than once per shader.
 class LightRegistry : public UniformSource {
  public:
+  LightRegistry();
   virtual ~LightRegistry() = default;
   void addLight(std::shared_ptr<Light> light);
   // Sets the view source used to update the light uniforms. The source is
@@ -99,7 +166,17 @@ class LightRegistry : public UniformSource {
   void setViewSource(std::shared_ptr<ViewSource> viewSource) {
     viewSource_ = viewSource;
   }
+  // Updates the light buffers. The shader is unused, since the buffers are
+  // bound to binding points that all programs share.
   void updateUniforms(Shader& shader);
+  // Writes the lights that have changed to the light buffers, and binds them.
+  void updateLightBuffers();
+  const LightUploadStats& getStats() const { return stats_; }
+  // Returns the storage buffer of the given light type, or nullptr if the
+  // lights haven't been updated yet.
+  const MappedStorageBuffer* getLightBuffer(LightType type) const {
+    return lists_[static_cast<int>(type)].buffer.get();
+  }
 
   // Applies the view transform to the registered lights. This is automatically
   // called if a view source has been set.
@@ -110,12 +187,30 @@ class LightRegistry : public UniformSource {
   void setUseViewTransform(bool useViewTransform);
 
  private:
-  unsigned int directionalCount_ = 0;
-  unsigned int pointCount_ = 0;
-  unsigned int spotCount_ = 0;
+  // The lights of a single type, and the buffer that they're written to.
+  struct LightList {
+    unsigned int binding = 0;
+    size_t stride = 0;
+    std::vector<Light*> lights = {};
+    // For each light, a bitmask of the buffer regions that don't hold its
+    // latest data.
+    std::vector<uint8_t> staleRegions = {};
+    // Created on first update, since it needs a GL context.
+    std::unique_ptr<MappedStorageBuffer> buffer = nullptr;
+  };
+
+  void updateLightList(LightList& list);
 
   std::shared_ptr<ViewSource> viewSource_;
   std::vector<std::shared_ptr<Light>> lights_;
+  // Indexed by LightType.
+  std::array<LightList, 3> lists_;
+
+  // The last view transform that was applied, if any.
+  glm::mat4 view_ = glm::mat4(1.0f);
+  bool hasView_ = false;
+
+  LightUploadStats stats_;
 };
 
 class DirectionalLight : public Light {
@@ -144,15 +239,12 @@ class DirectionalLight : public Light {
   }
 
  protected:
-  std::string getUniformName(unsigned int lightIdx) const {
-    return "qrk_directionalLights[" + std::to_string(lightIdx) + "]";
-  }
-  void updateUniforms(Shader& shader);
+  void writeData(std::byte* data);
   void applyViewTransform(const glm::mat4& view);
 
  private:
   glm::vec3 direction_;
-  glm::vec3 viewDirection_;
+  glm::vec3 viewDirection_ = glm::vec3(0.0f);
 
   glm::vec3 diffuse_;
   glm::vec3 specular_;
@@ -189,15 +281,12 @@ class PointLight : public Light {
   }
 
  protected:
-  std::string getUniformName(unsigned int lightIdx) const {
-    return "qrk_pointLights[" + std::to_string(lightIdx) + "]";
-  }
-  void updateUniforms(Shader& shader);
+  void writeData(std::byte* data);
   void applyViewTransform(const glm::mat4& view);
 
  private:
   glm::vec3 position_;
-  glm::vec3 viewPosition_;
+  glm::vec3 viewPosition_ = glm::vec3(0.0f);
 
   glm::vec3 diffuse_;
   glm::vec3 specular_;
@@ -244,17 +333,14 @@ class SpotLight : public Light {
   }
 
  protected:
-  std::string getUniformName(unsigned int lightIdx) const {
-    return "qrk_spotLights[" + std::to_string(lightIdx) + "]";
-  }
-  void updateUniforms(Shader& shader);
+  void writeData(std::byte* data);
   void applyViewTransform(const glm::mat4& view);
 
  private:
   glm::vec3 position_;
-  glm::vec3 viewPosition_;
+  glm::vec3 viewPosition_ = glm::vec3(0.0f);
   glm::vec3 direction_;
-  glm::vec3 viewDirection_;
+  glm::vec3 viewDirection_ = glm::vec3(0.0f);
 
   float innerAngle_;
   float outerAngle_;
@@ -0,0 +1,140 @@
+#include <qrk/light_clusters.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace qrk {
+namespace {
+
+bool sphereIntersectsBox(const BoundingSphere& sphere, const BoundingBox& box) {
+  if (sphere.radius <= 0.0f) return false;
+  glm::vec3 closest = glm::clamp(sphere.center, box.min, box.max);
+  glm::vec3 offset = sphere.center - closest;
+  return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+}
+
+}  // namespace
+
+float getClusterSliceDepth(const ClusterGrid& grid, unsigned int slice,
+                           float near, float far) {
+  return near * std::pow(far / near, slice / static_cast<float>(grid.size.z));
+}
+
+std::vector<BoundingBox> computeClusterBounds(const ClusterGrid& grid,
+                                              const ClusterView& view) {
+  const glm::mat4 inverseProjection = glm::inverse(view.projection);
+  // Returns the point on the near plane at the given NDC coordinates.
+  auto unproject = [&](glm::vec2 ndc) {
+    glm::vec4 point = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+    return glm::vec3(point) / point.w;
+  };
+
+  std::vector<BoundingBox> bounds(grid.getClusterCount());
+  const glm::vec2 tileSize = 2.0f / glm::vec2(grid.size.x, grid.size.y);
+  for (unsigned int y = 0; y < grid.size.y; y++) {
+    for (unsigned int x = 0; x < grid.size.x; x++) {
+      glm::vec2 tileMin = glm::vec2(x, y) * tileSize - 1.0f;
+      glm::vec3 nearMin = unproject(tileMin);
+      glm::vec3 nearMax = unproject(tileMin + tileSize);
+      for (unsigned int z = 0; z < grid.size.z; z++) {
+        // Points on the near plane are scaled along their view ray to reach
+        // the slice's depths.
+        float sliceNear = getClusterSliceDepth(grid, z, view.near, view.far);
+        float sliceFar = getClusterSliceDepth(grid, z + 1, view.near, view.far);
+        BoundingBox& box = bounds[grid.getClusterIndex(glm::uvec3(x, y, z))];
+        for (float depth : {sliceNear, sliceFar}) {
+          box.expand(nearMin * (depth / view.near));
+          box.expand(nearMax * (depth / view.near));
+        }
+      }
+    }
+  }
+  return bounds;
+}
+
+glm::uvec3 findCluster(const ClusterGrid& grid, const ClusterView& view,
+                       glm::vec3 position) {
+  glm::vec4 clip = view.projection * glm::vec4(position, 1.0f);
+  glm::vec2 screen = glm::vec2(clip) / clip.w * 0.5f + 0.5f;
+  glm::ivec2 tile = glm::floor(screen * glm::vec2(grid.size.x, grid.size.y));
+  tile = glm::clamp(tile, glm::ivec2(0),
+                    glm::ivec2(grid.size.x, grid.size.y) - 1);
+
+  float depth = std::max(-position.z, view.near);
+  int slice = static_cast<int>(std::floor(std::log(depth / view.near) /
+                                          std::log(view.far / view.near) *
+                                          grid.size.z));
+  slice = std::clamp(slice, 0, static_cast<int>(grid.size.z) - 1);
+  return glm::uvec3(tile.x, tile.y, slice);
+}
+
+LightClusterLists binLights(const ClusterGrid& grid,
+                            std::span<const BoundingBox> clusterBounds,
+                            std::span<const BoundingSphere> lights) {
+  LightClusterLists lists;
+  lists.counts.resize(clusterBounds.size(), 0);
+  lists.indices.resize(clusterBounds.size() * grid.maxLightsPerCluster, 0);
+  for (size_t i = 0; i < clusterBounds.size(); i++) {
+    unsigned int& count = lists.counts[i];
+    unsigned int* indices = &lists.indices[i * grid.maxLightsPerCluster];
+    for (size_t j = 0; j < lights.size(); j++) {
+      if (count == grid.maxLightsPerCluster) break;
+      if (sphereIntersectsBox(lights[j], clusterBounds[i])) {
+        indices[count++] = j;
+      }
+    }
+  }
+  return lists;
+}
+
+LightClusterShader::LightClusterShader()
+    : ComputeShader(ShaderPath("quarkgl/shaders/builtin/light_clusters.comp")) {
+}
+
+LightClusterPass::LightClusterPass(ClusterGrid grid)
+    : grid_(grid),
+      view_{.projection = glm::mat4(1.0f), .near = 0.1f, .far = 1.0f},
+      counts_(LIGHT_CLUSTER_COUNT_STORAGE_BINDING,
+              grid.getClusterCount() * sizeof(unsigned int)),
+      indices_(LIGHT_CLUSTER_INDEX_STORAGE_BINDING,
+               grid.getClusterCount() * grid.maxLightsPerCluster *
+                   sizeof(unsigned int)) {}
+
+void LightClusterPass::cull(LightRegistry& lightRegistry,
+                            const Camera& camera) {
+  view_ = {
+      .projection = camera.getProjectionTransform(),
+      .near = camera.getNearPlane(),
+      .far = camera.getFarPlane(),
+  };
+  // The shader reads the lights straight from the registry's buffers.
+  lightRegistry.updateLightBuffers();
+
+  static const UniformName inverseProjection("qrk_clusterInverseProjection");
+  shader_.setMat4(inverseProjection, glm::inverse(view_.projection));
+  updateUniforms(shader_);
+
+  counts_.bind();
+  indices_.bind();
+  const unsigned int clusterCount = grid_.getClusterCount();
+  shader_.dispatch((clusterCount + LIGHT_CLUSTER_WORK_GROUP_SIZE - 1) /
+                   LIGHT_CLUSTER_WORK_GROUP_SIZE);
+
+  // Guard until the lists are written.
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void LightClusterPass::updateUniforms(Shader& shader) {
+  static const UniformName gridSize("qrk_clusterGridSize");
+  static const UniformName maxLightsPerCluster("qrk_maxLightsPerCluster");
+  static const UniformName projection("qrk_clusterProjection");
+  static const UniformName near("qrk_clusterNear");
+  static const UniformName far("qrk_clusterFar");
+  shader.setUVec3(gridSize, grid_.size);
+  shader.setUInt(maxLightsPerCluster, grid_.maxLightsPerCluster);
+  shader.setMat4(projection, view_.projection);
+  shader.setFloat(near, view_.near);
+  shader.setFloat(far, view_.far);
+}
+
+}  // namespace qrk
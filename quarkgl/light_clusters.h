@@ -0,0 +1,109 @@
+#ifndef QUARKGL_LIGHT_CLUSTERS_H_
+#define QUARKGL_LIGHT_CLUSTERS_H_
+
+#include <qrk/bounds.h>
+#include <qrk/camera.h>
+#include <qrk/light.h>
+#include <qrk/shader.h>
+#include <qrk/storage_buffer.h>
+
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace qrk {
+
+// The number of clusters along each axis of the view frustum: X and Y tile the
+// screen, and Z slices the depth range.
+constexpr glm::uvec3 DEFAULT_CLUSTER_GRID_SIZE = glm::uvec3(16, 9, 24);
+// Lights past this many in a single cluster are dropped.
+constexpr unsigned int DEFAULT_MAX_LIGHTS_PER_CLUSTER = 128;
+// Must match local_size_x in light_clusters.comp.
+constexpr unsigned int LIGHT_CLUSTER_WORK_GROUP_SIZE = 64;
+
+// The layout of the clusters that the view frustum is divided into ("froxels").
+// Depth slices are spaced exponentially, so that clusters are roughly as deep
+// as they are wide.
+struct ClusterGrid {
+  glm::uvec3 size = DEFAULT_CLUSTER_GRID_SIZE;
+  unsigned int maxLightsPerCluster = DEFAULT_MAX_LIGHTS_PER_CLUSTER;
+
+  unsigned int getClusterCount() const { return size.x * size.y * size.z; }
+  unsigned int getClusterIndex(glm::uvec3 cluster) const {
+    return cluster.x + size.x * (cluster.y + size.y * cluster.z);
+  }
+};
+
+// The view frustum that clusters are laid out in.
+struct ClusterView {
+  glm::mat4 projection;
+  float near;
+  float far;
+};
+
+// Returns the view space distance of the near side of the given depth slice.
+// The slice past the last one starts at the far plane.
+float getClusterSliceDepth(const ClusterGrid& grid, unsigned int slice,
+                           float near, float far);
+
+// Computes the view space bounding box of every cluster, by cluster index.
+std::vector<BoundingBox> computeClusterBounds(const ClusterGrid& grid,
+                                              const ClusterView& view);
+
+// Returns the cluster that contains a view space position. Positions outside
+// the frustum are clamped to the nearest cluster.
+glm::uvec3 findCluster(const ClusterGrid& grid, const ClusterView& view,
+                       glm::vec3 position);
+
+// The lights that affect each cluster. Each cluster has
+// maxLightsPerCluster slots in `indices`, of which the first `counts[i]` are
+// used.
+struct LightClusterLists {
+  std::vector<unsigned int> counts;
+  std::vector<unsigned int> indices;
+};
+
+// Bins light volumes into clusters. This is a CPU reference for
+// light_clusters.comp, which bins the registry's lights in the same way, with
+// point lights indexed before spot lights.
+LightClusterLists binLights(const ClusterGrid& grid,
+                            std::span<const BoundingBox> clusterBounds,
+                            std::span<const BoundingSphere> lights);
+
+// A compute shader that bins lights into clusters.
+class LightClusterShader : public ComputeShader {
+ public:
+  LightClusterShader();
+};
+
+// Bins the point and spot lights of a LightRegistry into clusters of the view
+// frustum each frame, so that shading only has to consider the lights that can
+// reach each fragment. The lists are written to storage buffers that are bound
+// for all programs, and the grid is provided to shaders as uniforms, for use
+// with light_clusters.glsl.
+class LightClusterPass : public UniformSource {
+ public:
+  explicit LightClusterPass(ClusterGrid grid = {});
+  virtual ~LightClusterPass() = default;
+
+  const ClusterGrid& getGrid() const { return grid_; }
+
+  // Bins the registry's lights for the camera's view frustum. The lights must
+  // be in the camera's view space, as they are when the camera is the
+  // registry's view source.
+  void cull(LightRegistry& lightRegistry, const Camera& camera);
+
+  // Sets the grid uniforms of a shader that reads the light lists.
+  void updateUniforms(Shader& shader) override;
+
+ private:
+  ClusterGrid grid_;
+  ClusterView view_;
+  LightClusterShader shader_;
+  StorageBuffer counts_;
+  StorageBuffer indices_;
+};
+
+}  // namespace qrk
+
+#endif
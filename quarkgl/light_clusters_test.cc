@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <qrk/light_clusters.h>
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr float EPSILON = 1e-4f;
+
+qrk::ClusterView makeView() {
+  return {
+      .projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f,
+                                     /*near=*/0.1f, /*far=*/100.0f),
+      .near = 0.1f,
+      .far = 100.0f,
+  };
+}
+
+// Returns a random view space point inside the frustum.
+glm::vec3 randomPointInFrustum(const qrk::ClusterView& view,
+                               std::mt19937& rng) {
+  std::uniform_real_distribution<float> ndcDist(-0.999f, 0.999f);
+  std::uniform_real_distribution<float> depthDist(std::log(view.near),
+                                                  std::log(view.far));
+  glm::mat4 inverseProjection = glm::inverse(view.projection);
+  glm::vec4 point =
+      inverseProjection * glm::vec4(ndcDist(rng), ndcDist(rng), -1.0f, 1.0f);
+  float depth = std::exp(depthDist(rng));
+  return glm::vec3(point) / point.w * (depth / view.near);
+}
+
+bool contains(const qrk::BoundingBox& box, glm::vec3 point) {
+  return glm::all(glm::greaterThanEqual(point, box.min - EPSILON)) &&
+         glm::all(glm::lessThanEqual(point, box.max + EPSILON));
+}
+
+bool hasLight(const qrk::ClusterGrid& grid,
+              const qrk::LightClusterLists& lists, unsigned int cluster,
+              unsigned int light) {
+  const unsigned int* indices =
+      &lists.indices[cluster * grid.maxLightsPerCluster];
+  for (unsigned int i = 0; i < lists.counts[cluster]; i++) {
+    if (indices[i] == light) return true;
+  }
+  return false;
+}
+
+TEST(LightClustersTest, SlicesSpanDepthRange) {
+  qrk::ClusterGrid grid;
+  qrk::ClusterView view = makeView();
+  EXPECT_FLOAT_EQ(qrk::getClusterSliceDepth(grid, 0, view.near, view.far),
+                  view.near);
+  EXPECT_NEAR(
+      qrk::getClusterSliceDepth(grid, grid.size.z, view.near, view.far),
+      view.far, EPSILON);
+  // Slices are spaced exponentially, so every slice has the same ratio of far
+  // to near depth.
+  float ratio = qrk::getClusterSliceDepth(grid, 1, view.near, view.far) /
+                view.near;
+  for (unsigned int z = 1; z < grid.size.z; z++) {
+    float sliceNear = qrk::getClusterSliceDepth(grid, z, view.near, view.far);
+    float sliceFar =
+        qrk::getClusterSliceDepth(grid, z + 1, view.near, view.far);
+    EXPECT_NEAR(sliceFar / sliceNear, ratio, EPSILON);
+  }
+}
+
+TEST(LightClustersTest, BoundsContainPointsInTheirCluster) {
+  qrk::ClusterGrid grid;
+  qrk::ClusterView view = makeView();
+  std::vector<qrk::BoundingBox> bounds = qrk::computeClusterBounds(grid, view);
+  ASSERT_EQ(bounds.size(), grid.getClusterCount());
+
+  std::mt19937 rng(42);
+  for (int i = 0; i < 10000; i++) {
+    glm::vec3 point = randomPointInFrustum(view, rng);
+    glm::uvec3 cluster = qrk::findCluster(grid, view, point);
+    EXPECT_TRUE(contains(bounds[grid.getClusterIndex(cluster)], point))
+        << "point " << point.x << ", " << point.y << ", " << point.z;
+  }
+}
+
+TEST(LightClustersTest, ClampsPointsOutsideFrustum) {
+  qrk::ClusterGrid grid;
+  qrk::ClusterView view = makeView();
+  EXPECT_EQ(qrk::findCluster(grid, view, glm::vec3(0.0f, 0.0f, -0.01f)).z, 0);
+  EXPECT_EQ(qrk::findCluster(grid, view, glm::vec3(0.0f, 0.0f, -1000.0f)),
+            glm::uvec3(grid.size.x / 2, grid.size.y / 2, grid.size.z - 1));
+  EXPECT_EQ(qrk::findCluster(grid, view, glm::vec3(-1000.0f, 1000.0f, -1.0f)),
+            glm::uvec3(0, grid.size.y - 1, 8));
+}
+
+TEST(LightClustersTest, BinsLightsThatReachPoints) {
+  qrk::ClusterGrid grid;
+  qrk::ClusterView view = makeView();
+  std::vector<qrk::BoundingBox> bounds = qrk::computeClusterBounds(grid, view);
+
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> radiusDist(0.1f, 5.0f);
+  std::vector<qrk::BoundingSphere> lights;
+  for (int i = 0; i < 64; i++) {
+    lights.push_back({randomPointInFrustum(view, rng), radiusDist(rng)});
+  }
+  qrk::LightClusterLists lists = qrk::binLights(grid, bounds, lights);
+  ASSERT_EQ(lists.counts.size(), grid.getClusterCount());
+
+  // Every point within a light's radius must find the light in its cluster.
+  for (int i = 0; i < 10000; i++) {
+    glm::vec3 point = randomPointInFrustum(view, rng);
+    unsigned int cluster =
+        grid.getClusterIndex(qrk::findCluster(grid, view, point));
+    for (unsigned int j = 0; j < lights.size(); j++) {
+      if (glm::distance(point, lights[j].center) < lights[j].radius) {
+        EXPECT_TRUE(hasLight(grid, lists, cluster, j))
+            << "light " << j << ", cluster " << cluster;
+      }
+    }
+  }
+
+  // Lights are only binned into clusters that they overlap.
+  for (unsigned int j = 0; j < lights.size(); j++) {
+    glm::uvec3 cluster = qrk::findCluster(grid, view, lights[j].center);
+    glm::uvec3 farCluster = (cluster + grid.size / 2u) % grid.size;
+    const qrk::BoundingBox& box = bounds[grid.getClusterIndex(farCluster)];
+    glm::vec3 closest = glm::clamp(lights[j].center, box.min, box.max);
+    if (glm::distance(closest, lights[j].center) > lights[j].radius) {
+      EXPECT_FALSE(
+          hasLight(grid, lists, grid.getClusterIndex(farCluster), j));
+    }
+  }
+}
+
+TEST(LightClustersTest, SkipsLightsWithoutRadius) {
+  qrk::ClusterGrid grid = {.size = glm::uvec3(1, 1, 1)};
+  qrk::ClusterView view = makeView();
+  std::vector<qrk::BoundingBox> bounds = qrk::computeClusterBounds(grid, view);
+  std::vector<qrk::BoundingSphere> lights = {
+      {glm::vec3(0.0f, 0.0f, -1.0f), 0.0f},
+      {glm::vec3(0.0f, 0.0f, -1.0f), std::numeric_limits<float>::infinity()},
+  };
+  qrk::LightClusterLists lists = qrk::binLights(grid, bounds, lights);
+  ASSERT_EQ(lists.counts[0], 1);
+  EXPECT_EQ(lists.indices[0], 1);
+}
+
+TEST(LightClustersTest, DropsLightsPastClusterLimit) {
+  qrk::ClusterGrid grid = {.size = glm::uvec3(2, 2, 2),
+                           .maxLightsPerCluster = 4};
+  qrk::ClusterView view = makeView();
+  std::vector<qrk::BoundingBox> bounds = qrk::computeClusterBounds(grid, view);
+  std::vector<qrk::BoundingSphere> lights(
+      10, {glm::vec3(0.0f, 0.0f, -1.0f), 1000.0f});
+  qrk::LightClusterLists lists = qrk::binLights(grid, bounds, lights);
+  ASSERT_EQ(lists.indices.size(), 8 * 4);
+  for (unsigned int i = 0; i < grid.getClusterCount(); i++) {
+    EXPECT_EQ(lists.counts[i], 4);
+    EXPECT_EQ(lists.indices[i * 4 + 3], 3);
+  }
+}
+
+}  // namespace
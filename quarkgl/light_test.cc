@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include <qrk/light.h>
+
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// The contents of the mapped buffers, in place of a real context.
+std::map<GLuint, std::vector<std::byte>> buffers;
+GLuint nextBuffer = 1;
+constexpr size_t OFFSET_ALIGNMENT = 256;
+
+void APIENTRY fakeGetIntegerv(GLenum pname, GLint* data) {
+  *data = OFFSET_ALIGNMENT;
+}
+void APIENTRY fakeCreateBuffers(GLsizei n, GLuint* ids) {
+  for (int i = 0; i < n; i++) ids[i] = nextBuffer++;
+}
+void APIENTRY fakeDeleteBuffers(GLsizei n, const GLuint* ids) {}
+void APIENTRY fakeNamedBufferStorage(GLuint buffer, GLsizeiptr size,
+                                     const void* data, GLbitfield flags) {
+  // Storage starts out undefined, so fill it with garbage.
+  buffers[buffer].assign(size, std::byte{0xab});
+}
+void* APIENTRY fakeMapNamedBufferRange(GLuint buffer, GLintptr offset,
+                                       GLsizeiptr length, GLbitfield access) {
+  return buffers[buffer].data() + offset;
+}
+GLboolean APIENTRY fakeUnmapNamedBuffer(GLuint buffer) { return GL_TRUE; }
+GLsync APIENTRY fakeFenceSync(GLenum condition, GLbitfield flags) {
+  return reinterpret_cast<GLsync>(1);
+}
+GLenum APIENTRY fakeClientWaitSync(GLsync sync, GLbitfield flags,
+                                   GLuint64 timeout) {
+  return GL_ALREADY_SIGNALED;
+}
+void APIENTRY fakeDeleteSync(GLsync sync) {}
+void APIENTRY fakeBindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                                  GLintptr offset, GLsizeiptr size) {}
+
+class FixedViewSource : public qrk::ViewSource {
+ public:
+  glm::mat4 getViewTransform() const override { return view; }
+
+  glm::mat4 view = glm::mat4(1.0f);
+};
+
+class LightRegistryTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    glad_glGetIntegerv = fakeGetIntegerv;
+    glad_glCreateBuffers = fakeCreateBuffers;
+    glad_glDeleteBuffers = fakeDeleteBuffers;
+    glad_glNamedBufferStorage = fakeNamedBufferStorage;
+    glad_glMapNamedBufferRange = fakeMapNamedBufferRange;
+    glad_glUnmapNamedBuffer = fakeUnmapNamedBuffer;
+    glad_glFenceSync = fakeFenceSync;
+    glad_glClientWaitSync = fakeClientWaitSync;
+    glad_glDeleteSync = fakeDeleteSync;
+    glad_glBindBufferRange = fakeBindBufferRange;
+    registry_.setViewSource(viewSource_);
+  }
+
+  // Returns the light count and lights in the current region of a type's
+  // buffer.
+  template <typename T>
+  std::vector<T> readLights(qrk::LightType type) {
+    const qrk::MappedStorageBuffer* buffer = registry_.getLightBuffer(type);
+    const size_t regionStride =
+        (buffer->getRegionSize() + OFFSET_ALIGNMENT - 1) / OFFSET_ALIGNMENT *
+        OFFSET_ALIGNMENT;
+    const std::byte* region = buffers[buffer->getId()].data() +
+                              buffer->getRegion() * regionStride;
+    int count;
+    std::memcpy(&count, region, sizeof(count));
+    std::vector<T> lights(count);
+    std::memcpy(lights.data(), region + qrk::LIGHT_STORAGE_HEADER_SIZE,
+                count * sizeof(T));
+    return lights;
+  }
+
+  std::shared_ptr<FixedViewSource> viewSource_ =
+      std::make_shared<FixedViewSource>();
+  qrk::LightRegistry registry_;
+};
+
+TEST_F(LightRegistryTest, WritesLightsInViewSpace) {
+  viewSource_->view = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -5));
+  registry_.addLight(std::make_shared<qrk::DirectionalLight>());
+  registry_.addLight(std::make_shared<qrk::SpotLight>(glm::vec3(1, 2, 3)));
+  registry_.addLight(std::make_shared<qrk::SpotLight>(glm::vec3(4, 5, 6)));
+  registry_.updateLightBuffers();
+
+  auto directional =
+      readLights<qrk::DirectionalLightData>(qrk::LightType::DIRECTIONAL_LIGHT);
+  auto point = readLights<qrk::PointLightData>(qrk::LightType::POINT_LIGHT);
+  auto spot = readLights<qrk::SpotLightData>(qrk::LightType::SPOT_LIGHT);
+  ASSERT_EQ(directional.size(), 1);
+  EXPECT_EQ(point.size(), 0);
+  ASSERT_EQ(spot.size(), 2);
+  EXPECT_EQ(directional[0].direction, glm::vec3(0, -1, 0));
+  EXPECT_EQ(spot[0].position, glm::vec3(1, 2, -2));
+  EXPECT_EQ(spot[1].position, glm::vec3(4, 5, 1));
+  EXPECT_EQ(spot[0].outerAngle, qrk::DEFAULT_OUTER_ANGLE);
+}
+
+TEST_F(LightRegistryTest, WritesCountsOfEmptyLists) {
+  registry_.updateLightBuffers();
+  EXPECT_EQ(
+      readLights<qrk::DirectionalLightData>(qrk::LightType::DIRECTIONAL_LIGHT)
+          .size(),
+      0);
+  EXPECT_EQ(readLights<qrk::PointLightData>(qrk::LightType::POINT_LIGHT).size(),
+            0);
+  EXPECT_EQ(readLights<qrk::SpotLightData>(qrk::LightType::SPOT_LIGHT).size(),
+            0);
+
+  // Every region reads as empty, not just the one that was filled.
+  const qrk::MappedStorageBuffer* buffer =
+      registry_.getLightBuffer(qrk::LightType::POINT_LIGHT);
+  const std::vector<std::byte>& storage = buffers[buffer->getId()];
+  for (size_t offset = 0; offset < storage.size();
+       offset += storage.size() / qrk::MappedStorageBuffer::REGION_COUNT) {
+    int count;
+    std::memcpy(&count, storage.data() + offset, sizeof(count));
+    EXPECT_EQ(count, 0);
+  }
+}
+
+TEST_F(LightRegistryTest, WritesOnlyChangedLights) {
+  std::vector<std::shared_ptr<qrk::PointLight>> lights;
+  for (int i = 0; i < 100; i++) {
+    lights.push_back(std::make_shared<qrk::PointLight>(glm::vec3(i)));
+    registry_.addLight(lights.back());
+  }
+  registry_.updateLightBuffers();
+  EXPECT_EQ(registry_.getStats().lightsWritten, 100);
+
+  // Updating again, e.g. for another shader, doesn't write anything.
+  registry_.updateLightBuffers();
+  EXPECT_EQ(registry_.getStats().lightsWritten, 0);
+  EXPECT_EQ(registry_.getStats().lightsSkipped, 100);
+
+  // The next region still has to catch up on the initial values.
+  lights[7]->setDiffuse(glm::vec3(1.0f));
+  registry_.updateLightBuffers();
+  EXPECT_EQ(registry_.getStats().lightsWritten, 100);
+
+  // But once every region is current, only changed lights are written.
+  lights[7]->setDiffuse(glm::vec3(0.5f));
+  registry_.updateLightBuffers();
+  lights[7]->setDiffuse(glm::vec3(0.25f));
+  lights[8]->setPosition(glm::vec3(-1.0f));
+  registry_.updateLightBuffers();
+  EXPECT_EQ(registry_.getStats().lightsWritten, 2);
+
+  auto point = readLights<qrk::PointLightData>(qrk::LightType::POINT_LIGHT);
+  ASSERT_EQ(point.size(), 100);
+  EXPECT_EQ(point[7].diffuse, glm::vec3(0.25f));
+  EXPECT_EQ(point[8].position, glm::vec3(-1.0f));
+  EXPECT_EQ(point[9].position, glm::vec3(9.0f));
+}
+
+TEST_F(LightRegistryTest, RewritesAllLightsWhenViewMoves) {
+  for (int i = 0; i < 3; i++) {
+    registry_.addLight(std::make_shared<qrk::PointLight>());
+  }
+  registry_.updateLightBuffers();
+  registry_.updateLightBuffers();
+  EXPECT_EQ(registry_.getStats().lightsWritten, 0);
+
+  viewSource_->view = glm::translate(glm::mat4(1.0f), glm::vec3(1, 0, 0));
+  registry_.updateLightBuffers();
+  EXPECT_EQ(registry_.getStats().lightsWritten, 3);
+  auto point = readLights<qrk::PointLightData>(qrk::LightType::POINT_LIGHT);
+  EXPECT_EQ(point[2].position, glm::vec3(1, 0, 0));
+}
+
+TEST_F(LightRegistryTest, GrowsForThousandsOfLights) {
+  for (int i = 0; i < 4096; i++) {
+    registry_.addLight(std::make_shared<qrk::PointLight>(glm::vec3(i)));
+  }
+  registry_.updateLightBuffers();
+  auto point = readLights<qrk::PointLightData>(qrk::LightType::POINT_LIGHT);
+  ASSERT_EQ(point.size(), 4096);
+  EXPECT_EQ(point[4095].position, glm::vec3(4095.0f));
+}
+
+TEST(LightRadiusTest, ReachesCutoffAtRadius) {
+  qrk::Attenuation attenuation = {1.0f, 0.09f, 0.032f};
+  float radius = qrk::calculateLightRadius(attenuation, 2.0f);
+  float falloff = attenuation.constant + attenuation.linear * radius +
+                  attenuation.quadratic * radius * radius;
+  EXPECT_NEAR(2.0f / falloff, qrk::LIGHT_RADIUS_CUTOFF, 1e-6f);
+
+  // Without a quadratic term, the falloff is linear.
+  radius = qrk::calculateLightRadius({1.0f, 0.5f, 0.0f}, 1.0f);
+  EXPECT_NEAR(radius, (1.0f / qrk::LIGHT_RADIUS_CUTOFF - 1.0f) / 0.5f, 1e-3f);
+
+  // Lights that start below the cutoff have no effect, and lights that never
+  // fall off reach everything.
+  EXPECT_EQ(qrk::calculateLightRadius({1.0f, 0.0f, 1.0f}, 0.001f), 0.0f);
+  EXPECT_TRUE(std::isinf(qrk::calculateLightRadius({1.0f, 0.0f, 0.0f}, 1.0f)));
+}
+
+}  // namespace
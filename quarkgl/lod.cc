@@ -0,0 +1,69 @@
+#include <qrk/lod.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace qrk {
+
+float LodSelector::getProjectedRadius(const BoundingSphere& sphere) const {
+  const glm::mat4 projection = camera_->getProjectionTransform();
+  // Maps view-space units at unit distance to pixels.
+  const float pixelScale = projection[1][1] * viewportHeight_ * 0.5f;
+  // Orthographic projections don't divide by depth.
+  if (projection[2][3] == 0.0f) return sphere.radius * pixelScale;
+
+  const glm::vec3 viewCenter =
+      glm::vec3(camera_->getViewTransform() * glm::vec4(sphere.center, 1.0f));
+  const float distanceSquared = glm::dot(viewCenter, viewCenter);
+  const float radiusSquared = sphere.radius * sphere.radius;
+  if (distanceSquared <= radiusSquared) {
+    return std::numeric_limits<float>::infinity();
+  }
+  // The tangent of the angle that the sphere subtends from the camera.
+  return sphere.radius * pixelScale /
+         std::sqrt(distanceSquared - radiusSquared);
+}
+
+float LodSelector::getPixelsPerUnit(const BoundingSphere& bounds,
+                                    const glm::mat4& model) const {
+  const BoundingSphere worldBounds = transformBoundingSphere(bounds, model);
+  // Errors are in model space, so share the bounds' scale.
+  return getProjectedRadius(worldBounds) / bounds.radius;
+}
+
+unsigned int LodSelector::selectLodForScale(std::span<const MeshLod> lods,
+                                            float pixelsPerUnit) const {
+  if (std::isinf(pixelsPerUnit)) return 0;
+  unsigned int selected = 0;
+  for (unsigned int i = 1; i < lods.size(); i++) {
+    if (lods[i].error * pixelsPerUnit > maxPixelError_) break;
+    selected = i;
+  }
+  return selected;
+}
+
+unsigned int LodSelector::selectLod(std::span<const MeshLod> lods,
+                                    const BoundingSphere& bounds,
+                                    const glm::mat4& model) const {
+  if (lods.size() <= 1 || bounds.radius <= 0.0f) return 0;
+  return selectLodForScale(lods, getPixelsPerUnit(bounds, model));
+}
+
+unsigned int LodSelector::selectInstancedLod(
+    std::span<const MeshLod> lods, const BoundingSphere& bounds,
+    const glm::mat4& model, std::span<const glm::mat4> instances) const {
+  if (lods.size() <= 1 || bounds.radius <= 0.0f || instances.empty()) {
+    return 0;
+  }
+  // The instance that projects largest needs the most detail.
+  float maxPixelsPerUnit = 0.0f;
+  for (const glm::mat4& instance : instances) {
+    maxPixelsPerUnit =
+        std::max(maxPixelsPerUnit, getPixelsPerUnit(bounds, model * instance));
+    if (std::isinf(maxPixelsPerUnit)) return 0;
+  }
+  return selectLodForScale(lods, maxPixelsPerUnit);
+}
+
+}  // namespace qrk
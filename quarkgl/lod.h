@@ -0,0 +1,81 @@
+#ifndef QUARKGL_LOD_H_
+#define QUARKGL_LOD_H_
+
+#include <qrk/bounds.h>
+#include <qrk/camera.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <span>
+
+namespace qrk {
+
+// The default largest on-screen error, in pixels, that a level of detail may
+// have when it's selected.
+constexpr float DEFAULT_LOD_PIXEL_ERROR = 1.0f;
+constexpr int DEFAULT_LOD_VIEWPORT_HEIGHT = 1080;
+
+// A level of detail of a mesh, as a range of the mesh's indices.
+struct MeshLod {
+  unsigned int indexOffset;
+  unsigned int indexCount;
+  // The largest distance between this level's surface and the full-detail
+  // surface, in the mesh's model space.
+  float error;
+};
+
+// Selects a level of detail for each draw, based on the size that the mesh's
+// bounding sphere projects to on screen with the camera's current projection.
+// The coarsest level whose error projects to at most maxPixelError pixels is
+// chosen.
+class LodSelector {
+ public:
+  explicit LodSelector(std::shared_ptr<Camera> camera,
+                       float maxPixelError = DEFAULT_LOD_PIXEL_ERROR)
+      : camera_(std::move(camera)), maxPixelError_(maxPixelError) {}
+
+  float getMaxPixelError() const { return maxPixelError_; }
+  void setMaxPixelError(float maxPixelError) {
+    maxPixelError_ = maxPixelError;
+  }
+  // The height of the viewport, used to convert projected sizes to pixels.
+  int getViewportHeight() const { return viewportHeight_; }
+  void setViewportHeight(int height) { viewportHeight_ = height; }
+
+  // Returns the radius, in pixels, that a world-space sphere projects to.
+  // Returns infinity if the camera is inside the sphere.
+  float getProjectedRadius(const BoundingSphere& sphere) const;
+
+  // Returns the index of the level to draw. Levels must be ordered from most
+  // to least detailed. Bounds are in the mesh's model space, and are placed
+  // in the world by the given model transform.
+  unsigned int selectLod(std::span<const MeshLod> lods,
+                         const BoundingSphere& bounds,
+                         const glm::mat4& model) const;
+  // Returns the index of the level to draw every instance of an instanced mesh
+  // with. Each instance is placed by its own transform, and then by the model
+  // transform. The level is the one that the nearest instance (by projected
+  // size) would select on its own, so that no instance is drawn coarser than
+  // it should be.
+  unsigned int selectInstancedLod(std::span<const MeshLod> lods,
+                                  const BoundingSphere& bounds,
+                                  const glm::mat4& model,
+                                  std::span<const glm::mat4> instances) const;
+
+ private:
+  // Returns the number of pixels that a unit of the bounds' model space
+  // projects to when the bounds are placed by the given transform.
+  float getPixelsPerUnit(const BoundingSphere& bounds,
+                         const glm::mat4& model) const;
+  // Returns the coarsest level whose error is within the pixel threshold.
+  unsigned int selectLodForScale(std::span<const MeshLod> lods,
+                                 float pixelsPerUnit) const;
+
+  std::shared_ptr<Camera> camera_;
+  float maxPixelError_;
+  int viewportHeight_ = DEFAULT_LOD_VIEWPORT_HEIGHT;
+};
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <qrk/lod.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Levels that each have 10x the error of the previous one.
+const std::vector<qrk::MeshLod> LODS = {
+    {.indexOffset = 0, .indexCount = 300, .error = 0.0f},
+    {.indexOffset = 300, .indexCount = 100, .error = 0.001f},
+    {.indexOffset = 400, .indexCount = 30, .error = 0.01f},
+    {.indexOffset = 430, .indexCount = 10, .error = 0.1f},
+};
+const qrk::BoundingSphere BOUNDS = {.center = glm::vec3(0.0f), .radius = 1.0f};
+
+glm::mat4 at(float z) {
+  return glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, z));
+}
+
+class LodSelectorTest : public testing::Test {
+ protected:
+  // The camera sits at the origin, looking down -Z.
+  qrk::LodSelector selector_{std::make_shared<qrk::Camera>()};
+};
+
+TEST_F(LodSelectorTest, SelectsCoarserLevelsFartherAway) {
+  const unsigned int nearLod = selector_.selectLod(LODS, BOUNDS, at(-5.0f));
+  const unsigned int farLod = selector_.selectLod(LODS, BOUNDS, at(-500.0f));
+  EXPECT_LT(nearLod, farLod);
+  // The camera is inside the bounds.
+  EXPECT_EQ(selector_.selectLod(LODS, BOUNDS, at(-0.5f)), 0);
+}
+
+TEST_F(LodSelectorTest, SelectsInstancedLevelForNearestInstance) {
+  const std::vector<glm::mat4> instances = {at(-500.0f), at(-5.0f),
+                                            at(-2000.0f)};
+  EXPECT_EQ(selector_.selectInstancedLod(LODS, BOUNDS, glm::mat4(1.0f),
+                                         instances),
+            selector_.selectLod(LODS, BOUNDS, at(-5.0f)));
+
+  // Instances are placed by the model transform too.
+  const std::vector<glm::mat4> farInstances = {at(-500.0f), at(-2000.0f)};
+  const unsigned int farLod = selector_.selectInstancedLod(
+      LODS, BOUNDS, glm::mat4(1.0f), farInstances);
+  EXPECT_EQ(farLod, selector_.selectLod(LODS, BOUNDS, at(-500.0f)));
+  EXPECT_GT(farLod, 0);
+  EXPECT_EQ(selector_.selectInstancedLod(LODS, BOUNDS, at(495.0f),
+                                         farInstances),
+            selector_.selectLod(LODS, BOUNDS, at(-5.0f)));
+
+  EXPECT_EQ(selector_.selectInstancedLod(LODS, BOUNDS, glm::mat4(1.0f), {}),
+            0);
+}
+
+}  // namespace
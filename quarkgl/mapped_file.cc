@@ -0,0 +1,90 @@
+#include <qrk/mapped_file.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace qrk {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw MappedFileException("ERROR::MAPPED_FILE::OPEN_FAILED\n" + path);
+  }
+  fileHandle_ = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw MappedFileException("ERROR::MAPPED_FILE::STAT_FAILED\n" + path);
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  // Zero-length files can't be mapped, but are still valid to "read".
+  if (size_ == 0) return;
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    throw MappedFileException("ERROR::MAPPED_FILE::MAP_FAILED\n" + path);
+  }
+  mappingHandle_ = mapping;
+
+  data_ = static_cast<const char*>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw MappedFileException("ERROR::MAPPED_FILE::MAP_FAILED\n" + path);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_) UnmapViewOfFile(data_);
+  if (mappingHandle_) CloseHandle(mappingHandle_);
+  if (fileHandle_) CloseHandle(fileHandle_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+  fd_ = ::open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    throw MappedFileException("ERROR::MAPPED_FILE::OPEN_FAILED\n" + path);
+  }
+
+  struct stat st;
+  if (::fstat(fd_, &st) != 0) {
+    ::close(fd_);
+    throw MappedFileException("ERROR::MAPPED_FILE::STAT_FAILED\n" + path);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  // Zero-length files can't be mapped, but are still valid to "read".
+  if (size_ == 0) return;
+
+  void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (data == MAP_FAILED) {
+    ::close(fd_);
+    throw MappedFileException("ERROR::MAPPED_FILE::MAP_FAILED\n" + path);
+  }
+  data_ = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) ::munmap(const_cast<char*>(data_), size_);
+  if (fd_ >= 0) ::close(fd_);
+}
+
+#endif
+
+}  // namespace qrk
@@ -0,0 +1,41 @@
+#ifndef QUARKGL_MAPPED_FILE_H_
+#define QUARKGL_MAPPED_FILE_H_
+
+#include <qrk/exceptions.h>
+
+#include <cstddef>
+#include <string>
+
+namespace qrk {
+
+class MappedFileException : public QuarkException {
+  using QuarkException::QuarkException;
+};
+
+// A read-only memory mapping of an entire file. Pages are faulted in lazily by
+// the OS as they're accessed.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* getData() const { return data_; }
+  size_t getSize() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* fileHandle_ = nullptr;
+  void* mappingHandle_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+}  // namespace qrk
+
+#endif
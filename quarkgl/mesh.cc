@@ -1,22 +1,161 @@
 #include <qrk/mesh.h>
 
+#include <cstdint>
+#include <string>
+#include <string_view>
+
 namespace qrk {
+namespace {
+// Shared by all nodes, so that versions from different trees never collide
+// when a subtree is moved between them.
+uint64_t nodeChangeCounter = 0;
+
+// The names of the elements of a "material.<array>[idx]" uniform array,
+// interned as they're first used.
+class MaterialArrayUniforms {
+ public:
+  explicit MaterialArrayUniforms(std::string_view arrayName)
+      : prefix_("material." + std::string(arrayName) + "[") {}
+
+  UniformName get(unsigned int idx) {
+    while (names_.size() <= idx) {
+      names_.emplace_back(prefix_ + std::to_string(names_.size()) + "]");
+    }
+    return names_[idx];
+  }
+
+ private:
+  std::string prefix_;
+  std::vector<UniformName> names_;
+};
+
+template <typename T>
+std::vector<T> narrowIndices(const std::vector<unsigned int>& indices) {
+  return std::vector<T>(indices.begin(), indices.end());
+}
+}  // namespace
+
+unsigned int getIndexTypeForVertexCount(unsigned int numVertices,
+                                        bool allowByteIndices) {
+  if (allowByteIndices && numVertices <= 256) return GL_UNSIGNED_BYTE;
+  if (numVertices <= MAX_16BIT_INDEXED_VERTICES) return GL_UNSIGNED_SHORT;
+  return GL_UNSIGNED_INT;
+}
+
+unsigned int getIndexSizeBytes(unsigned int indexType) {
+  switch (indexType) {
+    case GL_UNSIGNED_BYTE:
+      return 1;
+    case GL_UNSIGNED_SHORT:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+bool isRenderableVisible(const Renderable& renderable,
+                         const glm::mat4& transform, const Frustum& frustum) {
+  std::optional<BoundingBox> bounds = renderable.getLocalBounds();
+  if (!bounds) return true;
+  return frustum.intersects(transformBoundingBox(
+      *bounds, transform * renderable.getModelTransform()));
+}
 
 void RenderableNode::drawWithTransform(const glm::mat4& transform,
                                        Shader& shader,
                                        TextureRegistry* textureRegistry) {
   // Combined incoming transform with the node's.
   const glm::mat4 mat = transform * getModelTransform();
+  const Frustum* frustum = shader.getCullingFrustum();
+  CullingStats& stats = shader.getCullingStats();
   for (auto& renderable : renderables_) {
+    if (frustum) {
+      if (!isRenderableVisible(*renderable, mat, *frustum)) {
+        stats.culled++;
+        continue;
+      }
+      stats.visible++;
+    }
     renderable->drawWithTransform(mat, shader, textureRegistry);
   }
 
-  // Render children.
+  // Render children, skipping entire subtrees that are out of view.
   for (auto& childNode : childNodes_) {
+    if (frustum && !isRenderableVisible(*childNode, mat, *frustum)) {
+      stats.culled += childNode->getRenderableCount();
+      continue;
+    }
     childNode->drawWithTransform(mat, shader, textureRegistry);
   }
 }
 
+void RenderableNode::setModelTransform(const glm::mat4& model) {
+  Renderable::setModelTransform(model);
+  // The node's own bounds are before its transform, but its parent's aren't.
+  if (parent_) parent_->invalidateBounds();
+  markTransformChanged();
+}
+
+std::optional<BoundingBox> RenderableNode::getLocalBounds() const {
+  updateBounds();
+  return bounds_;
+}
+
+unsigned int RenderableNode::getRenderableCount() const {
+  updateBounds();
+  return renderableCount_;
+}
+
+void RenderableNode::invalidateBounds() {
+  // Ancestors are already stale if this node is.
+  for (RenderableNode* node = this; node && !node->boundsDirty_;
+       node = node->parent_) {
+    node->boundsDirty_ = true;
+  }
+}
+
+void RenderableNode::markTransformChanged() {
+  transformVersion_ = ++nodeChangeCounter;
+  for (RenderableNode* node = this; node; node = node->parent_) {
+    node->subtreeTransformVersion_ = transformVersion_;
+  }
+}
+
+void RenderableNode::markStructureChanged() {
+  const uint64_t version = ++nodeChangeCounter;
+  for (RenderableNode* node = this; node; node = node->parent_) {
+    node->structureVersion_ = version;
+  }
+}
+
+void RenderableNode::updateBounds() const {
+  if (!boundsDirty_) return;
+  BoundingBox bounds;
+  bool bounded = true;
+  renderableCount_ = renderables_.size();
+  for (const auto& renderable : renderables_) {
+    std::optional<BoundingBox> childBounds = renderable->getLocalBounds();
+    if (!childBounds) {
+      bounded = false;
+      continue;
+    }
+    bounds.merge(
+        transformBoundingBox(*childBounds, renderable->getModelTransform()));
+  }
+  for (const auto& childNode : childNodes_) {
+    std::optional<BoundingBox> childBounds = childNode->getLocalBounds();
+    renderableCount_ += childNode->renderableCount_;
+    if (!childBounds) {
+      bounded = false;
+      continue;
+    }
+    bounds.merge(
+        transformBoundingBox(*childBounds, childNode->getModelTransform()));
+  }
+  bounds_ = bounded ? std::optional<BoundingBox>(bounds) : std::nullopt;
+  boundsDirty_ = false;
+}
+
 void RenderableNode::visitRenderables(
     std::function<void(Renderable*)> visitor) {
   for (auto& renderable : renderables_) {
@@ -40,42 +179,100 @@ void Mesh::loadMeshData(const void* vertexData, unsigned int numVertices,
 
   // Load VBO.
   vertexArray_.loadVertexData(vertexData, numVertices_ * vertexSizeBytes);
+  computeBounds(static_cast<const float*>(vertexData), numVertices_,
+                vertexSizeBytes_);
 
   initializeVertexAttributes();
   initializeVertexArrayInstanceData();
 
   // Load EBO if this is an indexed mesh.
   if (!indices_.empty()) {
-    vertexArray_.loadElementData(&indices_[0],
-                                 indices.size() * sizeof(unsigned int));
+    indexType_ = getIndexTypeForVertexCount(numVertices_, allowByteIndices_);
+    const unsigned int sizeBytes =
+        indices_.size() * getIndexSizeBytes(indexType_);
+    switch (indexType_) {
+      case GL_UNSIGNED_BYTE:
+        vertexArray_.loadElementData(narrowIndices<uint8_t>(indices_).data(),
+                                     sizeBytes);
+        break;
+      case GL_UNSIGNED_SHORT:
+        vertexArray_.loadElementData(narrowIndices<uint16_t>(indices_).data(),
+                                     sizeBytes);
+        break;
+      default:
+        vertexArray_.loadElementData(indices_.data(), sizeBytes);
+        break;
+    }
   }
 }
 
 void Mesh::loadInstanceModels(const std::vector<glm::mat4>& models) {
-  vertexArray_.loadInstanceVertexData(&models[0],
-                                      models.size() * sizeof(glm::mat4));
+  loadInstanceModels(models.data(), models.size());
+}
+
+std::optional<BoundingBox> Mesh::getLocalBounds() const {
+  if (!instanceCount_) return localBounds_;
+  // Instances that haven't been loaded could be anywhere.
+  if (instanceBounds_.isEmpty()) return std::nullopt;
+  return instanceBounds_;
+}
+
+void Mesh::computeBounds(const float* positions, unsigned int numVertices,
+                         unsigned int positionStrideBytes) {
+  localBounds_ =
+      computeBoundingBox(positions, numVertices, positionStrideBytes);
+  boundingSphere_ =
+      computeBoundingSphere(positions, numVertices, positionStrideBytes);
 }
 
 void Mesh::loadInstanceModels(const glm::mat4* models, unsigned int size) {
-  vertexArray_.loadInstanceVertexData(&models[0], size * sizeof(glm::mat4));
+  instanceBounds_ = BoundingBox();
+  instanceModels_.assign(models, models + size);
+  for (unsigned int i = 0; i < size; i++) {
+    instanceBounds_.merge(transformBoundingBox(localBounds_, models[i]));
+  }
+  if (vertexTransform_ == glm::mat4(1.0f)) {
+    vertexArray_.loadInstanceVertexData(&models[0], size * sizeof(glm::mat4));
+    return;
+  }
+  // The vertex transform has to be applied before each instance's transform.
+  std::vector<glm::mat4> transformed(models, models + size);
+  for (glm::mat4& model : transformed) {
+    model = model * vertexTransform_;
+  }
+  vertexArray_.loadInstanceVertexData(transformed.data(),
+                                      size * sizeof(glm::mat4));
 }
 
 void Mesh::drawWithTransform(const glm::mat4& transform, Shader& shader,
                              TextureRegistry* textureRegistry) {
   // First we set the model transform, combining with the incoming transform.
-  shader.setMat4("model", transform * getModelTransform());
+  // Instanced meshes carry the vertex transform in their instance data.
+  glm::mat4 model = transform * getModelTransform();
+  currentLod_ = 0;
+  if (lodSelector_ && instanceCount_) {
+    currentLod_ = lodSelector_->selectInstancedLod(lods_, boundingSphere_,
+                                                   model, instanceModels_);
+  } else if (lodSelector_) {
+    currentLod_ = lodSelector_->selectLod(lods_, boundingSphere_, model);
+  }
+  if (!instanceCount_) model = model * vertexTransform_;
+  static const UniformName modelUniform("model");
+  static const UniformName instancedUniform("instanced");
+  shader.setMat4(modelUniform, model);
+  // Lets shaders that support instancing combine the model transform with the
+  // per-instance transforms.
+  shader.setBool(instancedUniform, instanceCount_ > 0);
 
   bindTextures(shader, textureRegistry);
 
-  // Draw using the VAO.
+  // Draw using the VAO. It's left bound afterwards, since the next draw will
+  // likely bind another anyway, and GlState skips redundant binds.
   shader.activate();
   vertexArray_.activate();
 
   glDraw();
 
-  vertexArray_.deactivate();
-
-  // Reset.
   shader.deactivate();
 }
 
@@ -94,6 +291,29 @@ void Mesh::initializeVertexArrayInstanceData() {
 
 void Mesh::bindTextures(Shader& shader, TextureRegistry* textureRegistry) {
   // Bind textures. Assumes uniform naming is "material.textureMapType[idx]".
+  // TODO: Make this more configurable / less generic?
+  static MaterialArrayUniforms diffuseMaps("diffuseMaps");
+  static MaterialArrayUniforms specularMaps("specularMaps");
+  static MaterialArrayUniforms roughnessMaps("roughnessMaps");
+  static MaterialArrayUniforms roughnessIsPacked("roughnessIsPacked");
+  static MaterialArrayUniforms metallicMaps("metallicMaps");
+  static MaterialArrayUniforms metallicIsPacked("metallicIsPacked");
+  static MaterialArrayUniforms aoMaps("aoMaps");
+  static MaterialArrayUniforms aoIsPacked("aoIsPacked");
+  static MaterialArrayUniforms emissionMaps("emissionMaps");
+  static const UniformName normalMap("material.normalMap");
+  static const UniformName skybox("skybox");
+  static const UniformName diffuseCount("material.diffuseCount");
+  static const UniformName specularCount("material.specularCount");
+  static const UniformName roughnessCount("material.roughnessCount");
+  static const UniformName metallicCount("material.metallicCount");
+  static const UniformName aoCount("material.aoCount");
+  static const UniformName emissionCount("material.emissionCount");
+  static const UniformName hasNormalMapUniform("material.hasNormalMap");
+  static const VirtualTextureUniforms virtualDiffuse("material.virtualDiffuse");
+  static const UniformName hasVirtualDiffuseUniform(
+      "material.hasVirtualDiffuse");
+
   unsigned int diffuseIdx = 0;
   unsigned int specularIdx = 0;
   unsigned int roughnessIdx = 0;
@@ -101,6 +321,7 @@ void Mesh::bindTextures(Shader& shader, TextureRegistry* textureRegistry) {
   unsigned int aoIdx = 0;
   unsigned int emissionIdx = 0;
   bool hasNormalMap = false;
+  bool hasVirtualDiffuse = false;
 
   // If a TextureRegistry isn't provided, just start with texture unit 0.
   unsigned int textureUnit = 0;
@@ -109,58 +330,60 @@ void Mesh::bindTextures(Shader& shader, TextureRegistry* textureRegistry) {
     textureUnit = textureRegistry->getNextTextureUnit();
   }
   for (TextureMap& textureMap : textureMaps_) {
-    std::string samplerName;
     TextureMapType type = textureMap.getType();
     Texture& texture = textureMap.getTexture();
-    if (type == TextureMapType::CUBEMAP) {
+    if (textureMap.isVirtual()) {
+      // Only a single virtual diffuse map supported. Virtual textures take a
+      // second unit, for the page cache.
+      if (type == TextureMapType::DIFFUSE && !hasVirtualDiffuse) {
+        unsigned int pageCacheUnit = textureRegistry != nullptr
+                                         ? textureRegistry->getNextTextureUnit()
+                                         : ++textureUnit;
+        textureMap.getVirtualTexture()->bind(shader, virtualDiffuse,
+                                             textureUnit, pageCacheUnit);
+        hasVirtualDiffuse = true;
+      }
+    } else if (type == TextureMapType::CUBEMAP) {
       texture.bindToUnit(textureUnit, TextureBindType::CUBEMAP);
-      samplerName = "skybox";
+      shader.setInt(skybox, textureUnit);
     } else {
       texture.bindToUnit(textureUnit, TextureBindType::TEXTURE_2D);
-      static std::string materialName = "material";
-      std::ostringstream ss;
-      // TODO: Make this more configurable / less generic?
-      ss << "material.";
 
       // A subset of texture types can be packed into a single texture, which we
       // set a uniform for.
       switch (type) {
         case TextureMapType::DIFFUSE:
-          ss << "diffuseMaps[" << diffuseIdx << "]";
+          shader.setInt(diffuseMaps.get(diffuseIdx), textureUnit);
           diffuseIdx++;
           break;
         case TextureMapType::SPECULAR:
-          ss << "specularMaps[" << specularIdx << "]";
+          shader.setInt(specularMaps.get(specularIdx), textureUnit);
           specularIdx++;
           break;
         case TextureMapType::ROUGHNESS:
-          ss << "roughnessMaps[" << roughnessIdx << "]";
-          shader.setBool(materialName + ".roughnessIsPacked[" +
-                             std::to_string(roughnessIdx) + "]",
+          shader.setInt(roughnessMaps.get(roughnessIdx), textureUnit);
+          shader.setBool(roughnessIsPacked.get(roughnessIdx),
                          textureMap.isPacked());
           roughnessIdx++;
           break;
         case TextureMapType::METALLIC:
-          ss << "metallicMaps[" << metallicIdx << "]";
-          shader.setBool(materialName + ".metallicIsPacked[" +
-                             std::to_string(metallicIdx) + "]",
+          shader.setInt(metallicMaps.get(metallicIdx), textureUnit);
+          shader.setBool(metallicIsPacked.get(metallicIdx),
                          textureMap.isPacked());
           metallicIdx++;
           break;
         case TextureMapType::AO:
-          ss << "aoMaps[" << aoIdx << "]";
-          shader.setBool(
-              materialName + ".aoIsPacked[" + std::to_string(aoIdx) + "]",
-              textureMap.isPacked());
+          shader.setInt(aoMaps.get(aoIdx), textureUnit);
+          shader.setBool(aoIsPacked.get(aoIdx), textureMap.isPacked());
           aoIdx++;
           break;
         case TextureMapType::EMISSION:
-          ss << "emissionMaps[" << emissionIdx << "]";
+          shader.setInt(emissionMaps.get(emissionIdx), textureUnit);
           emissionIdx++;
           break;
         case TextureMapType::NORMAL:
           // Only a single normal map supported.
-          ss << "normalMap";
+          shader.setInt(normalMap, textureUnit);
           hasNormalMap = true;
           break;
         case TextureMapType::CUBEMAP:
@@ -168,10 +391,7 @@ void Mesh::bindTextures(Shader& shader, TextureRegistry* textureRegistry) {
           abort();
           break;
       }
-      samplerName = ss.str();
     }
-    // Set the sampler to the correct texture unit.
-    shader.setInt(samplerName, textureUnit);
 
     if (textureRegistry != nullptr) {
       textureUnit = textureRegistry->getNextTextureUnit();
@@ -182,22 +402,34 @@ void Mesh::bindTextures(Shader& shader, TextureRegistry* textureRegistry) {
   if (textureRegistry != nullptr) {
     textureRegistry->popUsageBlock();
   }
-  shader.setInt("material.diffuseCount", diffuseIdx);
-  shader.setInt("material.specularCount", specularIdx);
-  shader.setInt("material.roughnessCount", roughnessIdx);
-  shader.setInt("material.metallicCount", metallicIdx);
-  shader.setInt("material.aoCount", aoIdx);
-  shader.setInt("material.emissionCount", emissionIdx);
-  shader.setInt("material.hasNormalMap", hasNormalMap);
+  shader.setInt(diffuseCount, diffuseIdx);
+  shader.setInt(specularCount, specularIdx);
+  shader.setInt(roughnessCount, roughnessIdx);
+  shader.setInt(metallicCount, metallicIdx);
+  shader.setInt(aoCount, aoIdx);
+  shader.setInt(emissionCount, emissionIdx);
+  shader.setInt(hasNormalMapUniform, hasNormalMap);
+  shader.setBool(hasVirtualDiffuseUniform, hasVirtualDiffuse);
 }
 
 void Mesh::glDraw() {
+  // Draw the current level of detail, if there are any.
+  unsigned int indexCount = indices_.size();
+  const void* indexOffset = nullptr;
+  if (currentLod_ < lods_.size()) {
+    const MeshLod& lod = lods_[currentLod_];
+    indexCount = lod.indexCount;
+    indexOffset = reinterpret_cast<const void*>(
+        static_cast<uintptr_t>(lod.indexOffset) *
+        getIndexSizeBytes(indexType_));
+  }
+
   // Handle instancing.
   if (instanceCount_) {
     // Handle indexed arrays.
     if (!indices_.empty()) {
-      glDrawElementsInstanced(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_INT,
-                              nullptr, instanceCount_);
+      glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType_,
+                              indexOffset, instanceCount_);
     } else {
       glDrawArraysInstanced(GL_TRIANGLES, 0, numVertices_, instanceCount_);
     }
@@ -205,7 +437,7 @@ void Mesh::glDraw() {
   } else {
     // Handle indexed arrays.
     if (!indices_.empty()) {
-      glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_INT, nullptr);
+      glDrawElements(GL_TRIANGLES, indexCount, indexType_, indexOffset);
     } else {
       glDrawArrays(GL_TRIANGLES, 0, numVertices_);
     }
@@ -2,25 +2,47 @@
 #define QUARKGL_MESH_H_
 
 #include <glad/glad.h>
+#include <qrk/bounds.h>
+#include <qrk/lod.h>
 #include <qrk/shader.h>
 #include <qrk/texture_map.h>
 #include <qrk/texture_registry.h>
 #include <qrk/vertex_array.h>
 
+#include <cstdint>
 #include <functional>
 #include <glm/glm.hpp>
+#include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <vector>
 
 namespace qrk {
 
+// The largest number of vertices that 16-bit indices can address.
+constexpr unsigned int MAX_16BIT_INDEXED_VERTICES = 65536;
+
+// Returns the smallest GL index type that can address the given number of
+// vertices. 8-bit indices are opt-in, since some hardware handles them poorly.
+unsigned int getIndexTypeForVertexCount(unsigned int numVertices,
+                                        bool allowByteIndices = false);
+// Returns the size, in bytes, of a single index of the given GL type.
+unsigned int getIndexSizeBytes(unsigned int indexType);
+
 class Renderable {
  public:
   virtual ~Renderable() = default;
 
   glm::mat4 getModelTransform() const { return model_; }
-  void setModelTransform(const glm::mat4& model) { model_ = model; }
+  virtual void setModelTransform(const glm::mat4& model) { model_ = model; }
+
+  // Returns the bounds of everything the renderable draws, in its own model
+  // space (i.e. before its model transform). Renderables without bounds are
+  // never culled.
+  virtual std::optional<BoundingBox> getLocalBounds() const {
+    return std::nullopt;
+  }
 
   // TODO: Add translation, rotation, scale methods.
 
@@ -38,30 +60,82 @@ class Renderable {
   glm::mat4 model_ = glm::mat4(1.0f);
 };
 
+// Returns whether a renderable could be visible in the frustum, when drawn
+// with the given parent transform.
+bool isRenderableVisible(const Renderable& renderable,
+                         const glm::mat4& transform, const Frustum& frustum);
+
 // A node in a tree of Renderables, containing one or more renderables.
 // When rendering, each node's transform is applied to the transform of its
 // Renderables, as well as to its child RenderableNodes.
+//
+// If the shader has a culling frustum, renderables and child nodes whose
+// bounds are outside of it are skipped. Each node's bounds are cached, and
+// are recomputed when the node's subtree changes shape or a node within it is
+// moved. Renderables may be shared between nodes, so changing the transform
+// of a renderable that isn't a node requires calling invalidateBounds() on
+// the nodes that hold it.
+//
+// Trees that are drawn many times per frame can be compiled into a DrawList,
+// which draws the same renderables without walking the tree.
 class RenderableNode : public Renderable {
  public:
   virtual ~RenderableNode() = default;
   void drawWithTransform(const glm::mat4& transform, Shader& shader,
                          TextureRegistry* textureRegistry = nullptr) override;
 
-  void addRenderable(std::unique_ptr<Renderable> renderable) {
+  void setModelTransform(const glm::mat4& model) override;
+  std::optional<BoundingBox> getLocalBounds() const override;
+  // Marks the cached bounds of this node and its ancestors as stale.
+  void invalidateBounds();
+  // Returns the number of renderables (other than nodes) in the subtree.
+  unsigned int getRenderableCount() const;
+
+  // Versions that increase whenever a node in the subtree is moved, or
+  // whenever the subtree changes shape, respectively.
+  uint64_t getTransformVersion() const { return subtreeTransformVersion_; }
+  uint64_t getStructureVersion() const { return structureVersion_; }
+
+  // Renderables may be shared between multiple nodes.
+  void addRenderable(std::shared_ptr<Renderable> renderable) {
     renderables_.push_back(std::move(renderable));
+    invalidateBounds();
+    markStructureChanged();
   }
 
   void addChildNode(std::unique_ptr<RenderableNode> childNode) {
+    childNode->parent_ = this;
     childNodes_.push_back(std::move(childNode));
+    invalidateBounds();
+    markStructureChanged();
   }
 
   void visitRenderables(std::function<void(Renderable*)> visitor);
 
  protected:
+  // Recomputes the cached bounds and renderable count, if stale.
+  void updateBounds() const;
+  // Bump the versions of this node and its ancestors.
+  void markTransformChanged();
+  void markStructureChanged();
+
   // The set of Renderables making up this node.
-  std::vector<std::unique_ptr<Renderable>> renderables_;
+  std::vector<std::shared_ptr<Renderable>> renderables_;
   // The set of child RenderableNodes.
   std::vector<std::unique_ptr<RenderableNode>> childNodes_;
+  RenderableNode* parent_ = nullptr;
+
+  mutable bool boundsDirty_ = true;
+  mutable std::optional<BoundingBox> bounds_;
+  mutable unsigned int renderableCount_ = 0;
+
+  // The version of this node's own transform, and the latest of any
+  // transform in its subtree.
+  uint64_t transformVersion_ = 0;
+  uint64_t subtreeTransformVersion_ = 0;
+  uint64_t structureVersion_ = 0;
+
+  friend class DrawList;
 };
 
 // An abstract class that represents a triangle mesh and handles loading and
@@ -76,17 +150,47 @@ class Mesh : public Renderable {
                          TextureRegistry* textureRegistry = nullptr) override;
 
   std::vector<unsigned int> getIndices() { return indices_; }
+  // Returns the GL type of the index buffer.
+  unsigned int getIndexType() const { return indexType_; }
   std::vector<TextureMap> getTextureMaps() { return textureMaps_; }
+  void setTextureMaps(const std::vector<TextureMap>& textureMaps) {
+    textureMaps_ = textureMaps;
+  }
+
+  // Returns the bounds of the mesh's vertices, in model space. Instanced
+  // meshes are bounded by all of their instances.
+  std::optional<BoundingBox> getLocalBounds() const override;
+  // Returns a sphere bounding a single copy of the mesh's vertices.
+  const BoundingSphere& getBoundingSphere() const { return boundingSphere_; }
+  // Sets the mesh's levels of detail, as ranges of its indices ordered from
+  // most to least detailed. Meshes without levels draw all of their indices.
+  void setLods(std::vector<MeshLod> lods) { lods_ = std::move(lods); }
+  const std::vector<MeshLod>& getLods() const { return lods_; }
+  // Sets the selector used to pick a level of detail for each draw. Without
+  // one, the most detailed level is always drawn. Instanced meshes draw every
+  // instance at the level that their nearest instance needs.
+  void setLodSelector(std::shared_ptr<LodSelector> lodSelector) {
+    lodSelector_ = std::move(lodSelector);
+  }
+  // Returns the level of detail used by the most recent draw.
+  unsigned int getCurrentLod() const { return currentLod_; }
 
  protected:
   // Loads mesh data into the mesh. Calls initializeVertexAttributes and
   // initializeVertexArrayInstanceData under the hood. Must be called
-  // immediately after construction.
+  // immediately after construction. Indices are uploaded using the smallest
+  // type that can address every vertex. Bounds are computed assuming that
+  // positions are the first attribute, as 3 floats; meshes with other layouts
+  // must call computeBounds() themselves afterwards.
   virtual void loadMeshData(const void* vertexData, unsigned int numVertices,
                             unsigned int vertexSizeBytes,
                             const std::vector<unsigned int>& indices,
                             const std::vector<TextureMap>& textureMaps,
                             unsigned int instanceCount = 0);
+  // Computes the mesh's bounds from its vertex positions. Positions are read
+  // as 3 floats every positionStrideBytes bytes.
+  void computeBounds(const float* positions, unsigned int numVertices,
+                     unsigned int positionStrideBytes);
   // Initializes vertex attributes.
   virtual void initializeVertexAttributes() = 0;
   // Allocates and initializes vertex array instance data.
@@ -106,6 +210,26 @@ class Mesh : public Renderable {
   // The size, in bytes, of each vertex.
   unsigned int vertexSizeBytes_;
   unsigned int instanceCount_;
+  // The GL type of the uploaded indices.
+  unsigned int indexType_ = GL_UNSIGNED_INT;
+  // Whether meshes with few enough vertices may use 8-bit indices. Must be set
+  // before loading mesh data.
+  bool allowByteIndices_ = false;
+  // Applied to vertex positions before the model transform (or before each
+  // instance transform), e.g. to dequantize compressed positions.
+  glm::mat4 vertexTransform_ = glm::mat4(1.0f);
+  // The bounds of the vertices, in model space (i.e. after any vertex
+  // transform).
+  BoundingBox localBounds_;
+  BoundingSphere boundingSphere_;
+  // The bounds of all of the instances, for instanced meshes.
+  BoundingBox instanceBounds_;
+  // The transforms of the instances that were loaded, for selecting their
+  // level of detail.
+  std::vector<glm::mat4> instanceModels_;
+  std::vector<MeshLod> lods_;
+  std::shared_ptr<LodSelector> lodSelector_;
+  unsigned int currentLod_ = 0;
 };
 
 }  // namespace qrk
@@ -0,0 +1,376 @@
+#include <qrk/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <numeric>
+
+namespace qrk {
+namespace {
+
+// A FIFO vertex cache, simulated with timestamps: a vertex is in the cache if
+// it was inserted within the last cacheSize insertions.
+class VertexCacheSimulator {
+ public:
+  VertexCacheSimulator(size_t vertexCount, unsigned int cacheSize)
+      : cacheTimes_(vertexCount, 0),
+        cacheSize_(cacheSize),
+        timestamp_(cacheSize + 1) {}
+
+  // Returns whether the vertex was a miss.
+  bool access(uint32_t vertex) {
+    if (isCached(vertex)) return false;
+    cacheTimes_[vertex] = timestamp_++;
+    return true;
+  }
+  unsigned int accessTriangle(const uint32_t* triangle) {
+    return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+  }
+  bool isCached(uint32_t vertex) const { return getAge(vertex) <= cacheSize_; }
+  // Returns the number of insertions since the vertex was last inserted.
+  uint32_t getAge(uint32_t vertex) const {
+    return timestamp_ - cacheTimes_[vertex];
+  }
+  // Evicts everything.
+  void clear() { timestamp_ += cacheSize_ + 1; }
+
+ private:
+  std::vector<uint32_t> cacheTimes_;
+  uint32_t cacheSize_;
+  uint32_t timestamp_;
+};
+
+// The triangles that use each vertex.
+struct TriangleAdjacency {
+  // Triangles for vertex v are triangles[offsets[v]..offsets[v + 1]).
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+};
+
+TriangleAdjacency buildAdjacency(std::span<const uint32_t> indices,
+                                 size_t vertexCount) {
+  TriangleAdjacency adjacency;
+  adjacency.offsets.assign(vertexCount + 1, 0);
+  for (uint32_t index : indices) {
+    adjacency.offsets[index + 1]++;
+  }
+  std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(),
+                   adjacency.offsets.begin());
+
+  adjacency.triangles.resize(indices.size());
+  std::vector<uint32_t> cursors(adjacency.offsets.begin(),
+                                adjacency.offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++) {
+    adjacency.triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+  return adjacency;
+}
+
+glm::vec3 getPosition(const float* positions, size_t strideBytes,
+                      uint32_t vertex) {
+  const float* p = reinterpret_cast<const float*>(
+      reinterpret_cast<const char*>(positions) + vertex * strideBytes);
+  return glm::vec3(p[0], p[1], p[2]);
+}
+
+size_t getClusterEnd(const std::vector<size_t>& clusters, size_t cluster,
+                     size_t triangleCount) {
+  return cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+}
+
+// Returns the first triangle of each cluster. Clusters start wherever the
+// cache-optimized ordering had to jump to a disconnected part of the mesh,
+// which shows up as a triangle with three cache misses.
+std::vector<size_t> findHardBoundaries(std::span<const uint32_t> indices,
+                                       size_t vertexCount,
+                                       unsigned int cacheSize) {
+  std::vector<size_t> clusters;
+  VertexCacheSimulator cache(vertexCount, cacheSize);
+  const size_t triangleCount = indices.size() / 3;
+  for (size_t i = 0; i < triangleCount; i++) {
+    if (cache.accessTriangle(&indices[i * 3]) == 3 || i == 0) {
+      clusters.push_back(i);
+    }
+  }
+  return clusters;
+}
+
+// Splits clusters further, wherever the cluster so far already has an ACMR
+// within the threshold of the whole cluster's.
+std::vector<size_t> findSoftBoundaries(std::span<const uint32_t> indices,
+                                       size_t vertexCount,
+                                       const std::vector<size_t>& clusters,
+                                       unsigned int cacheSize,
+                                       float threshold) {
+  std::vector<size_t> result;
+  VertexCacheSimulator cache(vertexCount, cacheSize);
+  const size_t triangleCount = indices.size() / 3;
+  for (size_t c = 0; c < clusters.size(); c++) {
+    const size_t start = clusters[c];
+    const size_t end = getClusterEnd(clusters, c, triangleCount);
+
+    cache.clear();
+    size_t clusterMisses = 0;
+    for (size_t i = start; i < end; i++) {
+      clusterMisses += cache.accessTriangle(&indices[i * 3]);
+    }
+    const float clusterThreshold =
+        threshold * static_cast<float>(clusterMisses) / (end - start);
+
+    result.push_back(start);
+    cache.clear();
+    size_t runningMisses = 0;
+    size_t runningTriangles = 0;
+    for (size_t i = start; i < end; i++) {
+      runningMisses += cache.accessTriangle(&indices[i * 3]);
+      runningTriangles++;
+      const float runningAcmr =
+          static_cast<float>(runningMisses) / runningTriangles;
+      if (i + 1 < end && runningAcmr <= clusterThreshold) {
+        result.push_back(i + 1);
+        cache.clear();
+        runningMisses = 0;
+        runningTriangles = 0;
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+float VertexCacheStats::getAcmr() const {
+  return triangleCount ? static_cast<float>(transformCount) / triangleCount
+                       : 0.0f;
+}
+
+float VertexCacheStats::getAtvr() const {
+  return vertexCount ? static_cast<float>(transformCount) / vertexCount : 0.0f;
+}
+
+VertexCacheStats& VertexCacheStats::operator+=(const VertexCacheStats& other) {
+  triangleCount += other.triangleCount;
+  vertexCount += other.vertexCount;
+  transformCount += other.transformCount;
+  return *this;
+}
+
+MeshOptimizationStats& MeshOptimizationStats::operator+=(
+    const MeshOptimizationStats& other) {
+  before += other.before;
+  after += other.after;
+  return *this;
+}
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices,
+                                    size_t vertexCount,
+                                    unsigned int cacheSize) {
+  VertexCacheStats stats;
+  stats.triangleCount = indices.size() / 3;
+
+  VertexCacheSimulator cache(vertexCount, cacheSize);
+  std::vector<bool> referenced(vertexCount, false);
+  for (uint32_t index : indices) {
+    stats.transformCount += cache.access(index);
+    if (!referenced[index]) {
+      referenced[index] = true;
+      stats.vertexCount++;
+    }
+  }
+  return stats;
+}
+
+std::vector<uint32_t> optimizeVertexCache(std::span<const uint32_t> indices,
+                                          size_t vertexCount,
+                                          unsigned int cacheSize) {
+  const size_t triangleCount = indices.size() / 3;
+  // Ignore any trailing partial triangle.
+  indices = indices.first(triangleCount * 3);
+  const TriangleAdjacency adjacency = buildAdjacency(indices, vertexCount);
+
+  // The number of not-yet-emitted triangles using each vertex.
+  std::vector<uint32_t> liveCounts(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) {
+    liveCounts[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+  }
+  std::vector<bool> emitted(triangleCount, false);
+  VertexCacheSimulator cache(vertexCount, cacheSize);
+  // Recently used vertices, to fall back to when the fanning vertex has no
+  // good candidates.
+  std::vector<uint32_t> deadEndStack;
+  std::vector<uint32_t> candidates;
+  // Scans forward for unprocessed vertices, as a last resort.
+  size_t cursor = 0;
+
+  auto nextLiveVertex = [&]() -> int64_t {
+    while (!deadEndStack.empty()) {
+      uint32_t vertex = deadEndStack.back();
+      deadEndStack.pop_back();
+      if (liveCounts[vertex] > 0) return vertex;
+    }
+    for (; cursor < vertexCount; cursor++) {
+      if (liveCounts[cursor] > 0) return cursor;
+    }
+    return -1;
+  };
+
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  int64_t fanningVertex = nextLiveVertex();
+  while (fanningVertex >= 0) {
+    // Emit every remaining triangle around the fanning vertex.
+    candidates.clear();
+    for (uint32_t i = adjacency.offsets[fanningVertex];
+         i < adjacency.offsets[fanningVertex + 1]; i++) {
+      const uint32_t triangle = adjacency.triangles[i];
+      if (emitted[triangle]) continue;
+      emitted[triangle] = true;
+      for (int j = 0; j < 3; j++) {
+        const uint32_t vertex = indices[triangle * 3 + j];
+        result.push_back(vertex);
+        deadEndStack.push_back(vertex);
+        candidates.push_back(vertex);
+        liveCounts[vertex]--;
+        cache.access(vertex);
+      }
+    }
+
+    // Pick the next fanning vertex from the vertices just emitted, preferring
+    // the oldest one that will still be in the cache after its remaining
+    // triangles are emitted.
+    int64_t best = -1;
+    int64_t bestPriority = -1;
+    for (uint32_t vertex : candidates) {
+      if (liveCounts[vertex] == 0) continue;
+      int64_t priority = 0;
+      if (cache.getAge(vertex) + 2 * liveCounts[vertex] <= cacheSize) {
+        priority = cache.getAge(vertex);
+      }
+      if (priority > bestPriority) {
+        best = vertex;
+        bestPriority = priority;
+      }
+    }
+    fanningVertex = best >= 0 ? best : nextLiveVertex();
+  }
+  return result;
+}
+
+std::vector<uint32_t> optimizeOverdraw(std::span<const uint32_t> indices,
+                                       const float* positions,
+                                       size_t vertexCount,
+                                       size_t positionStrideBytes,
+                                       float threshold,
+                                       unsigned int cacheSize) {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) return {};
+  indices = indices.first(triangleCount * 3);
+
+  std::vector<size_t> clusters = findSoftBoundaries(
+      indices, vertexCount,
+      findHardBoundaries(indices, vertexCount, cacheSize), cacheSize,
+      threshold);
+
+  glm::vec3 meshCentroid(0.0f);
+  for (uint32_t index : indices) {
+    meshCentroid += getPosition(positions, positionStrideBytes, index);
+  }
+  meshCentroid /= static_cast<float>(indices.size());
+
+  // Sort clusters so that those facing away from the mesh center are drawn
+  // first; they're the most likely to occlude the rest.
+  std::vector<float> sortKeys(clusters.size());
+  for (size_t c = 0; c < clusters.size(); c++) {
+    const size_t start = clusters[c];
+    const size_t end = getClusterEnd(clusters, c, triangleCount);
+
+    glm::vec3 centroid(0.0f);
+    glm::vec3 normal(0.0f);
+    float area = 0.0f;
+    for (size_t i = start; i < end; i++) {
+      const glm::vec3 p0 =
+          getPosition(positions, positionStrideBytes, indices[i * 3 + 0]);
+      const glm::vec3 p1 =
+          getPosition(positions, positionStrideBytes, indices[i * 3 + 1]);
+      const glm::vec3 p2 =
+          getPosition(positions, positionStrideBytes, indices[i * 3 + 2]);
+      // Area-weighted, since the cross product's length is twice the area.
+      const glm::vec3 weightedNormal = glm::cross(p1 - p0, p2 - p0);
+      const float triangleArea = glm::length(weightedNormal);
+      centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+      normal += weightedNormal;
+      area += triangleArea;
+    }
+    if (area > 0.0f) centroid /= area;
+    const float normalLength = glm::length(normal);
+    if (normalLength > 0.0f) normal /= normalLength;
+    sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+  }
+
+  std::vector<size_t> order(clusters.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (size_t c : order) {
+    const size_t start = clusters[c];
+    const size_t end = getClusterEnd(clusters, c, triangleCount);
+    result.insert(result.end(), indices.begin() + start * 3,
+                  indices.begin() + end * 3);
+  }
+  return result;
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices,
+                                          size_t vertexCount) {
+  constexpr uint32_t UNASSIGNED = ~0u;
+  std::vector<uint32_t> remap(vertexCount, UNASSIGNED);
+  uint32_t nextVertex = 0;
+  for (uint32_t& index : indices) {
+    if (remap[index] == UNASSIGNED) remap[index] = nextVertex++;
+    index = remap[index];
+  }
+  for (uint32_t& entry : remap) {
+    if (entry == UNASSIGNED) entry = nextVertex++;
+  }
+  return remap;
+}
+
+void remapVertices(void* vertices, size_t vertexCount, size_t vertexSizeBytes,
+                   std::span<const uint32_t> remap) {
+  char* bytes = static_cast<char*>(vertices);
+  std::vector<char> original(bytes, bytes + vertexCount * vertexSizeBytes);
+  for (size_t i = 0; i < vertexCount; i++) {
+    std::memcpy(bytes + remap[i] * vertexSizeBytes,
+                original.data() + i * vertexSizeBytes, vertexSizeBytes);
+  }
+}
+
+MeshOptimizationStats optimizeMesh(std::span<uint32_t> indices, void* vertices,
+                                   size_t vertexCount, size_t vertexSizeBytes,
+                                   const MeshOptimizerOptions& options) {
+  MeshOptimizationStats stats;
+  stats.before = analyzeVertexCache(indices, vertexCount, options.cacheSize);
+
+  std::vector<uint32_t> optimized =
+      optimizeVertexCache(indices, vertexCount, options.cacheSize);
+  if (options.optimizeOverdraw) {
+    optimized = optimizeOverdraw(optimized, static_cast<const float*>(vertices),
+                                 vertexCount, vertexSizeBytes,
+                                 options.overdrawThreshold, options.cacheSize);
+  }
+  std::copy(optimized.begin(), optimized.end(), indices.begin());
+
+  if (options.optimizeVertexFetch) {
+    std::vector<uint32_t> remap = optimizeVertexFetch(indices, vertexCount);
+    remapVertices(vertices, vertexCount, vertexSizeBytes, remap);
+  }
+
+  stats.after = analyzeVertexCache(indices, vertexCount, options.cacheSize);
+  return stats;
+}
+
+}  // namespace qrk
@@ -0,0 +1,94 @@
+#ifndef QUARKGL_MESH_OPTIMIZER_H_
+#define QUARKGL_MESH_OPTIMIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace qrk {
+
+// The number of entries in the simulated post-transform vertex cache. Real
+// hardware varies, but orderings tuned for a small FIFO cache hold up well on
+// larger ones.
+constexpr unsigned int DEFAULT_VERTEX_CACHE_SIZE = 16;
+// How much worse than the vertex cache ordering the overdraw ordering is
+// allowed to make ACMR.
+constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+// Results from simulating a FIFO post-transform vertex cache over a triangle
+// list.
+struct VertexCacheStats {
+  size_t triangleCount = 0;
+  // The number of distinct vertices referenced.
+  size_t vertexCount = 0;
+  // The number of times a vertex had to be transformed (i.e. cache misses).
+  size_t transformCount = 0;
+
+  // Average cache miss ratio: transforms per triangle. Ranges from 3 (no
+  // reuse) down to ~0.5 for large regular grids.
+  float getAcmr() const;
+  // Average transform to vertex ratio. 1 is optimal.
+  float getAtvr() const;
+
+  VertexCacheStats& operator+=(const VertexCacheStats& other);
+};
+
+struct MeshOptimizationStats {
+  VertexCacheStats before;
+  VertexCacheStats after;
+
+  MeshOptimizationStats& operator+=(const MeshOptimizationStats& other);
+};
+
+struct MeshOptimizerOptions {
+  unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE;
+  // Whether to reorder triangle clusters to reduce overdraw, after optimizing
+  // for the vertex cache.
+  bool optimizeOverdraw = true;
+  float overdrawThreshold = DEFAULT_OVERDRAW_THRESHOLD;
+  // Whether to reorder vertices into the order that they're first referenced.
+  bool optimizeVertexFetch = true;
+};
+
+// Simulates a FIFO vertex cache over a triangle list.
+VertexCacheStats analyzeVertexCache(
+    std::span<const uint32_t> indices, size_t vertexCount,
+    unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Reorders triangles for vertex cache locality, using Tipsify (Sander et al.,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+std::vector<uint32_t> optimizeVertexCache(
+    std::span<const uint32_t> indices, size_t vertexCount,
+    unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Reorders triangles to reduce overdraw, by splitting a cache-optimized
+// triangle list into clusters and drawing outward-facing clusters first.
+// Positions are read as 3 floats every positionStrideBytes bytes. Clusters
+// are chosen so that ACMR gets no worse than threshold times the input's.
+std::vector<uint32_t> optimizeOverdraw(
+    std::span<const uint32_t> indices, const float* positions,
+    size_t vertexCount, size_t positionStrideBytes,
+    float threshold = DEFAULT_OVERDRAW_THRESHOLD,
+    unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Renumbers vertices in the order that the indices first reference them,
+// rewriting the indices in place. Returns the remap table from old to new
+// vertex index. Unreferenced vertices are moved to the end.
+std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices,
+                                          size_t vertexCount);
+
+// Moves each vertex to its position in the remap table. Works on vertices of
+// any size, e.g. interleaved float arrays.
+void remapVertices(void* vertices, size_t vertexCount, size_t vertexSizeBytes,
+                   std::span<const uint32_t> remap);
+
+// Runs all enabled optimization stages on an indexed triangle list, in place.
+// Vertex positions must be the first attribute, as 3 floats.
+MeshOptimizationStats optimizeMesh(std::span<uint32_t> indices, void* vertices,
+                                   size_t vertexCount, size_t vertexSizeBytes,
+                                   const MeshOptimizerOptions& options = {});
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <qrk/mesh_optimizer.h>
+
+#include <algorithm>
+#include <array>
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Grid {
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> indices;
+};
+
+// A size x size quad grid, with its triangles in random order.
+Grid makeShuffledGrid(uint32_t size) {
+  Grid grid;
+  for (uint32_t y = 0; y <= size; y++) {
+    for (uint32_t x = 0; x <= size; x++) {
+      grid.positions.emplace_back(x, y, 0.0f);
+    }
+  }
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (uint32_t y = 0; y < size; y++) {
+    for (uint32_t x = 0; x < size; x++) {
+      uint32_t a = y * (size + 1) + x;
+      uint32_t b = a + 1;
+      uint32_t c = a + size + 1;
+      uint32_t d = c + 1;
+      triangles.push_back({a, b, d});
+      triangles.push_back({a, d, c});
+    }
+  }
+  std::mt19937 rng(1234);
+  std::shuffle(triangles.begin(), triangles.end(), rng);
+  for (const auto& triangle : triangles) {
+    grid.indices.insert(grid.indices.end(), triangle.begin(), triangle.end());
+  }
+  return grid;
+}
+
+// Returns each triangle's vertices, rotated so that the smallest index comes
+// first (which preserves winding), in sorted order.
+std::vector<std::array<uint32_t, 3>> canonicalTriangles(
+    const std::vector<uint32_t>& indices) {
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::array<uint32_t, 3> triangle = {indices[i], indices[i + 1],
+                                        indices[i + 2]};
+    std::rotate(triangle.begin(),
+                std::min_element(triangle.begin(), triangle.end()),
+                triangle.end());
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+TEST(MeshOptimizerTest, AnalyzesStrip) {
+  // A strip of 4 triangles over 6 vertices; each vertex is transformed once.
+  std::vector<uint32_t> indices = {0, 1, 2, 2, 1, 3, 2, 3, 4, 4, 3, 5};
+  auto stats = qrk::analyzeVertexCache(indices, 6);
+  EXPECT_EQ(stats.triangleCount, 4);
+  EXPECT_EQ(stats.vertexCount, 6);
+  EXPECT_EQ(stats.transformCount, 6);
+  EXPECT_FLOAT_EQ(stats.getAcmr(), 1.5f);
+  EXPECT_FLOAT_EQ(stats.getAtvr(), 1.0f);
+}
+
+TEST(MeshOptimizerTest, AnalyzesCacheEviction) {
+  // With a cache of 3, the first vertex is evicted before it's reused.
+  std::vector<uint32_t> indices = {0, 1, 2, 3, 4, 5, 0, 1, 2};
+  auto stats = qrk::analyzeVertexCache(indices, 6, /*cacheSize=*/3);
+  EXPECT_EQ(stats.transformCount, 9);
+  EXPECT_FLOAT_EQ(stats.getAtvr(), 1.5f);
+}
+
+TEST(MeshOptimizerTest, VertexCacheOptimizationImprovesAcmr) {
+  Grid grid = makeShuffledGrid(32);
+  auto before = qrk::analyzeVertexCache(grid.indices, grid.positions.size());
+  auto optimized =
+      qrk::optimizeVertexCache(grid.indices, grid.positions.size());
+  auto after = qrk::analyzeVertexCache(optimized, grid.positions.size());
+
+  EXPECT_EQ(canonicalTriangles(optimized), canonicalTriangles(grid.indices));
+  EXPECT_GT(before.getAcmr(), 2.0f);
+  EXPECT_LT(after.getAcmr(), 0.8f);
+}
+
+TEST(MeshOptimizerTest, OverdrawOptimizationKeepsTrianglesAndAcmr) {
+  Grid grid = makeShuffledGrid(32);
+  auto cacheOptimized =
+      qrk::optimizeVertexCache(grid.indices, grid.positions.size());
+  auto optimized = qrk::optimizeOverdraw(
+      cacheOptimized, &grid.positions[0].x, grid.positions.size(),
+      sizeof(glm::vec3), /*threshold=*/1.05f);
+
+  EXPECT_EQ(canonicalTriangles(optimized), canonicalTriangles(grid.indices));
+  float cacheAcmr =
+      qrk::analyzeVertexCache(cacheOptimized, grid.positions.size()).getAcmr();
+  float overdrawAcmr =
+      qrk::analyzeVertexCache(optimized, grid.positions.size()).getAcmr();
+  // Cluster boundaries cost a little, but not much more than the threshold.
+  EXPECT_LT(overdrawAcmr, cacheAcmr * 1.1f);
+}
+
+TEST(MeshOptimizerTest, VertexFetchOptimizationUsesFirstReferenceOrder) {
+  std::vector<uint32_t> indices = {3, 1, 4, 4, 1, 0};
+  auto remap = qrk::optimizeVertexFetch(indices, 6);
+  EXPECT_EQ(indices, (std::vector<uint32_t>{0, 1, 2, 2, 1, 3}));
+  // Vertex 2 and 5 are unreferenced, so go at the end in their old order.
+  EXPECT_EQ(remap, (std::vector<uint32_t>{3, 1, 4, 0, 2, 5}));
+
+  std::vector<int> vertices = {10, 11, 12, 13, 14, 15};
+  qrk::remapVertices(vertices.data(), vertices.size(), sizeof(int), remap);
+  EXPECT_EQ(vertices, (std::vector<int>{13, 11, 14, 10, 12, 15}));
+}
+
+TEST(MeshOptimizerTest, OptimizeMeshPreservesGeometry) {
+  Grid grid = makeShuffledGrid(16);
+  // Like canonicalTriangles, but by position, since indices get renumbered.
+  auto positionTriangles = [](const Grid& grid) {
+    std::vector<std::array<std::array<float, 3>, 3>> triangles;
+    for (size_t i = 0; i + 2 < grid.indices.size(); i += 3) {
+      std::array<std::array<float, 3>, 3> triangle;
+      for (int j = 0; j < 3; j++) {
+        const glm::vec3& p = grid.positions[grid.indices[i + j]];
+        triangle[j] = {p.x, p.y, p.z};
+      }
+      std::rotate(triangle.begin(),
+                  std::min_element(triangle.begin(), triangle.end()),
+                  triangle.end());
+      triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+  };
+  auto expected = positionTriangles(grid);
+
+  auto stats =
+      qrk::optimizeMesh(grid.indices, grid.positions.data(),
+                        grid.positions.size(), sizeof(glm::vec3));
+  EXPECT_EQ(positionTriangles(grid), expected);
+  EXPECT_LT(stats.after.getAcmr(), stats.before.getAcmr());
+  EXPECT_EQ(stats.after.triangleCount, stats.before.triangleCount);
+  // Vertices are now in first-reference order.
+  EXPECT_EQ(grid.indices[0], 0);
+}
+
+TEST(MeshOptimizerTest, HandlesEmptyMesh) {
+  std::vector<uint32_t> indices;
+  auto stats = qrk::optimizeMesh(indices, nullptr, 0, sizeof(glm::vec3));
+  EXPECT_EQ(stats.after.triangleCount, 0);
+  EXPECT_FLOAT_EQ(stats.after.getAcmr(), 0.0f);
+}
+
+}  // namespace
@@ -1,5 +1,6 @@
 #include "mesh_primitives.h"
 
+#include <qrk/mesh_optimizer.h>
 #include <qrk/mesh_primitives.h>
 
 namespace qrk {
@@ -324,6 +325,10 @@ void SphereMesh::loadMeshAndTextures(
   }
 
   constexpr unsigned int sphereVertexSizeBytes = 11 * sizeof(float);
+  // The rows are generated in order, which makes poor use of the vertex cache.
+  optimizeMesh(indices, vertexData.data(),
+               (sizeof(float) * vertexData.size()) / sphereVertexSizeBytes,
+               sphereVertexSizeBytes);
   loadMeshData(vertexData.data(),
                (sizeof(float) * vertexData.size()) / sphereVertexSizeBytes,
                sphereVertexSizeBytes, indices, textureMaps);
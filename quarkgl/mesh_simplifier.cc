@@ -0,0 +1,357 @@
+#include <qrk/mesh_simplifier.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <numeric>
+#include <unordered_map>
+
+namespace qrk {
+namespace {
+
+// A quadric error metric: the sum of squared distances to a set of weighted
+// planes, as error(p) = p^T A p + 2 b^T p + c, where A is symmetric.
+// Accumulated in double precision, since the terms cancel heavily near the
+// planes.
+struct Quadric {
+  double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+  double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+  double c = 0.0;
+  // The total weight of the planes.
+  double weight = 0.0;
+
+  // Creates a quadric for the plane dot(normal, p) + d = 0.
+  static Quadric fromPlane(const glm::dvec3& normal, double d, double weight) {
+    Quadric q;
+    q.a00 = weight * normal.x * normal.x;
+    q.a01 = weight * normal.x * normal.y;
+    q.a02 = weight * normal.x * normal.z;
+    q.a11 = weight * normal.y * normal.y;
+    q.a12 = weight * normal.y * normal.z;
+    q.a22 = weight * normal.z * normal.z;
+    q.b0 = weight * normal.x * d;
+    q.b1 = weight * normal.y * d;
+    q.b2 = weight * normal.z * d;
+    q.c = weight * d * d;
+    q.weight = weight;
+    return q;
+  }
+
+  Quadric& operator+=(const Quadric& other) {
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+    weight += other.weight;
+    return *this;
+  }
+
+  // Returns the weighted mean squared distance from p to the planes.
+  double getError(const glm::dvec3& p) const {
+    if (weight <= 0.0) return 0.0;
+    const double error = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                         2.0 * (a01 * p.x * p.y + a02 * p.x * p.z +
+                                a12 * p.y * p.z) +
+                         2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+    // Rounding can push the error of points on the planes slightly negative.
+    return std::max(error, 0.0) / weight;
+  }
+};
+
+// A candidate edge collapse, which moves one vertex onto another.
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double error;
+};
+
+// The triangles that use each vertex.
+struct TriangleAdjacency {
+  // Triangles for vertex v are triangles[offsets[v]..offsets[v + 1]).
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+};
+
+TriangleAdjacency buildAdjacency(std::span<const uint32_t> indices,
+                                 size_t vertexCount) {
+  TriangleAdjacency adjacency;
+  adjacency.offsets.assign(vertexCount + 1, 0);
+  for (uint32_t index : indices) {
+    adjacency.offsets[index + 1]++;
+  }
+  std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(),
+                   adjacency.offsets.begin());
+
+  adjacency.triangles.resize(indices.size());
+  std::vector<uint32_t> cursors(adjacency.offsets.begin(),
+                                adjacency.offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++) {
+    adjacency.triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+  return adjacency;
+}
+
+glm::vec3 getPosition(const float* positions, size_t strideBytes,
+                      uint32_t vertex) {
+  const float* p = reinterpret_cast<const float*>(
+      reinterpret_cast<const char*>(positions) + vertex * strideBytes);
+  return glm::vec3(p[0], p[1], p[2]);
+}
+
+struct PositionKey {
+  uint32_t bits[3];
+
+  bool operator==(const PositionKey& other) const {
+    return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+  }
+};
+
+struct PositionKeyHash {
+  size_t operator()(const PositionKey& key) const {
+    uint64_t hash = key.bits[0];
+    hash = hash * 0x9e3779b97f4a7c15ull ^ key.bits[1];
+    hash = hash * 0x9e3779b97f4a7c15ull ^ key.bits[2];
+    return static_cast<size_t>(hash ^ (hash >> 32));
+  }
+};
+
+// Maps each vertex to the first vertex that has the exact same position.
+std::vector<uint32_t> buildPositionRemap(const float* positions,
+                                         size_t vertexCount,
+                                         size_t strideBytes) {
+  std::vector<uint32_t> remap(vertexCount);
+  std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstVertices;
+  firstVertices.reserve(vertexCount);
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    glm::vec3 p = getPosition(positions, strideBytes, v);
+    PositionKey key;
+    std::memcpy(key.bits, &p.x, sizeof(key.bits));
+    remap[v] = firstVertices.emplace(key, v).first->second;
+  }
+  return remap;
+}
+
+// Finds the vertices that can't be moved without tearing or shrinking the
+// mesh: those that share their position with other vertices, and those on
+// border or non-manifold edges of the position-welded mesh.
+std::vector<bool> findLockedVertices(std::span<const uint32_t> indices,
+                                     const std::vector<uint32_t>& remap) {
+  std::vector<bool> locked(remap.size(), false);
+  std::vector<uint32_t> positionUses(remap.size(), 0);
+  for (uint32_t v = 0; v < remap.size(); v++) {
+    positionUses[remap[v]]++;
+  }
+  for (uint32_t v = 0; v < remap.size(); v++) {
+    locked[v] = positionUses[remap[v]] > 1;
+  }
+
+  auto getEdgeKey = [&](uint32_t a, uint32_t b) {
+    a = remap[a];
+    b = remap[b];
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+  };
+  std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+  edgeTriangles.reserve(indices.size());
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    for (int j = 0; j < 3; j++) {
+      edgeTriangles[getEdgeKey(indices[i + j], indices[i + (j + 1) % 3])]++;
+    }
+  }
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    for (int j = 0; j < 3; j++) {
+      const uint32_t a = indices[i + j];
+      const uint32_t b = indices[i + (j + 1) % 3];
+      if (edgeTriangles[getEdgeKey(a, b)] != 2) {
+        locked[a] = true;
+        locked[b] = true;
+      }
+    }
+  }
+  return locked;
+}
+
+// Sums the area-weighted planes of each vertex's triangles.
+std::vector<Quadric> computeVertexQuadrics(std::span<const uint32_t> indices,
+                                           const float* positions,
+                                           size_t vertexCount,
+                                           size_t strideBytes) {
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const glm::dvec3 p0 = getPosition(positions, strideBytes, indices[i]);
+    const glm::dvec3 p1 = getPosition(positions, strideBytes, indices[i + 1]);
+    const glm::dvec3 p2 = getPosition(positions, strideBytes, indices[i + 2]);
+    glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+    const double length = glm::length(normal);
+    if (length == 0.0) continue;
+    normal /= length;
+
+    const Quadric q =
+        Quadric::fromPlane(normal, -glm::dot(normal, p0), length * 0.5);
+    for (int j = 0; j < 3; j++) {
+      quadrics[indices[i + j]] += q;
+    }
+  }
+  return quadrics;
+}
+
+// Returns whether collapsing the edge keeps every remaining triangle around
+// the moved vertex facing the same way. Sets removedTriangles to the number
+// of triangles that the collapse degenerates.
+bool isCollapseValid(const Collapse& collapse,
+                     std::span<const uint32_t> indices,
+                     const TriangleAdjacency& adjacency,
+                     const float* positions, size_t strideBytes,
+                     unsigned int* removedTriangles) {
+  *removedTriangles = 0;
+  const glm::vec3 target = getPosition(positions, strideBytes, collapse.to);
+  for (uint32_t i = adjacency.offsets[collapse.from];
+       i < adjacency.offsets[collapse.from + 1]; i++) {
+    const uint32_t* triangle = &indices[adjacency.triangles[i] * 3];
+    if (triangle[0] == collapse.to || triangle[1] == collapse.to ||
+        triangle[2] == collapse.to) {
+      (*removedTriangles)++;
+      continue;
+    }
+
+    glm::vec3 before[3];
+    glm::vec3 after[3];
+    for (int j = 0; j < 3; j++) {
+      before[j] = getPosition(positions, strideBytes, triangle[j]);
+      after[j] = triangle[j] == collapse.from ? target : before[j];
+    }
+    const glm::vec3 normalBefore =
+        glm::cross(before[1] - before[0], before[2] - before[0]);
+    const glm::vec3 normalAfter =
+        glm::cross(after[1] - after[0], after[2] - after[0]);
+    if (glm::dot(normalBefore, normalAfter) <= 0.0f) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+float getMeshExtent(const float* positions, size_t vertexCount,
+                    size_t positionStrideBytes) {
+  if (vertexCount == 0) return 0.0f;
+  glm::vec3 min = getPosition(positions, positionStrideBytes, 0);
+  glm::vec3 max = min;
+  for (uint32_t v = 1; v < vertexCount; v++) {
+    glm::vec3 p = getPosition(positions, positionStrideBytes, v);
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+  const glm::vec3 size = max - min;
+  return std::max({size.x, size.y, size.z});
+}
+
+std::vector<uint32_t> simplifyMesh(std::span<const uint32_t> indices,
+                                   const float* positions, size_t vertexCount,
+                                   size_t positionStrideBytes,
+                                   size_t targetIndexCount, float maxError,
+                                   float* resultError) {
+  std::vector<uint32_t> result(indices.begin(), indices.end());
+  result.resize(result.size() / 3 * 3);
+  if (resultError) *resultError = 0.0f;
+
+  const float extent =
+      getMeshExtent(positions, vertexCount, positionStrideBytes);
+  if (result.size() <= targetIndexCount || extent <= 0.0f) return result;
+  // Quadric errors are squared distances.
+  const double maxDistance = static_cast<double>(maxError) * extent;
+  const double errorLimit = maxDistance * maxDistance;
+
+  const std::vector<bool> locked = findLockedVertices(
+      result,
+      buildPositionRemap(positions, vertexCount, positionStrideBytes));
+  std::vector<Quadric> quadrics = computeVertexQuadrics(
+      result, positions, vertexCount, positionStrideBytes);
+
+  double largestError = 0.0;
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> collapseTargets(vertexCount);
+  std::vector<bool> touched(vertexCount);
+  // Each pass makes a set of independent collapses, cheapest first. A
+  // collapse touches every triangle around the moved vertex, and those
+  // triangles can't change again until the next pass.
+  while (result.size() > targetIndexCount) {
+    collapses.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (int j = 0; j < 3; j++) {
+        const uint32_t a = result[i + j];
+        const uint32_t b = result[i + (j + 1) % 3];
+        const glm::dvec3 pa = getPosition(positions, positionStrideBytes, a);
+        const glm::dvec3 pb = getPosition(positions, positionStrideBytes, b);
+        if (!locked[a]) collapses.push_back({a, b, quadrics[a].getError(pb)});
+        if (!locked[b]) collapses.push_back({b, a, quadrics[b].getError(pa)});
+      }
+    }
+    // Interior edges are found once from each of their triangles.
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse& lhs, const Collapse& rhs) {
+                if (lhs.error != rhs.error) return lhs.error < rhs.error;
+                if (lhs.from != rhs.from) return lhs.from < rhs.from;
+                return lhs.to < rhs.to;
+              });
+    collapses.erase(std::unique(collapses.begin(), collapses.end(),
+                                [](const Collapse& lhs, const Collapse& rhs) {
+                                  return lhs.from == rhs.from &&
+                                         lhs.to == rhs.to;
+                                }),
+                    collapses.end());
+
+    const TriangleAdjacency adjacency = buildAdjacency(result, vertexCount);
+    std::iota(collapseTargets.begin(), collapseTargets.end(), 0u);
+    std::fill(touched.begin(), touched.end(), false);
+    const size_t excessIndices = result.size() - targetIndexCount;
+    size_t removedIndices = 0;
+    size_t collapseCount = 0;
+    for (const Collapse& collapse : collapses) {
+      if (collapse.error > errorLimit) break;
+      if (touched[collapse.from] || touched[collapse.to]) continue;
+      unsigned int removedTriangles;
+      if (!isCollapseValid(collapse, result, adjacency, positions,
+                           positionStrideBytes, &removedTriangles)) {
+        continue;
+      }
+
+      collapseTargets[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      for (uint32_t i = adjacency.offsets[collapse.from];
+           i < adjacency.offsets[collapse.from + 1]; i++) {
+        const uint32_t* triangle = &result[adjacency.triangles[i] * 3];
+        touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] =
+            true;
+      }
+      largestError = std::max(largestError, collapse.error);
+      collapseCount++;
+      removedIndices += removedTriangles * 3;
+      if (removedIndices >= excessIndices) break;
+    }
+    if (collapseCount == 0) break;
+
+    // Apply the collapses, dropping the triangles that they degenerate.
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      const uint32_t a = collapseTargets[result[i]];
+      const uint32_t b = collapseTargets[result[i + 1]];
+      const uint32_t c = collapseTargets[result[i + 2]];
+      if (a == b || b == c || a == c) continue;
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  if (resultError) *resultError = std::sqrt(largestError) / extent;
+  return result;
+}
+
+}  // namespace qrk
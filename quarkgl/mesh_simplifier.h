@@ -0,0 +1,40 @@
+#ifndef QUARKGL_MESH_SIMPLIFIER_H_
+#define QUARKGL_MESH_SIMPLIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace qrk {
+
+// The default largest error that simplification may introduce, relative to
+// the mesh's extent.
+constexpr float DEFAULT_SIMPLIFICATION_ERROR = 0.05f;
+
+// Returns the size of the largest side of the positions' bounding box.
+// Positions are read as 3 floats every positionStrideBytes bytes.
+float getMeshExtent(const float* positions, size_t vertexCount,
+                    size_t positionStrideBytes);
+
+// Simplifies an indexed triangle list down to at most targetIndexCount
+// indices, by collapsing edges in order of their quadric error (Garland and
+// Heckbert, "Surface Simplification Using Quadric Error Metrics").
+//
+// Each collapse moves a vertex onto one of its neighbours, so the result
+// indexes a subset of the input's vertices, and can share its vertex buffer.
+// Vertices on open borders, or that share a position with another vertex
+// (e.g. along UV seams), are never moved.
+//
+// Stops early rather than introduce an error larger than maxError, relative to
+// the mesh's extent. If resultError is given, it's set to the largest error
+// that was introduced, on the same scale.
+std::vector<uint32_t> simplifyMesh(
+    std::span<const uint32_t> indices, const float* positions,
+    size_t vertexCount, size_t positionStrideBytes, size_t targetIndexCount,
+    float maxError = DEFAULT_SIMPLIFICATION_ERROR,
+    float* resultError = nullptr);
+
+}  // namespace qrk
+
+#endif
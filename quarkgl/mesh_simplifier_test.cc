@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <qrk/mesh_simplifier.h>
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace {
+
+struct TestMesh {
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> indices;
+};
+
+// A size x size quad grid on the XY plane, facing +Z.
+TestMesh makeGrid(uint32_t size) {
+  TestMesh mesh;
+  for (uint32_t y = 0; y <= size; y++) {
+    for (uint32_t x = 0; x <= size; x++) {
+      mesh.positions.emplace_back(x, y, 0.0f);
+    }
+  }
+  for (uint32_t y = 0; y < size; y++) {
+    for (uint32_t x = 0; x < size; x++) {
+      uint32_t a = y * (size + 1) + x;
+      uint32_t b = a + 1;
+      uint32_t c = a + size + 1;
+      uint32_t d = c + 1;
+      mesh.indices.insert(mesh.indices.end(), {a, b, d, a, d, c});
+    }
+  }
+  return mesh;
+}
+
+// A closed unit sphere, made by subdividing an octahedron.
+TestMesh makeSphere(int subdivisions) {
+  TestMesh mesh;
+  mesh.positions = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                    {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+  mesh.indices = {0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4,
+                  2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5};
+  for (int i = 0; i < subdivisions; i++) {
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> midpoints;
+    auto getMidpoint = [&](uint32_t a, uint32_t b) {
+      auto key = std::minmax(a, b);
+      auto [it, inserted] = midpoints.emplace(key, mesh.positions.size());
+      if (inserted) {
+        mesh.positions.push_back(
+            glm::normalize(mesh.positions[a] + mesh.positions[b]));
+      }
+      return it->second;
+    };
+    std::vector<uint32_t> indices;
+    for (size_t j = 0; j < mesh.indices.size(); j += 3) {
+      uint32_t a = mesh.indices[j];
+      uint32_t b = mesh.indices[j + 1];
+      uint32_t c = mesh.indices[j + 2];
+      uint32_t ab = getMidpoint(a, b);
+      uint32_t bc = getMidpoint(b, c);
+      uint32_t ca = getMidpoint(c, a);
+      indices.insert(indices.end(),
+                     {a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca});
+    }
+    mesh.indices = std::move(indices);
+  }
+  return mesh;
+}
+
+std::vector<uint32_t> simplify(const TestMesh& mesh, size_t targetIndexCount,
+                               float maxError, float* resultError = nullptr) {
+  return qrk::simplifyMesh(mesh.indices, &mesh.positions[0].x,
+                           mesh.positions.size(), sizeof(glm::vec3),
+                           targetIndexCount, maxError, resultError);
+}
+
+TEST(MeshSimplifierTest, MeasuresExtent) {
+  TestMesh grid = makeGrid(4);
+  EXPECT_FLOAT_EQ(qrk::getMeshExtent(&grid.positions[0].x,
+                                     grid.positions.size(), sizeof(glm::vec3)),
+                  4.0f);
+}
+
+TEST(MeshSimplifierTest, SimplifiesPlaneWithoutError) {
+  TestMesh grid = makeGrid(16);
+  float error = -1.0f;
+  auto simplified = simplify(grid, grid.indices.size() / 4, 0.01f, &error);
+
+  EXPECT_LE(simplified.size(), grid.indices.size() / 4);
+  EXPECT_EQ(simplified.size() % 3, 0);
+  EXPECT_FLOAT_EQ(error, 0.0f);
+
+  // The surface keeps its area and orientation.
+  float area = 0.0f;
+  for (size_t i = 0; i < simplified.size(); i += 3) {
+    glm::vec3 normal = glm::cross(
+        grid.positions[simplified[i + 1]] - grid.positions[simplified[i]],
+        grid.positions[simplified[i + 2]] - grid.positions[simplified[i]]);
+    EXPECT_GT(normal.z, 0.0f);
+    area += normal.z * 0.5f;
+  }
+  EXPECT_NEAR(area, 16.0f * 16.0f, 1e-3f);
+
+  // Border vertices are never moved.
+  std::set<uint32_t> used(simplified.begin(), simplified.end());
+  for (uint32_t i = 0; i <= 16; i++) {
+    EXPECT_TRUE(used.count(i));
+    EXPECT_TRUE(used.count(16 * 17 + i));
+  }
+}
+
+TEST(MeshSimplifierTest, SimplifiesSphereWithinError) {
+  TestMesh sphere = makeSphere(4);
+  float error = 0.0f;
+  auto simplified = simplify(sphere, sphere.indices.size() / 4, 0.1f, &error);
+
+  EXPECT_LE(simplified.size(), sphere.indices.size() / 4);
+  EXPECT_GT(error, 0.0f);
+  EXPECT_LE(error, 0.1f);
+  for (uint32_t index : simplified) {
+    EXPECT_LT(index, sphere.positions.size());
+  }
+}
+
+TEST(MeshSimplifierTest, StopsAtErrorLimit) {
+  // Every collapse on a sphere moves the surface.
+  TestMesh sphere = makeSphere(2);
+  float error = -1.0f;
+  auto simplified = simplify(sphere, 0, 0.0f, &error);
+  EXPECT_EQ(simplified, sphere.indices);
+  EXPECT_FLOAT_EQ(error, 0.0f);
+}
+
+TEST(MeshSimplifierTest, KeepsSeamVertices) {
+  // Duplicate the grid's middle column, as if along a UV seam.
+  TestMesh grid = makeGrid(8);
+  std::set<uint32_t> seam;
+  for (uint32_t y = 0; y <= 8; y++) {
+    uint32_t original = y * 9 + 4;
+    uint32_t duplicate = grid.positions.size();
+    grid.positions.push_back(grid.positions[original]);
+    seam.insert(original);
+    seam.insert(duplicate);
+    // Triangles to the right of the seam use the duplicate.
+    for (size_t i = 0; i < grid.indices.size(); i += 3) {
+      bool rightOfSeam = false;
+      for (int j = 0; j < 3; j++) {
+        rightOfSeam |= grid.positions[grid.indices[i + j]].x > 4.0f;
+      }
+      for (int j = 0; j < 3 && rightOfSeam; j++) {
+        if (grid.indices[i + j] == original) grid.indices[i + j] = duplicate;
+      }
+    }
+  }
+
+  auto simplified = simplify(grid, 0, 0.01f);
+  EXPECT_LT(simplified.size(), grid.indices.size());
+  std::set<uint32_t> used(simplified.begin(), simplified.end());
+  for (uint32_t vertex : seam) {
+    EXPECT_TRUE(used.count(vertex)) << vertex;
+  }
+}
+
+TEST(MeshSimplifierTest, HandlesEmptyMesh) {
+  std::vector<uint32_t> indices;
+  float error = -1.0f;
+  auto simplified = qrk::simplifyMesh(indices, nullptr, 0, sizeof(glm::vec3),
+                                      0, 0.1f, &error);
+  EXPECT_TRUE(simplified.empty());
+  EXPECT_FLOAT_EQ(error, 0.0f);
+}
+
+}  // namespace
@@ -1,10 +1,21 @@
 #include <glad/glad.h>
+#include <qrk/compressed_texture.h>
 #include <qrk/model.h>
+#include <qrk/model_cache.h>
+#include <qrk/thread_pool.h>
 
+#include <algorithm>
 #include <assimp/Importer.hpp>
+#include <cstddef>
+#include <future>
+#include <unordered_set>
 
 namespace qrk {
 namespace {
+// The fraction of the previous level's triangles that each level of detail
+// aims for.
+constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+
 constexpr TextureMapType loaderSupportedTextureMapTypes[] = {
     TextureMapType::DIFFUSE,   TextureMapType::SPECULAR,
     TextureMapType::ROUGHNESS, TextureMapType::METALLIC,
@@ -22,200 +33,786 @@ glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& m) {
   );
   // clang-format on
 }
+
+void importMesh(ModelData& data, const aiMesh* mesh) {
+  ModelMeshData meshData = {
+      .vertexOffset = static_cast<uint32_t>(data.vertices.size()),
+      .vertexCount = mesh->mNumVertices,
+      .indexOffset = static_cast<uint32_t>(data.indices.size()),
+      .indexCount = 0,
+      .materialIndex = mesh->mMaterialIndex,
+      .lodOffset = 0,
+      .lodCount = 0,
+  };
+
+  for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+    ModelVertex vertex;
+
+    // Process vertex positions, normals, tangents, and texture coordinates.
+    auto inputPos = mesh->mVertices[i];
+    glm::vec3 position(inputPos.x, inputPos.y, inputPos.z);
+    vertex.position = position;
+
+    if (mesh->HasNormals()) {
+      auto inputNorm = mesh->mNormals[i];
+      vertex.normal = glm::vec3(inputNorm.x, inputNorm.y, inputNorm.z);
+    } else {
+      vertex.normal = glm::vec3(0.0f);
+    }
+
+    if (mesh->HasTangentsAndBitangents()) {
+      auto inputTangent = mesh->mTangents[i];
+      vertex.tangent =
+          glm::vec3(inputTangent.x, inputTangent.y, inputTangent.z);
+    } else {
+      vertex.tangent = glm::vec3(0.0f);
+    }
+
+    // TODO: This is only using the first texture coord set.
+    if (mesh->HasTextureCoords(0)) {
+      auto inputTexCoords = mesh->mTextureCoords[0][i];
+      vertex.texCoords = glm::vec2(inputTexCoords.x, inputTexCoords.y);
+    } else {
+      vertex.texCoords = glm::vec2(0.0f);
+    }
+
+    data.vertices.push_back(vertex);
+  }
+
+  // Process indices.
+  for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+    aiFace face = mesh->mFaces[i];
+    for (unsigned int j = 0; j < face.mNumIndices; j++) {
+      data.indices.push_back(face.mIndices[j]);
+    }
+  }
+  meshData.indexCount =
+      static_cast<uint32_t>(data.indices.size()) - meshData.indexOffset;
+
+  data.meshes.push_back(meshData);
+}
+
+std::vector<MeshLod> getMeshLods(const ModelDataView& data,
+                                 const ModelMeshData& mesh) {
+  std::vector<MeshLod> lods;
+  for (const ModelMeshLodData& lod : data.getLods(mesh)) {
+    lods.push_back({
+        .indexOffset = lod.indexOffset,
+        .indexCount = lod.indexCount,
+        .error = lod.error,
+    });
+  }
+  return lods;
+}
+
+void importMaterial(ModelData& data, const aiMaterial* material) {
+  ModelMaterialData materialData = {
+      .bindingOffset = static_cast<uint32_t>(data.textureBindings.size()),
+      .bindingCount = 0,
+  };
+
+  for (auto type : loaderSupportedTextureMapTypes) {
+    std::vector<aiTextureType> aiTypes = textureMapTypeToAiTextureTypes(type);
+    for (aiTextureType aiType : aiTypes) {
+      for (unsigned int i = 0; i < material->GetTextureCount(aiType); i++) {
+        aiString texturePath;
+        material->GetTexture(aiType, i, &texturePath);
+        data.textureBindings.push_back(
+            data.addTextureBinding(type, texturePath.C_Str()));
+        materialData.bindingCount++;
+      }
+    }
+  }
+
+  data.materials.push_back(materialData);
+}
+
+void importNode(ModelData& data, const aiNode* node, int32_t parentIndex) {
+  const int32_t nodeIndex = static_cast<int32_t>(data.nodes.size());
+  ModelNodeData nodeData = {
+      .transform = aiMatrix4x4ToGlm(node->mTransformation),
+      .parentIndex = parentIndex,
+      .meshRefOffset = static_cast<uint32_t>(data.nodeMeshRefs.size()),
+      .meshRefCount = node->mNumMeshes,
+  };
+  data.nodes.push_back(nodeData);
+  data.nodeMeshRefs.insert(data.nodeMeshRefs.end(), node->mMeshes,
+                           node->mMeshes + node->mNumMeshes);
+
+  // Recurse for children. Recursion stops when no children left.
+  for (unsigned int i = 0; i < node->mNumChildren; i++) {
+    importNode(data, node->mChildren[i], nodeIndex);
+  }
+}
 }  // namespace
 
-ModelMesh::ModelMesh(const std::vector<ModelVertex>& vertices,
-                     const std::vector<unsigned int>& indices,
+bool isSRGBTextureMapType(TextureMapType type) {
+  // Assume that diffuse and emissive textures are in sRGB.
+  // TODO: Allow for a way to override this if necessary.
+  return type == TextureMapType::DIFFUSE || type == TextureMapType::EMISSION;
+}
+
+ImageData decodeTextureMap(const std::string& path, TextureMapType type,
+                           const ModelParams& params) {
+  ImageData image;
+  std::optional<CompressedImageData> compressed;
+  if (isCompressedImagePath(path)) {
+    try {
+      compressed = readCompressedImage(path);
+    } catch (const CompressedTextureException& e) {
+      throw TextureException("ERROR::TEXTURE::LOAD_FAILED\n" +
+                             std::string(e.what()));
+    }
+  } else if (params.useCompressedTextures) {
+    CompressedTextureCache cache =
+        params.textureCacheDirectory.empty()
+            ? CompressedTextureCache()
+            : CompressedTextureCache(params.textureCacheDirectory);
+    compressed = cache.load(
+        computeCompressedTextureKey(path, isSRGBTextureMapType(type)));
+    if (compressed) compressed->path = path;
+  }
+
+  if (compressed) {
+    image = makeCompressedImageData(std::move(*compressed));
+  } else {
+    image = decodeImage(path.c_str());
+    if (params.cpuMipGeneration) {
+      generateCpuMips(image, isSRGBTextureMapType(type), params.mipFilter);
+    }
+  }
+  if (params.stagingRing) {
+    stageImage(image, *params.stagingRing);
+  }
+  return image;
+}
+
+uint32_t ModelImportOptions::getCacheKey() const {
+  return (optimizeMeshes ? 1u : 0u) | (splitLargeMeshes ? 2u : 0u) |
+         (std::min(lodCount, MAX_MODEL_LODS) << 2);
+}
+
+ModelImportOptions getImportOptions(const ModelParams& params) {
+  return {
+      .optimizeMeshes = params.optimizeMeshes,
+      .splitLargeMeshes = params.splitLargeMeshes,
+      .lodCount = std::min(params.lodCount, MAX_MODEL_LODS),
+  };
+}
+
+ModelData importModelData(const std::string& path, unsigned int loadFlags,
+                          const ModelImportOptions& options) {
+  Assimp::Importer importer;
+  // Scene is freed by the importer.
+  const aiScene* scene = importer.ReadFile(path, loadFlags);
+
+  if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
+      !scene->mRootNode) {
+    throw ModelLoaderException("ERROR::MODEL::" +
+                               std::string(importer.GetErrorString()));
+  }
+
+  ModelData data;
+  for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+    importMesh(data, scene->mMeshes[i]);
+  }
+  for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+    importMaterial(data, scene->mMaterials[i]);
+  }
+  importNode(data, scene->mRootNode, /*parentIndex=*/-1);
+
+  // Optimize first, so that split meshes inherit a cache-friendly order.
+  if (options.optimizeMeshes) {
+    optimizeModelMeshes(data);
+  }
+  if (options.splitLargeMeshes) {
+    splitLargeMeshes(data);
+  }
+  // Levels of detail share their mesh's vertices, so come last.
+  if (options.lodCount > 0) {
+    generateModelLods(data, options.lodCount);
+  }
+  return data;
+}
+
+void splitLargeMeshes(ModelData& data, uint32_t maxVertices) {
+  // Each triangle can add up to 3 new vertices.
+  maxVertices = std::max(maxVertices, 3u);
+  bool anyLarge = false;
+  for (const ModelMeshData& mesh : data.meshes) {
+    anyLarge |= mesh.vertexCount > maxVertices;
+  }
+  if (!anyLarge) return;
+
+  std::vector<ModelVertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<ModelMeshData> meshes;
+  vertices.reserve(data.vertices.size());
+  indices.reserve(data.indices.size());
+  // The range of new meshes that each original mesh became.
+  std::vector<std::pair<uint32_t, uint32_t>> meshParts;
+  meshParts.reserve(data.meshes.size());
+
+  // Maps a mesh's vertex to its index within the current part.
+  constexpr uint32_t UNASSIGNED = ~0u;
+  std::vector<uint32_t> localIndices;
+  for (const ModelMeshData& mesh : data.meshes) {
+    const uint32_t firstPart = meshes.size();
+    auto startPart = [&]() {
+      meshes.push_back({
+          .vertexOffset = static_cast<uint32_t>(vertices.size()),
+          .vertexCount = 0,
+          .indexOffset = static_cast<uint32_t>(indices.size()),
+          .indexCount = 0,
+          .materialIndex = mesh.materialIndex,
+          .lodOffset = 0,
+          .lodCount = 0,
+      });
+      localIndices.assign(mesh.vertexCount, UNASSIGNED);
+    };
+
+    if (mesh.vertexCount <= maxVertices) {
+      startPart();
+      ModelMeshData& part = meshes.back();
+      auto meshVertices = data.view().getVertices(mesh);
+      auto meshIndices = data.view().getIndices(mesh);
+      vertices.insert(vertices.end(), meshVertices.begin(),
+                      meshVertices.end());
+      indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+      part.vertexCount = mesh.vertexCount;
+      part.indexCount = mesh.indexCount;
+      meshParts.emplace_back(firstPart, 1);
+      continue;
+    }
+
+    startPart();
+    for (uint32_t i = 0; i + 2 < mesh.indexCount; i += 3) {
+      const uint32_t* triangle = &data.indices[mesh.indexOffset + i];
+      uint32_t newVertices = 0;
+      for (int j = 0; j < 3; j++) {
+        // Count each distinct new vertex once, even in degenerate triangles.
+        bool repeated = j > 0 && triangle[j] == triangle[0];
+        repeated |= j > 1 && triangle[j] == triangle[1];
+        newVertices += localIndices[triangle[j]] == UNASSIGNED && !repeated;
+      }
+      if (meshes.back().vertexCount + newVertices > maxVertices) {
+        startPart();
+      }
+
+      ModelMeshData& part = meshes.back();
+      for (int j = 0; j < 3; j++) {
+        uint32_t& local = localIndices[triangle[j]];
+        if (local == UNASSIGNED) {
+          local = part.vertexCount++;
+          vertices.push_back(data.vertices[mesh.vertexOffset + triangle[j]]);
+        }
+        indices.push_back(local);
+        part.indexCount++;
+      }
+    }
+    meshParts.emplace_back(firstPart, meshes.size() - firstPart);
+  }
+
+  // Point each node at all of the parts of its meshes.
+  std::vector<uint32_t> nodeMeshRefs;
+  for (ModelNodeData& node : data.nodes) {
+    const uint32_t refOffset = nodeMeshRefs.size();
+    for (uint32_t meshRef : data.view().getMeshRefs(node)) {
+      const auto [firstPart, numParts] = meshParts[meshRef];
+      for (uint32_t part = 0; part < numParts; part++) {
+        nodeMeshRefs.push_back(firstPart + part);
+      }
+    }
+    node.meshRefOffset = refOffset;
+    node.meshRefCount = nodeMeshRefs.size() - refOffset;
+  }
+
+  data.vertices = std::move(vertices);
+  data.indices = std::move(indices);
+  data.meshes = std::move(meshes);
+  data.nodeMeshRefs = std::move(nodeMeshRefs);
+}
+
+void generateModelLods(ModelData& data, unsigned int lodCount,
+                       float maxError) {
+  // The simplifier reads positions from the start of each vertex.
+  static_assert(offsetof(ModelVertex, position) == 0);
+  lodCount = std::min(lodCount, MAX_MODEL_LODS);
+  std::vector<uint32_t> indices;
+  std::vector<ModelMeshLodData> lods;
+  indices.reserve(data.indices.size() * 2);
+  for (ModelMeshData& mesh : data.meshes) {
+    auto baseIndices = data.view().getIndices(mesh);
+    const float* positions =
+        &(data.vertices.data() + mesh.vertexOffset)->position.x;
+    const float extent =
+        getMeshExtent(positions, mesh.vertexCount, sizeof(ModelVertex));
+
+    const uint32_t indexOffset = indices.size();
+    const uint32_t lodOffset = lods.size();
+    indices.insert(indices.end(), baseIndices.begin(), baseIndices.end());
+    lods.push_back({
+        .indexOffset = 0,
+        .indexCount = mesh.indexCount,
+        .error = 0.0f,
+    });
+
+    size_t targetIndexCount = mesh.indexCount;
+    for (unsigned int level = 1; level <= lodCount; level++) {
+      targetIndexCount =
+          static_cast<size_t>(targetIndexCount * LOD_TRIANGLE_RATIO) / 3 * 3;
+      // Simplify from the full-detail mesh each time, so that errors don't
+      // compound from level to level.
+      float error;
+      std::vector<uint32_t> lodIndices =
+          simplifyMesh(baseIndices, positions, mesh.vertexCount,
+                       sizeof(ModelVertex), targetIndexCount, maxError, &error);
+      // Stop once simplification no longer makes progress.
+      if (lodIndices.empty() ||
+          lodIndices.size() >= lods.back().indexCount) {
+        break;
+      }
+      lodIndices = optimizeVertexCache(lodIndices, mesh.vertexCount);
+      lods.push_back({
+          .indexOffset = static_cast<uint32_t>(indices.size()) - indexOffset,
+          .indexCount = static_cast<uint32_t>(lodIndices.size()),
+          .error = error * extent,
+      });
+      indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+    }
+
+    mesh.indexOffset = indexOffset;
+    mesh.indexCount = static_cast<uint32_t>(indices.size()) - indexOffset;
+    mesh.lodOffset = lodOffset;
+    mesh.lodCount = static_cast<uint32_t>(lods.size()) - lodOffset;
+  }
+  data.indices = std::move(indices);
+  data.lods = std::move(lods);
+}
+
+MeshOptimizationStats optimizeModelMeshes(ModelData& data,
+                                          const MeshOptimizerOptions& options) {
+  // The optimizer reads positions from the start of each vertex.
+  static_assert(offsetof(ModelVertex, position) == 0);
+  MeshOptimizationStats stats;
+  for (const ModelMeshData& mesh : data.meshes) {
+    // Mesh indices are relative to the mesh's first vertex, so each mesh can
+    // be optimized on its own.
+    stats += optimizeMesh(
+        std::span<uint32_t>(data.indices).subspan(mesh.indexOffset,
+                                                  mesh.indexCount),
+        data.vertices.data() + mesh.vertexOffset, mesh.vertexCount,
+        sizeof(ModelVertex), options);
+  }
+  return stats;
+}
+
+ModelMesh::ModelMesh(std::span<const ModelVertex> vertices,
+                     std::span<const uint32_t> indices,
                      const std::vector<TextureMap>& textureMaps,
-                     unsigned int instanceCount)
-    : vertices_(vertices) {
-  loadMeshData(&vertices_[0], vertices_.size(), sizeof(ModelVertex), indices,
-               textureMaps, instanceCount);
+                     const ModelMeshParams& params)
+    : vertexFormat_(params.vertexFormat) {
+  allowByteIndices_ = params.allowByteIndices;
+  std::vector<unsigned int> meshIndices(indices.begin(), indices.end());
+  if (vertexFormat_ == ModelVertexFormat::FULL) {
+    loadMeshData(vertices.data(), vertices.size(), sizeof(ModelVertex),
+                 meshIndices, textureMaps, params.instanceCount);
+    return;
+  }
+
+  PackedVertices packed = packVertices(vertices, vertexFormat_);
+  // Must be set before any instance data is loaded.
+  vertexTransform_ = packed.positionTransform;
+  loadMeshData(packed.data.data(), vertices.size(),
+               getVertexSizeBytes(vertexFormat_), meshIndices, textureMaps,
+               params.instanceCount);
+  // Packed positions aren't floats, so bound the original vertices instead.
+  if (!vertices.empty()) {
+    computeBounds(&vertices[0].position.x, vertices.size(),
+                  sizeof(ModelVertex));
+  }
 }
 
 void ModelMesh::initializeVertexAttributes() {
   // Positions.
-  vertexArray_.addVertexAttrib(3, GL_FLOAT);
-  // Normals.
-  vertexArray_.addVertexAttrib(3, GL_FLOAT);
-  // Tangents.
-  vertexArray_.addVertexAttrib(3, GL_FLOAT);
-  // Texture coordinates.
-  vertexArray_.addVertexAttrib(2, GL_FLOAT);
+  if (vertexFormat_ == ModelVertexFormat::QUANTIZED) {
+    // The padding component is fetched too, but unused by shaders.
+    vertexArray_.addVertexAttrib(4, GL_UNSIGNED_SHORT, /*instanceDivisor=*/0,
+                                 /*normalized=*/true);
+  } else {
+    vertexArray_.addVertexAttrib(3, GL_FLOAT);
+  }
+
+  if (vertexFormat_ == ModelVertexFormat::FULL) {
+    // Normals.
+    vertexArray_.addVertexAttrib(3, GL_FLOAT);
+    // Tangents.
+    vertexArray_.addVertexAttrib(3, GL_FLOAT);
+    // Texture coordinates.
+    vertexArray_.addVertexAttrib(2, GL_FLOAT);
+  } else {
+    // Normals.
+    vertexArray_.addVertexAttrib(4, GL_INT_2_10_10_10_REV,
+                                 /*instanceDivisor=*/0, /*normalized=*/true);
+    // Tangents.
+    vertexArray_.addVertexAttrib(4, GL_INT_2_10_10_10_REV,
+                                 /*instanceDivisor=*/0, /*normalized=*/true);
+    // Texture coordinates.
+    vertexArray_.addVertexAttrib(2, GL_HALF_FLOAT);
+  }
 
   vertexArray_.finalizeVertexAttribs();
 }
 
+LoadedModelData loadModelData(const std::string& path,
+                              const ModelParams& params) {
+  const ModelImportOptions importOptions = getImportOptions(params);
+  if (!params.useCache) {
+    auto data = std::make_shared<ModelData>(
+        importModelData(path, DEFAULT_LOAD_FLAGS, importOptions));
+    return {.view = data->view(), .storage = data};
+  }
+
+  ModelCache cache = params.cacheDirectory.empty()
+                         ? ModelCache()
+                         : ModelCache(params.cacheDirectory);
+  ModelCacheKey key = computeModelCacheKey(path, DEFAULT_LOAD_FLAGS,
+                                           importOptions.getCacheKey());
+  if (std::shared_ptr<MappedModelData> cached = cache.load(key)) {
+    return {.view = cached->view(), .storage = cached};
+  }
+
+  auto data = std::make_shared<ModelData>(
+      importModelData(path, DEFAULT_LOAD_FLAGS, importOptions));
+  // A failure to write the cache isn't fatal; the next load will just import
+  // again.
+  cache.store(key, *data);
+  return {.view = data->view(), .storage = data};
+}
+
 Model::Model(const char* path, unsigned int instanceCount)
-    : instanceCount_(instanceCount) {
+    : Model(path, ModelParams{.instanceCount = instanceCount}) {}
+
+Model::Model(const char* path, const ModelParams& params)
+    : Model(path, params, DeferLoad{}) {
+  loadModel(path);
+}
+
+Model::Model(const char* path, const ModelParams& params, DeferLoad)
+    : params_(params),
+      textureResidency_(params.textureResidency
+                            ? params.textureResidency
+                            : std::make_shared<TextureResidencyManager>()) {
   std::string pathString(path);
   size_t i = pathString.find_last_of("/");
   // This will either be the model's directory, or empty string if the model is
   // at project root.
   directory_ = i != std::string::npos ? pathString.substr(0, i) : "";
-
-  loadModel(pathString);
 }
 
 void Model::loadInstanceModels(const std::vector<glm::mat4>& models) {
-  rootNode_.visitRenderables([&](Renderable* renderable) {
-    // All renderables in a Model are ModelMeshes.
-    ModelMesh* mesh = static_cast<ModelMesh*>(renderable);
-    mesh->loadInstanceModels(models);
-  });
+  loadInstanceModels(models.data(), models.size());
 }
 
 void Model::loadInstanceModels(const glm::mat4* models, unsigned int size) {
-  rootNode_.visitRenderables([&](Renderable* renderable) {
-    // All renderables in a Model are ModelMeshes.
-    ModelMesh* mesh = static_cast<ModelMesh*>(renderable);
+  for (auto& mesh : meshes_) {
     mesh->loadInstanceModels(models, size);
-  });
+  }
+  // The meshes' bounds now cover their instances.
+  rootNode_.invalidateBounds();
+  drawList_.invalidate();
 }
 
 void Model::drawWithTransform(const glm::mat4& transform, Shader& shader,
                               TextureRegistry* textureRegistry) {
-  rootNode_.drawWithTransform(transform * getModelTransform(), shader,
-                              textureRegistry);
+  const glm::mat4 modelTransform = transform * getModelTransform();
+  const Frustum* frustum = shader.getCullingFrustum();
+  CullingStats& stats = shader.getCullingStats();
+  // Every pass draws the same node tree, so draw it from its compiled form.
+  drawList_.drawWithTransform(modelTransform, shader, textureRegistry);
+  // Instanced meshes carry their node transforms as instance data.
+  for (auto& mesh : instancedMeshes_) {
+    if (frustum) {
+      if (!isRenderableVisible(*mesh, modelTransform, *frustum)) {
+        stats.culled++;
+        continue;
+      }
+      stats.visible++;
+    }
+    mesh->drawWithTransform(modelTransform, shader, textureRegistry);
+  }
 }
 
-void Model::loadModel(std::string path) {
-  Assimp::Importer importer;
-  // Scene is freed by the importer.
-  const aiScene* scene = importer.ReadFile(path, DEFAULT_LOAD_FLAGS);
+std::optional<BoundingBox> Model::getLocalBounds() const {
+  std::optional<BoundingBox> rootBounds = rootNode_.getLocalBounds();
+  if (!rootBounds) return std::nullopt;
+  BoundingBox bounds =
+      transformBoundingBox(*rootBounds, rootNode_.getModelTransform());
+  for (const auto& mesh : instancedMeshes_) {
+    std::optional<BoundingBox> meshBounds = mesh->getLocalBounds();
+    if (!meshBounds) return std::nullopt;
+    bounds.merge(transformBoundingBox(*meshBounds, mesh->getModelTransform()));
+  }
+  return bounds;
+}
 
-  if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
-      !scene->mRootNode) {
-    throw ModelLoaderException("ERROR::MODEL::" +
-                               std::string(importer.GetErrorString()));
+void Model::setLodSelector(std::shared_ptr<LodSelector> lodSelector) {
+  lodSelector_ = std::move(lodSelector);
+  for (auto& mesh : meshes_) {
+    mesh->setLodSelector(lodSelector_);
   }
+  for (auto& mesh : instancedMeshes_) {
+    mesh->setLodSelector(lodSelector_);
+  }
+}
 
-  processNode(rootNode_, scene->mRootNode, scene);
+void Model::loadModel(std::string path) {
+  LoadedModelData data = loadModelData(path, params_);
+  buildModel(data.view);
 }
 
-void Model::processNode(RenderableNode& target, aiNode* node,
-                        const aiScene* scene) {
-  // Consume the transform.
-  target.setModelTransform(aiMatrix4x4ToGlm(node->mTransformation));
+void Model::buildModel(const ModelDataView& data) {
+  if (params_.parallelTextureDecode) {
+    preloadTextureMaps(data);
+  }
 
-  // Process each mesh in the node.
-  for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-    // TODO: This might be creating meshes multiple times when they are
-    // referenced by multiple nodes.
-    aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-    target.addRenderable(processMesh(mesh, scene));
+  NodeLayout layout = buildNodes(data);
+  for (uint32_t i = 0; i < data.meshes.size(); i++) {
+    // Meshes that aren't referenced by any node are never drawn.
+    if (layout.meshNodes[i].empty()) continue;
+    addMesh(data, layout, i, getTextureMaps(data, data.meshes[i]));
   }
+}
 
-  // Recurse for children. Recursion stops when no children left.
-  for (unsigned int i = 0; i < node->mNumChildren; i++) {
+Model::NodeLayout Model::buildNodes(const ModelDataView& data) {
+  if (data.nodes.empty()) {
+    throw ModelLoaderException("ERROR::MODEL::NO_NODES");
+  }
+
+  NodeLayout layout;
+  layout.nodes.reserve(data.nodes.size());
+  layout.nodeTransforms.reserve(data.nodes.size());
+  layout.meshNodes.resize(data.meshes.size());
+  // Nodes are in pre-order, so each node's parent has always been built by
+  // the time we reach it.
+  for (uint32_t i = 0; i < data.nodes.size(); i++) {
+    const ModelNodeData& node = data.nodes[i];
+    for (uint32_t meshRef : data.getMeshRefs(node)) {
+      layout.meshNodes[meshRef].push_back(i);
+    }
+
+    if (node.parentIndex < 0) {
+      rootNode_.setModelTransform(node.transform);
+      layout.nodes.push_back(&rootNode_);
+      layout.nodeTransforms.push_back(node.transform);
+      continue;
+    }
     auto childTarget = std::make_unique<RenderableNode>();
-    processNode(*childTarget, node->mChildren[i], scene);
-    target.addChildNode(std::move(childTarget));
+    childTarget->setModelTransform(node.transform);
+    layout.nodes.push_back(childTarget.get());
+    layout.nodeTransforms.push_back(
+        layout.nodeTransforms[node.parentIndex] * node.transform);
+    layout.nodes[node.parentIndex]->addChildNode(std::move(childTarget));
   }
+  return layout;
 }
 
-std::unique_ptr<ModelMesh> Model::processMesh(aiMesh* mesh,
-                                              const aiScene* scene) {
-  std::vector<ModelVertex> vertices;
-  std::vector<unsigned int> indices;
-  std::vector<TextureMap> textureMaps;
-
-  for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-    ModelVertex vertex;
+bool Model::isMeshInstanced(const NodeLayout& layout,
+                            uint32_t meshIndex) const {
+  // Each mesh has a single material, so nodes that share a mesh also share
+  // its material.
+  return params_.autoInstance && params_.instanceCount == 0 &&
+         layout.meshNodes[meshIndex].size() > 1;
+}
 
-    // Process vertex positions, normals, tangents, and texture coordinates.
-    auto inputPos = mesh->mVertices[i];
-    glm::vec3 position(inputPos.x, inputPos.y, inputPos.z);
-    vertex.position = position;
+ModelMeshParams Model::getMeshParams(unsigned int instanceCount) const {
+  return {
+      .instanceCount = instanceCount,
+      .vertexFormat = params_.vertexFormat,
+      .allowByteIndices = params_.allowByteIndices,
+  };
+}
 
-    if (mesh->HasNormals()) {
-      auto inputNorm = mesh->mNormals[i];
-      vertex.normal = glm::vec3(inputNorm.x, inputNorm.y, inputNorm.z);
-    } else {
-      vertex.normal = glm::vec3(0.0f);
+ModelMesh* Model::addMesh(const ModelDataView& data, const NodeLayout& layout,
+                          uint32_t meshIndex,
+                          const std::vector<TextureMap>& textureMaps) {
+  const ModelMeshData& meshData = data.meshes[meshIndex];
+  const std::vector<uint32_t>& meshNodes = layout.meshNodes[meshIndex];
+
+  if (isMeshInstanced(layout, meshIndex)) {
+    auto mesh = std::make_shared<ModelMesh>(
+        data.getVertices(meshData), data.getIndices(meshData), textureMaps,
+        getMeshParams(/*instanceCount=*/meshNodes.size()));
+    mesh->setLods(getMeshLods(data, meshData));
+    mesh->setLodSelector(lodSelector_);
+    std::vector<glm::mat4> instanceModels;
+    instanceModels.reserve(meshNodes.size());
+    for (uint32_t nodeIndex : meshNodes) {
+      instanceModels.push_back(layout.nodeTransforms[nodeIndex]);
     }
+    mesh->loadInstanceModels(instanceModels);
+    instancedMeshes_.push_back(mesh);
+    return mesh.get();
+  }
 
-    if (mesh->HasTangentsAndBitangents()) {
-      auto inputTangent = mesh->mTangents[i];
-      vertex.tangent =
-          glm::vec3(inputTangent.x, inputTangent.y, inputTangent.z);
-    } else {
-      vertex.tangent = glm::vec3(0.0f);
-    }
+  auto mesh = std::make_shared<ModelMesh>(
+      data.getVertices(meshData), data.getIndices(meshData), textureMaps,
+      getMeshParams(params_.instanceCount));
+  mesh->setLods(getMeshLods(data, meshData));
+  mesh->setLodSelector(lodSelector_);
+  for (uint32_t nodeIndex : meshNodes) {
+    layout.nodes[nodeIndex]->addRenderable(mesh);
+  }
+  meshes_.push_back(mesh);
+  return mesh.get();
+}
 
-    // TODO: This is only using the first texture coord set.
-    if (mesh->HasTextureCoords(0)) {
-      auto inputTexCoords = mesh->mTextureCoords[0][i];
-      vertex.texCoords = glm::vec2(inputTexCoords.x, inputTexCoords.y);
-    } else {
-      vertex.texCoords = glm::vec2(0.0f);
-    }
+std::vector<TextureMap> Model::getTextureMaps(
+    const ModelDataView& data, const ModelMeshData& mesh,
+    const TexturePlaceholderFn& placeholder, bool* usedPlaceholder) {
+  if (usedPlaceholder) *usedPlaceholder = false;
 
-    vertices.push_back(vertex);
+  std::vector<TextureMap> textureMaps;
+  for (const ModelTextureBinding& binding :
+       data.getTextureBindings(data.materials[mesh.materialIndex])) {
+    std::string_view path = data.getTexturePath(binding);
+    if (placeholder && !loadedTextureMaps_.count(getTextureFullPath(path))) {
+      textureMaps.push_back(placeholder(binding.type));
+      if (usedPlaceholder) *usedPlaceholder = true;
+      continue;
+    }
+    textureMaps.push_back(loadTextureMap(path, binding.type));
   }
+  return textureMaps;
+}
 
-  // Process indices.
-  for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-    aiFace face = mesh->mFaces[i];
-    for (unsigned int j = 0; j < face.mNumIndices; j++) {
-      indices.push_back(face.mIndices[j]);
+std::vector<std::pair<std::string, TextureMapType>>
+Model::collectUnloadedTextures(const ModelDataView& data) {
+  // Walk the texture bindings in the same order that buildModel will, so that
+  // each texture is keyed by its first-referenced type (and thus gets the same
+  // sRGB-ness and packed status as it would when loaded serially).
+  std::vector<bool> referenced(data.meshes.size(), false);
+  for (const ModelNodeData& node : data.nodes) {
+    for (uint32_t meshRef : data.getMeshRefs(node)) {
+      referenced[meshRef] = true;
     }
   }
 
-  // Process material.
-  {
-    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-    for (auto type : loaderSupportedTextureMapTypes) {
-      auto loadedMaps = loadMaterialTextureMaps(material, type);
-      textureMaps.insert(textureMaps.end(), loadedMaps.begin(),
-                         loadedMaps.end());
+  std::vector<std::pair<std::string, TextureMapType>> textures;
+  std::unordered_set<std::string> seen;
+  for (uint32_t i = 0; i < data.meshes.size(); i++) {
+    if (!referenced[i]) continue;
+    const ModelMeshData& mesh = data.meshes[i];
+    for (const ModelTextureBinding& binding :
+         data.getTextureBindings(data.materials[mesh.materialIndex])) {
+      std::string fullPath = getTextureFullPath(data.getTexturePath(binding));
+      if (loadedTextureMaps_.count(fullPath) || !seen.insert(fullPath).second ||
+          acquireVirtualTexture(fullPath, binding.type) ||
+          acquireResidentTexture(fullPath, binding.type)) {
+        continue;
+      }
+      textures.emplace_back(std::move(fullPath), binding.type);
     }
   }
+  return textures;
+}
 
-  return std::make_unique<ModelMesh>(vertices, indices, textureMaps,
-                                     instanceCount_);
+void Model::preloadTextureMaps(const ModelDataView& data) {
+  std::vector<std::pair<std::string, TextureMapType>> pending =
+      collectUnloadedTextures(data);
+  if (pending.empty()) return;
+
+  ThreadPool pool(std::min<unsigned int>(ThreadPool::getDefaultNumThreads(),
+                                         pending.size()));
+  std::vector<std::future<ImageData>> decoded;
+  decoded.reserve(pending.size());
+  for (const auto& [fullPath, type] : pending) {
+    decoded.push_back(pool.submit([this, path = fullPath, type = type]() {
+      return decodeTextureMap(path, type, params_);
+    }));
+  }
+
+  // Upload on this (the GL) thread, in order, as decodes finish. Seeding
+  // loadedTextureMaps_ means that the mesh walk only ever hits the cache.
+  for (size_t i = 0; i < pending.size(); i++) {
+    const auto& [fullPath, type] = pending[i];
+    ImageData image = decoded[i].get();
+    addLoadedTexture(fullPath,
+                     Texture::loadFromImage(image, isSRGBTextureMapType(type)),
+                     type);
+  }
 }
 
-std::vector<TextureMap> Model::loadMaterialTextureMaps(aiMaterial* material,
-                                                       TextureMapType type) {
-  std::vector<aiTextureType> aiTypes = textureMapTypeToAiTextureTypes(type);
-  std::vector<TextureMap> textureMaps;
+bool Model::acquireResidentTexture(const std::string& fullPath,
+                                   TextureMapType type) {
+  TextureResidencyManager::TextureRef ref =
+      textureResidency_->find(fullPath, isSRGBTextureMapType(type));
+  if (!ref) return false;
+  loadedTextureMaps_.insert(std::make_pair(fullPath, TextureMap(*ref, type)));
+  textureRefs_.push_back(std::move(ref));
+  return true;
+}
 
-  for (aiTextureType aiType : aiTypes) {
-    for (unsigned int i = 0; i < material->GetTextureCount(aiType); i++) {
-      aiString texturePath;
-      material->GetTexture(aiType, i, &texturePath);
-      // TODO: Pull the texture loading bits into a separate class.
-      // Assume that the texture path is relative to model directory.
-      std::string fullPath = directory_ + "/" + texturePath.C_Str();
-
-      // Don't re-load a texture if it's already been loaded.
-      auto item = loadedTextureMaps_.find(fullPath);
-      if (item != loadedTextureMaps_.end()) {
-        // Texture has already been loaded, but likely of a different map type
-        // (for example, it could be a combined roughness / metallic map). If
-        // so, mark it as a packed texture.
-        TextureMap textureMap(item->second.getTexture(), type);
-        if (type != item->second.getType()) {
-          textureMap.setPacked(true);
-          item->second.setPacked(true);
-        }
-        textureMaps.push_back(textureMap);
-        continue;
-      }
+bool Model::acquireVirtualTexture(const std::string& fullPath,
+                                  TextureMapType type) {
+  if (params_.virtualTextures == nullptr || type != TextureMapType::DIFFUSE) {
+    return false;
+  }
+  std::shared_ptr<VirtualTexture> texture =
+      params_.virtualTextures->open(fullPath);
+  if (!texture) return false;
+  loadedTextureMaps_.insert(
+      std::make_pair(fullPath, TextureMap(std::move(texture), type)));
+  return true;
+}
 
-      // Assume that diffuse and emissive textures are in sRGB.
-      // TODO: Allow for a way to override this if necessary.
-      bool isSRGB =
-          type == TextureMapType::DIFFUSE || type == TextureMapType::EMISSION;
+void Model::addLoadedTexture(const std::string& fullPath,
+                             const Texture& texture, TextureMapType type) {
+  // The manager hands back its own texture if another model beat us to it.
+  TextureResidencyManager::TextureRef ref = textureResidency_->insert(
+      fullPath, isSRGBTextureMapType(type), texture);
+  loadedTextureMaps_.insert(std::make_pair(fullPath, TextureMap(*ref, type)));
+  textureRefs_.push_back(std::move(ref));
+}
 
-      Texture texture = Texture::load(fullPath.c_str(), isSRGB);
-      TextureMap textureMap(texture, type);
-      loadedTextureMaps_.insert(std::make_pair(fullPath, textureMap));
-      textureMaps.push_back(textureMap);
+std::string Model::getTextureFullPath(std::string_view path) const {
+  // Assume that the texture path is relative to model directory.
+  return directory_ + "/" + std::string(path);
+}
+
+TextureMap Model::loadTextureMap(std::string_view path, TextureMapType type) {
+  // TODO: Pull the texture loading bits into a separate class.
+  std::string fullPath = getTextureFullPath(path);
+
+  // Don't re-load a texture if it's already been loaded, by this model or
+  // another.
+  auto item = loadedTextureMaps_.find(fullPath);
+  if (item == loadedTextureMaps_.end() &&
+      (acquireVirtualTexture(fullPath, type) ||
+       acquireResidentTexture(fullPath, type))) {
+    item = loadedTextureMaps_.find(fullPath);
+  }
+  if (item != loadedTextureMaps_.end()) {
+    if (item->second.isVirtual()) {
+      return TextureMap(item->second.getVirtualTexture(), type);
     }
+    // Texture has already been loaded, but likely of a different map type
+    // (for example, it could be a combined roughness / metallic map). If so,
+    // mark it as a packed texture.
+    TextureMap textureMap(item->second.getTexture(), type);
+    if (type != item->second.getType()) {
+      textureMap.setPacked(true);
+      item->second.setPacked(true);
+    }
+    return textureMap;
   }
-  return textureMaps;
+
+  addLoadedTexture(
+      fullPath,
+      Texture::loadFromImage(decodeTextureMap(fullPath, type, params_),
+                             isSRGBTextureMapType(type)),
+      type);
+  return loadedTextureMaps_.at(fullPath);
 }
 
 }  // namespace qrk
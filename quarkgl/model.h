@@ -3,14 +3,29 @@
 
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <qrk/draw_list.h>
 #include <qrk/exceptions.h>
 #include <qrk/mesh.h>
+#include <qrk/lod.h>
+#include <qrk/mesh_optimizer.h>
+#include <qrk/mesh_simplifier.h>
+#include <qrk/model_data.h>
 #include <qrk/shader.h>
+#include <qrk/staging_ring.h>
 #include <qrk/texture_map.h>
+#include <qrk/texture_residency.h>
+#include <qrk/vertex_format.h>
+#include <qrk/virtual_texture.h>
 
+#include <functional>
 #include <glm/glm.hpp>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace qrk {
@@ -18,25 +33,28 @@ class ModelLoaderException : public QuarkException {
   using QuarkException::QuarkException;
 };
 
-struct ModelVertex {
-  glm::vec3 position;
-  glm::vec3 normal;
-  glm::vec3 tangent;
-  glm::vec2 texCoords;
+struct ModelMeshParams {
+  unsigned int instanceCount = 0;
+  ModelVertexFormat vertexFormat = ModelVertexFormat::FULL;
+  // Whether meshes with at most 256 vertices may use 8-bit indices.
+  bool allowByteIndices = false;
 };
 
 class ModelMesh : public Mesh {
  public:
-  ModelMesh(const std::vector<ModelVertex>& vertices,
-            const std::vector<unsigned int>& indices,
+  ModelMesh(std::span<const ModelVertex> vertices,
+            std::span<const uint32_t> indices,
             const std::vector<TextureMap>& textureMaps,
-            unsigned int instanceCount = 0);
+            const ModelMeshParams& params = {});
 
   virtual ~ModelMesh() = default;
 
+  ModelVertexFormat getVertexFormat() const { return vertexFormat_; }
+
  private:
   void initializeVertexAttributes() override;
-  std::vector<ModelVertex> vertices_;
+
+  ModelVertexFormat vertexFormat_;
 };
 
 constexpr auto DEFAULT_LOAD_FLAGS =
@@ -53,26 +71,229 @@ constexpr auto DEFAULT_LOAD_FLAGS =
     // Sort the result by primitive type.
     aiProcess_SortByPType;
 
+// The largest number of simplified levels of detail generated per mesh.
+constexpr unsigned int MAX_MODEL_LODS = 8;
+
+struct ModelParams {
+  unsigned int instanceCount = 0;
+  // Whether to use the on-disk model cache, which skips model import on warm
+  // loads.
+  bool useCache = true;
+  // The directory to store the model cache in. If empty, uses a directory
+  // under the system's temp directory.
+  std::string cacheDirectory = "";
+  // Whether to load block-compressed versions of the model's textures from the
+  // compressed texture cache, where they've been built ahead of time (see
+  // //tools:texture_compressor). These take a fraction of the memory, and
+  // skip image decoding entirely. DDS and KTX2 textures are always loaded
+  // as-is.
+  bool useCompressedTextures = true;
+  // The directory of the compressed texture cache. If empty, uses a directory
+  // under the system's temp directory.
+  std::string textureCacheDirectory = "";
+  // Whether to decode all of the model's textures up front on a thread pool,
+  // and then upload them in a single batch. Otherwise, textures are decoded
+  // serially as they are first referenced.
+  bool parallelTextureDecode = true;
+  // Whether to generate uncompressed textures' mips while decoding them,
+  // rather than with glGenerateMipmap on the GL thread. With
+  // parallelTextureDecode, this moves mip generation onto the thread pool.
+  bool cpuMipGeneration = false;
+  // The filter used for CPU-generated mips.
+  MipFilter mipFilter = MipFilter::KAISER;
+  // If set, decoded textures are written into this ring's mapped memory on
+  // the decoding threads, so that uploading them is only a copy on the GPU.
+  // Textures that don't fit are uploaded from client memory as usual. Must
+  // outlive any pending texture uploads.
+  StagingRing* stagingRing = nullptr;
+  // The cache to share textures through, so that models reuse each other's
+  // textures, and textures that are no longer used are evicted under a VRAM
+  // budget. If unset, the model keeps its textures to itself, and frees them
+  // along with it.
+  std::shared_ptr<TextureResidencyManager> textureResidency = nullptr;
+  // If set, diffuse maps that have been tiled (see //tools:texture_tiler) are
+  // streamed in through virtual textures, rather than being fully resident.
+  // Requires the shader to be built with QRK_VIRTUAL_TEXTURES (as the builtin
+  // shaders can be). Must outlive the model.
+  VirtualTextureSystem* virtualTextures = nullptr;
+  // Whether to collapse every reference to a mesh that's used by more than one
+  // node into a single instanced draw. Requires the shader to support the
+  // `instanced` uniform and the instanceModel attribute (as the builtin
+  // shaders do). Ignored if instanceCount is set.
+  bool autoInstance = false;
+  // The vertex layout to upload meshes with. Compact layouts reduce vertex
+  // bandwidth at a small cost in precision.
+  ModelVertexFormat vertexFormat = ModelVertexFormat::FULL;
+  // Whether to reorder each mesh's triangles and vertices at import time, for
+  // better vertex cache use, less overdraw, and more local vertex fetches.
+  // Optimized meshes are cached, so this only costs anything on cold loads.
+  bool optimizeMeshes = false;
+  // Whether to split meshes with too many vertices for 16-bit indices into
+  // several smaller meshes that each fit. Meshes are otherwise indexed with
+  // the smallest type that fits their vertex count.
+  bool splitLargeMeshes = false;
+  // Whether meshes with at most 256 vertices may use 8-bit indices. These
+  // save memory, but some hardware handles them poorly.
+  bool allowByteIndices = false;
+  // The number of simplified levels of detail to generate for each mesh at
+  // import time, each with about half the triangles of the last. Levels are
+  // only drawn once the model has a LOD selector (see setLodSelector()).
+  unsigned int lodCount = 0;
+};
+
+// Processing done by quarkGL itself when importing a model, after Assimp's
+// post-processing.
+struct ModelImportOptions {
+  bool optimizeMeshes = false;
+  bool splitLargeMeshes = false;
+  unsigned int lodCount = 0;
+
+  // Returns a value that identifies these options in the model cache.
+  uint32_t getCacheKey() const;
+};
+
+ModelImportOptions getImportOptions(const ModelParams& params);
+
+// Imports a model file into CPU-side model data. Texture paths are left
+// relative to the model's directory.
+ModelData importModelData(const std::string& path,
+                          unsigned int loadFlags = DEFAULT_LOAD_FLAGS,
+                          const ModelImportOptions& options = {});
+
+// Splits each mesh with more than maxVertices vertices into several meshes,
+// each with at most maxVertices vertices. Nodes that referenced the original
+// mesh reference all of its parts instead. Triangles keep their order, so
+// cache-optimized meshes split into spatially coherent parts.
+void splitLargeMeshes(ModelData& data,
+                      uint32_t maxVertices = MAX_16BIT_INDEXED_VERTICES);
+
+// Generates up to lodCount simplified levels of detail for each mesh, each
+// with about half the triangles of the last, and stores them after the mesh's
+// own indices. Fewer levels are generated for meshes that can't be simplified
+// within maxError (relative to the mesh's extent). Must be the last change
+// made to the model's meshes, since other processing assumes that each mesh
+// has a single level.
+void generateModelLods(ModelData& data, unsigned int lodCount,
+                       float maxError = DEFAULT_SIMPLIFICATION_ERROR);
+
+// Runs the mesh optimizer over each of the model's meshes, in place. Returns
+// the combined vertex cache stats for all meshes.
+MeshOptimizationStats optimizeModelMeshes(
+    ModelData& data, const MeshOptimizerOptions& options = {});
+
+// Model data that is either owned or mapped from the model cache.
+struct LoadedModelData {
+  ModelDataView view;
+  // Keeps the view's backing storage alive.
+  std::shared_ptr<const void> storage;
+};
+
+// Loads model data through the model cache (if enabled by the params),
+// falling back to a full import. Doesn't touch GL state, so this is safe to
+// call from any thread.
+LoadedModelData loadModelData(const std::string& path,
+                              const ModelParams& params);
+
+// Returns whether textures of the given type are assumed to be in sRGB.
+bool isSRGBTextureMapType(TextureMapType type);
+
+// Decodes one of a model's textures, preferring a block-compressed version
+// from the compressed texture cache (if enabled by the params), and generates
+// its mips if params.cpuMipGeneration is set, and stages it if
+// params.stagingRing is set. Doesn't touch GL state, so this is safe to call
+// from any thread.
+ImageData decodeTextureMap(const std::string& path, TextureMapType type,
+                           const ModelParams& params);
+
 class Model : public Renderable {
  public:
   explicit Model(const char* path, unsigned int instanceCount = 0);
+  Model(const char* path, const ModelParams& params);
   virtual ~Model() = default;
   void loadInstanceModels(const std::vector<glm::mat4>& models);
   void loadInstanceModels(const glm::mat4* models, unsigned int size);
   void drawWithTransform(const glm::mat4& transform, Shader& shader,
                          TextureRegistry* textureRegistry = nullptr) override;
+  std::optional<BoundingBox> getLocalBounds() const override;
+
+  // Sets the selector used to pick each mesh's level of detail when drawing.
+  // Has no effect on models loaded without levels of detail.
+  void setLodSelector(std::shared_ptr<LodSelector> lodSelector);
 
  private:
+  // Returns a texture map to substitute for one that isn't loaded yet.
+  using TexturePlaceholderFn = std::function<TextureMap(TextureMapType)>;
+
+  // Creates an empty model, to be populated by a ModelLoader.
+  struct DeferLoad {};
+  Model(const char* path, const ModelParams& params, DeferLoad);
+
   void loadModel(std::string path);
-  void processNode(RenderableNode& target, aiNode* node, const aiScene* scene);
-  std::unique_ptr<ModelMesh> processMesh(aiMesh* mesh, const aiScene* scene);
-  std::vector<TextureMap> loadMaterialTextureMaps(aiMaterial* material,
-                                                  TextureMapType type);
+  void buildModel(const ModelDataView& data);
+  // The model's node hierarchy, along with where each mesh is referenced.
+  struct NodeLayout {
+    // The built nodes, in the same order as the model data.
+    std::vector<RenderableNode*> nodes;
+    // The transform of each node, relative to the model.
+    std::vector<glm::mat4> nodeTransforms;
+    // The indices of the nodes that reference each mesh, by mesh index.
+    std::vector<std::vector<uint32_t>> meshNodes;
+  };
 
-  unsigned int instanceCount_;
+  // Builds the node hierarchy without any meshes.
+  NodeLayout buildNodes(const ModelDataView& data);
+  // Returns whether a mesh is drawn as a single instanced mesh, rather than
+  // being attached to each node that references it.
+  bool isMeshInstanced(const NodeLayout& layout, uint32_t meshIndex) const;
+  ModelMeshParams getMeshParams(unsigned int instanceCount) const;
+  // Builds a mesh and adds it to the model. Each mesh is only built once, and
+  // is shared by all of the nodes that reference it.
+  ModelMesh* addMesh(const ModelDataView& data, const NodeLayout& layout,
+                     uint32_t meshIndex,
+                     const std::vector<TextureMap>& textureMaps);
+  // Returns the texture maps for a mesh. Textures that haven't been loaded
+  // yet are either loaded synchronously, or substituted if a placeholder is
+  // given (in which case usedPlaceholder is set).
+  std::vector<TextureMap> getTextureMaps(
+      const ModelDataView& data, const ModelMeshData& mesh,
+      const TexturePlaceholderFn& placeholder = nullptr,
+      bool* usedPlaceholder = nullptr);
+  // Returns the textures that haven't been loaded yet, in the order that
+  // they're first referenced, along with the type they're first referenced
+  // as. Textures that are already resident are picked up along the way.
+  std::vector<std::pair<std::string, TextureMapType>> collectUnloadedTextures(
+      const ModelDataView& data);
+  void preloadTextureMaps(const ModelDataView& data);
+  // Adds a texture from the residency manager, if it's resident. Returns
+  // whether it was.
+  bool acquireResidentTexture(const std::string& fullPath,
+                              TextureMapType type);
+  // Adds a virtual texture for a diffuse map, if params_.virtualTextures has a
+  // tiled version of it. Returns whether it did.
+  bool acquireVirtualTexture(const std::string& fullPath, TextureMapType type);
+  void addLoadedTexture(const std::string& fullPath, const Texture& texture,
+                        TextureMapType type);
+  TextureMap loadTextureMap(std::string_view path, TextureMapType type);
+  std::string getTextureFullPath(std::string_view path) const;
+
+  ModelParams params_;
   RenderableNode rootNode_;
+  DrawList drawList_{rootNode_};
+  // Meshes that are attached to nodes.
+  std::vector<std::shared_ptr<ModelMesh>> meshes_;
+  // Auto-instanced meshes, which are drawn separately from the nodes.
+  std::vector<std::shared_ptr<ModelMesh>> instancedMeshes_;
+  std::shared_ptr<LodSelector> lodSelector_;
   std::string directory_;
+  // Declared before anything that references its textures, so that it's
+  // destroyed after them.
+  std::shared_ptr<TextureResidencyManager> textureResidency_;
   std::unordered_map<std::string, TextureMap> loadedTextureMaps_;
+  // Keeps the model's textures resident.
+  std::vector<TextureResidencyManager::TextureRef> textureRefs_;
+
+  friend class ModelLoader;
+  friend class ModelLoadHandle;
 };
 
 }  // namespace qrk
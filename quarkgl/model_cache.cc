@@ -0,0 +1,291 @@
+#include <qrk/model_cache.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace qrk {
+namespace {
+constexpr char MODEL_CACHE_MAGIC[8] = {'Q', 'R', 'K', 'M', 'O', 'D', 'E', 'L'};
+constexpr char MODEL_CACHE_EXTENSION[] = ".qmc";
+// Sections are aligned so that they can be used in-place once mapped.
+constexpr size_t SECTION_ALIGNMENT = 16;
+
+enum ModelCacheSectionId {
+  VERTICES = 0,
+  INDICES,
+  MESHES,
+  MESH_LODS,
+  MATERIALS,
+  TEXTURE_BINDINGS,
+  NODES,
+  NODE_MESH_REFS,
+  STRINGS,
+  NUM_SECTIONS,
+};
+
+struct ModelCacheSection {
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct ModelCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t loadFlags;
+  int64_t modifiedTime;
+  // The source path immediately follows the header, and is used to detect hash
+  // collisions.
+  uint32_t sourcePathLength;
+  uint32_t importOptions;
+  ModelCacheSection sections[NUM_SECTIONS];
+};
+
+size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// 64-bit FNV-1a. Unlike std::hash, this is stable across runs and platforms.
+uint64_t hashString(const std::string& str) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+int64_t toTicks(std::filesystem::file_time_type time) {
+  return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+// Maps the given section into a span. Returns false if the section is out of
+// bounds of the file.
+template <typename T>
+bool mapSection(const MappedFile& file, const ModelCacheSection& section,
+                std::span<const T>* out) {
+  if (section.offset % alignof(T) != 0 || section.offset > file.getSize() ||
+      section.count > (file.getSize() - section.offset) / sizeof(T)) {
+    return false;
+  }
+  *out = std::span<const T>(
+      reinterpret_cast<const T*>(file.getData() + section.offset),
+      section.count);
+  return true;
+}
+
+bool inBounds(uint64_t offset, uint64_t count, size_t size) {
+  return offset <= size && count <= size - offset;
+}
+
+// Checks that all ranges and indices in the mapped data are internally
+// consistent, so that a corrupt entry can't send us (or the GPU) reading
+// outside of the mapping.
+bool validate(const ModelDataView& view) {
+  for (const ModelMeshData& mesh : view.meshes) {
+    if (!inBounds(mesh.vertexOffset, mesh.vertexCount, view.vertices.size()) ||
+        !inBounds(mesh.indexOffset, mesh.indexCount, view.indices.size()) ||
+        !inBounds(mesh.lodOffset, mesh.lodCount, view.lods.size()) ||
+        mesh.materialIndex >= view.materials.size()) {
+      return false;
+    }
+    for (const ModelMeshLodData& lod : view.getLods(mesh)) {
+      if (!inBounds(lod.indexOffset, lod.indexCount, mesh.indexCount)) {
+        return false;
+      }
+    }
+    // Indices are uploaded as-is, so one that's past the mesh's vertices would
+    // have the GPU fetch outside of the vertex buffer. Levels of detail are
+    // ranges of these same indices, so this covers them too.
+    for (uint32_t index : view.getIndices(mesh)) {
+      if (index >= mesh.vertexCount) return false;
+    }
+  }
+  for (const ModelMaterialData& material : view.materials) {
+    if (!inBounds(material.bindingOffset, material.bindingCount,
+                  view.textureBindings.size())) {
+      return false;
+    }
+  }
+  for (const ModelTextureBinding& binding : view.textureBindings) {
+    if (!inBounds(binding.pathOffset, binding.pathLength,
+                  view.strings.size())) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < view.nodes.size(); i++) {
+    const ModelNodeData& node = view.nodes[i];
+    // Parents must precede their children.
+    if (node.parentIndex >= static_cast<int64_t>(i) ||
+        (i > 0 && node.parentIndex < 0) ||
+        !inBounds(node.meshRefOffset, node.meshRefCount,
+                  view.nodeMeshRefs.size())) {
+      return false;
+    }
+  }
+  for (uint32_t meshRef : view.nodeMeshRefs) {
+    if (meshRef >= view.meshes.size()) return false;
+  }
+  return true;
+}
+
+template <typename T>
+void writeSection(std::ofstream& out, const std::vector<T>& data,
+                  ModelCacheSection* section) {
+  size_t offset = alignUp(static_cast<size_t>(out.tellp()), SECTION_ALIGNMENT);
+  static constexpr char padding[SECTION_ALIGNMENT] = {};
+  out.write(padding, offset - static_cast<size_t>(out.tellp()));
+
+  section->offset = offset;
+  section->count = data.size();
+  out.write(reinterpret_cast<const char*>(data.data()),
+            data.size() * sizeof(T));
+}
+}  // namespace
+
+ModelCacheKey computeModelCacheKey(const std::string& path,
+                                   unsigned int loadFlags,
+                                   uint32_t importOptions) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  fs::path sourcePath = fs::absolute(path, ec);
+  // A missing source just produces a key that never matches anything; the
+  // model import itself will report the error.
+  int64_t modifiedTime = toTicks(fs::last_write_time(sourcePath, ec));
+
+  const fs::path stem = sourcePath.stem();
+  for (const auto& entry :
+       fs::directory_iterator(sourcePath.parent_path(), ec)) {
+    if (entry.path().stem() != stem) continue;
+    auto time = entry.last_write_time(ec);
+    if (!ec) modifiedTime = std::max(modifiedTime, toTicks(time));
+  }
+
+  return {
+      .sourcePath = sourcePath.string(),
+      .modifiedTime = modifiedTime,
+      .loadFlags = loadFlags,
+      .importOptions = importOptions,
+  };
+}
+
+std::string ModelCache::getDefaultDirectory() {
+  std::error_code ec;
+  std::filesystem::path tempDir = std::filesystem::temp_directory_path(ec);
+  if (ec) tempDir = ".";
+  return (tempDir / "quarkgl_model_cache").string();
+}
+
+std::string ModelCache::getEntryPath(const ModelCacheKey& key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx%s",
+                static_cast<unsigned long long>(hashString(key.sourcePath)),
+                MODEL_CACHE_EXTENSION);
+  return (std::filesystem::path(directory_) / name).string();
+}
+
+std::unique_ptr<MappedModelData> ModelCache::load(const ModelCacheKey& key) {
+  std::string entryPath = getEntryPath(key);
+  std::error_code ec;
+  if (!std::filesystem::exists(entryPath, ec)) return nullptr;
+
+  std::unique_ptr<MappedFile> file;
+  try {
+    file = std::make_unique<MappedFile>(entryPath);
+  } catch (const MappedFileException&) {
+    return nullptr;
+  }
+
+  // Validate that the entry matches the requested key.
+  if (file->getSize() < sizeof(ModelCacheHeader)) return nullptr;
+  ModelCacheHeader header;
+  std::memcpy(&header, file->getData(), sizeof(header));
+  if (std::memcmp(header.magic, MODEL_CACHE_MAGIC, sizeof(header.magic)) !=
+          0 ||
+      header.version != MODEL_CACHE_VERSION ||
+      header.loadFlags != key.loadFlags ||
+      header.importOptions != key.importOptions ||
+      header.modifiedTime != key.modifiedTime ||
+      header.sourcePathLength != key.sourcePath.size() ||
+      file->getSize() - sizeof(header) < header.sourcePathLength ||
+      std::memcmp(file->getData() + sizeof(header), key.sourcePath.data(),
+                  key.sourcePath.size()) != 0) {
+    return nullptr;
+  }
+
+  ModelDataView view;
+  if (!mapSection(*file, header.sections[VERTICES], &view.vertices) ||
+      !mapSection(*file, header.sections[INDICES], &view.indices) ||
+      !mapSection(*file, header.sections[MESHES], &view.meshes) ||
+      !mapSection(*file, header.sections[MESH_LODS], &view.lods) ||
+      !mapSection(*file, header.sections[MATERIALS], &view.materials) ||
+      !mapSection(*file, header.sections[TEXTURE_BINDINGS],
+                  &view.textureBindings) ||
+      !mapSection(*file, header.sections[NODES], &view.nodes) ||
+      !mapSection(*file, header.sections[NODE_MESH_REFS],
+                  &view.nodeMeshRefs) ||
+      !mapSection(*file, header.sections[STRINGS], &view.strings) ||
+      !validate(view)) {
+    return nullptr;
+  }
+
+  return std::make_unique<MappedModelData>(std::move(file), view);
+}
+
+bool ModelCache::store(const ModelCacheKey& key, const ModelData& data) {
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec) return false;
+
+  // Write to a temporary file first, and then move it into place, so that
+  // readers never observe a partially written entry.
+  std::string entryPath = getEntryPath(key);
+  std::string tempPath = entryPath + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    ModelCacheHeader header = {};
+    std::memcpy(header.magic, MODEL_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MODEL_CACHE_VERSION;
+    header.loadFlags = key.loadFlags;
+    header.importOptions = key.importOptions;
+    header.modifiedTime = key.modifiedTime;
+    header.sourcePathLength = static_cast<uint32_t>(key.sourcePath.size());
+
+    // Reserve space for the header, which is rewritten once the section
+    // offsets are known.
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(key.sourcePath.data(), key.sourcePath.size());
+
+    writeSection(out, data.vertices, &header.sections[VERTICES]);
+    writeSection(out, data.indices, &header.sections[INDICES]);
+    writeSection(out, data.meshes, &header.sections[MESHES]);
+    writeSection(out, data.lods, &header.sections[MESH_LODS]);
+    writeSection(out, data.materials, &header.sections[MATERIALS]);
+    writeSection(out, data.textureBindings,
+                 &header.sections[TEXTURE_BINDINGS]);
+    writeSection(out, data.nodes, &header.sections[NODES]);
+    writeSection(out, data.nodeMeshRefs, &header.sections[NODE_MESH_REFS]);
+    writeSection(out, data.strings, &header.sections[STRINGS]);
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) {
+      out.close();
+      std::filesystem::remove(tempPath, ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tempPath, entryPath, ec);
+  if (ec) {
+    std::filesystem::remove(tempPath, ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace qrk
@@ -0,0 +1,74 @@
+#ifndef QUARKGL_MODEL_CACHE_H_
+#define QUARKGL_MODEL_CACHE_H_
+
+#include <qrk/mapped_file.h>
+#include <qrk/model_data.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace qrk {
+
+// Bump this whenever the layout of the cache file, or of any of the ModelData
+// records, changes.
+constexpr uint32_t MODEL_CACHE_VERSION = 3;
+
+// Identifies a single version of a source model file, as loaded with a
+// particular set of Assimp post-processing flags.
+struct ModelCacheKey {
+  // The absolute path to the source model.
+  std::string sourcePath;
+  // The newest modification time of the source model and its sidecar files.
+  int64_t modifiedTime;
+  uint32_t loadFlags;
+  // Flags for any of quarkGL's own import-time processing.
+  uint32_t importOptions;
+};
+
+// Computes the cache key for the given model file. Sidecar files are siblings
+// that share the model's stem (e.g. a glTF's .bin buffers, or an OBJ's .mtl).
+ModelCacheKey computeModelCacheKey(const std::string& path,
+                                   unsigned int loadFlags,
+                                   uint32_t importOptions = 0);
+
+// Model data that is backed by a mapped cache file.
+class MappedModelData {
+ public:
+  MappedModelData(std::unique_ptr<MappedFile> file, ModelDataView view)
+      : file_(std::move(file)), view_(view) {}
+
+  const ModelDataView& view() const { return view_; }
+
+ private:
+  std::unique_ptr<MappedFile> file_;
+  ModelDataView view_;
+};
+
+// An on-disk cache of post-processed model data, which allows warm loads to
+// skip model import entirely. Each source model gets a single entry, which is
+// replaced whenever its key changes.
+//
+// Cache failures are never fatal; a bad or stale entry is treated as a miss.
+class ModelCache {
+ public:
+  explicit ModelCache(std::string directory = getDefaultDirectory())
+      : directory_(std::move(directory)) {}
+
+  // Maps the cache entry for the given key. Returns nullptr on a cache miss.
+  std::unique_ptr<MappedModelData> load(const ModelCacheKey& key);
+  // Writes a cache entry for the given key. Returns false on failure.
+  bool store(const ModelCacheKey& key, const ModelData& data);
+
+  std::string getEntryPath(const ModelCacheKey& key) const;
+  const std::string& getDirectory() const { return directory_; }
+
+  static std::string getDefaultDirectory();
+
+ private:
+  std::string directory_;
+};
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <qrk/model_cache.h>
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+class ModelCacheTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::path(testing::TempDir()) /
+                 testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::filesystem::remove_all(directory_);
+    std::filesystem::create_directories(directory_);
+  }
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  qrk::ModelCacheKey makeKey() {
+    return {.sourcePath = (directory_ / "model.gltf").string(),
+            .modifiedTime = 1,
+            .loadFlags = 0,
+            .importOptions = 0};
+  }
+
+  std::filesystem::path directory_;
+};
+
+// Returns a model with a single quad, which has a one-triangle LOD.
+qrk::ModelData makeQuad() {
+  qrk::ModelData data;
+  data.vertices.resize(4);
+  data.indices = {0, 1, 2, 0, 2, 3, 0, 1, 2};
+  data.lods = {{.indexOffset = 0, .indexCount = 6, .error = 0.0f},
+               {.indexOffset = 6, .indexCount = 3, .error = 0.5f}};
+  data.materials = {{.bindingOffset = 0, .bindingCount = 0}};
+  data.meshes = {{.vertexOffset = 0,
+                  .vertexCount = 4,
+                  .indexOffset = 0,
+                  .indexCount = 9,
+                  .materialIndex = 0,
+                  .lodOffset = 0,
+                  .lodCount = 2}};
+  data.nodes = {{.transform = glm::mat4(1.0f),
+                 .parentIndex = -1,
+                 .meshRefOffset = 0,
+                 .meshRefCount = 1}};
+  data.nodeMeshRefs = {0};
+  return data;
+}
+
+TEST_F(ModelCacheTest, RoundTrips) {
+  qrk::ModelCache cache(directory_.string());
+  const qrk::ModelCacheKey key = makeKey();
+  EXPECT_EQ(cache.load(key), nullptr);
+  ASSERT_TRUE(cache.store(key, makeQuad()));
+
+  std::unique_ptr<qrk::MappedModelData> loaded = cache.load(key);
+  ASSERT_NE(loaded, nullptr);
+  const qrk::ModelDataView& view = loaded->view();
+  ASSERT_EQ(view.meshes.size(), 1);
+  EXPECT_EQ(view.getIndices(view.meshes[0]).size(), 9);
+  EXPECT_EQ(view.getLods(view.meshes[0]).size(), 2);
+
+  qrk::ModelCacheKey stale = key;
+  stale.modifiedTime++;
+  EXPECT_EQ(cache.load(stale), nullptr);
+}
+
+TEST_F(ModelCacheTest, RejectsIndicesPastTheMeshVertices) {
+  qrk::ModelCache cache(directory_.string());
+  const qrk::ModelCacheKey key = makeKey();
+  qrk::ModelData data = makeQuad();
+  // Only in the coarsest level, which the section sizes don't catch.
+  data.indices[8] = 4;
+  ASSERT_TRUE(cache.store(key, data));
+  EXPECT_EQ(cache.load(key), nullptr);
+}
+
+TEST_F(ModelCacheTest, RejectsLodsPastTheMeshIndices) {
+  qrk::ModelCache cache(directory_.string());
+  const qrk::ModelCacheKey key = makeKey();
+  qrk::ModelData data = makeQuad();
+  data.lods[1].indexCount = 6;
+  ASSERT_TRUE(cache.store(key, data));
+  EXPECT_EQ(cache.load(key), nullptr);
+}
+
+}  // namespace
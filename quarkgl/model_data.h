@@ -0,0 +1,158 @@
+#ifndef QUARKGL_MODEL_DATA_H_
+#define QUARKGL_MODEL_DATA_H_
+
+#include <qrk/texture_map.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace qrk {
+
+struct ModelVertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec3 tangent;
+  glm::vec2 texCoords;
+};
+
+// A mesh, as a range of the model's vertex and index pools. Indices are
+// relative to the mesh's first vertex. Meshes with levels of detail store all
+// of their levels in their index range, and reference them as a range of the
+// model's LODs.
+struct ModelMeshData {
+  uint32_t vertexOffset;
+  uint32_t vertexCount;
+  uint32_t indexOffset;
+  uint32_t indexCount;
+  uint32_t materialIndex;
+  uint32_t lodOffset;
+  uint32_t lodCount;
+};
+
+// A level of detail of a mesh, as a range of the mesh's indices (relative to
+// the mesh's first index). All of a mesh's levels share its vertices.
+struct ModelMeshLodData {
+  uint32_t indexOffset;
+  uint32_t indexCount;
+  // The largest distance between this level's surface and the full-detail
+  // surface, in model units.
+  float error;
+};
+
+// A texture referenced by a material. The path is relative to the model's
+// directory, and is stored in the model's string pool.
+struct ModelTextureBinding {
+  TextureMapType type;
+  uint32_t pathOffset;
+  uint32_t pathLength;
+};
+
+// A material, as a range of the model's texture bindings.
+struct ModelMaterialData {
+  uint32_t bindingOffset;
+  uint32_t bindingCount;
+};
+
+// A node in the model's hierarchy. Nodes are stored in pre-order, so a node's
+// parent always precedes it. The node's meshes are a range of the model's
+// node mesh references.
+struct ModelNodeData {
+  glm::mat4 transform;
+  int32_t parentIndex;
+  uint32_t meshRefOffset;
+  uint32_t meshRefCount;
+};
+
+// All of the above are written to (and mapped from) disk directly.
+static_assert(std::is_trivially_copyable_v<ModelVertex>);
+static_assert(std::is_trivially_copyable_v<ModelMeshData>);
+static_assert(std::is_trivially_copyable_v<ModelMeshLodData>);
+static_assert(std::is_trivially_copyable_v<ModelTextureBinding>);
+static_assert(std::is_trivially_copyable_v<ModelMaterialData>);
+static_assert(std::is_trivially_copyable_v<ModelNodeData>);
+
+// A non-owning view of post-processed model data, either backed by a
+// ModelData or by a mapped cache file.
+struct ModelDataView {
+  std::span<const ModelVertex> vertices;
+  std::span<const uint32_t> indices;
+  std::span<const ModelMeshData> meshes;
+  std::span<const ModelMeshLodData> lods;
+  std::span<const ModelMaterialData> materials;
+  std::span<const ModelTextureBinding> textureBindings;
+  std::span<const ModelNodeData> nodes;
+  std::span<const uint32_t> nodeMeshRefs;
+  std::span<const char> strings;
+
+  std::span<const ModelVertex> getVertices(const ModelMeshData& mesh) const {
+    return vertices.subspan(mesh.vertexOffset, mesh.vertexCount);
+  }
+  std::span<const uint32_t> getIndices(const ModelMeshData& mesh) const {
+    return indices.subspan(mesh.indexOffset, mesh.indexCount);
+  }
+  std::span<const ModelMeshLodData> getLods(const ModelMeshData& mesh) const {
+    return lods.subspan(mesh.lodOffset, mesh.lodCount);
+  }
+  std::span<const ModelTextureBinding> getTextureBindings(
+      const ModelMaterialData& material) const {
+    return textureBindings.subspan(material.bindingOffset,
+                                   material.bindingCount);
+  }
+  std::span<const uint32_t> getMeshRefs(const ModelNodeData& node) const {
+    return nodeMeshRefs.subspan(node.meshRefOffset, node.meshRefCount);
+  }
+  std::string_view getTexturePath(const ModelTextureBinding& binding) const {
+    return std::string_view(strings.data() + binding.pathOffset,
+                            binding.pathLength);
+  }
+};
+
+// Owning, CPU-side post-processed model data. This is the intermediate format
+// between a model file and the GPU, and is what gets written to the model
+// cache.
+struct ModelData {
+  std::vector<ModelVertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<ModelMeshData> meshes;
+  std::vector<ModelMeshLodData> lods;
+  std::vector<ModelMaterialData> materials;
+  std::vector<ModelTextureBinding> textureBindings;
+  std::vector<ModelNodeData> nodes;
+  std::vector<uint32_t> nodeMeshRefs;
+  std::vector<char> strings;
+
+  // Appends a texture path to the string pool, returning the binding for it.
+  ModelTextureBinding addTextureBinding(TextureMapType type,
+                                        std::string_view path) {
+    ModelTextureBinding binding = {
+        .type = type,
+        .pathOffset = static_cast<uint32_t>(strings.size()),
+        .pathLength = static_cast<uint32_t>(path.size()),
+    };
+    strings.insert(strings.end(), path.begin(), path.end());
+    return binding;
+  }
+
+  ModelDataView view() const {
+    return {
+        .vertices = vertices,
+        .indices = indices,
+        .meshes = meshes,
+        .lods = lods,
+        .materials = materials,
+        .textureBindings = textureBindings,
+        .nodes = nodes,
+        .nodeMeshRefs = nodeMeshRefs,
+        .strings = strings,
+    };
+  }
+};
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,263 @@
+#include <glad/glad.h>
+#include <qrk/model_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace qrk {
+namespace {
+// Flat colors that approximate an "untextured" look for each map type.
+glm::vec3 placeholderColor(TextureMapType type) {
+  switch (type) {
+    case TextureMapType::DIFFUSE:
+      return glm::vec3(0.5f);
+    case TextureMapType::ROUGHNESS:
+      return glm::vec3(0.5f);
+    case TextureMapType::AO:
+      return glm::vec3(1.0f);
+    case TextureMapType::NORMAL:
+      // A flat tangent-space normal.
+      return glm::vec3(0.5f, 0.5f, 1.0f);
+    case TextureMapType::SPECULAR:
+    case TextureMapType::METALLIC:
+    case TextureMapType::EMISSION:
+    case TextureMapType::CUBEMAP:
+      return glm::vec3(0.0f);
+  }
+  return glm::vec3(0.0f);
+}
+}  // namespace
+
+float ModelLoadHandle::getProgress() const {
+  if (state_ == ModelLoadState::DONE) return 1.0f;
+  if (!imported_) return 0.0f;
+  size_t total = numMeshes_ + textures_.size();
+  size_t finished =
+      (numMeshes_ - pendingMeshes_.size()) + numTexturesUploaded_;
+  return total == 0 ? 1.0f : static_cast<float>(finished) / total;
+}
+
+ModelLoader::ModelLoader(unsigned int numThreads) : pool_(numThreads) {}
+
+ModelLoader::~ModelLoader() {
+  // Skip any work that hasn't started yet; the pool still waits for
+  // in-progress tasks.
+  stopping_ = true;
+  // Placeholders are only ever shared between the loader's own meshes, so
+  // nothing else owns them.
+  for (auto& [type, texture] : placeholders_) {
+    texture.free();
+  }
+}
+
+std::shared_ptr<ModelLoadHandle> ModelLoader::load(const char* path,
+                                                   const ModelParams& params) {
+  auto handle = std::make_shared<ModelLoadHandle>();
+  handle->path_ = path;
+  handle->model_ =
+      std::shared_ptr<Model>(new Model(path, params, Model::DeferLoad{}));
+  jobs_.push_back(handle);
+
+  pool_.submit([this, handle, path = std::string(path), params]() {
+    if (stopping_) return;
+    ImportResult result;
+    result.handle = handle;
+    try {
+      result.data = loadModelData(path, params);
+    } catch (const std::exception& e) {
+      result.error = e.what();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    importResults_.push_back(std::move(result));
+  });
+
+  return handle;
+}
+
+void ModelLoader::processUploads(const UploadBudget& budget) {
+  auto start = std::chrono::steady_clock::now();
+  size_t bytes = 0;
+  bool didWork = false;
+  auto withinBudget = [&]() {
+    // Always allow at least one upload, so that we make progress.
+    if (!didWork) return true;
+    std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return bytes < budget.maxBytes && elapsed.count() < budget.maxMillis;
+  };
+
+  std::vector<ImportResult> importResults;
+  std::vector<DecodeResult> decodeResults;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(importResults, importResults_);
+    std::swap(decodeResults, decodeResults_);
+  }
+
+  for (ImportResult& result : importResults) {
+    if (!result.error.empty()) {
+      fail(*result.handle, result.error);
+      continue;
+    }
+    handleImported(result.handle, std::move(result.data));
+  }
+  for (DecodeResult& result : decodeResults) {
+    if (!result.error.empty()) {
+      fail(*result.handle, result.error);
+      continue;
+    }
+    if (result.handle->state_ != ModelLoadState::LOADING) continue;
+    result.handle->decodedTextures_.emplace_back(result.textureIndex,
+                                                 std::move(result.image));
+  }
+
+  for (auto& handle : jobs_) {
+    if (handle->state_ != ModelLoadState::LOADING || !handle->imported_) {
+      continue;
+    }
+
+    // Build meshes first, so that geometry shows up as early as possible.
+    while (!handle->pendingMeshes_.empty() && withinBudget()) {
+      buildNextMesh(*handle, &bytes);
+      didWork = true;
+    }
+
+    bool uploadedTextures = false;
+    while (!handle->decodedTextures_.empty() && withinBudget()) {
+      uploadNextTexture(*handle, &bytes);
+      didWork = true;
+      uploadedTextures = true;
+    }
+    if (uploadedTextures) {
+      refreshPlaceholderMeshes(*handle);
+    }
+
+    if (handle->pendingMeshes_.empty() &&
+        handle->numTexturesUploaded_ == handle->textures_.size()) {
+      handle->state_ = ModelLoadState::DONE;
+      // Release the (possibly mapped) model data.
+      handle->data_ = {};
+      handle->layout_ = {};
+    }
+  }
+
+  std::erase_if(jobs_, [](const std::shared_ptr<ModelLoadHandle>& handle) {
+    return handle->state_ != ModelLoadState::LOADING;
+  });
+}
+
+void ModelLoader::handleImported(
+    const std::shared_ptr<ModelLoadHandle>& handle, LoadedModelData data) {
+  if (handle->state_ != ModelLoadState::LOADING) return;
+  Model& model = *handle->model_;
+  const ModelDataView& view = data.view;
+
+  try {
+    handle->layout_ = model.buildNodes(view);
+  } catch (const ModelLoaderException& e) {
+    fail(*handle, e.what());
+    return;
+  }
+  for (uint32_t i = 0; i < view.meshes.size(); i++) {
+    // Meshes that aren't referenced by any node are never drawn.
+    if (handle->layout_.meshNodes[i].empty()) continue;
+    handle->pendingMeshes_.push_back(i);
+  }
+  handle->numMeshes_ = handle->pendingMeshes_.size();
+  handle->textures_ = model.collectUnloadedTextures(view);
+  handle->data_ = std::move(data);
+  handle->imported_ = true;
+
+  for (size_t i = 0; i < handle->textures_.size(); i++) {
+    pool_.submit([this, handle, i]() {
+      if (stopping_) return;
+      DecodeResult result;
+      result.handle = handle;
+      result.textureIndex = i;
+      const auto& [path, type] = handle->textures_[i];
+      try {
+        result.image =
+            decodeTextureMap(path, type, handle->model_->params_);
+      } catch (const std::exception& e) {
+        result.error = e.what();
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      decodeResults_.push_back(std::move(result));
+    });
+  }
+}
+
+void ModelLoader::buildNextMesh(ModelLoadHandle& handle, size_t* bytes) {
+  uint32_t meshIndex = handle.pendingMeshes_.front();
+  handle.pendingMeshes_.pop_front();
+
+  const ModelDataView& view = handle.data_.view;
+  const ModelMeshData& meshData = view.meshes[meshIndex];
+  bool usedPlaceholder = false;
+  std::vector<TextureMap> textureMaps = handle.model_->getTextureMaps(
+      view, meshData,
+      [this](TextureMapType type) { return getPlaceholder(type); },
+      &usedPlaceholder);
+  ModelMesh* mesh =
+      handle.model_->addMesh(view, handle.layout_, meshIndex, textureMaps);
+  if (usedPlaceholder) {
+    handle.placeholderMeshes_.push_back({mesh, &meshData});
+  }
+
+  *bytes += meshData.vertexCount *
+                getVertexSizeBytes(handle.model_->params_.vertexFormat) +
+            meshData.indexCount * getIndexSizeBytes(mesh->getIndexType());
+}
+
+void ModelLoader::uploadNextTexture(ModelLoadHandle& handle, size_t* bytes) {
+  auto [textureIndex, image] = std::move(handle.decodedTextures_.front());
+  handle.decodedTextures_.pop_front();
+
+  const auto& [fullPath, type] = handle.textures_[textureIndex];
+  handle.model_->addLoadedTexture(
+      fullPath, Texture::loadFromImage(image, isSRGBTextureMapType(type)),
+      type);
+  handle.numTexturesUploaded_++;
+  *bytes += image.getSizeBytes();
+}
+
+void ModelLoader::refreshPlaceholderMeshes(ModelLoadHandle& handle) {
+  const ModelDataView& view = handle.data_.view;
+  auto placeholder = [this](TextureMapType type) {
+    return getPlaceholder(type);
+  };
+  // Swap in any newly uploaded textures, and stop tracking meshes that no
+  // longer need placeholders.
+  std::erase_if(handle.placeholderMeshes_, [&](const auto& placeholderMesh) {
+    bool usedPlaceholder = false;
+    placeholderMesh.mesh->setTextureMaps(handle.model_->getTextureMaps(
+        view, *placeholderMesh.data, placeholder, &usedPlaceholder));
+    return !usedPlaceholder;
+  });
+}
+
+void ModelLoader::fail(ModelLoadHandle& handle, const std::string& error) {
+  if (handle.state_ != ModelLoadState::LOADING) return;
+  handle.state_ = ModelLoadState::FAILED;
+  handle.error_ = error;
+  // Anything that was already built stays in the model.
+  handle.pendingMeshes_.clear();
+  handle.decodedTextures_.clear();
+  handle.placeholderMeshes_.clear();
+  handle.data_ = {};
+  handle.layout_ = {};
+}
+
+TextureMap ModelLoader::getPlaceholder(TextureMapType type) {
+  auto item = placeholders_.find(type);
+  if (item == placeholders_.end()) {
+    // A single texel is enough.
+    Texture texture = Texture::createFromData(
+        /*width=*/1, /*height=*/1, GL_RGB8, {placeholderColor(type)});
+    item = placeholders_.emplace(type, texture).first;
+  }
+  return TextureMap(item->second, type);
+}
+
+}  // namespace qrk
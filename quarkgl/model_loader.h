@@ -0,0 +1,141 @@
+#ifndef QUARKGL_MODEL_LOADER_H_
+#define QUARKGL_MODEL_LOADER_H_
+
+#include <qrk/model.h>
+#include <qrk/texture.h>
+#include <qrk/texture_map.h>
+#include <qrk/thread_pool.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace qrk {
+
+// Limits on how much GL upload work a ModelLoader performs per call to
+// processUploads(). At least one upload is always performed, so that loading
+// always makes progress.
+struct UploadBudget {
+  // The maximum time to spend uploading, in milliseconds.
+  float maxMillis = 2.0f;
+  // The maximum number of bytes of vertex, index, and texture data to upload.
+  size_t maxBytes = 16 * 1024 * 1024;
+};
+
+enum class ModelLoadState {
+  LOADING = 0,
+  DONE,
+  FAILED,
+};
+
+// A handle to a model that is being loaded by a ModelLoader. The model itself
+// is available immediately, and fills in as uploads are processed. Should
+// only be used from the GL thread.
+class ModelLoadHandle {
+ public:
+  std::shared_ptr<Model> getModel() const { return model_; }
+  const std::string& getPath() const { return path_; }
+  ModelLoadState getState() const { return state_; }
+  bool isDone() const { return state_ == ModelLoadState::DONE; }
+  bool hasFailed() const { return state_ == ModelLoadState::FAILED; }
+  const std::string& getError() const { return error_; }
+  // Returns the fraction of meshes and textures that have been uploaded.
+  float getProgress() const;
+
+ private:
+  // A built mesh that is still using placeholder textures.
+  struct PlaceholderMesh {
+    ModelMesh* mesh;
+    const ModelMeshData* data;
+  };
+
+  std::shared_ptr<Model> model_;
+  std::string path_;
+  ModelLoadState state_ = ModelLoadState::LOADING;
+  std::string error_;
+
+  // All of the following are populated once the model data is imported.
+  bool imported_ = false;
+  LoadedModelData data_;
+  Model::NodeLayout layout_;
+  // Indices of the meshes waiting to be built.
+  std::deque<uint32_t> pendingMeshes_;
+  std::vector<PlaceholderMesh> placeholderMeshes_;
+  size_t numMeshes_ = 0;
+  // The textures being decoded, along with their first-referenced types.
+  std::vector<std::pair<std::string, TextureMapType>> textures_;
+  // Decoded textures waiting to be uploaded, by index into textures_.
+  std::deque<std::pair<size_t, ImageData>> decodedTextures_;
+  size_t numTexturesUploaded_ = 0;
+
+  friend class ModelLoader;
+};
+
+// Loads models asynchronously. Model import and texture decoding happen on a
+// pool of worker threads, while GL uploads are done incrementally on the GL
+// thread, within a per-call budget. Meshes are drawable as soon as they're
+// uploaded, using placeholder textures until their real textures arrive. The
+// placeholders belong to the loader, so models whose loads didn't finish (e.g.
+// because a texture failed) mustn't be drawn once the loader is destroyed.
+class ModelLoader {
+ public:
+  explicit ModelLoader(
+      unsigned int numThreads = ThreadPool::getDefaultNumThreads());
+  ~ModelLoader();
+
+  // Starts loading a model in the background, returning immediately.
+  // Textures are always decoded off-thread, so params.parallelTextureDecode is
+  // ignored.
+  std::shared_ptr<ModelLoadHandle> load(const char* path,
+                                        const ModelParams& params = {});
+
+  // Performs pending GL uploads, within the given budget. Must be called
+  // regularly (e.g. once per frame) from the GL thread.
+  void processUploads(const UploadBudget& budget = {});
+
+  // Returns whether there are no loads in progress.
+  bool isIdle() const { return jobs_.empty(); }
+
+ private:
+  struct ImportResult {
+    std::shared_ptr<ModelLoadHandle> handle;
+    LoadedModelData data;
+    std::string error;
+  };
+  struct DecodeResult {
+    std::shared_ptr<ModelLoadHandle> handle;
+    size_t textureIndex;
+    ImageData image;
+    std::string error;
+  };
+
+  void handleImported(const std::shared_ptr<ModelLoadHandle>& handle,
+                      LoadedModelData data);
+  void buildNextMesh(ModelLoadHandle& handle, size_t* bytes);
+  void uploadNextTexture(ModelLoadHandle& handle, size_t* bytes);
+  void refreshPlaceholderMeshes(ModelLoadHandle& handle);
+  static void fail(ModelLoadHandle& handle, const std::string& error);
+  TextureMap getPlaceholder(TextureMapType type);
+
+  std::vector<std::shared_ptr<ModelLoadHandle>> jobs_;
+  std::unordered_map<TextureMapType, Texture> placeholders_;
+
+  // Results from the workers, guarded by mutex_.
+  std::mutex mutex_;
+  std::vector<ImportResult> importResults_;
+  std::vector<DecodeResult> decodeResults_;
+  std::atomic<bool> stopping_ = false;
+
+  // Declared last, so that workers are joined before anything they touch is
+  // destroyed.
+  ThreadPool pool_;
+};
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,145 @@
+#include <qrk/program_cache.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace qrk {
+namespace {
+constexpr char PROGRAM_CACHE_MAGIC[8] = {'Q', 'R', 'K', 'P',
+                                         'R', 'O', 'G', 'M'};
+constexpr char PROGRAM_CACHE_EXTENSION[] = ".qpc";
+
+struct ProgramCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t format;
+  uint64_t checkHash;
+  // The binary immediately follows the header.
+  uint64_t binaryLength;
+};
+
+// 64-bit FNV-1a. Unlike std::hash, this is stable across runs and platforms.
+class Fnv1aHash {
+ public:
+  explicit Fnv1aHash(uint64_t basis = 14695981039346656037ull)
+      : hash_(basis) {}
+
+  void add(std::string_view data) {
+    for (unsigned char c : data) {
+      hash_ ^= c;
+      hash_ *= 1099511628211ull;
+    }
+    // Separate consecutive strings, so that moving data between them changes
+    // the hash.
+    hash_ ^= 0xff;
+    hash_ *= 1099511628211ull;
+  }
+  uint64_t get() const { return hash_; }
+
+ private:
+  uint64_t hash_;
+};
+}  // namespace
+
+ProgramCacheKey computeProgramCacheKey(
+    std::string_view driver, std::span<const ShaderStageSource> stages) {
+  // The check hash uses a different basis, so that it's independent of the
+  // entry's name.
+  Fnv1aHash hash;
+  Fnv1aHash checkHash(0x6c62272e07bb0142ull);
+  auto add = [&](std::string_view data) {
+    hash.add(data);
+    checkHash.add(data);
+  };
+  add(driver);
+  for (const ShaderStageSource& stage : stages) {
+    add(std::to_string(static_cast<int>(stage.type)));
+    add(stage.source);
+  }
+  return {.hash = hash.get(), .checkHash = checkHash.get()};
+}
+
+std::string ProgramCache::getDefaultDirectory() {
+  std::error_code ec;
+  std::filesystem::path tempDir = std::filesystem::temp_directory_path(ec);
+  if (ec) tempDir = ".";
+  return (tempDir / "quarkgl_program_cache").string();
+}
+
+std::string ProgramCache::getEntryPath(const ProgramCacheKey& key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx%s",
+                static_cast<unsigned long long>(key.hash),
+                PROGRAM_CACHE_EXTENSION);
+  return (std::filesystem::path(directory_) / name).string();
+}
+
+std::optional<ProgramBinary> ProgramCache::load(const ProgramCacheKey& key) {
+  std::ifstream in(getEntryPath(key), std::ios::binary);
+  if (!in) return std::nullopt;
+
+  // Validate that the entry matches the requested key.
+  ProgramCacheHeader header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) !=
+          0 ||
+      header.version != PROGRAM_CACHE_VERSION ||
+      header.checkHash != key.checkHash) {
+    return std::nullopt;
+  }
+
+  // Check the length against the file, so that a corrupt header can't cause a
+  // huge allocation.
+  std::error_code ec;
+  uintmax_t fileSize = std::filesystem::file_size(getEntryPath(key), ec);
+  if (ec || header.binaryLength != fileSize - sizeof(header)) {
+    return std::nullopt;
+  }
+
+  ProgramBinary binary;
+  binary.format = header.format;
+  binary.data.resize(header.binaryLength);
+  if (!in.read(binary.data.data(), binary.data.size())) return std::nullopt;
+  return binary;
+}
+
+bool ProgramCache::store(const ProgramCacheKey& key,
+                         const ProgramBinary& binary) {
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec) return false;
+
+  // Write to a temporary file first, and then move it into place, so that
+  // readers never observe a partially written entry.
+  std::string entryPath = getEntryPath(key);
+  std::string tempPath = entryPath + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    ProgramCacheHeader header = {};
+    std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.format = binary.format;
+    header.checkHash = key.checkHash;
+    header.binaryLength = binary.data.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(binary.data.data(), binary.data.size());
+    if (!out) {
+      out.close();
+      std::filesystem::remove(tempPath, ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tempPath, entryPath, ec);
+  if (ec) {
+    std::filesystem::remove(tempPath, ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace qrk
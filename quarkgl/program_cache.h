@@ -0,0 +1,75 @@
+#ifndef QUARKGL_PROGRAM_CACHE_H_
+#define QUARKGL_PROGRAM_CACHE_H_
+
+#include <qrk/shader_defs.h>
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qrk {
+
+// Bump this whenever the layout of the cache file changes.
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// The fully preprocessed source of a single shader stage.
+struct ShaderStageSource {
+  ShaderType type;
+  std::string source;
+  // The files that the source was combined from, indexed by the source string
+  // numbers in its #line directives. Not part of the cache key, since the
+  // source already reflects them.
+  std::vector<std::string> sourceFiles = {};
+};
+
+// Identifies a program by the sources of all of its stages, and by the driver
+// that compiles it, since program binaries are driver-specific.
+struct ProgramCacheKey {
+  // Names the cache entry.
+  uint64_t hash;
+  // An independent hash of the same data, stored in the entry to detect
+  // collisions.
+  uint64_t checkHash;
+};
+
+ProgramCacheKey computeProgramCacheKey(
+    std::string_view driver, std::span<const ShaderStageSource> stages);
+
+// A linked program, as returned by glGetProgramBinary.
+struct ProgramBinary {
+  unsigned int format;
+  std::vector<char> data;
+};
+
+// An on-disk cache of linked program binaries, which allows shaders to skip
+// compilation and linking on later runs.
+//
+// Cache failures are never fatal; a bad or stale entry is treated as a miss.
+// Drivers may also reject a binary that loads successfully (e.g. after a driver
+// update), in which case the caller should compile the program and replace the
+// entry.
+class ProgramCache {
+ public:
+  explicit ProgramCache(std::string directory = getDefaultDirectory())
+      : directory_(std::move(directory)) {}
+
+  // Reads the cache entry for the given key. Returns nullopt on a cache miss.
+  std::optional<ProgramBinary> load(const ProgramCacheKey& key);
+  // Writes a cache entry for the given key. Returns false on failure.
+  bool store(const ProgramCacheKey& key, const ProgramBinary& binary);
+
+  std::string getEntryPath(const ProgramCacheKey& key) const;
+  const std::string& getDirectory() const { return directory_; }
+
+  static std::string getDefaultDirectory();
+
+ private:
+  std::string directory_;
+};
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <qrk/program_cache.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<qrk::ShaderStageSource> STAGES = {
+    {qrk::ShaderType::VERTEX, "void main() { gl_Position = vec4(0.0); }"},
+    {qrk::ShaderType::FRAGMENT, "out vec4 color; void main() { color = 1; }"},
+};
+
+class ProgramCacheTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::path(testing::TempDir()) /
+                 testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::filesystem::remove_all(directory_);
+  }
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  std::filesystem::path directory_;
+};
+
+TEST_F(ProgramCacheTest, LoadsStoredBinary) {
+  qrk::ProgramCache cache(directory_.string());
+  qrk::ProgramCacheKey key = qrk::computeProgramCacheKey("driver", STAGES);
+  EXPECT_FALSE(cache.load(key).has_value());
+
+  qrk::ProgramBinary binary = {.format = 42, .data = {'a', '\0', 'b'}};
+  ASSERT_TRUE(cache.store(key, binary));
+  std::optional<qrk::ProgramBinary> loaded = cache.load(key);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->format, 42);
+  EXPECT_EQ(loaded->data, binary.data);
+}
+
+TEST_F(ProgramCacheTest, KeyDependsOnDriverAndEveryStage) {
+  qrk::ProgramCacheKey key = qrk::computeProgramCacheKey("driver", STAGES);
+  EXPECT_EQ(qrk::computeProgramCacheKey("driver", STAGES).hash, key.hash);
+  EXPECT_NE(qrk::computeProgramCacheKey("other driver", STAGES).hash,
+            key.hash);
+
+  std::vector<qrk::ShaderStageSource> stages = STAGES;
+  stages[1].source += " ";
+  EXPECT_NE(qrk::computeProgramCacheKey("driver", stages).hash, key.hash);
+
+  stages = STAGES;
+  stages[1].type = qrk::ShaderType::GEOMETRY;
+  EXPECT_NE(qrk::computeProgramCacheKey("driver", stages).hash, key.hash);
+
+  // Moving text between stages must also change the key.
+  stages = STAGES;
+  stages[0].source += stages[1].source.substr(0, 3);
+  stages[1].source = stages[1].source.substr(3);
+  EXPECT_NE(qrk::computeProgramCacheKey("driver", stages).hash, key.hash);
+}
+
+TEST_F(ProgramCacheTest, IgnoresMismatchedAndCorruptEntries) {
+  qrk::ProgramCache cache(directory_.string());
+  qrk::ProgramCacheKey key = qrk::computeProgramCacheKey("driver", STAGES);
+  ASSERT_TRUE(cache.store(key, {.format = 1, .data = {'x', 'y', 'z'}}));
+
+  // A colliding entry name with different contents.
+  qrk::ProgramCacheKey collision = key;
+  collision.checkHash++;
+  EXPECT_FALSE(cache.load(collision).has_value());
+
+  // A truncated entry.
+  std::filesystem::resize_file(cache.getEntryPath(key), 10);
+  EXPECT_FALSE(cache.load(key).has_value());
+
+  // A truncated binary.
+  ASSERT_TRUE(cache.store(key, {.format = 1, .data = {'x', 'y', 'z'}}));
+  std::filesystem::resize_file(
+      cache.getEntryPath(key),
+      std::filesystem::file_size(cache.getEntryPath(key)) - 1);
+  EXPECT_FALSE(cache.load(key).has_value());
+}
+
+}  // namespace
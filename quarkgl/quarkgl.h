@@ -7,19 +7,34 @@
 // clang-format on
 
 #include <qrk/aa.h>
+#include <qrk/block_compression.h>
 #include <qrk/bloom.h>
 #include <qrk/blur.h>
+#include <qrk/bounds.h>
 #include <qrk/camera.h>
+#include <qrk/compressed_texture.h>
 #include <qrk/cubemap.h>
 #include <qrk/debug.h>
 #include <qrk/deferred.h>
+#include <qrk/draw_list.h>
 #include <qrk/exceptions.h>
 #include <qrk/framebuffer.h>
+#include <qrk/gl_state.h>
 #include <qrk/ibl.h>
+#include <qrk/image_mips.h>
 #include <qrk/light.h>
+#include <qrk/light_clusters.h>
+#include <qrk/lod.h>
+#include <qrk/mapped_file.h>
 #include <qrk/mesh.h>
+#include <qrk/mesh_optimizer.h>
 #include <qrk/mesh_primitives.h>
+#include <qrk/mesh_simplifier.h>
 #include <qrk/model.h>
+#include <qrk/model_cache.h>
+#include <qrk/model_data.h>
+#include <qrk/model_loader.h>
+#include <qrk/program_cache.h>
 #include <qrk/random.h>
 #include <qrk/screen.h>
 #include <qrk/shader.h>
@@ -27,13 +42,22 @@
 #include <qrk/shader_defs.h>
 #include <qrk/shader_loader.h>
 #include <qrk/shader_primitives.h>
+#include <qrk/shader_variant_cache.h>
+#include <qrk/shader_watcher.h>
 #include <qrk/shadows.h>
 #include <qrk/ssao.h>
+#include <qrk/staging_ring.h>
+#include <qrk/storage_buffer.h>
 #include <qrk/texture.h>
 #include <qrk/texture_map.h>
 #include <qrk/texture_registry.h>
+#include <qrk/texture_residency.h>
+#include <qrk/thread_pool.h>
+#include <qrk/uniform_buffer.h>
 #include <qrk/utils.h>
 #include <qrk/vertex_array.h>
+#include <qrk/vertex_format.h>
+#include <qrk/virtual_texture.h>
 #include <qrk/window.h>
 
 #endif
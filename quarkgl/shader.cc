@@ -1,40 +1,290 @@
 #include <qrk/core.h>
+#include <qrk/gl_state.h>
 #include <qrk/shader.h>
 #include <qrk/shader_compiler.h>
 #include <qrk/shader_loader.h>
 
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace qrk {
+namespace {
+// Marks a UniformName whose location hasn't been looked up yet.
+constexpr int UNRESOLVED_LOCATION = -2;
+
+// The interned names of every UniformName.
+struct UniformNameRegistry {
+  std::mutex mutex;
+  std::unordered_map<std::string_view, unsigned int> ids;
+  // A deque, so that views of earlier names stay valid as it grows.
+  std::deque<std::string> names;
+};
+
+UniformNameRegistry& getUniformNameRegistry() {
+  static UniformNameRegistry registry;
+  return registry;
+}
+
+thread_local bool deferLinks = false;
+
+struct ActiveUniform {
+  std::string name;
+  int size;
+  GLenum type;
+};
+
+std::vector<ActiveUniform> getActiveUniforms(unsigned int program) {
+  int numUniforms = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
+  int maxNameLength = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+  std::string name(maxNameLength, '\0');
+  std::vector<ActiveUniform> uniforms;
+  for (int i = 0; i < numUniforms; i++) {
+    int length = 0;
+    int size = 0;
+    GLenum type;
+    glGetActiveUniform(program, i, maxNameLength, &length, &size, &type,
+                       name.data());
+    uniforms.push_back({name.substr(0, length), size, type});
+  }
+  return uniforms;
+}
+
+// Copies a uniform's value between programs. Only handles the types that
+// shaders in this library use; others are skipped.
+void copyUniformValue(unsigned int from, int fromLocation, unsigned int to,
+                      int toLocation, GLenum type) {
+  float floats[16];
+  int ints[4];
+  unsigned int uints[4];
+  switch (type) {
+    case GL_FLOAT:
+      glGetUniformfv(from, fromLocation, floats);
+      glProgramUniform1fv(to, toLocation, 1, floats);
+      break;
+    case GL_FLOAT_VEC2:
+      glGetUniformfv(from, fromLocation, floats);
+      glProgramUniform2fv(to, toLocation, 1, floats);
+      break;
+    case GL_FLOAT_VEC3:
+      glGetUniformfv(from, fromLocation, floats);
+      glProgramUniform3fv(to, toLocation, 1, floats);
+      break;
+    case GL_FLOAT_VEC4:
+      glGetUniformfv(from, fromLocation, floats);
+      glProgramUniform4fv(to, toLocation, 1, floats);
+      break;
+    case GL_FLOAT_MAT3:
+      glGetUniformfv(from, fromLocation, floats);
+      glProgramUniformMatrix3fv(to, toLocation, 1, GL_FALSE, floats);
+      break;
+    case GL_FLOAT_MAT4:
+      glGetUniformfv(from, fromLocation, floats);
+      glProgramUniformMatrix4fv(to, toLocation, 1, GL_FALSE, floats);
+      break;
+    case GL_UNSIGNED_INT:
+      glGetUniformuiv(from, fromLocation, uints);
+      glProgramUniform1uiv(to, toLocation, 1, uints);
+      break;
+    case GL_UNSIGNED_INT_VEC3:
+      glGetUniformuiv(from, fromLocation, uints);
+      glProgramUniform3uiv(to, toLocation, 1, uints);
+      break;
+    // Samplers and images are set to the unit they read from.
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_IMAGE_2D:
+      glGetUniformiv(from, fromLocation, ints);
+      glProgramUniform1iv(to, toLocation, 1, ints);
+      break;
+    default:
+      break;
+  }
+}
+
+// Copies the values of the uniforms that both programs have, with the same
+// type.
+void copyUniformValues(unsigned int from, unsigned int to) {
+  std::unordered_map<std::string, GLenum> toTypes;
+  for (const ActiveUniform& uniform : getActiveUniforms(to)) {
+    toTypes.emplace(uniform.name, uniform.type);
+  }
+  constexpr std::string_view arraySuffix = "[0]";
+  for (const ActiveUniform& uniform : getActiveUniforms(from)) {
+    auto it = toTypes.find(uniform.name);
+    if (it == toTypes.end() || it->second != uniform.type) continue;
+
+    // Arrays are listed once, as "name[0]", so copy each element in turn.
+    std::string arrayName = uniform.name;
+    if (uniform.name.ends_with(arraySuffix)) {
+      arrayName.resize(arrayName.size() - arraySuffix.size());
+    }
+    for (int i = 0; i < uniform.size; i++) {
+      std::string name = i == 0 ? uniform.name
+                                : arrayName + "[" + std::to_string(i) + "]";
+      int fromLocation = glGetUniformLocation(from, name.c_str());
+      int toLocation = glGetUniformLocation(to, name.c_str());
+      // Members of uniform blocks don't have locations.
+      if (fromLocation == -1 || toLocation == -1) continue;
+      copyUniformValue(from, fromLocation, to, toLocation, uniform.type);
+    }
+  }
+}
+}  // namespace
+
+DeferredLinkScope::DeferredLinkScope() : previous_(deferLinks) {
+  deferLinks = true;
+}
+
+DeferredLinkScope::~DeferredLinkScope() { deferLinks = previous_; }
+
+UniformName::UniformName(std::string_view name) {
+  UniformNameRegistry& registry = getUniformNameRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.ids.find(name);
+  if (it == registry.ids.end()) {
+    const std::string& interned = registry.names.emplace_back(name);
+    it = registry.ids.emplace(interned, registry.names.size() - 1).first;
+  }
+  id_ = it->second;
+  name_ = &registry.names[id_];
+}
 
 Shader::Shader(const ShaderSource& vertexSource,
                const ShaderSource& fragmentSource) {
-  ShaderCompiler compiler;
-  compiler.loadAndCompileShader(vertexSource, ShaderType::VERTEX);
-  compiler.loadAndCompileShader(fragmentSource, ShaderType::FRAGMENT);
-  shaderProgram_ = compiler.linkShaderProgram();
+  auto compiler = std::make_shared<ShaderCompiler>();
+  compiler->loadShader(vertexSource, ShaderType::VERTEX);
+  compiler->loadShader(fragmentSource, ShaderType::FRAGMENT);
+  linkProgram(std::move(compiler));
 }
 
 Shader::Shader(const ShaderSource& vertexSource,
                const ShaderSource& fragmentSource,
                const ShaderSource& geometrySource) {
-  ShaderCompiler compiler;
-  compiler.loadAndCompileShader(vertexSource, ShaderType::VERTEX);
-  compiler.loadAndCompileShader(fragmentSource, ShaderType::FRAGMENT);
-  compiler.loadAndCompileShader(geometrySource, ShaderType::GEOMETRY);
-  shaderProgram_ = compiler.linkShaderProgram();
+  auto compiler = std::make_shared<ShaderCompiler>();
+  compiler->loadShader(vertexSource, ShaderType::VERTEX);
+  compiler->loadShader(fragmentSource, ShaderType::FRAGMENT);
+  compiler->loadShader(geometrySource, ShaderType::GEOMETRY);
+  linkProgram(std::move(compiler));
+}
+
+void Shader::linkProgram(std::shared_ptr<ShaderCompiler> compiler) {
+  compiler_ = compiler;
+  if (ShaderBatch* batch = ShaderBatch::current()) {
+    batch->add(compiler);
+    pendingCompiler_ = std::move(compiler);
+    return;
+  }
+  if (deferLinks) {
+    shaderProgram_ = compiler->submitShaderProgram();
+    pendingCompiler_ = std::move(compiler);
+    return;
+  }
+  shaderProgram_ = compiler->linkShaderProgram();
+  loadUniformLocations();
+}
+
+void Shader::finishPendingLink() {
+  shaderProgram_ = pendingCompiler_->finishShaderProgram();
+  pendingCompiler_.reset();
+  loadUniformLocations();
+}
+
+std::vector<std::string> Shader::getSourceFiles() {
+  finishLink();
+  if (!compiler_) return {};
+  return compiler_->getSourceFiles();
+}
+
+void Shader::reload() {
+  finishLink();
+  if (!compiler_) {
+    throw ShaderException("ERROR::SHADER::RELOAD_FAILED\nNo shader sources");
+  }
+  // Build the new program before touching the current one, so that the shader
+  // stays usable if it fails.
+  std::shared_ptr<ShaderCompiler> compiler = compiler_->recreate();
+  unsigned int program = compiler->linkShaderProgram();
+
+  copyUniformValues(shaderProgram_, program);
+  GlState::current().onProgramDeleted(shaderProgram_);
+  glDeleteProgram(shaderProgram_);
+  shaderProgram_ = program;
+  compiler_ = std::move(compiler);
+  loadUniformLocations();
+}
+
+void Shader::loadUniformLocations() {
+  uniformLocations_.clear();
+  resolvedLocations_.clear();
+
+  for (const ActiveUniform& uniform : getActiveUniforms(shaderProgram_)) {
+    const std::string& uniformName = uniform.name;
+    int location = glGetUniformLocation(shaderProgram_, uniformName.c_str());
+    // Members of uniform blocks don't have locations.
+    if (location == -1) continue;
+    uniformLocations_.emplace(uniformName, location);
+
+    // Arrays of basic types are listed once, as "name[0]". Make each element
+    // addressable, as well as the array itself.
+    constexpr std::string_view arraySuffix = "[0]";
+    if (!uniformName.ends_with(arraySuffix)) continue;
+    std::string arrayName =
+        uniformName.substr(0, uniformName.size() - arraySuffix.size());
+    uniformLocations_.emplace(arrayName, location);
+    for (int j = 1; j < uniform.size; j++) {
+      std::string elementName = arrayName + "[" + std::to_string(j) + "]";
+      int elementLocation =
+          glGetUniformLocation(shaderProgram_, elementName.c_str());
+      if (elementLocation != -1) {
+        uniformLocations_.emplace(elementName, elementLocation);
+      }
+    }
+  }
 }
 
 int Shader::safeGetUniformLocation(const char* name) {
-  int uniform = glGetUniformLocation(shaderProgram_, name);
-  if (uniform == -1) {
+  finishLink();
+  auto it = uniformLocations_.find(std::string_view(name));
+  if (it == uniformLocations_.end()) {
     // TODO: Log a message; either uniform is invalid, or it got optimized away
     // by the shader.
     // printf("unknown uniform: %s\n", name);
+    return -1;
+  }
+  return it->second;
+}
+
+int Shader::getUniformLocation(const UniformName& uniform) {
+  finishLink();
+  const unsigned int id = uniform.getId();
+  if (id >= resolvedLocations_.size()) {
+    resolvedLocations_.resize(id + 1, UNRESOLVED_LOCATION);
   }
-  return uniform;
+  int& location = resolvedLocations_[id];
+  if (location == UNRESOLVED_LOCATION) {
+    location = safeGetUniformLocation(uniform.getName().c_str());
+  }
+  return location;
 }
 
-void Shader::activate() { glUseProgram(shaderProgram_); }
-void Shader::deactivate() { glUseProgram(0); }
+void Shader::activate() {
+  finishLink();
+  GlState::current().useProgram(shaderProgram_);
+}
+// The program is left bound, since binding it again is free if it's still
+// current, and any other shader will replace it anyway.
+void Shader::deactivate() {}
 
 // TODO: Is shared_ptr really the best approach here?
 void Shader::addUniformSource(std::shared_ptr<UniformSource> source) {
@@ -42,55 +292,110 @@ void Shader::addUniformSource(std::shared_ptr<UniformSource> source) {
 }
 
 void Shader::updateUniforms() {
-  // Update core uniforms.
-  setFloat("qrk_time", qrk::time());
-
+  finishLink();
+  // Core uniforms (e.g. qrk_time) are in the QrkFrame block, which the window
+  // writes once per frame.
   for (auto uniformSource : uniformSources_) {
     uniformSource->updateUniforms(*this);
   }
+
+  if (frustumSource_) cullingFrustum_ = frustumSource_->getFrustum();
+  cullingStats_ = {};
 }
 
 void Shader::setBool(const char* name, bool value) {
-  activate();
-  glUniform1i(safeGetUniformLocation(name), static_cast<int>(value));
+  int location = safeGetUniformLocation(name);
+  glProgramUniform1i(shaderProgram_, location, static_cast<int>(value));
 }
 
 void Shader::setUInt(const char* name, unsigned int value) {
-  activate();
-  glUniform1ui(safeGetUniformLocation(name), value);
+  int location = safeGetUniformLocation(name);
+  glProgramUniform1ui(shaderProgram_, location, value);
 }
 
 void Shader::setInt(const char* name, int value) {
-  activate();
-  glUniform1i(safeGetUniformLocation(name), value);
+  int location = safeGetUniformLocation(name);
+  glProgramUniform1i(shaderProgram_, location, value);
 }
 
 void Shader::setFloat(const char* name, float value) {
-  activate();
-  glUniform1f(safeGetUniformLocation(name), value);
+  int location = safeGetUniformLocation(name);
+  glProgramUniform1f(shaderProgram_, location, value);
 }
 
 void Shader::setVec3(const char* name, const glm::vec3& vector) {
-  activate();
-  glUniform3fv(safeGetUniformLocation(name), /*count=*/1,
-               glm::value_ptr(vector));
+  int location = safeGetUniformLocation(name);
+  glProgramUniform3fv(shaderProgram_, location, /*count=*/1,
+                      glm::value_ptr(vector));
 }
 
 void Shader::setVec3(const char* name, float v0, float v1, float v2) {
-  activate();
-  glUniform3f(safeGetUniformLocation(name), v0, v1, v2);
+  int location = safeGetUniformLocation(name);
+  glProgramUniform3f(shaderProgram_, location, v0, v1, v2);
+}
+
+void Shader::setUVec3(const char* name, const glm::uvec3& vector) {
+  int location = safeGetUniformLocation(name);
+  glProgramUniform3uiv(shaderProgram_, location, /*count=*/1,
+                       glm::value_ptr(vector));
 }
 
 void Shader::setMat4(const char* name, const glm::mat4& matrix) {
-  activate();
-  glUniformMatrix4fv(safeGetUniformLocation(name), /*count=*/1,
-                     /*transpose=*/GL_FALSE, glm::value_ptr(matrix));
+  int location = safeGetUniformLocation(name);
+  glProgramUniformMatrix4fv(shaderProgram_, location, /*count=*/1,
+                            /*transpose=*/GL_FALSE, glm::value_ptr(matrix));
+}
+
+void Shader::setBool(const UniformName& uniform, bool value) {
+  int location = getUniformLocation(uniform);
+  glProgramUniform1i(shaderProgram_, location, static_cast<int>(value));
+}
+
+void Shader::setUInt(const UniformName& uniform, unsigned int value) {
+  int location = getUniformLocation(uniform);
+  glProgramUniform1ui(shaderProgram_, location, value);
+}
+
+void Shader::setInt(const UniformName& uniform, int value) {
+  int location = getUniformLocation(uniform);
+  glProgramUniform1i(shaderProgram_, location, value);
+}
+
+void Shader::setFloat(const UniformName& uniform, float value) {
+  int location = getUniformLocation(uniform);
+  glProgramUniform1f(shaderProgram_, location, value);
+}
+
+void Shader::setVec3(const UniformName& uniform, const glm::vec3& vector) {
+  int location = getUniformLocation(uniform);
+  glProgramUniform3fv(shaderProgram_, location, /*count=*/1,
+                      glm::value_ptr(vector));
+}
+
+void Shader::setUVec3(const UniformName& uniform, const glm::uvec3& vector) {
+  int location = getUniformLocation(uniform);
+  glProgramUniform3uiv(shaderProgram_, location, /*count=*/1,
+                       glm::value_ptr(vector));
+}
+
+void Shader::setMat4(const UniformName& uniform, const glm::mat4& matrix) {
+  int location = getUniformLocation(uniform);
+  glProgramUniformMatrix4fv(shaderProgram_, location, /*count=*/1,
+                            /*transpose=*/GL_FALSE, glm::value_ptr(matrix));
+}
+
+void Shader::setVec3Array(const UniformName& uniform,
+                          std::span<const glm::vec3> vectors) {
+  if (vectors.empty()) return;
+  int location = getUniformLocation(uniform);
+  glProgramUniform3fv(shaderProgram_, location, vectors.size(),
+                      glm::value_ptr(vectors[0]));
 }
 
 ComputeShader::ComputeShader(const ShaderSource& computeSource) {
-  ShaderCompiler compiler;
-  compiler.loadAndCompileShader(computeSource, ShaderType::COMPUTE);
-  shaderProgram_ = compiler.linkShaderProgram();
+  auto compiler = std::make_shared<ShaderCompiler>();
+  compiler->loadShader(computeSource, ShaderType::COMPUTE);
+  linkProgram(std::move(compiler));
 }
 
 void ComputeShader::dispatchToTexture(Texture& texture) {
@@ -102,4 +407,9 @@ void ComputeShader::dispatchToTexture(Texture& texture) {
   glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 }
 
+void ComputeShader::dispatch(unsigned int x, unsigned int y, unsigned int z) {
+  activate();
+  glDispatchCompute(x, y, z);
+}
+
 }  // namespace qrk
@@ -2,14 +2,20 @@
 #define QUARKGL_SHADER_H_
 
 #include <glad/glad.h>
+#include <qrk/bounds.h>
 #include <qrk/exceptions.h>
+#include <qrk/shader_compiler.h>
 #include <qrk/shader_defs.h>
 #include <qrk/texture.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace qrk {
@@ -28,6 +34,42 @@ class UniformSource {
   virtual void updateUniforms(Shader& shader) = 0;
 };
 
+// Counts of the renderables drawn and skipped during a pass.
+struct CullingStats {
+  unsigned int visible = 0;
+  unsigned int culled = 0;
+};
+
+// A uniform name that's resolved to a location once per shader, so that
+// setting it skips both hashing the name and querying the driver. Names are
+// interned, so a UniformName is best created once (e.g. as a static) and
+// reused for every draw, with any shader.
+class UniformName {
+ public:
+  explicit UniformName(std::string_view name);
+
+  const std::string& getName() const { return *name_; }
+  // A small, dense ID that's shared by every UniformName with the same name.
+  unsigned int getId() const { return id_; }
+
+ private:
+  unsigned int id_;
+  const std::string* name_;
+};
+
+// While an instance is alive, shaders constructed on the current thread submit
+// their programs to the driver without waiting for them to build, and finish
+// them on first use instead. With KHR_parallel_shader_compile, the driver
+// builds them in the background meanwhile.
+class DeferredLinkScope {
+ public:
+  DeferredLinkScope();
+  ~DeferredLinkScope();
+
+ private:
+  bool previous_;
+};
+
 class Shader {
  public:
   Shader(const ShaderSource& vertexSource, const ShaderSource& fragmentSource);
@@ -35,14 +77,53 @@ class Shader {
          const ShaderSource& geometrySource);
   virtual ~Shader() = default;
 
-  unsigned int getProgramId() const { return shaderProgram_; }
+  unsigned int getProgramId() {
+    finishLink();
+    return shaderProgram_;
+  }
+  // Returns whether the program is built, so that using the shader won't
+  // block. Only shaders built in a DeferredLinkScope or ShaderBatch may not be.
+  bool isReady() const {
+    return !pendingCompiler_ || pendingCompiler_->isShaderProgramReady();
+  }
 
+  // Returns the files that the program was built from, including every
+  // include. Finishes the program if it's deferred.
+  std::vector<std::string> getSourceFiles();
+  // Rebuilds the program from its sources, e.g. after their files changed.
+  // Uniform sources are kept, and the values of uniforms that the old and new
+  // programs share are carried over, so that uniforms that are only set once
+  // don't have to be set again. Throws if the new program fails to build, in
+  // which case the shader keeps its current program.
+  void reload();
+
+  // Binds the shader's program for drawing. Uniforms are set directly on the
+  // program, so don't need the shader to be active.
   virtual void activate();
+  // Ends drawing with the shader. The program is left bound, since GlState
+  // skips binding it again.
   virtual void deactivate();
 
   void addUniformSource(std::shared_ptr<UniformSource> source);
+  // Updates uniforms from all uniform sources. Also refreshes the culling
+  // frustum and resets the culling stats, so should be called once per pass.
   void updateUniforms();
 
+  // Sets the source of the frustum that renderables drawn with this shader
+  // are culled against. Usually the same camera that provides the shader's
+  // view and projection.
+  void setFrustumSource(std::shared_ptr<FrustumSource> source) {
+    frustumSource_ = std::move(source);
+  }
+  // Returns the frustum to cull against, as of the last updateUniforms(), or
+  // nullptr if the shader has no frustum source.
+  const Frustum* getCullingFrustum() const {
+    return cullingFrustum_ ? &*cullingFrustum_ : nullptr;
+  }
+  // Returns the culling results since the last updateUniforms().
+  const CullingStats& getCullingStats() const { return cullingStats_; }
+  CullingStats& getCullingStats() { return cullingStats_; }
+
   // Functions for uniforms.
 
   virtual void setBool(const char* name, bool value);
@@ -65,17 +146,76 @@ class Shader {
   void setVec3(std::string name, float v0, float v1, float v2) {
     setVec3(name.c_str(), v0, v1, v2);
   }
+  virtual void setUVec3(const char* name, const glm::uvec3& vector);
+  void setUVec3(std::string name, const glm::uvec3& vector) {
+    setUVec3(name.c_str(), vector);
+  }
   virtual void setMat4(const char* name, const glm::mat4& matrix);
   void setMat4(std::string name, const glm::mat4& matrix) {
     setMat4(name.c_str(), matrix);
   }
 
+  // Functions for pre-resolved uniforms.
+
+  virtual void setBool(const UniformName& uniform, bool value);
+  virtual void setUInt(const UniformName& uniform, unsigned int value);
+  virtual void setInt(const UniformName& uniform, int value);
+  virtual void setFloat(const UniformName& uniform, float value);
+  virtual void setVec3(const UniformName& uniform, const glm::vec3& vector);
+  virtual void setUVec3(const UniformName& uniform, const glm::uvec3& vector);
+  virtual void setMat4(const UniformName& uniform, const glm::mat4& matrix);
+  // Sets consecutive elements of an array, starting at the given one. Does
+  // nothing if there are no elements.
+  virtual void setVec3Array(const UniformName& uniform,
+                            std::span<const glm::vec3> vectors);
+
+  // Returns whether the uniform is active in the linked program.
+  bool hasUniform(std::string_view name) {
+    finishLink();
+    return uniformLocations_.find(name) != uniformLocations_.end();
+  }
+
  protected:
   Shader() = default;
+  // Links the program from the compiler's loaded shaders, unless links are
+  // deferred or batched, in which case it's finished later.
+  void linkProgram(std::shared_ptr<ShaderCompiler> compiler);
+  // Finishes a deferred link. Called before anything that needs the linked
+  // program.
+  void finishLink() {
+    if (pendingCompiler_) [[unlikely]] finishPendingLink();
+  }
+  void finishPendingLink();
   int safeGetUniformLocation(const char* name);
-
-  unsigned int shaderProgram_;
+  int getUniformLocation(const UniformName& uniform);
+  // Queries the active uniforms of the linked program. Must be called after
+  // each link.
+  void loadUniformLocations();
+
+  // Hashes strings and string_views alike, so lookups don't allocate.
+  struct UniformNameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>()(name);
+    }
+  };
+
+  unsigned int shaderProgram_ = 0;
+  // The compiler that built the program, kept so that it can be reloaded.
+  std::shared_ptr<ShaderCompiler> compiler_;
+  // The compiler of a program that's deferred or batched, but not yet
+  // finished.
+  std::shared_ptr<ShaderCompiler> pendingCompiler_;
+  // The locations of every active uniform, by name. Array elements are
+  // included both with and without an index.
+  std::unordered_map<std::string, int, UniformNameHash, std::equal_to<>>
+      uniformLocations_;
+  // The locations of UniformNames, by their ID, as they're resolved.
+  std::vector<int> resolvedLocations_;
   std::vector<std::shared_ptr<UniformSource>> uniformSources_;
+  std::shared_ptr<FrustumSource> frustumSource_;
+  std::optional<Frustum> cullingFrustum_;
+  CullingStats cullingStats_;
 };
 
 class ComputeShader : public Shader {
@@ -87,6 +227,9 @@ class ComputeShader : public Shader {
   // texture. Assumes that the texture has already been bound to the correct
   // texture unit.
   void dispatchToTexture(Texture& texture);
+  // Dispatches the given number of work groups. The caller must issue a memory
+  // barrier for whatever the shader writes before it's read.
+  void dispatch(unsigned int x, unsigned int y = 1, unsigned int z = 1);
 };
 
 }  // namespace qrk
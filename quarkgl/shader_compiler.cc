@@ -1,6 +1,9 @@
 #include <qrk/shader_compiler.h>
 #include <qrk/shader_loader.h>
 
+#include <algorithm>
+#include <optional>
+
 namespace qrk {
 namespace {
 inline const char* shaderTypeToString(ShaderType type) {
@@ -32,69 +35,322 @@ inline const GLenum shaderTypeToGlShaderType(ShaderType type) {
   throw QuarkException("ERROR::SHADER::INVALID_SHADER_TYPE\n" +
                        std::to_string(static_cast<int>(type)));
 }
-}  // namespace
 
-unsigned int ShaderCompiler::loadAndCompileShader(
-    const ShaderSource& shaderSource, const ShaderType type) {
+std::shared_ptr<ProgramCache>& getProgramCacheRef() {
+  static std::shared_ptr<ProgramCache> cache = std::make_shared<ProgramCache>();
+  return cache;
+}
+
+ShaderCompilerStats& getStatsRef() {
+  static ShaderCompilerStats stats;
+  return stats;
+}
+
+bool isProgramBinarySupported() {
+  static const bool supported = []() {
+    int numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+  }();
+  return supported;
+}
+
+// Identifies the driver, since program binaries can only be loaded by the
+// driver that produced them.
+const std::string& getDriverString() {
+  static const std::string driver = []() {
+    std::string result;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      const GLubyte* value = glGetString(name);
+      if (value) result += reinterpret_cast<const char*>(value);
+      result += '\n';
+    }
+    return result;
+  }();
+  return driver;
+}
+
+double getMillisSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+ShaderStageSource preprocessShader(const ShaderSource& shaderSource,
+                                   const ShaderType type) {
   ShaderLoader shaderLoader(&shaderSource, type);
-  std::string shaderString = shaderLoader.load();
-  const char* resolvedSource = shaderString.c_str();
-  unsigned int shaderId = compileShader(resolvedSource, type);
-  shaders_.push_back(shaderId);
-  return shaderId;
+  std::string source = shaderLoader.load();
+  return {type, std::move(source), shaderLoader.getSourceFiles()};
+}
+
+ShaderStageSource preprocessShader(const std::string& value, bool isPath,
+                                   const ShaderDefines& defines,
+                                   const ShaderType type) {
+  if (isPath) return preprocessShader(ShaderPath(value.c_str(), defines), type);
+  return preprocessShader(ShaderInline(value.c_str(), defines), type);
+}
+
+thread_local ShaderBatch* currentBatch = nullptr;
+}  // namespace
+
+ShaderBatch::ShaderBatch(ThreadPool& pool)
+    : pool_(pool), previous_(currentBatch) {
+  currentBatch = this;
+}
+
+ShaderBatch::~ShaderBatch() { currentBatch = previous_; }
+
+ShaderBatch* ShaderBatch::current() { return currentBatch; }
+
+void ShaderBatch::finish() {
+  // Queue up work for every program before blocking on any of them.
+  for (auto& compiler : compilers_) {
+    compiler->submitShaderProgram();
+  }
+  for (auto& compiler : compilers_) {
+    compiler->finishShaderProgram();
+  }
+  compilers_.clear();
+}
+
+void ShaderCompiler::loadShader(const ShaderSource& shaderSource,
+                                const ShaderType type) {
+  // The source may not outlive this call, so keep a copy.
+  loadShader(LoadedShader{shaderSource.value, shaderSource.isPath(),
+                          shaderSource.defines, type});
+}
+
+void ShaderCompiler::loadShader(LoadedShader shader) {
+  if (loadedShaders_.empty()) {
+    start_ = std::chrono::steady_clock::now();
+  }
+  loadedShaders_.push_back(shader);
+  if (ShaderBatch* batch = ShaderBatch::current()) {
+    pendingStages_.push_back(
+        batch->getThreadPool().submit([shader = std::move(shader)]() {
+          return preprocessShader(shader.value, shader.isPath, shader.defines,
+                                  shader.type);
+        }));
+    return;
+  }
+  stages_.push_back(preprocessShader(shader.value, shader.isPath,
+                                     shader.defines, shader.type));
+}
+
+std::shared_ptr<ShaderCompiler> ShaderCompiler::recreate() const {
+  auto compiler = std::make_shared<ShaderCompiler>();
+  for (const LoadedShader& shader : loadedShaders_) {
+    compiler->loadShader(shader);
+  }
+  return compiler;
+}
+
+void ShaderCompiler::setProgramCache(std::shared_ptr<ProgramCache> cache) {
+  getProgramCacheRef() = std::move(cache);
+}
+
+const ShaderCompilerStats& ShaderCompiler::getStats() { return getStatsRef(); }
+
+bool ShaderCompiler::isParallelCompileSupported() {
+  static const bool supported = []() {
+    if (!GLAD_GL_KHR_parallel_shader_compile) return false;
+    // Let the driver choose how many threads to use.
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    return true;
+  }();
+  return supported;
 }
 
 unsigned int ShaderCompiler::linkShaderProgram() {
-  int success;
-  char infoLog[512];
+  return finishShaderProgram();
+}
+
+unsigned int ShaderCompiler::submitShaderProgram() {
+  if (submitted_) return program_;
+  submitted_ = true;
+  for (auto& pendingStage : pendingStages_) {
+    stages_.push_back(pendingStage.get());
+  }
+  pendingStages_.clear();
+  for (const ShaderStageSource& stage : stages_) {
+    for (const std::string& file : stage.sourceFiles) {
+      // Inline sources aren't files, but may include some.
+      if (file == "<inline>") continue;
+      if (std::find(sourceFiles_.begin(), sourceFiles_.end(), file) ==
+          sourceFiles_.end()) {
+        sourceFiles_.push_back(file);
+      }
+    }
+  }
+
+  // Make sure the driver's threads are enabled before the first compile.
+  isParallelCompileSupported();
+
+  cache_ = isProgramBinarySupported() ? getProgramCacheRef() : nullptr;
+  if (cache_) {
+    key_ = computeProgramCacheKey(getDriverString(), stages_);
+    loadedFromCache_ = submitCachedProgram();
+  }
+  if (!loadedFromCache_) {
+    submitCompileAndLink(/*retrievable=*/cache_ != nullptr);
+  }
+  return program_;
+}
+
+bool ShaderCompiler::isShaderProgramReady() const {
+  if (!submitted_) return false;
+  if (finished_ || !isParallelCompileSupported()) return true;
+  int done = GL_TRUE;
+  glGetProgramiv(program_, GL_COMPLETION_STATUS_KHR, &done);
+  return done;
+}
+
+unsigned int ShaderCompiler::finishShaderProgram() {
+  if (finished_) return program_;
+  submitShaderProgram();
+
+  ShaderCompilerStats& stats = getStatsRef();
+  if (loadedFromCache_ && finishCachedProgram()) {
+    stats.programsLoaded++;
+    stats.loadMillis += getMillisSince(start_);
+  } else {
+    if (loadedFromCache_) {
+      // Too late to build in the background; compile the program now.
+      loadedFromCache_ = false;
+      submitCompileAndLink(/*retrievable=*/true);
+    }
+    finishCompileAndLink();
+    if (cache_) storeCachedProgram();
+    stats.programsCompiled++;
+    stats.compileMillis += getMillisSince(start_);
+  }
+  stages_.clear();
+  finished_ = true;
+  return program_;
+}
+
+void ShaderCompiler::submitCompileAndLink(bool retrievable) {
+  shaders_.clear();
+  for (const ShaderStageSource& stage : stages_) {
+    shaders_.push_back(compileShader(stage));
+  }
 
   // Create and link shader program.
-  unsigned int shaderProgram = glCreateProgram();
+  program_ = glCreateProgram();
+  if (retrievable) {
+    glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
 
-  // Add the compiled shaders into the program.
+  // Add the compiled shaders into the program. Linking fails if any of them
+  // failed to compile, which is checked once the program is finished.
   for (unsigned int shaderId : shaders_) {
-    glAttachShader(shaderProgram, shaderId);
+    glAttachShader(program_, shaderId);
   }
-  glLinkProgram(shaderProgram);
+  glLinkProgram(program_);
+}
+
+void ShaderCompiler::finishCompileAndLink() {
+  int success;
+  char infoLog[512];
 
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+  glGetProgramiv(program_, GL_LINK_STATUS, &success);
   if (!success) {
-    glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
-    throw ShaderCompilerException("ERROR::SHADER_COMPILER::LINKING_FAILED\n" +
-                                  std::string(infoLog));
+    // Report the first stage that failed to compile, if any, since that's
+    // what failed the link.
+    std::string error;
+    for (size_t i = 0; i < shaders_.size() && error.empty(); i++) {
+      error = getShaderError(shaders_[i], stages_[i]);
+    }
+    if (error.empty()) {
+      glGetProgramInfoLog(program_, 512, nullptr, infoLog);
+      error = "ERROR::SHADER_COMPILER::LINKING_FAILED\n" + std::string(infoLog);
+    }
+    // Clean up, since a failed build may be retried, e.g. by a shader reload.
+    deleteShaders();
+    glDeleteProgram(program_);
+    program_ = 0;
+    throw ShaderCompilerException(error);
   }
 
   // Delete shaders now that they're linked.
+  deleteShaders();
+}
+
+void ShaderCompiler::deleteShaders() {
   for (unsigned int shaderId : shaders_) {
     glDeleteShader(shaderId);
   }
   shaders_.clear();
-  return shaderProgram;
 }
 
-unsigned int ShaderCompiler::compileShader(const char* shaderSource,
-                                           const ShaderType type) {
-  unsigned int shader;
+bool ShaderCompiler::submitCachedProgram() {
+  std::optional<ProgramBinary> binary = cache_->load(*key_);
+  if (!binary) return false;
+
+  program_ = glCreateProgram();
+  glProgramBinary(program_, binary->format, binary->data.data(),
+                  binary->data.size());
+  return true;
+}
+
+bool ShaderCompiler::finishCachedProgram() {
   int success;
-  char infoLog[512];
+  glGetProgramiv(program_, GL_LINK_STATUS, &success);
+  if (!success) {
+    // The driver no longer accepts the binary's format, e.g. after an update.
+    glDeleteProgram(program_);
+    program_ = 0;
+    getStatsRef().binariesRejected++;
+    return false;
+  }
+  return true;
+}
+
+void ShaderCompiler::storeCachedProgram() {
+  int length = 0;
+  glGetProgramiv(program_, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) return;
 
-  // Compile shader.
-  GLenum glShaderType = shaderTypeToGlShaderType(type);
-  shader = glCreateShader(glShaderType);
+  ProgramBinary binary;
+  binary.data.resize(length);
+  GLenum format;
+  glGetProgramBinary(program_, length, &length, &format, binary.data.data());
+  binary.data.resize(length);
+  binary.format = format;
+  // Failing to store only costs a compile on the next run.
+  cache_->store(*key_, binary);
+}
+
+unsigned int ShaderCompiler::compileShader(const ShaderStageSource& stage) {
+  GLenum glShaderType = shaderTypeToGlShaderType(stage.type);
+  unsigned int shader = glCreateShader(glShaderType);
 
+  const char* shaderSource = stage.source.c_str();
   glShaderSource(shader, 1, &shaderSource, nullptr);
   glCompileShader(shader);
+  return shader;
+}
+
+std::string ShaderCompiler::getShaderError(unsigned int shader,
+                                           const ShaderStageSource& stage) {
+  int success;
+  char infoLog[512];
 
   glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-    std::string typeString(shaderTypeToString(type));
-    throw ShaderCompilerException(
-        "ERROR::SHADER_COMPILER::" + typeString + "::COMPILATION_FAILED\n" +
-        std::string(infoLog) + "\n\nShader source:\n" +
-        std::string(shaderSource));
+  if (success) return "";
+
+  glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+  std::string typeString(shaderTypeToString(stage.type));
+  // Drivers identify files in errors by their source string number, so list
+  // the file that each number refers to.
+  std::string sourceFiles;
+  for (size_t i = 0; i < stage.sourceFiles.size(); i++) {
+    sourceFiles +=
+        "  " + std::to_string(i) + ": " + stage.sourceFiles[i] + "\n";
   }
-  return shader;
+  return "ERROR::SHADER_COMPILER::" + typeString + "::COMPILATION_FAILED\n" +
+         std::string(infoLog) + "\n\nSource files:\n" + sourceFiles +
+         "\nShader source:\n" + stage.source;
 }
 
 }  // namespace qrk
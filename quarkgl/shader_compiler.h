@@ -2,8 +2,14 @@
 #define QUARKGL_SHADER_COMPILER_H_
 
 #include <qrk/exceptions.h>
+#include <qrk/program_cache.h>
 #include <qrk/shader_defs.h>
+#include <qrk/thread_pool.h>
 
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -13,20 +19,137 @@ class ShaderCompilerException : public QuarkException {
   using QuarkException::QuarkException;
 };
 
+// Counts and timings of the programs built by all ShaderCompilers.
+struct ShaderCompilerStats {
+  unsigned int programsCompiled = 0;
+  unsigned int programsLoaded = 0;
+  // Binaries that were found in the cache, but rejected by the driver.
+  unsigned int binariesRejected = 0;
+  // Both include preprocessing the shader sources, and compiling also includes
+  // storing the binary in the cache.
+  double compileMillis = 0.0;
+  double loadMillis = 0.0;
+};
+
 class ShaderCompiler {
  public:
-  // Loads and compiles a shader, returning the shader ID. Note that the shader
-  // is deleted after linking.
-  unsigned int loadAndCompileShader(const ShaderSource& shaderSource,
-                                    const ShaderType type);
+  // Loads and preprocesses a shader stage. Compilation is deferred until the
+  // program is linked, so that it can be skipped if the program is cached.
+  // While a ShaderBatch is active, preprocessing runs on its thread pool.
+  void loadShader(const ShaderSource& shaderSource, const ShaderType type);
 
-  // Links all compiled shaders into a shader program, and deletes the shaders.
+  // Compiles and links all loaded shaders into a shader program, or loads the
+  // program from the program cache if it was linked before.
   unsigned int linkShaderProgram();
 
+  // Splits linkShaderProgram() in two, so that the driver can build the
+  // program in the background in between. Submits the loaded shaders to be
+  // compiled and linked, or the cached binary to be loaded, and returns the
+  // program without waiting for the result. Does nothing if already submitted.
+  unsigned int submitShaderProgram();
+  // Returns whether the submitted program is built, so that finishing it won't
+  // block. Always true once submitted without KHR_parallel_shader_compile.
+  bool isShaderProgramReady() const;
+  // Submits the program if needed, waits for it, checks it for errors, and
+  // returns it. This is a different program than was submitted if the driver
+  // rejected the cached binary, in which case it's compiled after all. Does
+  // nothing if already finished.
+  unsigned int finishShaderProgram();
+
+  // Returns the files that the finished program was built from, including
+  // every include, without duplicates.
+  const std::vector<std::string>& getSourceFiles() const {
+    return sourceFiles_;
+  }
+  // Returns a new compiler that loads the same shaders again, so that changes
+  // to their files are picked up.
+  std::shared_ptr<ShaderCompiler> recreate() const;
+
+  // Sets the cache that programs are loaded from and stored in, which is shared
+  // by all compilers. Caching is disabled if null. Defaults to a cache in the
+  // default directory.
+  static void setProgramCache(std::shared_ptr<ProgramCache> cache);
+  static const ShaderCompilerStats& getStats();
+  // Whether the driver can build programs on its own threads, via
+  // KHR_parallel_shader_compile.
+  static bool isParallelCompileSupported();
+
  private:
-  unsigned int compileShader(const char* shaderSource, const ShaderType type);
+  // A loadShader() call, kept so that the compiler can be recreated.
+  struct LoadedShader {
+    std::string value;
+    bool isPath;
+    ShaderDefines defines;
+    ShaderType type;
+  };
+
+  void loadShader(LoadedShader shader);
+  unsigned int compileShader(const ShaderStageSource& stage);
+  // Returns the error that the shader failed to compile with, or an empty
+  // string if it compiled.
+  std::string getShaderError(unsigned int shader,
+                             const ShaderStageSource& stage);
+  void submitCompileAndLink(bool retrievable);
+  void finishCompileAndLink();
+  void deleteShaders();
+  // Returns whether the cached binary was found, and submits it if so.
+  bool submitCachedProgram();
+  // Returns whether the driver accepted the cached binary.
+  bool finishCachedProgram();
+  void storeCachedProgram();
 
+  std::vector<LoadedShader> loadedShaders_;
+  std::vector<ShaderStageSource> stages_;
+  // Stages that are still being preprocessed by a batch's thread pool.
+  std::vector<std::future<ShaderStageSource>> pendingStages_;
+  // When the first stage started loading.
+  std::chrono::steady_clock::time_point start_;
+
+  // The state of the submitted program.
+  bool submitted_ = false;
+  bool finished_ = false;
+  unsigned int program_ = 0;
   std::vector<unsigned int> shaders_;
+  std::shared_ptr<ProgramCache> cache_;
+  std::optional<ProgramCacheKey> key_;
+  bool loadedFromCache_ = false;
+  std::vector<std::string> sourceFiles_;
+};
+
+// Builds the shader programs that are created on the current thread while it's
+// alive together, so that their work overlaps. Sources are preprocessed on a
+// thread pool, and finish() submits every program to the driver before
+// waiting on any of them, since checking a program's status blocks until it's
+// built.
+//
+// Shaders created during the batch only finish once finish() is called, or on
+// their first use, whichever comes first. Batches can be nested, in which case
+// the innermost one is active.
+class ShaderBatch {
+ public:
+  explicit ShaderBatch(ThreadPool& pool);
+  ~ShaderBatch();
+
+  ShaderBatch(const ShaderBatch&) = delete;
+  ShaderBatch& operator=(const ShaderBatch&) = delete;
+
+  // Adds a compiler whose program should be built with the batch.
+  void add(std::shared_ptr<ShaderCompiler> compiler) {
+    compilers_.push_back(std::move(compiler));
+  }
+  // Submits all programs added so far, then finishes each of them. Throws on
+  // the first program that fails to build.
+  void finish();
+
+  ThreadPool& getThreadPool() { return pool_; }
+
+  // Returns the active batch on the current thread, or null if there is none.
+  static ShaderBatch* current();
+
+ private:
+  ThreadPool& pool_;
+  ShaderBatch* previous_;
+  std::vector<std::shared_ptr<ShaderCompiler>> compilers_;
 };
 
 }  // namespace qrk
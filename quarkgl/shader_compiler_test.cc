@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <qrk/shader_compiler.h>
+#include <qrk/thread_pool.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The GL calls that reach the driver, recorded in place of a real context.
+std::vector<std::string> calls;
+// Whether compiles and links succeed.
+int buildStatus = GL_TRUE;
+unsigned int nextId = 1;
+
+GLuint APIENTRY fakeCreateShader(GLenum type) { return nextId++; }
+void APIENTRY fakeShaderSource(GLuint shader, GLsizei count,
+                               const GLchar* const* source,
+                               const GLint* length) {}
+void APIENTRY fakeCompileShader(GLuint shader) {
+  calls.push_back("compile " + std::to_string(shader));
+}
+void APIENTRY fakeGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+  calls.push_back("checkShader " + std::to_string(shader));
+  *params = buildStatus;
+}
+void APIENTRY fakeGetShaderInfoLog(GLuint shader, GLsizei bufSize,
+                                   GLsizei* length, GLchar* infoLog) {
+  std::strncpy(infoLog, "0(2) : error", bufSize);
+}
+void APIENTRY fakeDeleteShader(GLuint shader) {}
+GLuint APIENTRY fakeCreateProgram() { return nextId++; }
+void APIENTRY fakeAttachShader(GLuint program, GLuint shader) {}
+void APIENTRY fakeLinkProgram(GLuint program) {
+  calls.push_back("link " + std::to_string(program));
+}
+void APIENTRY fakeGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+  calls.push_back("checkProgram " + std::to_string(program));
+  *params = buildStatus;
+}
+void APIENTRY fakeGetProgramInfoLog(GLuint program, GLsizei bufSize,
+                                    GLsizei* length, GLchar* infoLog) {
+  std::strncpy(infoLog, "link error", bufSize);
+}
+void APIENTRY fakeDeleteProgram(GLuint program) {
+  calls.push_back("deleteProgram " + std::to_string(program));
+}
+void APIENTRY fakeGetIntegerv(GLenum pname, GLint* data) {
+  // Report no program binary formats, which disables the program cache.
+  *data = 0;
+}
+
+constexpr char VERTEX_SOURCE[] = "#version 460 core\nvoid main() {}\n";
+constexpr char FRAGMENT_SOURCE[] = "#version 460 core\nvoid main() {}\n";
+
+class ShaderCompilerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    glad_glCreateShader = fakeCreateShader;
+    glad_glShaderSource = fakeShaderSource;
+    glad_glCompileShader = fakeCompileShader;
+    glad_glGetShaderiv = fakeGetShaderiv;
+    glad_glGetShaderInfoLog = fakeGetShaderInfoLog;
+    glad_glDeleteShader = fakeDeleteShader;
+    glad_glCreateProgram = fakeCreateProgram;
+    glad_glAttachShader = fakeAttachShader;
+    glad_glLinkProgram = fakeLinkProgram;
+    glad_glGetProgramiv = fakeGetProgramiv;
+    glad_glGetProgramInfoLog = fakeGetProgramInfoLog;
+    glad_glDeleteProgram = fakeDeleteProgram;
+    glad_glGetIntegerv = fakeGetIntegerv;
+    calls.clear();
+    buildStatus = GL_TRUE;
+    nextId = 1;
+  }
+
+  std::shared_ptr<qrk::ShaderCompiler> loadProgram() {
+    auto compiler = std::make_shared<qrk::ShaderCompiler>();
+    compiler->loadShader(qrk::ShaderInline(VERTEX_SOURCE),
+                         qrk::ShaderType::VERTEX);
+    compiler->loadShader(qrk::ShaderInline(FRAGMENT_SOURCE),
+                         qrk::ShaderType::FRAGMENT);
+    return compiler;
+  }
+};
+
+TEST_F(ShaderCompilerTest, LinksProgram) {
+  EXPECT_EQ(loadProgram()->linkShaderProgram(), 3);
+  EXPECT_EQ(calls, (std::vector<std::string>{"compile 1", "compile 2",
+                                             "link 3", "checkProgram 3"}));
+}
+
+TEST_F(ShaderCompilerTest, BatchSubmitsEveryProgramBeforeCheckingAny) {
+  qrk::ThreadPool pool(2);
+  qrk::ShaderBatch batch(pool);
+  EXPECT_EQ(qrk::ShaderBatch::current(), &batch);
+  auto first = loadProgram();
+  auto second = loadProgram();
+  batch.add(first);
+  batch.add(second);
+  // Nothing reaches the driver until the batch finishes.
+  EXPECT_TRUE(calls.empty());
+
+  batch.finish();
+  EXPECT_EQ(calls, (std::vector<std::string>{
+                       "compile 1", "compile 2", "link 3", "compile 4",
+                       "compile 5", "link 6", "checkProgram 3",
+                       "checkProgram 6"}));
+
+  // Finishing again is a no-op.
+  calls.clear();
+  EXPECT_EQ(first->finishShaderProgram(), 3);
+  EXPECT_TRUE(calls.empty());
+}
+
+TEST_F(ShaderCompilerTest, BatchesNest) {
+  qrk::ThreadPool pool(1);
+  qrk::ShaderBatch outer(pool);
+  {
+    qrk::ShaderBatch inner(pool);
+    EXPECT_EQ(qrk::ShaderBatch::current(), &inner);
+  }
+  EXPECT_EQ(qrk::ShaderBatch::current(), &outer);
+}
+
+TEST_F(ShaderCompilerTest, ReportsFailedStageWithSourceFiles) {
+  buildStatus = GL_FALSE;
+  try {
+    loadProgram()->linkShaderProgram();
+    FAIL() << "Expected a ShaderCompilerException";
+  } catch (const qrk::ShaderCompilerException& e) {
+    std::string message = e.what();
+    EXPECT_NE(message.find("VERTEX::COMPILATION_FAILED"), std::string::npos);
+    EXPECT_NE(message.find("0(2) : error"), std::string::npos);
+    EXPECT_NE(message.find("0: <inline>"), std::string::npos);
+  }
+  // The failed program is cleaned up, so that it can be retried.
+  EXPECT_EQ(calls.back(), "deleteProgram 3");
+}
+
+}  // namespace
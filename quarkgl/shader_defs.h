@@ -1,6 +1,10 @@
 #ifndef QUARKGL_SHADER_DEFS_H_
 #define QUARKGL_SHADER_DEFS_H_
 
+#include <map>
+#include <string>
+#include <utility>
+
 namespace qrk {
 
 enum class ShaderType {
@@ -10,9 +14,51 @@ enum class ShaderType {
   COMPUTE,
 };
 
+// A set of #defines to build a shader with, e.g. to select a variant of it.
+// Defines are ordered by name, so that equal sets produce the same source.
+class ShaderDefines {
+ public:
+  // Defines a flag, for use with #ifdef.
+  ShaderDefines& define(const std::string& name) { return define(name, ""); }
+  ShaderDefines& define(const std::string& name, const std::string& value) {
+    defines_[name] = value;
+    return *this;
+  }
+  ShaderDefines& define(const std::string& name, int value) {
+    return define(name, std::to_string(value));
+  }
+  // Defines a flag only if it's enabled.
+  ShaderDefines& defineIf(const std::string& name, bool enabled) {
+    return enabled ? define(name) : *this;
+  }
+
+  bool empty() const { return defines_.empty(); }
+  const std::map<std::string, std::string>& get() const { return defines_; }
+
+  // Returns the defines as #define directives, one per line. Also serves as a
+  // key that identifies the set.
+  std::string toSource() const {
+    std::string source;
+    for (const auto& [name, value] : defines_) {
+      source += "#define " + name;
+      if (!value.empty()) source += " " + value;
+      source += "\n";
+    }
+    return source;
+  }
+
+  bool operator==(const ShaderDefines& other) const = default;
+
+ private:
+  std::map<std::string, std::string> defines_;
+};
+
 struct ShaderSource {
-  inline explicit ShaderSource(const char* value) : value(value) {}
+  inline explicit ShaderSource(const char* value, ShaderDefines defines = {})
+      : value(value), defines(std::move(defines)) {}
   const char* value;
+  // Inserted after the #version directive of the shader.
+  ShaderDefines defines;
   virtual bool isPath() const = 0;
 };
 
@@ -3,12 +3,40 @@
 #include <qrk/shader_loader.h>
 #include <qrk/utils.h>
 
+#include <cctype>
+#include <filesystem>
 #include <fstream>
-#include <regex>
+#include <mutex>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
 
 namespace qrk {
 
+// A shader file, split at its include directives, which are dropped. The text
+// between includes is kept as-is, including any `#pragma once`.
+struct ShaderLoader::ScannedFile {
+  struct Include {
+    // The range of code that precedes the directive, since the previous one.
+    size_t textBegin;
+    size_t textEnd;
+    // The path as written, without its delimiters.
+    std::string path;
+    // Whether the path is relative to quarkgl/shaders, rather than the file.
+    bool isQrkInclude;
+    // The line number that follows the directive.
+    int nextLine;
+  };
+
+  std::string code;
+  bool once = false;
+  std::vector<Include> includes;
+  // Where the code after the last include begins.
+  size_t tailBegin = 0;
+};
+
+namespace {
+
 std::string readFile(std::string const& path) {
   std::ifstream file;
   file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
@@ -19,6 +47,141 @@ std::string readFile(std::string const& path) {
   return buffer.str();
 }
 
+bool isSpace(char c) { return std::isspace(static_cast<unsigned char>(c)); }
+
+std::string_view trimView(std::string_view s) {
+  while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+  while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+  return s;
+}
+
+// Removes a word from the start of `s`, if it's followed by whitespace or the
+// end of the line.
+bool consumeWord(std::string_view& s, std::string_view word) {
+  if (!s.starts_with(word)) return false;
+  if (s.size() > word.size() && !isSpace(s[word.size()])) return false;
+  s.remove_prefix(word.size());
+  return true;
+}
+
+enum class Directive {
+  NONE,
+  ONCE,
+  INCLUDE,
+};
+
+// Parses a line for one of our directives. For includes, also returns the
+// path and its delimiter.
+Directive parseDirective(std::string_view line, std::string_view* path,
+                         char* delimiter) {
+  line = trimView(line);
+  if (!line.starts_with('#')) return Directive::NONE;
+  line = trimView(line.substr(1));
+  if (!consumeWord(line, "pragma")) return Directive::NONE;
+  line = trimView(line);
+
+  if (line == "once") return Directive::ONCE;
+  if (!consumeWord(line, "qrk_include")) return Directive::NONE;
+  line = trimView(line);
+  if (line.size() < 2 ||
+      !((line.front() == '"' && line.back() == '"') ||
+        (line.front() == '<' && line.back() == '>'))) {
+    return Directive::NONE;
+  }
+  *delimiter = line.front();
+  *path = trimView(line.substr(1, line.size() - 2));
+  return Directive::INCLUDE;
+}
+
+// Returns whether the line is a #version directive.
+bool isVersionDirective(std::string_view line) {
+  line = trimView(line);
+  if (!line.starts_with('#')) return false;
+  line = trimView(line.substr(1));
+  return consumeWord(line, "version");
+}
+
+// Inserts the defines after the #version directive, which may only follow
+// blank lines and comments, and restores the line numbering that follows it.
+void insertDefines(std::string& code, const ShaderDefines& defines) {
+  size_t insertAt = 0;
+  int nextLine = 1;
+  int lineNumber = 1;
+  for (size_t lineBegin = 0; lineBegin < code.size(); lineNumber++) {
+    size_t lineEnd = code.find('\n', lineBegin);
+    if (lineEnd == std::string::npos) lineEnd = code.size();
+    std::string_view line(code.data() + lineBegin, lineEnd - lineBegin);
+    if (isVersionDirective(line)) {
+      if (lineEnd == code.size()) code += '\n';
+      insertAt = lineEnd + 1;
+      nextLine = lineNumber + 1;
+      break;
+    }
+    line = trimView(line);
+    if (!line.empty() && !line.starts_with("//")) break;
+    lineBegin = lineEnd + 1;
+  }
+  code.insert(insertAt, defines.toSource() + "#line " +
+                            std::to_string(nextLine) + " 0\n");
+}
+
+// Splits the code at its directives, in a single pass over its lines.
+ShaderLoader::ScannedFile scanShader(std::string code) {
+  ShaderLoader::ScannedFile file;
+  file.code = std::move(code);
+  const std::string& text = file.code;
+
+  size_t textBegin = 0;
+  int lineNumber = 1;
+  for (size_t lineBegin = 0; lineBegin < text.size(); lineNumber++) {
+    size_t lineEnd = text.find('\n', lineBegin);
+    if (lineEnd == std::string::npos) lineEnd = text.size();
+    std::string_view line(text.data() + lineBegin, lineEnd - lineBegin);
+
+    std::string_view path;
+    char delimiter;
+    switch (parseDirective(line, &path, &delimiter)) {
+      case Directive::ONCE:
+        file.once = true;
+        break;
+      case Directive::INCLUDE:
+        file.includes.push_back({
+            .textBegin = textBegin,
+            .textEnd = lineBegin,
+            .path = std::string(path),
+            .isQrkInclude = delimiter == '<',
+            .nextLine = lineNumber + 1,
+        });
+        // Drop the directive, including its newline.
+        textBegin = std::min(lineEnd + 1, text.size());
+        break;
+      case Directive::NONE:
+        break;
+    }
+    lineBegin = lineEnd + 1;
+  }
+  file.tailBegin = textBegin;
+  return file;
+}
+
+// Scanned files, shared by every loader, by resolved path.
+struct ShaderFileCache {
+  struct Entry {
+    std::filesystem::file_time_type modifiedTime;
+    std::shared_ptr<const ShaderLoader::ScannedFile> file;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+};
+
+ShaderFileCache& getShaderFileCache() {
+  static ShaderFileCache cache;
+  return cache;
+}
+
+}  // namespace
+
 void ShaderLoader::checkShaderType(std::string const& shaderPath) {
   // Allow ".glsl" as a generic shader suffix (e.g. for type-agnostic shader
   // code).
@@ -60,12 +223,6 @@ void ShaderLoader::checkShaderType(std::string const& shaderPath) {
   }
 }
 
-bool ShaderLoader::alreadyLoadedOnce(std::string const& shaderPath) {
-  std::string resolvedPath = resolvePath(shaderPath);
-  auto item = onceCache_.find(resolvedPath);
-  return item != onceCache_.end();
-}
-
 std::string ShaderLoader::getIncludesTraceback() {
   std::stringstream buffer;
   for (std::string path : includeChain_) {
@@ -87,13 +244,25 @@ ShaderLoader::ShaderLoader(const ShaderSource* shaderSource,
                            const ShaderType type)
     : shaderSource_(shaderSource), shaderType_(type) {}
 
-std::string ShaderLoader::lookupOrLoad(std::string const& shaderPath) {
-  std::string resolvedPath = resolvePath(shaderPath);
+void ShaderLoader::clearCache() {
+  ShaderFileCache& cache = getShaderFileCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.entries.clear();
+}
 
-  auto item = codeCache_.find(resolvedPath);
-  if (item != codeCache_.end()) {
-    // Cache hit; return code.
-    return item->second;
+std::shared_ptr<const ShaderLoader::ScannedFile> ShaderLoader::lookupOrLoad(
+    std::string const& shaderPath, std::string const& resolvedPath) {
+  ShaderFileCache& cache = getShaderFileCache();
+  std::error_code ec;
+  auto modifiedTime = std::filesystem::last_write_time(resolvedPath, ec);
+  if (!ec) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto item = cache.entries.find(resolvedPath);
+    if (item != cache.entries.end() &&
+        item->second.modifiedTime == modifiedTime) {
+      // Cache hit; the file hasn't changed since it was scanned.
+      return item->second.file;
+    }
   }
 
   // Cache miss; read code from file.
@@ -108,75 +277,94 @@ std::string ShaderLoader::lookupOrLoad(std::string const& shaderPath) {
         std::string(shaderPath) + "', traceback below (most recent last):\n" +
         traceback);
   }
-  // Don't cache the code just yet, because we need to preprocess it.
-  return shaderCode;
+
+  auto file = std::make_shared<const ScannedFile>(scanShader(shaderCode));
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.entries[resolvedPath] = {modifiedTime, file};
+  return file;
 }
 
-std::string ShaderLoader::load(std::string const& shaderPath) {
+void ShaderLoader::load(std::string const& shaderPath, std::string& out) {
   checkShaderType(shaderPath);
 
   // Handle #pragma once.
-  if (alreadyLoadedOnce(shaderPath)) {
-    return "";
-  }
+  std::string resolvedPath = resolvePath(shaderPath);
+  if (onceCache_.contains(resolvedPath)) return;
 
-  auto shaderCode = lookupOrLoad(shaderPath);
-  auto processedCode = preprocessShader(shaderPath, shaderCode);
-  cacheShaderCode(shaderPath, processedCode);
-  return processedCode;
-}
+  if (checkCircularInclude(resolvedPath)) {
+    std::string traceback = getIncludesTraceback();
+    throw ShaderLoaderException(
+        "ERROR::SHADER_LOADER::CIRCULAR_INCLUDE\n"
+        "Shader '" +
+        shaderPath +
+        "' includes itself, traceback below (most recent last):\n" +
+        traceback);
+  }
 
-void ShaderLoader::cacheShaderCode(std::string const& shaderPath,
-                                   std::string const& shaderCode) {
-  std::string resolvedPath = resolvePath(shaderPath);
-  codeCache_[resolvedPath] = shaderCode;
+  std::shared_ptr<const ScannedFile> file =
+      lookupOrLoad(shaderPath, resolvedPath);
+  append(*file, shaderPath, resolvedPath, shaderPath, out);
 }
 
-std::string ShaderLoader::preprocessShader(std::string const& shaderPath,
-                                           std::string const& shaderCode) {
-  std::string resolvedPath = resolvePath(shaderPath);
+void ShaderLoader::append(const ScannedFile& file,
+                          std::string const& shaderPath,
+                          std::string const& resolvedPath,
+                          std::string const& sourceName, std::string& out) {
   includeChain_.push_back(resolvedPath);
+  if (file.once) onceCache_.insert(resolvedPath);
+  const size_t sourceIndex = sourceFiles_.size();
+  sourceFiles_.push_back(sourceName);
 
-  std::regex oncePattern(R"(((^|\r?\n)\s*)#pragma\s+once\s*(?=\r?\n|$))");
-  if (std::regex_search(shaderCode, oncePattern)) {
-    onceCache_.insert(resolvedPath);
-  }
+  for (const ScannedFile::Include& include : file.includes) {
+    out.append(file.code, include.textBegin,
+               include.textEnd - include.textBegin);
+
+    std::string includePath;
+    if (include.isQrkInclude) {
+      includePath = "quarkgl/shaders/" + include.path;
+    } else {
+      // Relative to either the current shader's directory, or the project
+      // root if the current shader is at the root.
+      size_t i = shaderPath.find_last_of("/");
+      std::string directory =
+          i != std::string::npos ? shaderPath.substr(0, i + 1) : "";
+      includePath = directory + include.path;
+    }
 
-  std::regex includePattern(
-      R"(((^|\r?\n)\s*)#pragma\s+qrk_include\s+(".*"|<.*>)(?=\r?\n|$))");
-  std::string processedCode = regexReplace(
-      shaderCode, includePattern, [this, shaderPath](const std::smatch& m) {
-        std::string whitespace = m[1];
-        // Extract the path.
-        std::string incl = m[3];
-        char inclType = incl[0];
-        std::string path = trim(incl.substr(1, incl.size() - 2));
-
-        if (inclType == '<') {
-          // qrk include.
-          return whitespace + load("quarkgl/shaders/" + path);
-        } else {
-          // Standard include.
-          size_t i = shaderPath.find_last_of("/");
-          // This will either be the current shader's directory, or empty
-          // string if the current shader is at project root.
-          std::string prefix =
-              i != std::string::npos ? shaderPath.substr(0, i + 1) : "";
-          return whitespace + load(prefix + path);
-        }
-      });
+    const size_t directiveBegin = out.size();
+    out += "#line 1 " + std::to_string(sourceFiles_.size()) + "\n";
+    const size_t includeBegin = out.size();
+    load(includePath, out);
+    if (out.size() == includeBegin) {
+      // Nothing was included, so keep the line that the directive was on
+      // instead.
+      out.resize(directiveBegin);
+      out += '\n';
+      continue;
+    }
+    if (out.back() != '\n') out += '\n';
+    out += "#line " + std::to_string(include.nextLine) + " " +
+           std::to_string(sourceIndex) + "\n";
+  }
+  out.append(file.code, file.tailBegin);
 
   includeChain_.pop_back();
-  return processedCode;
 }
 
 std::string ShaderLoader::load() {
   // Handle either loading from file, or loading from inline source.
   onceCache_.clear();
+  sourceFiles_.clear();
+  std::string out;
   if (shaderSource_->isPath()) {
-    return load(shaderSource_->value);
+    load(shaderSource_->value, out);
   } else {
-    return preprocessShader(".", shaderSource_->value);
+    append(scanShader(shaderSource_->value), ".", resolvePath("."), "<inline>",
+           out);
+  }
+  if (!shaderSource_->defines.empty()) {
+    insertDefines(out, shaderSource_->defines);
   }
+  return out;
 }
 }  // namespace qrk
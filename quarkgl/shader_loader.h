@@ -4,10 +4,10 @@
 #include <qrk/exceptions.h>
 #include <qrk/shader_defs.h>
 
-#include <deque>
+#include <memory>
 #include <string>
-#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace qrk {
 
@@ -15,28 +15,53 @@ class ShaderLoaderException : public QuarkException {
   using QuarkException::QuarkException;
 };
 
+// Loads a shader and resolves its includes. Two directives are supported, each
+// on its own line:
+//
+//   #pragma once: Skips the file if it has already been included.
+//   #pragma qrk_include "path" or < path>: Includes another file, relative to
+//     the current file ("") or to quarkgl/shaders (<>).
+//
+// Included files are surrounded by #line directives, so that compiler errors
+// report the file (as a source string number) and line that they came from.
 class ShaderLoader {
  public:
   ShaderLoader(const ShaderSource* shaderSource, const ShaderType type);
   std::string load();
 
+  // Returns the files that the last load() combined, indexed by the source
+  // string numbers in its #line directives.
+  const std::vector<std::string>& getSourceFiles() const {
+    return sourceFiles_;
+  }
+
+  // Files are read and scanned for directives once per process, and only read
+  // again once they're modified. This forgets every file, so that the next
+  // loads read them from disk.
+  static void clearCache();
+
+  // A shader file, split at its include directives.
+  struct ScannedFile;
+
  private:
   void checkShaderType(std::string const& shaderPath);
-  bool alreadyLoadedOnce(std::string const& shaderPath);
-  void cacheShaderCode(std::string const& shaderPath,
-                       std::string const& shaderCode);
-  std::string load(std::string const& shaderPath);
-  std::string lookupOrLoad(std::string const& shaderPath);
-  std::string preprocessShader(std::string const& shaderPath,
-                               std::string const& shaderCode);
+  std::shared_ptr<const ScannedFile> lookupOrLoad(
+      std::string const& shaderPath, std::string const& resolvedPath);
+  // Appends the shader at the given path to `out`, unless it's already been
+  // included once.
+  void load(std::string const& shaderPath, std::string& out);
+  // Appends a scanned file to `out`, with its includes resolved.
+  void append(const ScannedFile& file, std::string const& shaderPath,
+              std::string const& resolvedPath, std::string const& sourceName,
+              std::string& out);
   std::string getIncludesTraceback();
   bool checkCircularInclude(std::string const& resolvedPath);
 
   const ShaderSource* shaderSource_;
   const ShaderType shaderType_;
-  std::deque<std::string> includeChain_;
-  std::unordered_map<std::string, std::string> codeCache_;
+  std::vector<std::string> includeChain_;
   std::unordered_set<std::string> onceCache_;
+  std::vector<std::string> sourceFiles_;
 };
 }  // namespace qrk
 
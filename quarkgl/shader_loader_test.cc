@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <qrk/shader_loader.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+class ShaderLoaderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::path(testing::TempDir()) /
+                 testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::filesystem::remove_all(directory_);
+    std::filesystem::create_directories(directory_);
+    qrk::ShaderLoader::clearCache();
+  }
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  std::string writeFile(const std::string& name, const std::string& code) {
+    std::string path = (directory_ / name).string();
+    std::ofstream(path) << code;
+    return path;
+  }
+
+  std::filesystem::path directory_;
+};
+
+TEST_F(ShaderLoaderTest, ResolvesIncludesWithLineDirectives) {
+  writeFile("common.glsl", "float a;\nfloat b;\n");
+  std::string path = writeFile("main.frag",
+                               "#version 460 core\n"
+                               "  #  pragma   qrk_include \"common.glsl\"\n"
+                               "void main() {}\n");
+  qrk::ShaderPath source(path.c_str());
+  qrk::ShaderLoader loader(&source, qrk::ShaderType::FRAGMENT);
+
+  EXPECT_EQ(loader.load(),
+            "#version 460 core\n"
+            "#line 1 1\n"
+            "float a;\n"
+            "float b;\n"
+            "#line 3 0\n"
+            "void main() {}\n");
+  std::vector<std::string> sourceFiles = {
+      path, (directory_ / "common.glsl").string()};
+  EXPECT_EQ(loader.getSourceFiles(), sourceFiles);
+}
+
+TEST_F(ShaderLoaderTest, IncludesOnceFilesOnlyOnce) {
+  writeFile("once.glsl", "#pragma once\nfloat a;");
+  writeFile("twice.glsl", "float b;");
+  std::string path = writeFile("main.vert",
+                               "#pragma qrk_include \"once.glsl\"\n"
+                               "#pragma qrk_include \"once.glsl\"\n"
+                               "#pragma qrk_include \"twice.glsl\"\n"
+                               "#pragma qrk_include \"twice.glsl\"\n");
+  qrk::ShaderPath source(path.c_str());
+  qrk::ShaderLoader loader(&source, qrk::ShaderType::VERTEX);
+
+  // The skipped include keeps its line, so that line numbers stay correct.
+  EXPECT_EQ(loader.load(),
+            "#line 1 1\n"
+            "#pragma once\n"
+            "float a;\n"
+            "#line 2 0\n"
+            "\n"
+            "#line 1 2\n"
+            "float b;\n"
+            "#line 4 0\n"
+            "#line 1 3\n"
+            "float b;\n"
+            "#line 5 0\n");
+}
+
+TEST_F(ShaderLoaderTest, InsertsDefinesAfterVersion) {
+  qrk::ShaderInline source("// Comment.\n#version 460 core\nvoid main() {}\n",
+                           qrk::ShaderDefines().define("B", 2).define("A"));
+  qrk::ShaderLoader loader(&source, qrk::ShaderType::FRAGMENT);
+
+  EXPECT_EQ(loader.load(),
+            "// Comment.\n"
+            "#version 460 core\n"
+            "#define A\n"
+            "#define B 2\n"
+            "#line 3 0\n"
+            "void main() {}\n");
+}
+
+TEST_F(ShaderLoaderTest, RejectsCircularIncludes) {
+  writeFile("a.glsl", "#pragma qrk_include \"b.glsl\"\n");
+  writeFile("b.glsl", "#pragma qrk_include \"a.glsl\"\n");
+  std::string path = writeFile("main.frag", "#pragma qrk_include \"a.glsl\"\n");
+  qrk::ShaderPath source(path.c_str());
+  qrk::ShaderLoader loader(&source, qrk::ShaderType::FRAGMENT);
+
+  EXPECT_THROW(loader.load(), qrk::ShaderLoaderException);
+}
+
+TEST_F(ShaderLoaderTest, ReloadsModifiedFiles) {
+  std::string path = writeFile("main.comp", "int a;\n");
+  qrk::ShaderPath source(path.c_str());
+  qrk::ShaderLoader loader(&source, qrk::ShaderType::COMPUTE);
+  EXPECT_EQ(loader.load(), "int a;\n");
+
+  // Make sure the modification time changes, regardless of its resolution.
+  writeFile("main.comp", "int b;\n");
+  std::filesystem::last_write_time(
+      path, std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+  EXPECT_EQ(loader.load(), "int b;\n");
+}
+
+}  // namespace
@@ -33,6 +33,16 @@ void SkyboxShader::setMat4(const char* name, const glm::mat4& matrix) {
   Shader::setMat4(name, matrix);
 }
 
+void SkyboxShader::setMat4(const UniformName& uniform,
+                           const glm::mat4& matrix) {
+  static const UniformName view("view");
+  if (uniform.getId() == view.getId()) {
+    Shader::setMat4(uniform, glm::mat4(glm::mat3(matrix)));
+    return;
+  }
+  Shader::setMat4(uniform, matrix);
+}
+
 ScreenShader::ScreenShader()
     : Shader(ShaderPath("quarkgl/shaders/builtin/screen_quad.vert"),
              ShaderPath("quarkgl/shaders/builtin/screen_quad.frag")) {}
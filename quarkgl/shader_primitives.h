@@ -17,7 +17,10 @@ class SkyboxShader : public Shader {
   virtual void activate() override;
   virtual void deactivate() override;
 
+  using Shader::setMat4;
   virtual void setMat4(const char* name, const glm::mat4& matrix) override;
+  virtual void setMat4(const UniformName& uniform,
+                       const glm::mat4& matrix) override;
 };
 
 class ScreenShader : public Shader {
@@ -0,0 +1,57 @@
+#include <qrk/shader_variant_cache.h>
+
+namespace qrk {
+
+void ShaderVariantCache::addUniformSource(
+    std::shared_ptr<UniformSource> source) {
+  for (auto& [key, variant] : variants_) {
+    variant->addUniformSource(source);
+  }
+  uniformSources_.push_back(std::move(source));
+}
+
+void ShaderVariantCache::setFrustumSource(
+    std::shared_ptr<FrustumSource> source) {
+  for (auto& [key, variant] : variants_) {
+    variant->setFrustumSource(source);
+  }
+  frustumSource_ = std::move(source);
+}
+
+Shader& ShaderVariantCache::get(const ShaderDefines& defines) {
+  std::string key = defines.toSource();
+  auto it = variants_.find(key);
+  if (it != variants_.end()) return *it->second;
+  return create(key, defines);
+}
+
+void ShaderVariantCache::prefetch(const ShaderDefines& defines) {
+  std::string key = defines.toSource();
+  if (variants_.contains(key)) return;
+  DeferredLinkScope deferLink;
+  create(key, defines);
+}
+
+bool ShaderVariantCache::isReady(const ShaderDefines& defines) const {
+  auto it = variants_.find(defines.toSource());
+  return it != variants_.end() && it->second->isReady();
+}
+
+void ShaderVariantCache::forEachVariant(
+    const std::function<void(Shader&)>& fn) {
+  for (auto& [key, variant] : variants_) {
+    fn(*variant);
+  }
+}
+
+Shader& ShaderVariantCache::create(const std::string& key,
+                                   const ShaderDefines& defines) {
+  std::unique_ptr<Shader> variant = factory_(defines);
+  for (const auto& source : uniformSources_) {
+    variant->addUniformSource(source);
+  }
+  if (frustumSource_) variant->setFrustumSource(frustumSource_);
+  return *variants_.emplace(key, std::move(variant)).first->second;
+}
+
+}  // namespace qrk
@@ -0,0 +1,58 @@
+#ifndef QUARKGL_SHADER_VARIANT_CACHE_H_
+#define QUARKGL_SHADER_VARIANT_CACHE_H_
+
+#include <qrk/bounds.h>
+#include <qrk/shader.h>
+#include <qrk/shader_defs.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace qrk {
+
+// Builds variants of a shader with different sets of #defines, so that
+// features can be compiled in or out rather than branched on at runtime.
+// Variants are built on first use and kept for reuse. Every variant shares the
+// cache's uniform sources and frustum source.
+class ShaderVariantCache {
+ public:
+  // Creates the shader, built with the given defines (usually by passing them
+  // to its ShaderSource).
+  using Factory =
+      std::function<std::unique_ptr<Shader>(const ShaderDefines& defines)>;
+
+  explicit ShaderVariantCache(Factory factory) : factory_(std::move(factory)) {}
+
+  void addUniformSource(std::shared_ptr<UniformSource> source);
+  void setFrustumSource(std::shared_ptr<FrustumSource> source);
+
+  // Returns the variant for the given defines, building it first if needed.
+  Shader& get(const ShaderDefines& defines);
+  // Submits the variant to be built, if it hasn't been already, without
+  // waiting for it. With KHR_parallel_shader_compile, the driver builds it in
+  // the background, so that a later get() doesn't stall.
+  void prefetch(const ShaderDefines& defines);
+  // Returns whether the variant is built and can be used without blocking.
+  bool isReady(const ShaderDefines& defines) const;
+
+  size_t getNumVariants() const { return variants_.size(); }
+  // Calls the function with every variant that's been built so far.
+  void forEachVariant(const std::function<void(Shader&)>& fn);
+
+ private:
+  Shader& create(const std::string& key, const ShaderDefines& defines);
+
+  Factory factory_;
+  // Variants by the source of their defines.
+  std::unordered_map<std::string, std::unique_ptr<Shader>> variants_;
+  std::vector<std::shared_ptr<UniformSource>> uniformSources_;
+  std::shared_ptr<FrustumSource> frustumSource_;
+};
+
+}  // namespace qrk
+
+#endif
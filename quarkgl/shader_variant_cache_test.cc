@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <qrk/shader_variant_cache.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A shader without a program, which records the defines it was built with.
+class FakeShader : public qrk::Shader {
+ public:
+  explicit FakeShader(const qrk::ShaderDefines& defines)
+      : defines(defines.toSource()) {}
+
+  std::string defines;
+};
+
+class CountingUniformSource : public qrk::UniformSource {
+ public:
+  void updateUniforms(qrk::Shader& shader) override { updates++; }
+
+  int updates = 0;
+};
+
+TEST(ShaderVariantCacheTest, BuildsEachVariantOnce) {
+  std::vector<std::string> built;
+  qrk::ShaderVariantCache cache([&](const qrk::ShaderDefines& defines) {
+    built.push_back(defines.toSource());
+    return std::make_unique<FakeShader>(defines);
+  });
+
+  qrk::ShaderDefines shadows = qrk::ShaderDefines().define("SHADOWS");
+  qrk::Shader& variant = cache.get(shadows);
+  EXPECT_EQ(static_cast<FakeShader&>(variant).defines, "#define SHADOWS\n");
+  EXPECT_EQ(&cache.get(qrk::ShaderDefines().define("SHADOWS")), &variant);
+
+  qrk::Shader& other = cache.get(qrk::ShaderDefines());
+  EXPECT_NE(&other, &variant);
+  EXPECT_EQ(static_cast<FakeShader&>(other).defines, "");
+
+  // Prefetching a variant that already exists does nothing.
+  cache.prefetch(shadows);
+  EXPECT_TRUE(cache.isReady(shadows));
+  EXPECT_FALSE(cache.isReady(qrk::ShaderDefines().define("SSAO")));
+
+  EXPECT_EQ(built, (std::vector<std::string>{"#define SHADOWS\n", ""}));
+  EXPECT_EQ(cache.getNumVariants(), 2);
+}
+
+TEST(ShaderVariantCacheTest, SharesUniformSourcesWithEveryVariant) {
+  qrk::ShaderVariantCache cache([](const qrk::ShaderDefines& defines) {
+    return std::make_unique<FakeShader>(defines);
+  });
+  auto before = std::make_shared<CountingUniformSource>();
+  cache.addUniformSource(before);
+  qrk::Shader& first = cache.get(qrk::ShaderDefines().define("A"));
+
+  // Sources added later also reach variants that were already built.
+  auto after = std::make_shared<CountingUniformSource>();
+  cache.addUniformSource(after);
+  qrk::Shader& second = cache.get(qrk::ShaderDefines().define("B"));
+
+  first.updateUniforms();
+  second.updateUniforms();
+  EXPECT_EQ(before->updates, 2);
+  EXPECT_EQ(after->updates, 2);
+}
+
+}  // namespace
@@ -0,0 +1,164 @@
+#include <qrk/shader_loader.h>
+#include <qrk/shader_watcher.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace qrk {
+namespace {
+std::string canonicalPath(const std::string& path) {
+  std::error_code error;
+  std::filesystem::path canonical =
+      std::filesystem::weakly_canonical(path, error);
+  return error ? path : canonical.string();
+}
+}  // namespace
+
+#ifdef __linux__
+
+ShaderWatcher::ShaderWatcher() {
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ == -1) {
+    throw ShaderWatcherException("ERROR::SHADER_WATCHER::INIT_FAILED\n" +
+                                 std::string(std::strerror(errno)));
+  }
+}
+
+ShaderWatcher::~ShaderWatcher() { close(fd_); }
+
+void ShaderWatcher::watchDirectory(const std::string& directory) {
+  if (!directories_.insert(directory).second) return;
+  // Editors either write files in place, or write a new file and move it over
+  // the old one.
+  int wd = inotify_add_watch(fd_, directory.c_str(),
+                             IN_CLOSE_WRITE | IN_MOVED_TO);
+  // Not fatal; the directory's files just won't be reloaded.
+  if (wd == -1) return;
+  watchDescriptors_[wd] = directory;
+}
+
+std::unordered_set<std::string> ShaderWatcher::readChangedFiles() {
+  std::unordered_set<std::string> changed;
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    ssize_t length = read(fd_, buffer, sizeof(buffer));
+    // Fails with EAGAIN once there are no more events.
+    if (length <= 0) break;
+    for (char* p = buffer; p < buffer + length;) {
+      const auto* event = reinterpret_cast<const inotify_event*>(p);
+      p += sizeof(inotify_event) + event->len;
+      if (event->len == 0) continue;
+      auto it = watchDescriptors_.find(event->wd);
+      if (it == watchDescriptors_.end()) continue;
+      changed.insert(
+          (std::filesystem::path(it->second) / event->name).string());
+    }
+  }
+  return changed;
+}
+
+#else
+
+ShaderWatcher::ShaderWatcher() = default;
+ShaderWatcher::~ShaderWatcher() = default;
+
+void ShaderWatcher::watchDirectory(const std::string& directory) {
+  directories_.insert(directory);
+}
+
+std::unordered_set<std::string> ShaderWatcher::readChangedFiles() {
+  std::unordered_set<std::string> changed;
+  for (auto& [file, modifiedTime] : modifiedTimes_) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(file, error);
+    if (error || time == modifiedTime) continue;
+    modifiedTime = time;
+    changed.insert(file);
+  }
+  return changed;
+}
+
+#endif
+
+void ShaderWatcher::watch(Shader& shader) {
+  if (shaders_.contains(&shader)) return;
+  if (!shader.isReady()) {
+    if (std::find(pendingShaders_.begin(), pendingShaders_.end(), &shader) ==
+        pendingShaders_.end()) {
+      pendingShaders_.push_back(&shader);
+    }
+    return;
+  }
+  track(shader);
+}
+
+void ShaderWatcher::watch(ShaderVariantCache& cache) {
+  caches_.push_back(&cache);
+  cache.forEachVariant([this](Shader& variant) { watch(variant); });
+}
+
+void ShaderWatcher::unwatch(Shader& shader) {
+  shaders_.erase(&shader);
+  std::erase(pendingShaders_, &shader);
+}
+
+void ShaderWatcher::track(Shader& shader) {
+  std::vector<std::string>& files = shaders_[&shader];
+  files.clear();
+  for (const std::string& file : shader.getSourceFiles()) {
+    std::string path = canonicalPath(file);
+    watchDirectory(std::filesystem::path(path).parent_path().string());
+#ifndef __linux__
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    if (!error) modifiedTimes_.try_emplace(path, time);
+#endif
+    files.push_back(std::move(path));
+  }
+}
+
+int ShaderWatcher::update() {
+  // Pick up new variants, and shaders that have finished building.
+  for (ShaderVariantCache* cache : caches_) {
+    cache->forEachVariant([this](Shader& variant) { watch(variant); });
+  }
+  std::vector<Shader*> pending = std::move(pendingShaders_);
+  pendingShaders_.clear();
+  for (Shader* shader : pending) {
+    watch(*shader);
+  }
+
+  std::unordered_set<std::string> changed = readChangedFiles();
+  if (changed.empty()) return 0;
+
+  // Read every file anew, in case modification times are too coarse to tell
+  // that a file changed.
+  ShaderLoader::clearCache();
+  int reloaded = 0;
+  for (auto& [shader, files] : shaders_) {
+    bool affected = std::any_of(
+        files.begin(), files.end(),
+        [&](const std::string& file) { return changed.contains(file); });
+    if (!affected) continue;
+
+    try {
+      shader->reload();
+      reloaded++;
+    } catch (const QuarkException& e) {
+      fprintf(stderr, "Failed to reload shader:\n%s\n", e.what());
+      continue;
+    }
+    // Includes may have been added or removed.
+    track(*shader);
+  }
+  return reloaded;
+}
+
+}  // namespace qrk
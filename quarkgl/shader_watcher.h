@@ -0,0 +1,75 @@
+#ifndef QUARKGL_SHADER_WATCHER_H_
+#define QUARKGL_SHADER_WATCHER_H_
+
+#include <qrk/exceptions.h>
+#include <qrk/shader.h>
+#include <qrk/shader_variant_cache.h>
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace qrk {
+
+class ShaderWatcherException : public QuarkException {
+  using QuarkException::QuarkException;
+};
+
+// Watches the files that shaders were built from, including their includes,
+// and reloads the shaders whose files change. On Linux, changes are noticed
+// through inotify; elsewhere, modification times are polled on every update.
+//
+// Directories are watched rather than files, since many editors save by
+// replacing the file. Symlinks are followed, so that editing the file that a
+// runfiles symlink points at is noticed.
+class ShaderWatcher {
+ public:
+  ShaderWatcher();
+  ~ShaderWatcher();
+
+  ShaderWatcher(const ShaderWatcher&) = delete;
+  ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+  // Starts watching a shader. The shader must be unwatched before it's
+  // destroyed. Shaders that are still building are watched once they're ready.
+  void watch(Shader& shader);
+  // Starts watching every variant in the cache, including ones built later.
+  // The cache must outlive the watcher.
+  void watch(ShaderVariantCache& cache);
+  void unwatch(Shader& shader);
+
+  // Reloads the shaders whose files changed since the last update. Should be
+  // called between frames, since shaders are rebuilt on the calling thread.
+  // Shaders that fail to build keep their current program, and the error is
+  // printed. Returns the number of shaders that were reloaded.
+  int update();
+
+ private:
+  // Records the files that a built shader came from, and watches them.
+  void track(Shader& shader);
+  void watchDirectory(const std::string& directory);
+  // Returns the canonical paths of the files that changed since the last call.
+  std::unordered_set<std::string> readChangedFiles();
+
+  // The files that each shader was built from, as canonical paths.
+  std::unordered_map<Shader*, std::vector<std::string>> shaders_;
+  // Shaders that were still building when they were watched.
+  std::vector<Shader*> pendingShaders_;
+  std::vector<ShaderVariantCache*> caches_;
+  std::unordered_set<std::string> directories_;
+#ifdef __linux__
+  int fd_ = -1;
+  // The watched directories, by their watch descriptors.
+  std::unordered_map<int, std::string> watchDescriptors_;
+#else
+  // The last seen modification time of each file.
+  std::unordered_map<std::string, std::filesystem::file_time_type>
+      modifiedTimes_;
+#endif
+};
+
+}  // namespace qrk
+
+#endif
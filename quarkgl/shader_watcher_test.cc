@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <qrk/shader_watcher.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// A fake driver, whose shaders fail to compile if their source contains
+// "error".
+std::unordered_map<unsigned int, bool> shaderCompiles;
+std::unordered_map<unsigned int, bool> programLinks;
+std::vector<unsigned int> deletedPrograms;
+unsigned int nextId = 1;
+
+GLuint APIENTRY fakeCreateShader(GLenum type) { return nextId++; }
+void APIENTRY fakeShaderSource(GLuint shader, GLsizei count,
+                               const GLchar* const* source,
+                               const GLint* length) {
+  shaderCompiles[shader] = std::string(source[0]).find("error") ==
+                           std::string::npos;
+}
+void APIENTRY fakeCompileShader(GLuint shader) {}
+void APIENTRY fakeGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+  *params = shaderCompiles[shader];
+}
+void APIENTRY fakeGetShaderInfoLog(GLuint shader, GLsizei bufSize,
+                                   GLsizei* length, GLchar* infoLog) {
+  infoLog[0] = '\0';
+}
+void APIENTRY fakeDeleteShader(GLuint shader) {}
+GLuint APIENTRY fakeCreateProgram() {
+  programLinks[nextId] = true;
+  return nextId++;
+}
+void APIENTRY fakeAttachShader(GLuint program, GLuint shader) {
+  programLinks[program] = programLinks[program] && shaderCompiles[shader];
+}
+void APIENTRY fakeLinkProgram(GLuint program) {}
+void APIENTRY fakeGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+  // The programs have no uniforms.
+  *params = pname == GL_LINK_STATUS ? programLinks[program] : 0;
+}
+void APIENTRY fakeDeleteProgram(GLuint program) {
+  deletedPrograms.push_back(program);
+}
+void APIENTRY fakeGetIntegerv(GLenum pname, GLint* data) {
+  // Report no program binary formats, which disables the program cache.
+  *data = 0;
+}
+
+class CountingUniformSource : public qrk::UniformSource {
+ public:
+  void updateUniforms(qrk::Shader& shader) override { updates++; }
+
+  int updates = 0;
+};
+
+constexpr char VERTEX_SOURCE[] = "#version 460 core\nvoid main() {}\n";
+
+class ShaderWatcherTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    glad_glCreateShader = fakeCreateShader;
+    glad_glShaderSource = fakeShaderSource;
+    glad_glCompileShader = fakeCompileShader;
+    glad_glGetShaderiv = fakeGetShaderiv;
+    glad_glGetShaderInfoLog = fakeGetShaderInfoLog;
+    glad_glDeleteShader = fakeDeleteShader;
+    glad_glCreateProgram = fakeCreateProgram;
+    glad_glAttachShader = fakeAttachShader;
+    glad_glLinkProgram = fakeLinkProgram;
+    glad_glGetProgramiv = fakeGetProgramiv;
+    glad_glDeleteProgram = fakeDeleteProgram;
+    glad_glGetIntegerv = fakeGetIntegerv;
+
+    directory_ = std::filesystem::path(testing::TempDir()) /
+                 testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::filesystem::remove_all(directory_);
+    std::filesystem::create_directories(directory_);
+  }
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  std::string writeFile(const std::string& name, const std::string& code) {
+    std::string path = (directory_ / name).string();
+    std::ofstream(path) << code;
+    return path;
+  }
+
+  std::filesystem::path directory_;
+};
+
+TEST_F(ShaderWatcherTest, ReloadsShadersWhoseIncludesChange) {
+  writeFile("common.glsl", "float a;\n");
+  std::string included = writeFile("included.frag",
+                                   "#version 460 core\n"
+                                   "#pragma qrk_include \"common.glsl\"\n"
+                                   "void main() {}\n");
+  std::string other = writeFile("other.frag", VERTEX_SOURCE);
+  qrk::Shader shader(qrk::ShaderInline(VERTEX_SOURCE),
+                     qrk::ShaderPath(included.c_str()));
+  qrk::Shader otherShader(qrk::ShaderInline(VERTEX_SOURCE),
+                          qrk::ShaderPath(other.c_str()));
+  auto uniformSource = std::make_shared<CountingUniformSource>();
+  shader.addUniformSource(uniformSource);
+
+  qrk::ShaderWatcher watcher;
+  watcher.watch(shader);
+  watcher.watch(otherShader);
+  EXPECT_EQ(watcher.update(), 0);
+
+  unsigned int program = shader.getProgramId();
+  unsigned int otherProgram = otherShader.getProgramId();
+  writeFile("common.glsl", "float b;\n");
+  EXPECT_EQ(watcher.update(), 1);
+  EXPECT_NE(shader.getProgramId(), program);
+  EXPECT_EQ(otherShader.getProgramId(), otherProgram);
+  EXPECT_EQ(deletedPrograms.back(), program);
+
+  // Uniform sources survive the reload.
+  shader.updateUniforms();
+  EXPECT_EQ(uniformSource->updates, 1);
+}
+
+TEST_F(ShaderWatcherTest, KeepsProgramIfReloadFails) {
+  std::string path = writeFile("main.frag", "void main() {}\n");
+  qrk::Shader shader(qrk::ShaderInline(VERTEX_SOURCE),
+                     qrk::ShaderPath(path.c_str()));
+  qrk::ShaderWatcher watcher;
+  watcher.watch(shader);
+
+  unsigned int program = shader.getProgramId();
+  writeFile("main.frag", "error\n");
+  EXPECT_EQ(watcher.update(), 0);
+  EXPECT_EQ(shader.getProgramId(), program);
+
+  // Fixing the error reloads the shader after all.
+  writeFile("main.frag", "void main() { }\n");
+  EXPECT_EQ(watcher.update(), 1);
+  EXPECT_NE(shader.getProgramId(), program);
+}
+
+}  // namespace
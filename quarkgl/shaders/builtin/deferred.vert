@@ -4,6 +4,7 @@ layout(location = 0) in vec3 vertexPos;
 layout(location = 1) in vec3 vertexNormal;
 layout(location = 2) in vec3 vertexTangent;
 layout(location = 3) in vec2 vertexTexCoords;
+layout(location = 4) in mat4 instanceModel;
 
 // Deferred geometry pass vertex shader.
 
@@ -17,16 +18,17 @@ out VS_OUT {
 vs_out;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool instanced;
 
 void main() {
-  gl_Position = projection * view * model * vec4(vertexPos, 1.0);
+  mat4 modelView =
+      instanced ? qrk_view * model * instanceModel : qrk_view * model;
+  gl_Position = qrk_projection * modelView * vec4(vertexPos, 1.0);
 
   vs_out.texCoords = vertexTexCoords;
-  vs_out.fragPos_viewSpace = vec3(view * model * vec4(vertexPos, 1.0));
+  vs_out.fragPos_viewSpace = vec3(modelView * vec4(vertexPos, 1.0));
 
-  mat3 modelViewInverseTranspose = mat3(transpose(inverse(view * model)));
+  mat3 modelViewInverseTranspose = mat3(transpose(inverse(modelView)));
 
   // Propagate vertex normals in case we don't have a normal map.
   vs_out.fragNormal_viewSpace = modelViewInverseTranspose * vertexNormal;
@@ -34,7 +36,7 @@ void main() {
   // Build a tangent space transform matrix.
   vec3 normal_viewSpace = normalize(vs_out.fragNormal_viewSpace);
   vec3 tangent_viewSpace =
-      normalize(vec3(view * model * vec4(vertexTangent, 0.0)));
+      normalize(vec3(modelView * vec4(vertexTangent, 0.0)));
   vs_out.fragTBN_viewSpace =
       qrk_calculateTBN(normal_viewSpace, tangent_viewSpace);
 }
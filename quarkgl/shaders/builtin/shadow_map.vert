@@ -1,9 +1,12 @@
 #version 460 core
 layout(location = 0) in vec3 vertexPos;
+layout(location = 4) in mat4 instanceModel;
 
 uniform mat4 model;
 uniform mat4 lightViewProjection;
+uniform bool instanced;
 
 void main() {
-  gl_Position = lightViewProjection * model * vec4(vertexPos, 1.0);
+  mat4 modelTransform = instanced ? model * instanceModel : model;
+  gl_Position = lightViewProjection * modelTransform * vec4(vertexPos, 1.0);
 }
@@ -19,8 +19,6 @@ uniform float qrk_ssaoSampleBias;
 uniform vec3 qrk_ssaoKernel[QRK_MAX_SSAO_KERNEL_SIZE];
 uniform int qrk_ssaoKernelSize;
 
-uniform mat4 projection;
-
 void main() {
   ivec2 noiseSize = textureSize(qrk_ssaoNoise, /*lod=*/0);
   // Create a scale factor to tile the noise texture across the screen (this
@@ -49,7 +47,7 @@ void main() {
         fragPos_viewSpace + sampleOffset_viewSpace * qrk_ssaoSampleRadius;
 
     // Now we transform the sample to screen space.
-    vec4 samplePos_clipSpace = projection * vec4(samplePos_viewSpace, 1.0);
+    vec4 samplePos_clipSpace = qrk_projection * vec4(samplePos_viewSpace, 1.0);
     samplePos_clipSpace /= samplePos_clipSpace.w;  // Perspective divide.
     // Transform from [-1, 1] to [0, 1] so that we can use them as tex coords.
     samplePos_clipSpace = samplePos_clipSpace * 0.5 + 0.5;
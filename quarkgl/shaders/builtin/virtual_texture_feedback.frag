@@ -0,0 +1,30 @@
+#version 460 core
+#define QRK_VIRTUAL_TEXTURES
+#pragma qrk_include < core.glsl>
+#pragma qrk_include < lighting.frag>
+
+// Virtual texture feedback pass fragment shader. Records the page of the
+// material's virtual texture that each fragment samples.
+
+in VS_OUT {
+  vec2 texCoords;
+  vec3 fragPos_viewSpace;
+  vec3 fragNormal_viewSpace;
+  mat3 fragTBN_viewSpace;
+}
+fs_in;
+
+// A packed VirtualPageId, or 0 for no page.
+out vec4 feedback;
+
+uniform QrkMaterial material;
+uniform float lodBias;
+
+void main() {
+  if (!material.hasVirtualDiffuse) {
+    feedback = vec4(0.0);
+    return;
+  }
+  feedback = qrk_virtualTextureFeedback(material.virtualDiffuse,
+                                        fs_in.texCoords, lodBias);
+}
@@ -1,3 +1,16 @@
 #pragma once
 
-uniform float qrk_time;
\ No newline at end of file
+/**
+ * Per-frame data, written once per frame by the window and shared by all
+ * programs. Must match FrameUniformData in uniform_buffer.h.
+ */
+layout(std140, binding = 0) uniform QrkFrame {
+  // The bound camera's transforms.
+  mat4 qrk_view;
+  mat4 qrk_projection;
+  float qrk_time;
+  float qrk_deltaTime;
+  // TODO: Replace these with a vec2.
+  int qrk_windowWidth;
+  int qrk_windowHeight;
+};
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#pragma qrk_include < lights.glsl>
+
+/**
+ * The registered lights, one storage block per light type, written by the
+ * light registry when they change and shared by all programs. The buffers have
+ * spare capacity, so each list is as long as the count stored at its start,
+ * rather than the array's length. Must match the std430 layouts in light.h.
+ */
+layout(std430, binding = 0) readonly buffer QrkDirectionalLights {
+  int qrk_directionalLightCount;
+  QrkDirectionalLight qrk_directionalLights[];
+};
+
+layout(std430, binding = 1) readonly buffer QrkPointLights {
+  int qrk_pointLightCount;
+  QrkPointLight qrk_pointLights[];
+};
+
+layout(std430, binding = 2) readonly buffer QrkSpotLights {
+  int qrk_spotLightCount;
+  QrkSpotLight qrk_spotLights[];
+};
\ No newline at end of file
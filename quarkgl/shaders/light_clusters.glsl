@@ -0,0 +1,52 @@
+#pragma once
+
+/**
+ * Lists of the lights that affect each cluster of the view frustum, written by
+ * LightClusterPass. Clusters tile the screen in X and Y, and slice the depth
+ * range exponentially in Z. Each cluster has qrk_maxLightsPerCluster index
+ * slots, of which the first qrk_lightClusterCounts[i] are used. Indices below
+ * qrk_pointLightCount are point lights, and the rest are spot lights, offset
+ * by qrk_pointLightCount. Must match light_clusters.h.
+ */
+uniform uvec3 qrk_clusterGridSize;
+uniform uint qrk_maxLightsPerCluster;
+uniform mat4 qrk_clusterProjection;
+uniform float qrk_clusterNear;
+uniform float qrk_clusterFar;
+
+layout(std430, binding = 3) buffer QrkLightClusterCounts {
+  uint qrk_lightClusterCounts[];
+};
+
+layout(std430, binding = 4) buffer QrkLightClusterIndices {
+  uint qrk_lightClusterIndices[];
+};
+
+/** Returns the view space distance of the near side of a depth slice. */
+float qrk_clusterSliceDepth(uint slice) {
+  return qrk_clusterNear * pow(qrk_clusterFar / qrk_clusterNear,
+                               float(slice) / float(qrk_clusterGridSize.z));
+}
+
+uint qrk_clusterIndex(uvec3 cluster) {
+  uvec3 gridSize = qrk_clusterGridSize;
+  return cluster.x + gridSize.x * (cluster.y + gridSize.y * cluster.z);
+}
+
+/**
+ * Returns the index of the cluster that contains a view space position.
+ * Positions outside the frustum are clamped to the nearest cluster.
+ */
+uint qrk_findClusterIndex(vec3 pos_viewSpace) {
+  vec4 clip = qrk_clusterProjection * vec4(pos_viewSpace, 1.0);
+  vec2 screen = clip.xy / clip.w * 0.5 + 0.5;
+  ivec2 tile = ivec2(floor(screen * vec2(qrk_clusterGridSize.xy)));
+  tile = clamp(tile, ivec2(0), ivec2(qrk_clusterGridSize.xy) - 1);
+
+  float depth = max(-pos_viewSpace.z, qrk_clusterNear);
+  int slice = int(floor(log(depth / qrk_clusterNear) /
+                        log(qrk_clusterFar / qrk_clusterNear) *
+                        float(qrk_clusterGridSize.z)));
+  slice = clamp(slice, 0, int(qrk_clusterGridSize.z) - 1);
+  return qrk_clusterIndex(uvec3(tile, slice));
+}
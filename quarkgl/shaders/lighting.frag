@@ -2,15 +2,13 @@
 
 #pragma qrk_include < gamma.frag>
 #pragma qrk_include < normals.frag>
+#pragma qrk_include < lights.glsl>
+#ifdef QRK_VIRTUAL_TEXTURES
+#pragma qrk_include < virtual_texture.glsl>
+#endif
 
 /** Core lighting structs and functions. */
 
-struct QrkAttenuation {
-  float constant;
-  float linear;
-  float quadratic;
-};
-
 #ifndef QRK_MAX_DIFFUSE_TEXTURES
 #define QRK_MAX_DIFFUSE_TEXTURES 1
 #endif
@@ -64,6 +62,12 @@ struct QrkMaterial {
   sampler2D normalMap;
   bool hasNormalMap;
 
+#ifdef QRK_VIRTUAL_TEXTURES
+  // A virtual texture that's sampled in place of diffuseMaps, if set.
+  QrkVirtualTexture virtualDiffuse;
+  bool hasVirtualDiffuse;
+#endif
+
   // Ambient light factor.
   vec3 ambient;
 
@@ -73,36 +77,13 @@ struct QrkMaterial {
   QrkAttenuation emissionAttenuation;
 };
 
-struct QrkDirectionalLight {
-  vec3 direction;
-
-  vec3 diffuse;
-  vec3 specular;
-};
-
-struct QrkPointLight {
-  vec3 position;
-
-  vec3 diffuse;
-  vec3 specular;
-
-  QrkAttenuation attenuation;
-};
-
-struct QrkSpotLight {
-  vec3 position;
-  vec3 direction;
-  float innerAngle;
-  float outerAngle;
-
-  vec3 diffuse;
-  vec3 specular;
-
-  QrkAttenuation attenuation;
-};
-
 /** Extracts albedo from the material. */
 vec3 qrk_extractAlbedo(QrkMaterial material, vec2 texCoords) {
+#ifdef QRK_VIRTUAL_TEXTURES
+  if (material.hasVirtualDiffuse) {
+    return qrk_sampleVirtualTexture(material.virtualDiffuse, texCoords).rgb;
+  }
+#endif
   vec3 albedo = vec3(0.0);
   if (material.diffuseCount > 0) {
     albedo = texture(material.diffuseMaps[0], texCoords).rgb;
@@ -183,6 +164,11 @@ vec3 qrk_extractEmission(QrkMaterial material, vec2 texCoords) {
  * Calculate a material's final alpha based on its set of diffuse textures.
  */
 float qrk_materialAlpha(QrkMaterial material, vec2 texCoords) {
+#ifdef QRK_VIRTUAL_TEXTURES
+  if (material.hasVirtualDiffuse) {
+    return qrk_sampleVirtualTexture(material.virtualDiffuse, texCoords).a;
+  }
+#endif
   float sum = 0.0;
   for (int i = 0; i < material.diffuseCount; i++) {
     sum += texture(material.diffuseMaps[i], texCoords).a;
@@ -0,0 +1,43 @@
+#pragma once
+
+/**
+ * Light structs, which are shared by every stage. Must match the std430
+ * layouts in light.h.
+ */
+
+struct QrkAttenuation {
+  float constant;
+  float linear;
+  float quadratic;
+};
+
+struct QrkDirectionalLight {
+  vec3 direction;
+
+  vec3 diffuse;
+  vec3 specular;
+};
+
+struct QrkPointLight {
+  vec3 position;
+
+  vec3 diffuse;
+  vec3 specular;
+
+  QrkAttenuation attenuation;
+  // The distance beyond which the light is negligible, for light culling.
+  float radius;
+};
+
+struct QrkSpotLight {
+  vec3 position;
+  vec3 direction;
+  float innerAngle;
+  float outerAngle;
+
+  vec3 diffuse;
+  vec3 specular;
+
+  QrkAttenuation attenuation;
+  float radius;
+};
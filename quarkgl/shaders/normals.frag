@@ -2,10 +2,13 @@
 
 /**
  * Samples a normal map and converts the texture colors [0..1] to a normalized
- * normal vector [-1..1], in tangent space.
+ * normal vector [-1..1], in tangent space. Only X and Y are read, and Z is
+ * reconstructed, so that two-channel (e.g. BC5) normal maps work too.
  */
 vec3 qrk_sampleNormalMap(sampler2D normalMap, vec2 texCoords) {
-  return normalize(texture(normalMap, texCoords).xyz * 2.0 - 1.0);
+  vec2 xy = texture(normalMap, texCoords).xy * 2.0 - 1.0;
+  float z = sqrt(max(1.0 - dot(xy, xy), 0.0));
+  return normalize(vec3(xy, z));
 }
 
 /** Converts a normal to a color representation, with 100% opacity. */
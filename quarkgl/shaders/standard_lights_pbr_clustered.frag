@@ -0,0 +1,64 @@
+#pragma once
+
+#pragma qrk_include < light_clusters.glsl>
+#pragma qrk_include < standard_lights_pbr.frag>
+
+/** ===================== PBR, clustered ===================== **/
+
+/**
+ * Variants of the functions in standard_lights_pbr.frag that only shade the
+ * point and spot lights in the fragment's cluster, which must have been binned
+ * by a LightClusterPass. Directional lights affect every cluster, so are
+ * always shaded. Fragment positions must be in view space.
+ */
+
+/**
+ * Calculate shading from the point and spot lights in the fragment's cluster
+ * using deferred data.
+ */
+vec3 qrk_shadeClusteredLightsCookTorranceGGXDeferred(vec3 albedo,
+                                                     float roughness,
+                                                     float metallic,
+                                                     vec3 fragPos_viewSpace,
+                                                     vec3 normal) {
+  uint clusterIndex = qrk_findClusterIndex(fragPos_viewSpace);
+  uint firstSlot = clusterIndex * qrk_maxLightsPerCluster;
+  uint count = qrk_lightClusterCounts[clusterIndex];
+
+  vec3 result = vec3(0.0);
+  for (uint i = 0; i < count; i++) {
+    int light = int(qrk_lightClusterIndices[firstSlot + i]);
+    if (light < qrk_pointLightCount) {
+      result += qrk_shadePointLightCookTorranceGGXDeferred(
+          albedo, roughness, metallic, qrk_pointLights[light],
+          fragPos_viewSpace, normal);
+    } else {
+      result += qrk_shadeSpotLightCookTorranceGGXDeferred(
+          albedo, roughness, metallic,
+          qrk_spotLights[light - qrk_pointLightCount], fragPos_viewSpace,
+          normal);
+    }
+  }
+  return result;
+}
+
+/**
+ * Calculate shading from all light sources that reach the fragment, except
+ * ambient and emission textures, using deferred data.
+ */
+vec3 qrk_shadeAllLightsCookTorranceGGXDeferredClustered(
+    vec3 albedo, float roughness, float metallic, vec3 fragPos_viewSpace,
+    vec3 normal, float shadow) {
+  vec3 directional = qrk_shadeAllDirectionalLightsCookTorranceGGXDeferred(
+      albedo, roughness, metallic, fragPos_viewSpace, normal, shadow);
+  vec3 clustered = qrk_shadeClusteredLightsCookTorranceGGXDeferred(
+      albedo, roughness, metallic, fragPos_viewSpace, normal);
+  return directional + clustered;
+}
+
+vec3 qrk_shadeAllLightsCookTorranceGGXDeferredClustered(
+    vec3 albedo, float roughness, float metallic, vec3 fragPos_viewSpace,
+    vec3 normal) {
+  return qrk_shadeAllLightsCookTorranceGGXDeferredClustered(
+      albedo, roughness, metallic, fragPos_viewSpace, normal, /*shadow=*/0.0);
+}
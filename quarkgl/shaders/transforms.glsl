@@ -1,5 +1,7 @@
 #pragma once
 
+#pragma qrk_include < core.glsl>
+
 /**
  * Calculates the normal of a triangle based on vertices.
  */
@@ -0,0 +1,75 @@
+#pragma once
+
+/** Sampling through virtual textures. See virtual_texture.h. */
+
+struct QrkVirtualTexture {
+  // Maps each page, at each mip level, to the physical page that stands in for
+  // it. RG holds the slot in the page cache, B the mip level of the page that
+  // stands in, and A is set if any page does.
+  sampler2D pageTable;
+  // The physical page cache, shared by every virtual texture.
+  sampler2D pageCache;
+  // The size of the virtual texture's base level, in texels.
+  int width;
+  int height;
+  int numMips;
+  // The size of a page's content, and of the border around it, in texels.
+  int pageSize;
+  int pageBorder;
+  // Identifies the texture in the feedback buffer.
+  int id;
+};
+
+/**
+ * Returns the mip level that a virtual texture would be sampled at, as
+ * hardware sampling would pick it.
+ */
+float qrk_virtualTextureLod(QrkVirtualTexture vt, vec2 texCoords) {
+  vec2 size = vec2(vt.width, vt.height);
+  vec2 dx = dFdx(texCoords * size);
+  vec2 dy = dFdy(texCoords * size);
+  return 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+}
+
+/**
+ * Samples a virtual texture through its page table. If the page that's needed
+ * isn't resident yet, the nearest coarser page that is gets sampled instead.
+ * Texture coordinates wrap, as they do for repeating textures.
+ */
+vec4 qrk_sampleVirtualTexture(QrkVirtualTexture vt, vec2 texCoords) {
+  int mip = clamp(int(qrk_virtualTextureLod(vt, texCoords)), 0,
+                  vt.numMips - 1);
+  vec2 uv = fract(texCoords);
+
+  ivec2 numPages = textureSize(vt.pageTable, mip);
+  ivec2 page = min(ivec2(uv * numPages), numPages - 1);
+  vec4 entry = round(texelFetch(vt.pageTable, page, mip) * 255.0);
+
+  // Find where the texel lies within the page that stands in, which may be at
+  // a coarser mip level than the one that was asked for.
+  int residentMip = int(entry.b);
+  vec2 mipSize = vec2(max(ivec2(vt.width, vt.height) >> residentMip, 1));
+  vec2 pageCoords = uv * mipSize / float(vt.pageSize);
+  vec2 offset = pageCoords - floor(pageCoords);
+
+  float tileSize = float(vt.pageSize + 2 * vt.pageBorder);
+  vec2 texel =
+      entry.rg * tileSize + float(vt.pageBorder) + offset * float(vt.pageSize);
+  return textureLod(vt.pageCache, texel / vec2(textureSize(vt.pageCache, 0)),
+                    0.0);
+}
+
+/**
+ * Returns the page that a virtual texture sample needs, for the feedback
+ * buffer, as a packed VirtualPageId. The LOD bias makes up for the feedback
+ * buffer being smaller than the screen.
+ */
+vec4 qrk_virtualTextureFeedback(QrkVirtualTexture vt, vec2 texCoords,
+                                float lodBias) {
+  int mip = clamp(int(qrk_virtualTextureLod(vt, texCoords) + lodBias), 0,
+                  vt.numMips - 1);
+  vec2 uv = fract(texCoords);
+  ivec2 numPages = textureSize(vt.pageTable, mip);
+  ivec2 page = min(ivec2(uv * numPages), numPages - 1);
+  return vec4(page, mip, vt.id) / 255.0;
+}
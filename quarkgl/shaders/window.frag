@@ -1,11 +1,8 @@
 #pragma once
 
-// TODO: This file should be .glsl
+#pragma qrk_include < core.glsl>
 
-uniform float qrk_deltaTime;
-// TODO: Replace these uniforms with a vec2.
-uniform int qrk_windowWidth;
-uniform int qrk_windowHeight;
+// TODO: This file should be .glsl
 
 bool qrk_isWindowLeftHalf() { return gl_FragCoord.x < (qrk_windowWidth / 2); }
 bool qrk_isWindowRightHalf() { return gl_FragCoord.x >= (qrk_windowWidth / 2); }
@@ -14,17 +14,21 @@ ShadowCamera::ShadowCamera(std::shared_ptr<DirectionalLight> light,
       shadowCameraDistanceFromOrigin_(shadowCameraDistanceFromOrigin),
       worldUp_(worldUp) {}
 
-glm::mat4 ShadowCamera::getViewTransform() {
+glm::mat4 ShadowCamera::getViewTransform() const {
   return glm::lookAt(shadowCameraDistanceFromOrigin_ * -light_->getDirection(),
                      glm::vec3(0.0f), worldUp_);
 }
 
-glm::mat4 ShadowCamera::getProjectionTransform() {
+glm::mat4 ShadowCamera::getProjectionTransform() const {
   // Directional lights cast orthographic shadows.
   return glm::ortho(-cuboidExtents_, cuboidExtents_, -cuboidExtents_,
                     cuboidExtents_, near_, far_);
 }
 
+Frustum ShadowCamera::getFrustum() const {
+  return Frustum(getProjectionTransform() * getViewTransform());
+}
+
 void ShadowCamera::updateUniforms(Shader& shader) {
   shader.setMat4("lightViewProjection",
                  getProjectionTransform() * getViewTransform());
@@ -1,6 +1,7 @@
 #ifndef QUARKGL_SHADOWS_H_
 #define QUARKGL_SHADOWS_H_
 
+#include <qrk/bounds.h>
 #include <qrk/exceptions.h>
 #include <qrk/framebuffer.h>
 #include <qrk/light.h>
@@ -17,7 +18,7 @@ class ShadowException : public QuarkException {
   using QuarkException::QuarkException;
 };
 
-class ShadowCamera : public UniformSource {
+class ShadowCamera : public UniformSource, public FrustumSource {
  public:
   // TODO: Currently only renders the origin. Make this more dynamic, and have
   // it automatically determine a best-fit frustum based on the scene.
@@ -40,8 +41,10 @@ class ShadowCamera : public UniformSource {
     shadowCameraDistanceFromOrigin_ = dist;
   }
 
-  glm::mat4 getViewTransform();
-  glm::mat4 getProjectionTransform();
+  glm::mat4 getViewTransform() const;
+  glm::mat4 getProjectionTransform() const;
+  // The light's orthographic frustum, for culling shadow casters.
+  Frustum getFrustum() const override;
 
   void updateUniforms(Shader& shader) override;
 
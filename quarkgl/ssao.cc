@@ -69,12 +69,15 @@ void SsaoKernel::regenerate(int kernelSize, int noiseTextureSideLength) {
 }
 
 void SsaoKernel::updateUniforms(Shader& shader) {
-  shader.setFloat("qrk_ssaoSampleRadius", radius_);
-  shader.setFloat("qrk_ssaoSampleBias", bias_);
-  shader.setInt("qrk_ssaoKernelSize", kernel_.size());
-  for (unsigned int i = 0; i < kernel_.size(); ++i) {
-    shader.setVec3("qrk_ssaoKernel[" + std::to_string(i) + "]", kernel_[i]);
-  }
+  static const UniformName sampleRadius("qrk_ssaoSampleRadius");
+  static const UniformName sampleBias("qrk_ssaoSampleBias");
+  static const UniformName kernelSize("qrk_ssaoKernelSize");
+  static const UniformName kernel("qrk_ssaoKernel[0]");
+  shader.setFloat(sampleRadius, radius_);
+  shader.setFloat(sampleBias, bias_);
+  shader.setInt(kernelSize, kernel_.size());
+  // Upload the whole kernel at once.
+  if (!kernel_.empty()) shader.setVec3Array(kernel, kernel_);
 }
 
 unsigned int SsaoKernel::bindTexture(unsigned int nextTextureUnit,
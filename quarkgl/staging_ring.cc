@@ -0,0 +1,190 @@
+#include <qrk/staging_ring.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace qrk {
+namespace {
+
+constexpr GLbitfield MAP_FLAGS =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+// How long to wait for a fence before checking it again.
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+size_t alignUp(size_t value) {
+  return (value + StagingRing::ALIGNMENT - 1) / StagingRing::ALIGNMENT *
+         StagingRing::ALIGNMENT;
+}
+
+}  // namespace
+
+StagingRing::Allocation::Allocation(Allocation&& other) noexcept
+    : ring_(std::exchange(other.ring_, nullptr)),
+      id_(other.id_),
+      data_(other.data_),
+      offset_(other.offset_),
+      size_(other.size_) {}
+
+StagingRing::Allocation& StagingRing::Allocation::operator=(
+    Allocation&& other) noexcept {
+  if (this != &other) {
+    if (ring_) ring_->cancel(id_);
+    ring_ = std::exchange(other.ring_, nullptr);
+    id_ = other.id_;
+    data_ = other.data_;
+    offset_ = other.offset_;
+    size_ = other.size_;
+  }
+  return *this;
+}
+
+StagingRing::Allocation::~Allocation() {
+  // Submitted allocations ignore this.
+  if (ring_) ring_->cancel(id_);
+}
+
+unsigned int StagingRing::Allocation::getBuffer() const {
+  return ring_->getId();
+}
+
+void StagingRing::Allocation::submit() const { ring_->submit(id_); }
+
+StagingRing::StagingRing(size_t size) : size_(size) {
+  glCreateBuffers(1, &buffer_);
+  glNamedBufferStorage(buffer_, size_, nullptr, MAP_FLAGS);
+  mapped_ = static_cast<std::byte*>(
+      glMapNamedBufferRange(buffer_, 0, size_, MAP_FLAGS));
+  if (mapped_ == nullptr) {
+    glDeleteBuffers(1, &buffer_);
+    throw StagingRingException("ERROR::STAGING_RING::MAP_FAILED");
+  }
+}
+
+StagingRing::~StagingRing() {
+  for (const Segment& segment : segments_) {
+    if (segment.fence) glDeleteSync(segment.fence);
+  }
+  glUnmapNamedBuffer(buffer_);
+  glDeleteBuffers(1, &buffer_);
+}
+
+size_t StagingRing::getUsedBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (segments_.empty()) return 0;
+  const size_t tail = segments_.front().begin;
+  return head_ > tail ? head_ - tail : size_ - tail + head_;
+}
+
+std::optional<StagingRing::Allocation> StagingRing::tryAllocate(size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return allocateLocked(size);
+}
+
+std::optional<StagingRing::Allocation> StagingRing::allocate(size_t size) {
+  if (size > size_) return std::nullopt;
+  std::lock_guard<std::mutex> lock(mutex_);
+  reclaimLocked(/*wait=*/false);
+  while (true) {
+    std::optional<Allocation> allocation = allocateLocked(size);
+    if (allocation || !reclaimLocked(/*wait=*/true)) return allocation;
+  }
+}
+
+void StagingRing::reclaim() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  reclaimLocked(/*wait=*/false);
+}
+
+std::optional<StagingRing::Allocation> StagingRing::allocateLocked(
+    size_t size) {
+  // Zero-sized allocations still take up space, so that every live segment
+  // is distinct.
+  const size_t reserved = std::max<size_t>(size, 1);
+  if (reserved > size_) return std::nullopt;
+
+  size_t begin = head_;
+  size_t offset;
+  if (segments_.empty()) {
+    begin = 0;
+    offset = 0;
+  } else {
+    const size_t tail = segments_.front().begin;
+    const size_t aligned = alignUp(head_);
+    if (head_ > tail) {
+      // The used space doesn't wrap, so the space after it and before it are
+      // both free.
+      if (aligned + reserved <= size_) {
+        offset = aligned;
+      } else if (reserved <= tail) {
+        // Wrap around, skipping the rest of the ring.
+        offset = 0;
+      } else {
+        return std::nullopt;
+      }
+    } else {
+      // The used space wraps, so only the space between its ends is free.
+      if (aligned + reserved > tail) return std::nullopt;
+      offset = aligned;
+    }
+  }
+
+  const uint64_t id = nextId_++;
+  head_ = offset + reserved;
+  segments_.push_back({.id = id, .begin = begin, .end = head_});
+  return Allocation(this, id, mapped_ + offset, offset, size);
+}
+
+bool StagingRing::reclaimLocked(bool wait) {
+  bool freed = false;
+  while (!segments_.empty()) {
+    Segment& segment = segments_.front();
+    if (!segment.cancelled) {
+      // Unsubmitted allocations may still be being written.
+      if (!segment.fence) break;
+      GLenum result = glClientWaitSync(segment.fence, 0, 0);
+      if (result == GL_TIMEOUT_EXPIRED) {
+        // Only wait for as much as is needed to make progress.
+        if (!wait || freed) break;
+        do {
+          result = glClientWaitSync(segment.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                    FENCE_TIMEOUT_NS);
+        } while (result == GL_TIMEOUT_EXPIRED);
+      }
+      glDeleteSync(segment.fence);
+      segment.fence = nullptr;
+      if (result == GL_WAIT_FAILED) {
+        throw StagingRingException("ERROR::STAGING_RING::WAIT_FAILED");
+      }
+    }
+    segments_.pop_front();
+    freed = true;
+  }
+  if (segments_.empty()) head_ = 0;
+  return freed;
+}
+
+void StagingRing::submit(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(segments_.begin(), segments_.end(),
+                         [id](const Segment& s) { return s.id == id; });
+  if (it != segments_.end() && !it->fence && !it->cancelled) {
+    it->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  reclaimLocked(/*wait=*/false);
+}
+
+void StagingRing::cancel(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(segments_.begin(), segments_.end(),
+                         [id](const Segment& s) { return s.id == id; });
+  if (it == segments_.end() || it->fence) return;
+  it->cancelled = true;
+  // Cancelled space was never read by the GPU, so it can be reused right
+  // away. This doesn't touch GL state, since it may run on any thread.
+  while (!segments_.empty() && segments_.front().cancelled) {
+    segments_.pop_front();
+  }
+  if (segments_.empty()) head_ = 0;
+}
+
+}  // namespace qrk
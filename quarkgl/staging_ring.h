@@ -0,0 +1,131 @@
+#ifndef QUARKGL_STAGING_RING_H_
+#define QUARKGL_STAGING_RING_H_
+
+#include <glad/glad.h>
+#include <qrk/exceptions.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace qrk {
+
+class StagingRingException : public QuarkException {
+  using QuarkException::QuarkException;
+};
+
+// A ring of persistently mapped staging memory for uploads to GL objects.
+// Space is allocated in order, written through the mapping (from any thread),
+// and then copied into its destination with a GL command that reads the
+// buffer, e.g. glTexSubImage2D with the buffer bound to
+// GL_PIXEL_UNPACK_BUFFER. Each allocation is fenced once its copy has been
+// issued, and its space is reused once the GPU is done with it, so the driver
+// never has to copy from client memory or stall on it.
+//
+// Allocations are freed in order, so an allocation that's held for a long
+// time holds up the space after it.
+class StagingRing {
+ public:
+  // 64MB, which fits a 4K RGBA texture with its mips.
+  static constexpr size_t DEFAULT_SIZE = 64 * 1024 * 1024;
+  // The alignment of every allocation's offset.
+  static constexpr size_t ALIGNMENT = 16;
+
+  // A range of staging memory. Allocations that are destroyed without being
+  // submitted are freed right away. Must not outlive their ring.
+  class Allocation {
+   public:
+    Allocation(Allocation&& other) noexcept;
+    Allocation& operator=(Allocation&& other) noexcept;
+    ~Allocation();
+    Allocation(const Allocation&) = delete;
+    Allocation& operator=(const Allocation&) = delete;
+
+    std::byte* getData() const { return data_; }
+    // The offset of the allocation within the ring's buffer.
+    size_t getOffset() const { return offset_; }
+    size_t getSize() const { return size_; }
+    unsigned int getBuffer() const;
+
+    // Fences the allocation. Must be called on the GL thread, right after
+    // issuing the commands that read it.
+    void submit() const;
+
+   private:
+    Allocation(StagingRing* ring, uint64_t id, std::byte* data, size_t offset,
+               size_t size)
+        : ring_(ring), id_(id), data_(data), offset_(offset), size_(size) {}
+
+    StagingRing* ring_;
+    uint64_t id_;
+    std::byte* data_;
+    size_t offset_;
+    size_t size_;
+
+    friend class StagingRing;
+  };
+
+  explicit StagingRing(size_t size = DEFAULT_SIZE);
+  virtual ~StagingRing();
+  StagingRing(const StagingRing&) = delete;
+  StagingRing& operator=(const StagingRing&) = delete;
+
+  unsigned int getId() const { return buffer_; }
+  size_t getSize() const { return size_; }
+  // Returns the number of bytes that are allocated, or waiting on the GPU.
+  size_t getUsedBytes() const;
+
+  // Allocates staging memory, without waiting. Returns nullopt if the ring
+  // doesn't have room right now. Doesn't touch any GL state, so this is safe
+  // to call from any thread.
+  std::optional<Allocation> tryAllocate(size_t size);
+  // Allocates staging memory, waiting for the GPU to finish with earlier
+  // allocations if needed. Returns nullopt if the request is larger than the
+  // ring, or if it can't be met until allocations that haven't been submitted
+  // yet are. Must be called on the GL thread.
+  std::optional<Allocation> allocate(size_t size);
+
+  // Frees the space of submitted allocations that the GPU is done with,
+  // without waiting. Must be called on the GL thread.
+  void reclaim();
+
+ private:
+  struct Segment {
+    uint64_t id;
+    // Where the segment's space starts. This is before the allocation's
+    // offset if the allocation wrapped around to the start of the ring.
+    size_t begin;
+    size_t end;
+    // Set once the allocation is submitted.
+    GLsync fence = nullptr;
+    // Set if the allocation was destroyed without being submitted.
+    bool cancelled = false;
+  };
+
+  // Reserves space for an allocation. The mutex must be held.
+  std::optional<Allocation> allocateLocked(size_t size);
+  // Frees segments from the front of the ring while they're done, waiting on
+  // the first submitted one if requested. Returns whether anything was freed.
+  // The mutex must be held.
+  bool reclaimLocked(bool wait);
+
+  void submit(uint64_t id);
+  void cancel(uint64_t id);
+
+  unsigned int buffer_ = 0;
+  size_t size_;
+  std::byte* mapped_ = nullptr;
+
+  mutable std::mutex mutex_;
+  // The live segments, in the order they were allocated.
+  std::deque<Segment> segments_;
+  // Where the next allocation starts looking for space.
+  size_t head_ = 0;
+  uint64_t nextId_ = 0;
+};
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <qrk/staging_ring.h>
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace {
+
+// Stands in for the mapped buffer and the fences of a real context. Fences are
+// signaled by hand.
+std::vector<std::byte> mapped;
+std::set<GLsync> fences;
+std::set<GLsync> signaledFences;
+uintptr_t nextFence = 1;
+
+void APIENTRY fakeCreateBuffers(GLsizei n, GLuint* buffers) { *buffers = 7; }
+void APIENTRY fakeNamedBufferStorage(GLuint buffer, GLsizeiptr size,
+                                     const void* data, GLbitfield flags) {
+  mapped.assign(size, std::byte{0});
+}
+void* APIENTRY fakeMapNamedBufferRange(GLuint buffer, GLintptr offset,
+                                       GLsizeiptr length, GLbitfield access) {
+  return mapped.data() + offset;
+}
+GLboolean APIENTRY fakeUnmapNamedBuffer(GLuint buffer) { return GL_TRUE; }
+void APIENTRY fakeDeleteBuffers(GLsizei n, const GLuint* buffers) {}
+GLsync APIENTRY fakeFenceSync(GLenum condition, GLbitfield flags) {
+  GLsync fence = reinterpret_cast<GLsync>(nextFence++);
+  fences.insert(fence);
+  return fence;
+}
+GLenum APIENTRY fakeClientWaitSync(GLsync fence, GLbitfield flags,
+                                   GLuint64 timeout) {
+  // Waiting with a timeout stands in for the GPU finishing.
+  if (timeout > 0) signaledFences.insert(fence);
+  return signaledFences.count(fence) ? GL_ALREADY_SIGNALED
+                                     : GL_TIMEOUT_EXPIRED;
+}
+void APIENTRY fakeDeleteSync(GLsync fence) { fences.erase(fence); }
+
+class StagingRingTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    glad_glCreateBuffers = fakeCreateBuffers;
+    glad_glNamedBufferStorage = fakeNamedBufferStorage;
+    glad_glMapNamedBufferRange = fakeMapNamedBufferRange;
+    glad_glUnmapNamedBuffer = fakeUnmapNamedBuffer;
+    glad_glDeleteBuffers = fakeDeleteBuffers;
+    glad_glFenceSync = fakeFenceSync;
+    glad_glClientWaitSync = fakeClientWaitSync;
+    glad_glDeleteSync = fakeDeleteSync;
+    fences.clear();
+    signaledFences.clear();
+  }
+
+  void signalAll() { signaledFences = fences; }
+};
+
+TEST_F(StagingRingTest, AllocatesAlignedRangesInOrder) {
+  qrk::StagingRing ring(256);
+  std::optional<qrk::StagingRing::Allocation> a = ring.tryAllocate(10);
+  std::optional<qrk::StagingRing::Allocation> b = ring.tryAllocate(20);
+  ASSERT_TRUE(a && b);
+  EXPECT_EQ(a->getOffset(), 0);
+  EXPECT_EQ(a->getSize(), 10);
+  EXPECT_EQ(b->getOffset(), qrk::StagingRing::ALIGNMENT);
+  EXPECT_EQ(b->getData(), mapped.data() + b->getOffset());
+  EXPECT_EQ(b->getBuffer(), 7);
+  EXPECT_EQ(ring.getUsedBytes(), qrk::StagingRing::ALIGNMENT + 20);
+}
+
+TEST_F(StagingRingTest, ReusesSpaceOnceTheGpuIsDone) {
+  qrk::StagingRing ring(256);
+  std::optional<qrk::StagingRing::Allocation> a = ring.tryAllocate(128);
+  std::optional<qrk::StagingRing::Allocation> b = ring.tryAllocate(128);
+  ASSERT_TRUE(a && b);
+  EXPECT_FALSE(ring.tryAllocate(1));
+
+  a->submit();
+  b->submit();
+  EXPECT_FALSE(ring.tryAllocate(1));
+  EXPECT_EQ(fences.size(), 2);
+
+  signalAll();
+  ring.reclaim();
+  EXPECT_EQ(ring.getUsedBytes(), 0);
+  EXPECT_TRUE(fences.empty());
+  std::optional<qrk::StagingRing::Allocation> c = ring.tryAllocate(256);
+  ASSERT_TRUE(c);
+  EXPECT_EQ(c->getOffset(), 0);
+}
+
+TEST_F(StagingRingTest, WrapsAroundToTheStart) {
+  qrk::StagingRing ring(256);
+  std::optional<qrk::StagingRing::Allocation> a = ring.tryAllocate(96);
+  std::optional<qrk::StagingRing::Allocation> b = ring.tryAllocate(96);
+  ASSERT_TRUE(a && b);
+  a->submit();
+  signalAll();
+  ring.reclaim();
+
+  // Doesn't fit after b, but does before it.
+  std::optional<qrk::StagingRing::Allocation> c = ring.tryAllocate(80);
+  ASSERT_TRUE(c);
+  EXPECT_EQ(c->getOffset(), 0);
+  // The skipped space at the end counts as used until c is freed.
+  EXPECT_EQ(ring.getUsedBytes(), 256 - 96 + 80);
+  // Only the space between c and b is left.
+  EXPECT_FALSE(ring.tryAllocate(32));
+  EXPECT_TRUE(ring.tryAllocate(16));
+}
+
+TEST_F(StagingRingTest, FreesUnsubmittedAllocationsImmediately) {
+  qrk::StagingRing ring(256);
+  {
+    std::optional<qrk::StagingRing::Allocation> a = ring.tryAllocate(200);
+    ASSERT_TRUE(a);
+    EXPECT_FALSE(ring.tryAllocate(100));
+  }
+  EXPECT_EQ(ring.getUsedBytes(), 0);
+  EXPECT_TRUE(ring.tryAllocate(256));
+  EXPECT_TRUE(fences.empty());
+}
+
+TEST_F(StagingRingTest, AllocateWaitsForSubmittedAllocations) {
+  qrk::StagingRing ring(256);
+  std::optional<qrk::StagingRing::Allocation> a = ring.tryAllocate(200);
+  ASSERT_TRUE(a);
+  // Nothing to wait for while a is still being written.
+  EXPECT_FALSE(ring.allocate(100));
+
+  a->submit();
+  std::optional<qrk::StagingRing::Allocation> b = ring.allocate(100);
+  ASSERT_TRUE(b);
+  EXPECT_EQ(b->getOffset(), 0);
+  EXPECT_FALSE(ring.allocate(257));
+}
+
+}  // namespace
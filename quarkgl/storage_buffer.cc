@@ -0,0 +1,84 @@
+#include <qrk/storage_buffer.h>
+
+#include <cstring>
+
+namespace qrk {
+namespace {
+
+constexpr GLbitfield MAP_FLAGS =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+// How long to wait for a fence before checking it again.
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+}  // namespace
+
+StorageBuffer::StorageBuffer(unsigned int binding, size_t size)
+    : binding_(binding), size_(size) {
+  glCreateBuffers(1, &ssbo_);
+  glNamedBufferStorage(ssbo_, size_, nullptr, 0);
+}
+
+StorageBuffer::~StorageBuffer() { glDeleteBuffers(1, &ssbo_); }
+
+void StorageBuffer::bind() {
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding_, ssbo_);
+}
+
+MappedStorageBuffer::MappedStorageBuffer(unsigned int binding,
+                                         size_t regionSize)
+    : binding_(binding), regionSize_(regionSize) {
+  // Regions are bound by offset, which has to be aligned.
+  GLint offsetAlignment = 1;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+  const size_t alignment = offsetAlignment > 0 ? offsetAlignment : 1;
+  regionStride_ = (regionSize_ + alignment - 1) / alignment * alignment;
+
+  const size_t size = regionStride_ * REGION_COUNT;
+  glCreateBuffers(1, &ssbo_);
+  glNamedBufferStorage(ssbo_, size, nullptr, MAP_FLAGS);
+  mapped_ = static_cast<std::byte*>(
+      glMapNamedBufferRange(ssbo_, 0, size, MAP_FLAGS));
+  if (mapped_ == nullptr) {
+    throw StorageBufferException("ERROR::STORAGE_BUFFER::MAP_FAILED");
+  }
+  // Storage starts out undefined. Zero every region, so that a region that's
+  // bound before it's first written (e.g. an empty list) reads as empty rather
+  // than as garbage.
+  std::memset(mapped_, 0, size);
+}
+
+MappedStorageBuffer::~MappedStorageBuffer() {
+  for (GLsync fence : fences_) {
+    if (fence) glDeleteSync(fence);
+  }
+  glUnmapNamedBuffer(ssbo_);
+  glDeleteBuffers(1, &ssbo_);
+}
+
+std::byte* MappedStorageBuffer::nextRegion() {
+  if (fences_[region_]) glDeleteSync(fences_[region_]);
+  fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  region_ = (region_ + 1) % REGION_COUNT;
+  GLsync fence = fences_[region_];
+  if (fence) {
+    GLenum result;
+    do {
+      result =
+          glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+    } while (result == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(fence);
+    fences_[region_] = nullptr;
+    if (result == GL_WAIT_FAILED) {
+      throw StorageBufferException("ERROR::STORAGE_BUFFER::WAIT_FAILED");
+    }
+  }
+  return mapped_ + region_ * regionStride_;
+}
+
+void MappedStorageBuffer::bind() {
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding_, ssbo_,
+                    region_ * regionStride_, regionSize_);
+}
+
+}  // namespace qrk
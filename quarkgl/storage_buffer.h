@@ -0,0 +1,89 @@
+#ifndef QUARKGL_STORAGE_BUFFER_H_
+#define QUARKGL_STORAGE_BUFFER_H_
+
+#include <glad/glad.h>
+#include <qrk/exceptions.h>
+
+#include <array>
+#include <cstddef>
+
+namespace qrk {
+
+class StorageBufferException : public QuarkException {
+  using QuarkException::QuarkException;
+};
+
+// Binding points of the shader storage blocks shared by all programs. These
+// must match the bindings declared by the blocks in the built-in shaders.
+constexpr unsigned int DIRECTIONAL_LIGHT_STORAGE_BINDING = 0;
+constexpr unsigned int POINT_LIGHT_STORAGE_BINDING = 1;
+constexpr unsigned int SPOT_LIGHT_STORAGE_BINDING = 2;
+constexpr unsigned int LIGHT_CLUSTER_COUNT_STORAGE_BINDING = 3;
+constexpr unsigned int LIGHT_CLUSTER_INDEX_STORAGE_BINDING = 4;
+
+// A shader storage buffer that's only accessed by the GPU, e.g. to pass data
+// between a compute shader and later passes.
+class StorageBuffer {
+ public:
+  StorageBuffer(unsigned int binding, size_t size);
+  virtual ~StorageBuffer();
+  StorageBuffer(const StorageBuffer&) = delete;
+  StorageBuffer& operator=(const StorageBuffer&) = delete;
+
+  unsigned int getId() const { return ssbo_; }
+  unsigned int getBinding() const { return binding_; }
+  size_t getSize() const { return size_; }
+
+  // Binds the buffer to its binding point.
+  void bind();
+
+ private:
+  unsigned int ssbo_ = 0;
+  unsigned int binding_;
+  size_t size_;
+};
+
+// A shader storage buffer that stays mapped for writing. It's split into
+// regions that are written in turn, and each region is fenced when it's left,
+// so that the CPU never overwrites data that the GPU may still be reading.
+// Since every region holds its own copy of the data, callers that only rewrite
+// what has changed must track which regions are stale. Regions start out
+// zeroed.
+class MappedStorageBuffer {
+ public:
+  static constexpr unsigned int REGION_COUNT = 3;
+
+  MappedStorageBuffer(unsigned int binding, size_t regionSize);
+  virtual ~MappedStorageBuffer();
+  MappedStorageBuffer(const MappedStorageBuffer&) = delete;
+  MappedStorageBuffer& operator=(const MappedStorageBuffer&) = delete;
+
+  unsigned int getId() const { return ssbo_; }
+  unsigned int getBinding() const { return binding_; }
+  size_t getRegionSize() const { return regionSize_; }
+  // Returns the index of the region that was written last.
+  unsigned int getRegion() const { return region_; }
+
+  // Moves on to the next region, waiting until the GPU is done with it, and
+  // returns a pointer to write it through. Commands issued after this call
+  // must not read the previous region.
+  std::byte* nextRegion();
+  // Binds the current region to the binding point.
+  void bind();
+
+ private:
+  unsigned int ssbo_ = 0;
+  unsigned int binding_;
+  size_t regionSize_;
+  // The distance between regions, which is padded to the offset alignment.
+  size_t regionStride_;
+  std::byte* mapped_ = nullptr;
+  unsigned int region_ = 0;
+  // Signaled once the GPU has finished the commands that may read each
+  // region.
+  std::array<GLsync, REGION_COUNT> fences_ = {};
+};
+
+}  // namespace qrk
+
+#endif
@@ -1,10 +1,118 @@
 #include <glad/glad.h>
+#include <qrk/gl_state.h>
 #include <qrk/texture.h>
 #include <stb/stb_image.h>
 
+#include <algorithm>
+#include <cstring>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace qrk {
+namespace {
+// stb_image's own flip setting is global state, so it isn't safe to use while
+// decoding on multiple threads. Instead, we always decode unflipped and flip
+// rows ourselves.
+void flipRows(void* data, int width, int height, int bytesPerPixel) {
+  const size_t rowSize = static_cast<size_t>(width) * bytesPerPixel;
+  auto* bytes = static_cast<unsigned char*>(data);
+  for (int row = 0; row < height / 2; row++) {
+    unsigned char* top = bytes + row * rowSize;
+    unsigned char* bottom = bytes + (height - 1 - row) * rowSize;
+    std::swap_ranges(top, top + rowSize, bottom);
+  }
+}
+
+GLenum getCompressedInternalFormat(BlockFormat format, bool isSRGB) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return isSRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+                    : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3:
+      return isSRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                    : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4:
+      return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5:
+      return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7:
+      return isSRGB ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+                    : GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+  throw TextureException("ERROR::TEXTURE::UNSUPPORTED_TEXTURE_FORMAT\n" +
+                         std::string(blockFormatToString(format)));
+}
+
+// Returns the number of mips to allocate for a texture, given whether it
+// should have mips at all.
+int getNumMipsToAllocate(int width, int height, bool hasMips,
+                         int maxNumMips) {
+  if (!hasMips) return 1;
+  int numMips = calculateNumMips(width, height);
+  if (maxNumMips >= 0) {
+    numMips = std::clamp(maxNumMips, 1, numMips);
+  }
+  return numMips;
+}
+
+// Uploads tightly-packed 8-bit pixels to a level of the currently-bound
+// texture. GL's default unpack alignment of 4 would otherwise skew the rows of
+// images whose row size isn't a multiple of 4 (e.g. odd-sized RGB images).
+void uploadPixels(GLenum target, int level, int width, int height,
+                  GLenum dataFormat, const void* pixels) {
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(target, level, /*xoffset=*/0, /*yoffset=*/0, width, height,
+                  dataFormat, GL_UNSIGNED_BYTE, pixels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// Returns the size of a texel in an uncompressed format, or of a 4x4 block in
+// a block-compressed one.
+size_t getFormatSizeBytes(GLenum internalFormat, bool* isBlockCompressed) {
+  *isBlockCompressed = false;
+  switch (internalFormat) {
+    case GL_R8:
+    case GL_STENCIL_INDEX8:
+      return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+      return 2;
+    case GL_RGB16F:
+    case GL_RGBA16F:
+    case GL_RGB16_SNORM:
+    case GL_RGBA16_SNORM:
+    case GL_RG32F:
+      return 8;
+    case GL_RGB32F:
+    case GL_RGBA32F:
+      return 16;
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RED_RGTC1:
+      *isBlockCompressed = true;
+      return 8;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RG_RGTC2:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+      *isBlockCompressed = true;
+      return 16;
+    default:
+      // Most other formats (e.g. RGBA8, and RGB8 once padded) are 4 bytes.
+      return 4;
+  }
+}
+
+// Returns where data lies within a staged image, as a pointer for GL calls
+// that read from the bound GL_PIXEL_UNPACK_BUFFER. This is only an offset into
+// the buffer, and is null for the start of the ring, so it mustn't be used to
+// tell whether an image was staged.
+const unsigned char* getStagedData(const StagingRing::Allocation& staging,
+                                   size_t offset = 0) {
+  return reinterpret_cast<const unsigned char*>(staging.getOffset() + offset);
+}
+}  // namespace
 
 int calculateNumMips(int width, int height) {
   return 1 + static_cast<int>(std::floor(std::log2(std::max(width, height))));
@@ -26,6 +134,77 @@ ImageSize calculateMipLevel(int mip0Width, int mip0Height, int level) {
   return size;
 }
 
+void ImageDataDeleter::operator()(unsigned char* pixels) const {
+  stbi_image_free(pixels);
+}
+
+ImageData makeCompressedImageData(CompressedImageData compressed) {
+  ImageData image;
+  image.path = compressed.path;
+  image.width = compressed.width;
+  image.height = compressed.height;
+  image.numChannels = getNumChannels(compressed.format);
+  image.compressed = std::move(compressed);
+  return image;
+}
+
+ImageData decodeImage(const char* path, bool flipVertically) {
+  ImageData image;
+  image.path = path;
+  image.pixels.reset(stbi_load(path, &image.width, &image.height,
+                               &image.numChannels, /*desired_channels=*/0));
+  if (image.pixels == nullptr) {
+    throw TextureException("ERROR::TEXTURE::LOAD_FAILED\n" + std::string(path));
+  }
+  if (flipVertically) {
+    flipRows(image.pixels.get(), image.width, image.height, image.numChannels);
+  }
+  return image;
+}
+
+void generateCpuMips(ImageData& image, bool isSRGB, MipFilter filter) {
+  if (image.compressed) return;
+  image.mips = generateImageMips(image.pixels.get(), image.width,
+                                 image.height, image.numChannels, isSRGB,
+                                 filter);
+}
+
+bool stageImage(ImageData& image, StagingRing& ring) {
+  if (image.staging) return true;
+
+  if (image.compressed) {
+    std::vector<unsigned char>& data = image.compressed->data;
+    std::optional<StagingRing::Allocation> staging =
+        ring.tryAllocate(data.size());
+    if (!staging) return false;
+    std::memcpy(staging->getData(), data.data(), data.size());
+    data = std::vector<unsigned char>();
+    image.staging = std::move(staging);
+    return true;
+  }
+
+  // Mips are packed right after the base level. Their sizes are kept, so that
+  // they can be found again.
+  const size_t baseSize =
+      static_cast<size_t>(image.width) * image.height * image.numChannels;
+  size_t size = baseSize;
+  for (const ImageMip& mip : image.mips) size += mip.pixels.size();
+  std::optional<StagingRing::Allocation> staging = ring.tryAllocate(size);
+  if (!staging) return false;
+
+  std::byte* out = staging->getData();
+  std::memcpy(out, image.pixels.get(), baseSize);
+  out += baseSize;
+  for (ImageMip& mip : image.mips) {
+    std::memcpy(out, mip.pixels.data(), mip.pixels.size());
+    out += mip.pixels.size();
+    mip.pixels = std::vector<unsigned char>();
+  }
+  image.pixels.reset();
+  image.staging = std::move(staging);
+  return true;
+}
+
 Texture Texture::load(const char* path, bool isSRGB) {
   TextureParams params = {.filtering = TextureFiltering::ANISOTROPIC,
                           .wrapMode = TextureWrapMode::REPEAT};
@@ -34,19 +213,31 @@ Texture Texture::load(const char* path, bool isSRGB) {
 
 Texture Texture::load(const char* path, bool isSRGB,
                       const TextureParams& params) {
-  Texture texture;
-  texture.type_ = TextureType::TEXTURE_2D;
+  ImageData image = decodeImage(path, params.flipVerticallyOnLoad);
+  return loadFromImage(image, isSRGB, params);
+}
 
-  stbi_set_flip_vertically_on_load(params.flipVerticallyOnLoad);
-  unsigned char* data =
-      stbi_load(path, &texture.width_, &texture.height_, &texture.numChannels_,
-                /*desired_channels=*/0);
+Texture Texture::loadFromImage(const ImageData& image, bool isSRGB) {
+  TextureParams params = {.filtering = TextureFiltering::ANISOTROPIC,
+                          .wrapMode = TextureWrapMode::REPEAT};
+  return loadFromImage(image, isSRGB, params);
+}
 
-  if (data == nullptr) {
-    stbi_image_free(data);
-    throw TextureException("ERROR::TEXTURE::LOAD_FAILED\n" + std::string(path));
+Texture Texture::loadFromImage(const ImageData& image, bool isSRGB,
+                               const TextureParams& params) {
+  if (image.compressed) {
+    return loadCompressed(*image.compressed,
+                          image.staging ? &*image.staging : nullptr, isSRGB,
+                          params);
   }
 
+  Texture texture;
+  texture.type_ = TextureType::TEXTURE_2D;
+  texture.path_ = image.path;
+  texture.width_ = image.width;
+  texture.height_ = image.height;
+  texture.numChannels_ = image.numChannels;
+
   GLenum dataFormat;
   if (texture.numChannels_ == 1) {
     texture.internalFormat_ = GL_R8;
@@ -61,33 +252,129 @@ Texture Texture::load(const char* path, bool isSRGB,
     texture.internalFormat_ = isSRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
     dataFormat = GL_RGBA;
   } else {
-    stbi_image_free(data);
     throw TextureException(
         "ERROR::TEXTURE::UNSUPPORTED_TEXTURE_FORMAT\n"
         "Texture '" +
-        std::string(path) + "' contained unsupported number of channels: " +
+        image.path + "' contained unsupported number of channels: " +
         std::to_string(texture.numChannels_));
   }
 
   glGenTextures(1, &texture.id_);
-  glBindTexture(GL_TEXTURE_2D, texture.id_);
-
-  // TODO: Replace with glTexStorage2D
-  glTexImage2D(GL_TEXTURE_2D, /* mipmap level */ 0, texture.internalFormat_,
-               texture.width_, texture.height_, 0,
-               /* tex data format */ dataFormat, GL_UNSIGNED_BYTE, data);
-  if (params.generateMips >= MipGeneration::ON_LOAD) {
-    glGenerateMipmap(GL_TEXTURE_2D);
-    texture.numMips_ = calculateNumMips(texture.width_, texture.height_);
-    // TODO: Take into account params.maxNumMips
-  } else {
-    texture.numMips_ = 1;
+  GlState::current().bindTexture(GL_TEXTURE_2D, texture.id_);
+
+  texture.numMips_ = getNumMipsToAllocate(
+      texture.width_, texture.height_,
+      params.generateMips >= MipGeneration::ON_LOAD, params.maxNumMips);
+  glTexStorage2D(GL_TEXTURE_2D, texture.numMips_, texture.internalFormat_,
+                 texture.width_, texture.height_);
+
+  // Staged images are packed base level first, followed by their mips.
+  const bool isStaged = image.staging.has_value();
+  if (isStaged) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, image.staging->getBuffer());
+  }
+  uploadPixels(GL_TEXTURE_2D, /*level=*/0, texture.width_, texture.height_,
+               dataFormat,
+               isStaged ? getStagedData(*image.staging) : image.pixels.get());
+  if (texture.numMips_ > 1) {
+    if (image.mips.size() + 1 >= static_cast<size_t>(texture.numMips_)) {
+      size_t offset =
+          static_cast<size_t>(image.width) * image.height * image.numChannels;
+      for (int level = 1; level < texture.numMips_; level++) {
+        const ImageMip& mip = image.mips[level - 1];
+        uploadPixels(GL_TEXTURE_2D, level, mip.width, mip.height, dataFormat,
+                     isStaged ? getStagedData(*image.staging, offset)
+                              : mip.pixels.data());
+        offset += static_cast<size_t>(mip.width) * mip.height *
+                  image.numChannels;
+      }
+    } else {
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
+  }
+  if (isStaged) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    image.staging->submit();
   }
 
   // Set texture-wrapping/filtering options.
   applyParams(params, texture.type_);
 
-  stbi_image_free(data);
+  return texture;
+}
+
+Texture Texture::loadCompressed(const char* path, bool isSRGB) {
+  TextureParams params = {.filtering = TextureFiltering::ANISOTROPIC,
+                          .wrapMode = TextureWrapMode::REPEAT};
+  return loadCompressed(path, isSRGB, params);
+}
+
+Texture Texture::loadCompressed(const char* path, bool isSRGB,
+                                const TextureParams& params) {
+  CompressedImageData image;
+  try {
+    image = readCompressedImage(path, params.flipVerticallyOnLoad);
+  } catch (const CompressedTextureException& e) {
+    throw TextureException("ERROR::TEXTURE::LOAD_FAILED\n" +
+                           std::string(e.what()));
+  }
+  return loadCompressed(image, isSRGB, params);
+}
+
+Texture Texture::loadCompressed(const CompressedImageData& image, bool isSRGB,
+                                const TextureParams& params) {
+  return loadCompressed(image, /*staging=*/nullptr, isSRGB, params);
+}
+
+Texture Texture::loadCompressed(const CompressedImageData& image,
+                                const StagingRing::Allocation* staging,
+                                bool isSRGB, const TextureParams& params) {
+  if ((image.format == BlockFormat::BC1 || image.format == BlockFormat::BC3) &&
+      !GLAD_GL_EXT_texture_compression_s3tc) {
+    throw TextureException(
+        "ERROR::TEXTURE::UNSUPPORTED_TEXTURE_FORMAT\n"
+        "S3TC compression isn't supported, needed by texture '" +
+        image.path + "'");
+  }
+
+  Texture texture;
+  texture.type_ = TextureType::TEXTURE_2D;
+  texture.path_ = image.path;
+  texture.width_ = image.width;
+  texture.height_ = image.height;
+  texture.numChannels_ = qrk::getNumChannels(image.format);
+  texture.internalFormat_ = getCompressedInternalFormat(image.format, isSRGB);
+
+  // Use the image's own mips, since compressed textures can't generate their
+  // own.
+  texture.numMips_ = std::min(
+      getNumMipsToAllocate(texture.width_, texture.height_,
+                           params.generateMips >= MipGeneration::ON_LOAD,
+                           params.maxNumMips),
+      static_cast<int>(image.mips.size()));
+
+  glGenTextures(1, &texture.id_);
+  GlState::current().bindTexture(GL_TEXTURE_2D, texture.id_);
+
+  glTexStorage2D(GL_TEXTURE_2D, texture.numMips_, texture.internalFormat_,
+                 texture.width_, texture.height_);
+  if (staging) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging->getBuffer());
+  }
+  for (int level = 0; level < texture.numMips_; level++) {
+    const CompressedImageData::Mip& mip = image.mips[level];
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, level, /*xoffset=*/0,
+                              /*yoffset=*/0, mip.width, mip.height,
+                              texture.internalFormat_, mip.size,
+                              staging ? getStagedData(*staging, mip.offset)
+                                      : image.data.data() + mip.offset);
+  }
+  if (staging) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    staging->submit();
+  }
+
+  applyParams(params, texture.type_);
 
   return texture;
 }
@@ -103,7 +390,6 @@ Texture Texture::loadHdr(const char* path, const TextureParams& params) {
   texture.type_ = TextureType::TEXTURE_2D;
   texture.numMips_ = 1;
 
-  stbi_set_flip_vertically_on_load(true);
   float* data = stbi_loadf(path, &texture.width_, &texture.height_,
                            &texture.numChannels_, /*desired_channels=*/0);
 
@@ -111,6 +397,9 @@ Texture Texture::loadHdr(const char* path, const TextureParams& params) {
     stbi_image_free(data);
     throw TextureException("ERROR::TEXTURE::LOAD_FAILED\n" + std::string(path));
   }
+  // HDR images are always flipped.
+  flipRows(data, texture.width_, texture.height_,
+           texture.numChannels_ * sizeof(float));
 
   GLenum dataFormat;
   if (texture.numChannels_ == 1) {
@@ -135,12 +424,12 @@ Texture Texture::loadHdr(const char* path, const TextureParams& params) {
   }
 
   glGenTextures(1, &texture.id_);
-  glBindTexture(GL_TEXTURE_2D, texture.id_);
+  GlState::current().bindTexture(GL_TEXTURE_2D, texture.id_);
 
-  // TODO: Replace with glTexStorage2D
-  glTexImage2D(GL_TEXTURE_2D, /*mip=*/0, texture.internalFormat_,
-               texture.width_, texture.height_, 0,
-               /*tex data format=*/dataFormat, GL_FLOAT, data);
+  glTexStorage2D(GL_TEXTURE_2D, texture.numMips_, texture.internalFormat_,
+                 texture.width_, texture.height_);
+  glTexSubImage2D(GL_TEXTURE_2D, /*level=*/0, /*xoffset=*/0, /*yoffset=*/0,
+                  texture.width_, texture.height_, dataFormat, GL_FLOAT, data);
 
   // Set texture-wrapping/filtering options.
   applyParams(params, texture.type_);
@@ -152,7 +441,8 @@ Texture Texture::loadHdr(const char* path, const TextureParams& params) {
 
 Texture Texture::loadCubemap(std::vector<std::string> faces) {
   TextureParams params = {.filtering = TextureFiltering::BILINEAR,
-                          .wrapMode = TextureWrapMode::CLAMP_TO_EDGE};
+                          .wrapMode = TextureWrapMode::CLAMP_TO_EDGE,
+                          .generateMips = MipGeneration::NEVER};
   return loadCubemap(faces, params);
 }
 
@@ -166,11 +456,10 @@ Texture Texture::loadCubemap(std::vector<std::string> faces,
 
   Texture texture;
   texture.type_ = TextureType::CUBEMAP;
-  texture.numMips_ = 1;
   texture.internalFormat_ = GL_RGB8;  // Cubemaps must be RGB.
 
   glGenTextures(1, &texture.id_);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, texture.id_);
+  GlState::current().bindTexture(GL_TEXTURE_CUBE_MAP, texture.id_);
 
   int width, height, numChannels;
   bool initialized = false;
@@ -200,6 +489,12 @@ Texture Texture::loadCubemap(std::vector<std::string> faces,
       texture.width_ = width;
       texture.height_ = height;
       texture.numChannels_ = numChannels;
+      texture.numMips_ = getNumMipsToAllocate(
+          width, height, params.generateMips >= MipGeneration::ON_LOAD,
+          params.maxNumMips);
+      glTexStorage2D(GL_TEXTURE_CUBE_MAP, texture.numMips_,
+                     texture.internalFormat_, width, height);
+      initialized = true;
     } else if (width != texture.width_ || height != texture.height_) {
       throw TextureException(
           "ERROR::TEXTURE::INVALID_TEXTURE_SIZE\n"
@@ -207,13 +502,20 @@ Texture Texture::loadCubemap(std::vector<std::string> faces,
           faces[i] + "' was a different size than the first face");
     }
 
+    // Decoding no longer leaves stb_image's global flip set, so flip
+    // explicitly, as previously loaded textures would have by default.
+    if (params.flipVerticallyOnLoad) {
+      flipRows(data, width, height, numChannels);
+    }
+
     // Load into the next cube map texture position.
-    // TODO: Replace with glTexStorage2D
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, /*level=*/0,
-                 texture.internalFormat_, width, height, /*border=*/0,
-                 /*format=*/GL_RGB, /*type=*/GL_UNSIGNED_BYTE, data);
+    uploadPixels(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, /*level=*/0, width,
+                 height, GL_RGB, data);
     stbi_image_free(data);
   }
+  if (texture.numMips_ > 1) {
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+  }
 
   applyParams(params, texture.type_);
 
@@ -233,17 +535,13 @@ Texture Texture::create(int width, int height, GLenum internalFormat,
   texture.width_ = width;
   texture.height_ = height;
   texture.numChannels_ = 0;  // Default.
-  texture.numMips_ = 1;
-  if (params.generateMips == MipGeneration::ALWAYS) {
-    texture.numMips_ = calculateNumMips(texture.width_, texture.height_);
-    if (params.maxNumMips >= 0) {
-      texture.numMips_ = std::min(texture.numMips_, params.maxNumMips);
-    }
-  }
+  texture.numMips_ = getNumMipsToAllocate(
+      texture.width_, texture.height_,
+      params.generateMips == MipGeneration::ALWAYS, params.maxNumMips);
   texture.internalFormat_ = internalFormat;
 
   glGenTextures(1, &texture.id_);
-  glBindTexture(GL_TEXTURE_2D, texture.id_);
+  GlState::current().bindTexture(GL_TEXTURE_2D, texture.id_);
 
   glTexStorage2D(GL_TEXTURE_2D, texture.numMips_, texture.internalFormat_,
                  texture.width_, texture.height_);
@@ -267,17 +565,13 @@ Texture Texture::createCubemap(int size, GLenum internalFormat,
   texture.width_ = size;
   texture.height_ = size;
   texture.numChannels_ = 0;  // Default.
-  texture.numMips_ = 1;
-  if (params.generateMips == MipGeneration::ALWAYS) {
-    texture.numMips_ = calculateNumMips(texture.width_, texture.height_);
-    if (params.maxNumMips >= 0) {
-      texture.numMips_ = std::min(texture.numMips_, params.maxNumMips);
-    }
-  }
+  texture.numMips_ = getNumMipsToAllocate(
+      texture.width_, texture.height_,
+      params.generateMips == MipGeneration::ALWAYS, params.maxNumMips);
   texture.internalFormat_ = internalFormat;
 
   glGenTextures(1, &texture.id_);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, texture.id_);
+  GlState::current().bindTexture(GL_TEXTURE_CUBE_MAP, texture.id_);
 
   glTexStorage2D(GL_TEXTURE_CUBE_MAP, texture.numMips_, texture.internalFormat_,
                  texture.width_, texture.height_);
@@ -309,20 +603,37 @@ Texture Texture::createFromData(int width, int height, GLenum internalFormat,
   return texture;
 }
 
+size_t Texture::getSizeBytes() const {
+  bool isBlockCompressed;
+  const size_t unitSize =
+      getFormatSizeBytes(internalFormat_, &isBlockCompressed);
+  size_t size = 0;
+  ImageSize mip = {width_, height_};
+  for (int level = 0; level < numMips_; level++) {
+    if (isBlockCompressed) {
+      size += static_cast<size_t>((mip.width + 3) / 4) *
+              ((mip.height + 3) / 4) * unitSize;
+    } else {
+      size += static_cast<size_t>(mip.width) * mip.height * unitSize;
+    }
+    mip = calculateNextMip(mip);
+  }
+  return type_ == TextureType::CUBEMAP ? size * 6 : size;
+}
+
 void Texture::bindToUnit(unsigned int textureUnit, TextureBindType bindType) {
   // TODO: Take into account GL_MAX_TEXTURE_UNITS here.
-  glActiveTexture(GL_TEXTURE0 + textureUnit);
-
   if (bindType == TextureBindType::BY_TEXTURE_TYPE) {
     bindType = textureTypeToTextureBindType(type_);
   }
 
   switch (bindType) {
     case TextureBindType::TEXTURE_2D:
-      glBindTexture(GL_TEXTURE_2D, id_);
+      GlState::current().bindTextureToUnit(textureUnit, GL_TEXTURE_2D, id_);
       break;
     case TextureBindType::CUBEMAP:
-      glBindTexture(GL_TEXTURE_CUBE_MAP, id_);
+      GlState::current().bindTextureToUnit(textureUnit, GL_TEXTURE_CUBE_MAP,
+                                           id_);
       break;
     case TextureBindType::IMAGE_TEXTURE:
       // Bind image unit.
@@ -337,7 +648,7 @@ void Texture::bindToUnit(unsigned int textureUnit, TextureBindType bindType) {
 
 void Texture::setSamplerMipRange(int min, int max) {
   GLenum target = textureTypeToGlTarget(type_);
-  glBindTexture(target, id_);
+  GlState::current().bindTexture(target, id_);
   glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, min);
   glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, max);
 }
@@ -347,7 +658,10 @@ void Texture::unsetSamplerMipRange() {
   setSamplerMipRange(0, 1000);
 }
 
-void Texture::free() { glDeleteTextures(1, &id_); }
+void Texture::free() {
+  glDeleteTextures(1, &id_);
+  GlState::current().onTextureDeleted(id_);
+}
 
 void Texture::generateMips(int maxNumMips) {
   if (maxNumMips >= 0) {
@@ -355,7 +669,7 @@ void Texture::generateMips(int maxNumMips) {
   }
 
   GLenum target = textureTypeToGlTarget(type_);
-  glBindTexture(target, id_);
+  GlState::current().bindTexture(target, id_);
   glGenerateMipmap(target);
 
   if (maxNumMips >= 0) {
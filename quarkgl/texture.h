@@ -1,10 +1,15 @@
 #ifndef QUARKGL_TEXTURE_H_
 #define QUARKGL_TEXTURE_H_
 
+#include <qrk/compressed_texture.h>
 #include <qrk/exceptions.h>
+#include <qrk/image_mips.h>
 #include <qrk/screen.h>
+#include <qrk/staging_ring.h>
 
 #include <glm/glm.hpp>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -102,6 +107,56 @@ ImageSize calculateNextMip(const ImageSize& mipSize);
 // Returns the calculated size for a mip level.
 ImageSize calculateMipLevel(int mip0Width, int mip0Height, int level);
 
+struct ImageDataDeleter {
+  void operator()(unsigned char* pixels) const;
+};
+
+// Decoded, CPU-side 8-bit image data, ready to be uploaded to a texture.
+struct ImageData {
+  std::string path;
+  int width = 0;
+  int height = 0;
+  int numChannels = 0;
+  std::unique_ptr<unsigned char, ImageDataDeleter> pixels;
+  // Mips below the base level, if they were generated on the CPU (see
+  // generateCpuMips()). Otherwise, mips are generated by the driver on upload.
+  std::vector<ImageMip> mips;
+  // If set, the image is block-compressed, and is uploaded from here instead
+  // of from pixels.
+  std::optional<CompressedImageData> compressed;
+  // If set, the image's data has been moved into staging memory (see
+  // stageImage()), and is uploaded from there.
+  std::optional<StagingRing::Allocation> staging;
+
+  size_t getSizeBytes() const {
+    if (staging) return staging->getSize();
+    if (compressed) return compressed->getSizeBytes();
+    size_t size = static_cast<size_t>(width) * height * numChannels;
+    for (const ImageMip& mip : mips) size += mip.pixels.size();
+    return size;
+  }
+};
+
+// Wraps block-compressed image data, so that it can be uploaded like any other
+// decoded image.
+ImageData makeCompressedImageData(CompressedImageData compressed);
+
+// Decodes an image from the given path. Doesn't touch any GL state, so this is
+// safe to call from any thread.
+ImageData decodeImage(const char* path, bool flipVertically = true);
+
+// Generates the image's full mip chain on the CPU, so that it doesn't have to
+// be generated on the GL thread when uploading. Doesn't touch any GL state, so
+// this is safe to call from any thread (e.g. right after decoding).
+void generateCpuMips(ImageData& image, bool isSRGB,
+                     MipFilter filter = MipFilter::BOX);
+
+// Moves the image's data, including any mips, into staging memory, so that
+// uploading it is only a copy on the GPU. Returns false, leaving the image
+// as-is, if the ring doesn't have room. Doesn't touch any GL state, so this is
+// safe to call from any thread (e.g. right after decoding).
+bool stageImage(ImageData& image, StagingRing& ring);
+
 class Texture {
  public:
   // Loads a texture from a given path.
@@ -109,6 +164,23 @@ class Texture {
   static Texture load(const char* path, bool isSRGB = true);
   static Texture load(const char* path, bool isSRGB,
                       const TextureParams& params);
+  // Uploads an already-decoded image. The image's flip is used as-is, so
+  // params.flipVerticallyOnLoad is ignored. Uses the image's CPU-generated
+  // mips if it has them, and copies from staging memory if it was staged.
+  static Texture loadFromImage(const ImageData& image, bool isSRGB = true);
+  static Texture loadFromImage(const ImageData& image, bool isSRGB,
+                               const TextureParams& params);
+
+  // Loads a block-compressed texture from a DDS or KTX2 file, along with any
+  // mips that it contains. Mips can't be generated for compressed textures, so
+  // only the file's own mips are used, unless params.generateMips is NEVER.
+  static Texture loadCompressed(const char* path, bool isSRGB = true);
+  static Texture loadCompressed(const char* path, bool isSRGB,
+                                const TextureParams& params);
+  // Uploads already-loaded compressed image data. The image's flip is used
+  // as-is, so params.flipVerticallyOnLoad is ignored.
+  static Texture loadCompressed(const CompressedImageData& image, bool isSRGB,
+                                const TextureParams& params);
 
   // Loads an HDR texture from the given path.
   static Texture loadHdr(const char* path);
@@ -117,7 +189,8 @@ class Texture {
   // Loads a cubemap from a set of 6 textures for the faces. Textures must be
   // passed in order starting with GL_TEXTURE_CUBE_MAP_POSITIVE_X and
   // incrementing from there; namely, in the order right, left, top, bottom,
-  // front, and back.
+  // front, and back. Faces are flipped according to
+  // params.flipVerticallyOnLoad, like other textures.
   static Texture loadCubemap(std::vector<std::string> faces);
   static Texture loadCubemap(std::vector<std::string> faces,
                              const TextureParams& params);
@@ -137,7 +210,9 @@ class Texture {
                                 const std::vector<glm::vec3>& data,
                                 const TextureParams& params);
 
-  // TODO: Replace this with proper RAII.
+  // Deletes the texture. Textures are plain handles that can be freely copied,
+  // so this isn't done automatically; instead, model textures are owned by a
+  // TextureResidencyManager, and attachments by their Framebuffer.
   void free();
 
   // Binds the texture to the given texture unit.
@@ -147,8 +222,8 @@ class Texture {
   void bindToUnit(unsigned int textureUnit,
                   TextureBindType bindType = TextureBindType::BY_TEXTURE_TYPE);
 
-  // Generates mipmaps for the current texture. Note that this will not succeed
-  // for textures with immutable storage.
+  // Generates mipmaps for the current texture. Textures have immutable
+  // storage, so only the mips that were allocated up front are generated.
   void generateMips(int maxNumMips = -1);
 
   // Sets a min/max mip level allowed when sampling from this texture. This is
@@ -167,11 +242,14 @@ class Texture {
   int getHeight() const { return height_; }
   int getNumChannels() const { return numChannels_; }
   int getNumMips() const { return numMips_; }
+  // Returns an estimate of the texture's size in VRAM, including its mips.
+  // RGB formats are assumed to be padded out to RGBA, as drivers tend to.
+  size_t getSizeBytes() const;
   // TODO: Remove GLenum from this API (use a custom enum).
   GLenum getInternalFormat() const { return internalFormat_; }
 
  private:
-  // TODO: Texture lifetimes aren't managed currently, so they aren't unloaded.
+  // The GL texture isn't owned by the handle; see free().
   unsigned int id_;
   TextureType type_;
   std::string path_;
@@ -181,6 +259,11 @@ class Texture {
   int numMips_;
   GLenum internalFormat_;
 
+  // Uploads compressed image data, copying it from staging memory if given.
+  static Texture loadCompressed(const CompressedImageData& image,
+                                const StagingRing::Allocation* staging,
+                                bool isSRGB, const TextureParams& params);
+
   // Applies the given params to the currently-active texture.
   static void applyParams(const TextureParams& params,
                           TextureType type = TextureType::TEXTURE_2D);
@@ -4,7 +4,9 @@
 #include <assimp/scene.h>
 #include <qrk/exceptions.h>
 #include <qrk/texture.h>
+#include <qrk/virtual_texture.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -70,8 +72,21 @@ class TextureMap {
  public:
   TextureMap(const Texture& texture, TextureMapType type, bool isPacked = false)
       : texture_(texture), type_(type), packed_(isPacked) {}
+  // A map that's streamed in through a virtual texture. Virtual textures are
+  // only sampled as diffuse maps, so maps of any other type are ignored.
+  TextureMap(std::shared_ptr<VirtualTexture> virtualTexture,
+             TextureMapType type)
+      : texture_(virtualTexture->getPageTable()),
+        type_(type),
+        packed_(false),
+        virtualTexture_(std::move(virtualTexture)) {}
 
+  // For virtual maps, this is the virtual texture's page table.
   Texture& getTexture() { return texture_; }
+  bool isVirtual() const { return virtualTexture_ != nullptr; }
+  const std::shared_ptr<VirtualTexture>& getVirtualTexture() const {
+    return virtualTexture_;
+  }
   TextureMapType getType() const { return type_; }
   bool isPacked() const { return packed_; }
   void setPacked(bool packed) { packed_ = packed; }
@@ -81,6 +96,7 @@ class TextureMap {
   TextureMapType type_;
   // Whether the texture type is part of a packed texture.
   bool packed_;
+  std::shared_ptr<VirtualTexture> virtualTexture_;
 };
 }  // namespace qrk
 
@@ -0,0 +1,98 @@
+#include <qrk/texture_residency.h>
+
+namespace qrk {
+
+TextureResidencyManager::~TextureResidencyManager() {
+  for (auto& [key, entry] : entries_) {
+    entry.texture.free();
+  }
+}
+
+TextureResidencyManager::TextureRef TextureResidencyManager::find(
+    const std::string& path, bool isSRGB) {
+  auto it = entries_.find({path, isSRGB});
+  if (it == entries_.end()) {
+    stats_.misses++;
+    return nullptr;
+  }
+  stats_.hits++;
+  if (TextureRef ref = it->second.ref.lock()) return ref;
+  return acquire(it);
+}
+
+TextureResidencyManager::TextureRef TextureResidencyManager::insert(
+    const std::string& path, bool isSRGB, const Texture& texture) {
+  auto it = entries_.find({path, isSRGB});
+  if (it != entries_.end()) {
+    if (texture.getId() != it->second.texture.getId()) {
+      Texture duplicate = texture;
+      duplicate.free();
+    }
+    if (TextureRef ref = it->second.ref.lock()) return ref;
+    return acquire(it);
+  }
+
+  const size_t sizeBytes = texture.getSizeBytes();
+  it = entries_
+           .emplace(Key(path, isSRGB),
+                    Entry{.texture = texture,
+                          .sizeBytes = sizeBytes,
+                          // Set by acquire() below.
+                          .ref = {},
+                          .lruPosition = unreferenced_.end()})
+           .first;
+  stats_.residentBytes += sizeBytes;
+  stats_.numResident++;
+  TextureRef ref = acquire(it);
+  // Make room for the new texture.
+  evictToBudget(budgetBytes_);
+  return ref;
+}
+
+void TextureResidencyManager::setBudgetBytes(size_t budgetBytes) {
+  budgetBytes_ = budgetBytes;
+  evictToBudget(budgetBytes_);
+}
+
+void TextureResidencyManager::evictUnreferenced() { evictToBudget(0); }
+
+TextureResidencyManager::TextureRef TextureResidencyManager::acquire(
+    std::map<Key, Entry>::iterator it) {
+  Entry& entry = it->second;
+  if (entry.lruPosition != unreferenced_.end()) {
+    unreferenced_.erase(entry.lruPosition);
+    entry.lruPosition = unreferenced_.end();
+    stats_.unreferencedBytes -= entry.sizeBytes;
+  }
+  // The texture itself is owned by the entry, so dropping the last reference
+  // only hands it back.
+  TextureRef ref(&entry.texture,
+                 [this, key = it->first](Texture*) { release(key); });
+  entry.ref = ref;
+  return ref;
+}
+
+void TextureResidencyManager::release(const Key& key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) return;
+  Entry& entry = it->second;
+  entry.lruPosition = unreferenced_.insert(unreferenced_.begin(), key);
+  stats_.unreferencedBytes += entry.sizeBytes;
+  evictToBudget(budgetBytes_);
+}
+
+void TextureResidencyManager::evictToBudget(size_t budgetBytes) {
+  while (stats_.residentBytes > budgetBytes && !unreferenced_.empty()) {
+    auto it = entries_.find(unreferenced_.back());
+    unreferenced_.pop_back();
+    Entry& entry = it->second;
+    entry.texture.free();
+    stats_.residentBytes -= entry.sizeBytes;
+    stats_.unreferencedBytes -= entry.sizeBytes;
+    stats_.numResident--;
+    stats_.evictions++;
+    entries_.erase(it);
+  }
+}
+
+}  // namespace qrk
@@ -0,0 +1,99 @@
+#ifndef QUARKGL_TEXTURE_RESIDENCY_H_
+#define QUARKGL_TEXTURE_RESIDENCY_H_
+
+#include <qrk/texture.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace qrk {
+
+struct TextureResidencyStats {
+  // The estimated size of every resident texture, referenced or not.
+  size_t residentBytes = 0;
+  // The part of residentBytes that nothing references, and could be evicted.
+  size_t unreferencedBytes = 0;
+  unsigned int numResident = 0;
+  unsigned int hits = 0;
+  unsigned int misses = 0;
+  unsigned int evictions = 0;
+
+  float getHitRate() const {
+    const unsigned int lookups = hits + misses;
+    return lookups == 0 ? 0.0f : static_cast<float>(hits) / lookups;
+  }
+};
+
+// A reference-counted cache of loaded textures, keyed by path and color
+// space, which lets models share textures rather than each loading their own.
+// Textures stay resident while they're referenced. Once they aren't, they're
+// kept around in case they're needed again, and are freed in least recently
+// used order to keep the total under a VRAM budget. Referenced textures are
+// never evicted, so the budget can be exceeded while they're in use.
+//
+// Should only be used from the GL thread. References must not outlive the
+// manager, which frees every texture that it still holds when destroyed.
+class TextureResidencyManager {
+ public:
+  // A reference to a resident texture.
+  using TextureRef = std::shared_ptr<Texture>;
+
+  // 512MB.
+  static constexpr size_t DEFAULT_BUDGET_BYTES = 512 * 1024 * 1024;
+
+  explicit TextureResidencyManager(size_t budgetBytes = DEFAULT_BUDGET_BYTES)
+      : budgetBytes_(budgetBytes) {}
+  ~TextureResidencyManager();
+  TextureResidencyManager(const TextureResidencyManager&) = delete;
+  TextureResidencyManager& operator=(const TextureResidencyManager&) = delete;
+
+  // Returns a reference to the resident texture for the key, or nullptr if
+  // it isn't resident. Counts towards the hit rate.
+  TextureRef find(const std::string& path, bool isSRGB);
+  // Takes ownership of a newly loaded texture, and returns a reference to it.
+  // If the key is already resident (e.g. if it was loaded twice at once), the
+  // new texture is freed and the resident one is returned instead.
+  TextureRef insert(const std::string& path, bool isSRGB,
+                    const Texture& texture);
+
+  size_t getBudgetBytes() const { return budgetBytes_; }
+  // Sets the budget, evicting unreferenced textures to meet it.
+  void setBudgetBytes(size_t budgetBytes);
+  // Frees every unreferenced texture, regardless of the budget.
+  void evictUnreferenced();
+
+  const TextureResidencyStats& getStats() const { return stats_; }
+
+ private:
+  using Key = std::pair<std::string, bool>;
+
+  struct Entry {
+    Texture texture;
+    size_t sizeBytes;
+    // Set while the texture is referenced.
+    std::weak_ptr<Texture> ref;
+    // The entry's place in unreferenced_, while it isn't referenced.
+    std::list<Key>::iterator lruPosition;
+  };
+
+  // Returns a new reference to an entry that isn't referenced.
+  TextureRef acquire(std::map<Key, Entry>::iterator it);
+  // Called when an entry's last reference is dropped.
+  void release(const Key& key);
+  // Evicts unreferenced entries until resident textures fit in the budget.
+  void evictToBudget(size_t budgetBytes);
+
+  size_t budgetBytes_;
+  // Entries are never moved, so references can point into them.
+  std::map<Key, Entry> entries_;
+  // Unreferenced entries, most recently released first.
+  std::list<Key> unreferenced_;
+  TextureResidencyStats stats_;
+};
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <qrk/texture_residency.h>
+
+#include <vector>
+
+namespace {
+
+// Textures are created and deleted through these, in place of a real context.
+GLuint nextTexture = 1;
+std::vector<GLuint> deleted;
+
+void APIENTRY fakeGenTextures(GLsizei n, GLuint* textures) {
+  *textures = nextTexture++;
+}
+void APIENTRY fakeDeleteTextures(GLsizei n, const GLuint* textures) {
+  deleted.push_back(*textures);
+}
+void APIENTRY fakeBindTexture(GLenum target, GLuint texture) {}
+void APIENTRY fakeTexStorage2D(GLenum target, GLsizei levels,
+                               GLenum internalformat, GLsizei width,
+                               GLsizei height) {}
+void APIENTRY fakeTexParameteri(GLenum target, GLenum pname, GLint param) {}
+
+class TextureResidencyTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    glad_glGenTextures = fakeGenTextures;
+    glad_glDeleteTextures = fakeDeleteTextures;
+    glad_glBindTexture = fakeBindTexture;
+    glad_glTexStorage2D = fakeTexStorage2D;
+    glad_glTexParameteri = fakeTexParameteri;
+    deleted.clear();
+  }
+
+  // Creates a 16x16 RGBA8 texture without mips, which takes up 1KB.
+  qrk::Texture createTexture() {
+    return qrk::Texture::create(16, 16, GL_RGBA8);
+  }
+};
+
+TEST_F(TextureResidencyTest, EstimatesTextureSizes) {
+  EXPECT_EQ(createTexture().getSizeBytes(), 1024);
+  qrk::Texture withMips = qrk::Texture::create(
+      4, 4, GL_R8, {.generateMips = qrk::MipGeneration::ALWAYS});
+  EXPECT_EQ(withMips.getSizeBytes(), 16 + 4 + 1);
+  qrk::Texture cubemap = qrk::Texture::createCubemap(4, GL_RGB16F);
+  EXPECT_EQ(cubemap.getSizeBytes(), 4 * 4 * 8 * 6);
+}
+
+TEST_F(TextureResidencyTest, SharesTexturesByPathAndColorSpace) {
+  qrk::TextureResidencyManager manager;
+  EXPECT_EQ(manager.find("a.png", true), nullptr);
+
+  qrk::Texture texture = createTexture();
+  auto ref = manager.insert("a.png", true, texture);
+  EXPECT_EQ(ref->getId(), texture.getId());
+  auto hit = manager.find("a.png", true);
+  EXPECT_EQ(hit, ref);
+  EXPECT_EQ(manager.find("a.png", false), nullptr);
+
+  const qrk::TextureResidencyStats& stats = manager.getStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_FLOAT_EQ(stats.getHitRate(), 1.0f / 3.0f);
+  EXPECT_EQ(stats.numResident, 1);
+  EXPECT_EQ(stats.residentBytes, 1024);
+  EXPECT_EQ(stats.unreferencedBytes, 0);
+}
+
+TEST_F(TextureResidencyTest, FreesDuplicateInserts) {
+  qrk::TextureResidencyManager manager;
+  qrk::Texture first = createTexture();
+  qrk::Texture second = createTexture();
+  auto ref = manager.insert("a.png", true, first);
+  auto duplicate = manager.insert("a.png", true, second);
+  EXPECT_EQ(duplicate, ref);
+  EXPECT_EQ(deleted, std::vector<GLuint>{second.getId()});
+  EXPECT_EQ(manager.getStats().numResident, 1);
+}
+
+TEST_F(TextureResidencyTest, KeepsUnreferencedTexturesWithinBudget) {
+  qrk::TextureResidencyManager manager(/*budgetBytes=*/2048);
+  qrk::Texture a = createTexture();
+  qrk::Texture b = createTexture();
+  qrk::Texture c = createTexture();
+  manager.insert("a.png", true, a);
+  manager.insert("b.png", true, b);
+  // Both are unreferenced, but fit.
+  EXPECT_TRUE(deleted.empty());
+  EXPECT_EQ(manager.getStats().unreferencedBytes, 2048);
+
+  // Using a again makes b the least recently used.
+  manager.find("a.png", true);
+  auto cRef = manager.insert("c.png", true, c);
+  EXPECT_EQ(deleted, std::vector<GLuint>{b.getId()});
+  EXPECT_EQ(manager.getStats().evictions, 1);
+  EXPECT_EQ(manager.find("b.png", true), nullptr);
+  EXPECT_NE(manager.find("a.png", true), nullptr);
+}
+
+TEST_F(TextureResidencyTest, NeverEvictsReferencedTextures) {
+  qrk::TextureResidencyManager manager(/*budgetBytes=*/1024);
+  qrk::Texture a = createTexture();
+  qrk::Texture b = createTexture();
+  auto aRef = manager.insert("a.png", true, a);
+  auto bRef = manager.insert("b.png", true, b);
+  EXPECT_TRUE(deleted.empty());
+  EXPECT_EQ(manager.getStats().residentBytes, 2048);
+
+  bRef.reset();
+  EXPECT_EQ(deleted, std::vector<GLuint>{b.getId()});
+  EXPECT_EQ(manager.getStats().residentBytes, 1024);
+
+  aRef.reset();
+  manager.evictUnreferenced();
+  EXPECT_EQ(deleted, (std::vector<GLuint>{b.getId(), a.getId()}));
+  EXPECT_EQ(manager.getStats().numResident, 0);
+}
+
+TEST_F(TextureResidencyTest, FreesEverythingWhenDestroyed) {
+  qrk::Texture a = createTexture();
+  {
+    qrk::TextureResidencyManager manager;
+    manager.insert("a.png", true, a);
+  }
+  EXPECT_EQ(deleted, std::vector<GLuint>{a.getId()});
+}
+
+}  // namespace
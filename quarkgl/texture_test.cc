@@ -1,6 +1,14 @@
 #include <gtest/gtest.h>
+#include <qrk/staging_ring.h>
 #include <qrk/texture.h>
 
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
 namespace {
 
 TEST(CalculateNumMipsTest, Small) {
@@ -54,4 +62,150 @@ TEST(CalculateMipLevelTest, Far) {
   EXPECT_EQ(qrk::calculateMipLevel(512, 512, 3), expected);
 }
 
-}  // namespace
\ No newline at end of file
+TEST(DecodeImageTest, MissingFileThrows) {
+  EXPECT_THROW(qrk::decodeImage("does/not/exist.png"), qrk::TextureException);
+}
+
+// Stands in for a real context. Uploads are recorded, along with the unpack
+// buffer that was bound when they were made.
+struct Upload {
+  int level;
+  GLuint unpackBuffer;
+  uintptr_t pixels;
+  // The first byte of client memory uploads.
+  unsigned char firstByte;
+};
+std::vector<Upload> uploads;
+std::vector<std::byte> mapped;
+GLuint unpackBuffer = 0;
+
+void APIENTRY fakeGenTextures(GLsizei n, GLuint* textures) { *textures = 1; }
+void APIENTRY fakeBindTexture(GLenum target, GLuint texture) {}
+void APIENTRY fakeTexStorage2D(GLenum target, GLsizei levels,
+                               GLenum internalformat, GLsizei width,
+                               GLsizei height) {}
+void APIENTRY fakeTexParameteri(GLenum target, GLenum pname, GLint param) {}
+void APIENTRY fakePixelStorei(GLenum pname, GLint param) {}
+void APIENTRY fakeBindBuffer(GLenum target, GLuint buffer) {
+  if (target == GL_PIXEL_UNPACK_BUFFER) unpackBuffer = buffer;
+}
+void APIENTRY fakeTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+                                GLint yoffset, GLsizei width, GLsizei height,
+                                GLenum format, GLenum type,
+                                const void* pixels) {
+  const unsigned char firstByte =
+      unpackBuffer == 0 ? *static_cast<const unsigned char*>(pixels) : 0;
+  uploads.push_back({.level = level,
+                     .unpackBuffer = unpackBuffer,
+                     .pixels = reinterpret_cast<uintptr_t>(pixels),
+                     .firstByte = firstByte});
+}
+void APIENTRY fakeGenerateMipmap(GLenum target) {
+  ADD_FAILURE() << "CPU-generated mips shouldn't be regenerated";
+}
+void APIENTRY fakeCreateBuffers(GLsizei n, GLuint* buffers) { *buffers = 7; }
+void APIENTRY fakeNamedBufferStorage(GLuint buffer, GLsizeiptr size,
+                                     const void* data, GLbitfield flags) {
+  mapped.assign(size, std::byte{0});
+}
+void* APIENTRY fakeMapNamedBufferRange(GLuint buffer, GLintptr offset,
+                                       GLsizeiptr length, GLbitfield access) {
+  return mapped.data() + offset;
+}
+GLboolean APIENTRY fakeUnmapNamedBuffer(GLuint buffer) { return GL_TRUE; }
+void APIENTRY fakeDeleteBuffers(GLsizei n, const GLuint* buffers) {}
+GLsync APIENTRY fakeFenceSync(GLenum condition, GLbitfield flags) {
+  return reinterpret_cast<GLsync>(1);
+}
+GLenum APIENTRY fakeClientWaitSync(GLsync fence, GLbitfield flags,
+                                   GLuint64 timeout) {
+  return GL_ALREADY_SIGNALED;
+}
+void APIENTRY fakeDeleteSync(GLsync fence) {}
+
+class StagedUploadTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    glad_glGenTextures = fakeGenTextures;
+    glad_glBindTexture = fakeBindTexture;
+    glad_glTexStorage2D = fakeTexStorage2D;
+    glad_glTexParameteri = fakeTexParameteri;
+    glad_glPixelStorei = fakePixelStorei;
+    glad_glBindBuffer = fakeBindBuffer;
+    glad_glTexSubImage2D = fakeTexSubImage2D;
+    glad_glGenerateMipmap = fakeGenerateMipmap;
+    glad_glCreateBuffers = fakeCreateBuffers;
+    glad_glNamedBufferStorage = fakeNamedBufferStorage;
+    glad_glMapNamedBufferRange = fakeMapNamedBufferRange;
+    glad_glUnmapNamedBuffer = fakeUnmapNamedBuffer;
+    glad_glDeleteBuffers = fakeDeleteBuffers;
+    glad_glFenceSync = fakeFenceSync;
+    glad_glClientWaitSync = fakeClientWaitSync;
+    glad_glDeleteSync = fakeDeleteSync;
+    uploads.clear();
+    unpackBuffer = 0;
+  }
+
+  // Creates a 4x4 RGBA image, as if it had been decoded.
+  qrk::ImageData createImage() {
+    qrk::ImageData image;
+    image.width = 4;
+    image.height = 4;
+    image.numChannels = 4;
+    // Freed with stbi_image_free(), which is free() by default.
+    image.pixels.reset(static_cast<unsigned char*>(std::malloc(64)));
+    std::memset(image.pixels.get(), 128, 64);
+    return image;
+  }
+};
+
+TEST_F(StagedUploadTest, UploadsCpuMipsFromTheStartOfTheRing) {
+  qrk::StagingRing ring(1024);
+  qrk::ImageData image = createImage();
+  qrk::generateCpuMips(image, /*isSRGB=*/false);
+  ASSERT_EQ(image.mips.size(), 2);
+  ASSERT_TRUE(qrk::stageImage(image, ring));
+  // The first allocation starts at offset 0, which GL takes as a null pointer.
+  ASSERT_EQ(image.staging->getOffset(), 0);
+
+  qrk::Texture::loadFromImage(
+      image, /*isSRGB=*/false,
+      {.filtering = qrk::TextureFiltering::BILINEAR,
+       .generateMips = qrk::MipGeneration::ON_LOAD});
+
+  // Each level is read from its own place in the ring: 4x4, then 2x2, then 1x1
+  // texels, right after one another.
+  ASSERT_EQ(uploads.size(), 3);
+  const uintptr_t expectedOffsets[] = {0, 64, 64 + 16};
+  for (int level = 0; level < 3; level++) {
+    EXPECT_EQ(uploads[level].level, level);
+    EXPECT_EQ(uploads[level].unpackBuffer, 7);
+    EXPECT_EQ(uploads[level].pixels, expectedOffsets[level]);
+  }
+  EXPECT_EQ(unpackBuffer, 0);
+}
+
+// Uses the same fake context.
+class CubemapTest : public StagedUploadTest {};
+
+TEST_F(CubemapTest, FlipsFacesByDefault) {
+  // A 2x2 face with a red top row and a blue bottom row.
+  const std::string path = testing::TempDir() + "/cubemap_face.ppm";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n2 2\n255\n";
+    const char pixels[] = {'\xff', 0, 0, '\xff', 0, 0,
+                           0,      0, '\xff', 0, 0, '\xff'};
+    file.write(pixels, sizeof(pixels));
+  }
+
+  qrk::Texture::loadCubemap(std::vector<std::string>(6, path));
+
+  // Each face is uploaded bottom row first.
+  ASSERT_EQ(uploads.size(), 6);
+  for (const Upload& upload : uploads) {
+    EXPECT_EQ(upload.firstByte, 0);
+  }
+}
+
+}  // namespace
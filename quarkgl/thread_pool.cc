@@ -0,0 +1,55 @@
+#include <qrk/thread_pool.h>
+
+#include <algorithm>
+
+namespace qrk {
+
+ThreadPool::ThreadPool(unsigned int numThreads) {
+  numThreads = std::max(numThreads, 1u);
+  workers_.reserve(numThreads);
+  for (unsigned int i = 0; i < numThreads; i++) {
+    workers_.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+unsigned int ThreadPool::getDefaultNumThreads() {
+  // hardware_concurrency() may return 0 if it can't be determined.
+  unsigned int hardwareThreads = std::thread::hardware_concurrency();
+  return std::max(hardwareThreads, 2u) - 1;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      // Drain the queue before stopping.
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace qrk
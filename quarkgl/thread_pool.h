@@ -0,0 +1,58 @@
+#ifndef QUARKGL_THREAD_POOL_H_
+#define QUARKGL_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace qrk {
+
+// A simple fixed-size pool of worker threads that run tasks in FIFO order.
+// Tasks must not touch GL state, since workers don't own a GL context.
+class ThreadPool {
+ public:
+  explicit ThreadPool(unsigned int numThreads = getDefaultNumThreads());
+  // Finishes all queued tasks before joining the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Queues a task, returning a future for its result. Exceptions thrown by the
+  // task are rethrown from the future.
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& task) {
+    using Result = std::invoke_result_t<std::decay_t<F>>;
+    // std::function requires copyable callables, so the task is shared.
+    auto packaged =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return future;
+  }
+
+  unsigned int getNumThreads() const { return workers_.size(); }
+
+  // Returns the number of hardware threads, minus one for the main thread.
+  static unsigned int getDefaultNumThreads();
+
+ private:
+  void enqueue(std::function<void()> task);
+  void workerLoop();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_ = false;
+};
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <qrk/thread_pool.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+TEST(ThreadPoolTest, ReturnsResults) {
+  qrk::ThreadPool pool(4);
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; i++) {
+    results.push_back(pool.submit([i]() { return i * i; }));
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(results[i].get(), i * i);
+  }
+}
+
+TEST(ThreadPoolTest, PropagatesExceptions) {
+  qrk::ThreadPool pool(2);
+  auto result = pool.submit([]() -> int { throw std::runtime_error("oops"); });
+  EXPECT_THROW(result.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTest, DrainsOnDestruction) {
+  std::atomic<int> count = 0;
+  {
+    qrk::ThreadPool pool(3);
+    for (int i = 0; i < 50; i++) {
+      pool.submit([&count]() { count++; });
+    }
+  }
+  EXPECT_EQ(count, 50);
+}
+
+TEST(ThreadPoolTest, AlwaysHasAWorker) {
+  qrk::ThreadPool pool(0);
+  EXPECT_EQ(pool.getNumThreads(), 1);
+  EXPECT_EQ(pool.submit([]() { return 42; }).get(), 42);
+}
+
+}  // namespace
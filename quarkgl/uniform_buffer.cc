@@ -0,0 +1,23 @@
+#include <qrk/uniform_buffer.h>
+
+namespace qrk {
+
+UniformBuffer::UniformBuffer(unsigned int binding, size_t size)
+    : binding_(binding), size_(size) {
+  glCreateBuffers(1, &ubo_);
+  // The buffer is rewritten often, but never resized.
+  glNamedBufferStorage(ubo_, size_, nullptr, GL_DYNAMIC_STORAGE_BIT);
+  bind();
+}
+
+UniformBuffer::~UniformBuffer() { glDeleteBuffers(1, &ubo_); }
+
+void UniformBuffer::bind() {
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding_, ubo_);
+}
+
+void UniformBuffer::update(const void* data, size_t size, size_t offset) {
+  glNamedBufferSubData(ubo_, offset, size, data);
+}
+
+}  // namespace qrk
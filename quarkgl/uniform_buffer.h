@@ -0,0 +1,56 @@
+#ifndef QUARKGL_UNIFORM_BUFFER_H_
+#define QUARKGL_UNIFORM_BUFFER_H_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+namespace qrk {
+
+// Binding points of the uniform blocks shared by all programs. These must
+// match the bindings declared by the blocks in the built-in shaders.
+constexpr unsigned int FRAME_UNIFORM_BINDING = 0;
+
+// A uniform buffer object that backs a uniform block at a fixed binding point.
+// Since binding points are shared by every program, the buffer is written once
+// and read by all shaders that declare the block.
+class UniformBuffer {
+ public:
+  UniformBuffer(unsigned int binding, size_t size);
+  virtual ~UniformBuffer();
+  UniformBuffer(const UniformBuffer&) = delete;
+  UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+  unsigned int getId() const { return ubo_; }
+  unsigned int getBinding() const { return binding_; }
+  size_t getSize() const { return size_; }
+
+  // Binds the buffer to its binding point. Only needed if another buffer has
+  // been bound to the same point since the buffer was created.
+  void bind();
+  // Writes data to the buffer, starting at the given byte offset.
+  void update(const void* data, size_t size, size_t offset = 0);
+
+ private:
+  unsigned int ubo_ = 0;
+  unsigned int binding_;
+  size_t size_;
+};
+
+// The std140 layout of the QrkFrame block in core.glsl, which holds the data
+// that's constant over a frame.
+struct FrameUniformData {
+  glm::mat4 view = glm::mat4(1.0f);
+  glm::mat4 projection = glm::mat4(1.0f);
+  float time = 0.0f;
+  float deltaTime = 0.0f;
+  int windowWidth = 0;
+  int windowHeight = 0;
+};
+static_assert(sizeof(FrameUniformData) == 144,
+              "FrameUniformData must match the std140 layout of QrkFrame");
+
+}  // namespace qrk
+
+#endif
@@ -3,8 +3,9 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
-#include <regex>
 #include <string>
 
 namespace qrk {
@@ -39,48 +40,6 @@ static inline std::string resolvePath(std::string const& path) {
   std::filesystem::path p = path;
   return std::filesystem::absolute(p).string();
 }
-
-template <class BidirIt, class Traits, class CharT, class UnaryFunction>
-std::basic_string<CharT> regexReplace(BidirIt first, BidirIt last,
-                                      const std::basic_regex<CharT, Traits>& re,
-                                      UnaryFunction f) {
-  std::basic_string<CharT> s;
-
-  typename std::match_results<BidirIt>::difference_type positionOfLastMatch = 0;
-  auto endOfLastMatch = first;
-
-  auto callback = [&](const std::match_results<BidirIt>& match) {
-    auto positionOfThisMatch = match.position(0);
-    auto diff = positionOfThisMatch - positionOfLastMatch;
-
-    auto startOfThisMatch = endOfLastMatch;
-    std::advance(startOfThisMatch, diff);
-
-    s.append(endOfLastMatch, startOfThisMatch);
-    s.append(f(match));
-
-    auto lengthOfMatch = match.length(0);
-
-    positionOfLastMatch = positionOfThisMatch + lengthOfMatch;
-
-    endOfLastMatch = startOfThisMatch;
-    std::advance(endOfLastMatch, lengthOfMatch);
-  };
-
-  std::sregex_iterator begin(first, last, re), end;
-  std::for_each(begin, end, callback);
-
-  s.append(endOfLastMatch, last);
-
-  return s;
-}
-
-template <class Traits, class CharT, class UnaryFunction>
-std::string regexReplace(const std::string& s,
-                         const std::basic_regex<CharT, Traits>& re,
-                         UnaryFunction f) {
-  return regexReplace(s.cbegin(), s.cend(), re, f);
-}
 }  // namespace qrk
 
 #endif
@@ -1,15 +1,38 @@
+#include <qrk/gl_state.h>
 #include <qrk/vertex_array.h>
 
 namespace qrk {
+namespace {
+unsigned int getAttribSizeBytes(unsigned int size, unsigned int type) {
+  switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+      return size;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+      return size * 2;
+    case GL_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+      // Packed types hold all components in a single 32-bit value.
+      return 4;
+    case GL_DOUBLE:
+      return size * 8;
+    default:
+      return size * 4;
+  }
+}
+}  // namespace
 
 VertexArray::VertexArray() {
   glGenVertexArrays(1, &vao_);
   activate();
 }
 
-void VertexArray::activate() { glBindVertexArray(vao_); }
+void VertexArray::activate() { GlState::current().bindVertexArray(vao_); }
 
-void VertexArray::deactivate() { glBindVertexArray(0); }
+void VertexArray::deactivate() { GlState::current().bindVertexArray(0); }
 
 // TODO: Reduce duplication in these methods.
 void VertexArray::loadVertexData(const std::vector<char>& data) {
@@ -31,6 +54,13 @@ void VertexArray::loadVertexData(const void* data, unsigned int sizeBytes) {
   vertexSizeBytes_ = sizeBytes;
 }
 
+void VertexArray::loadVertexData(const StagingRing::Allocation& data) {
+  loadVertexData(nullptr, data.getSize());
+  glCopyNamedBufferSubData(data.getBuffer(), vbo_, data.getOffset(),
+                           /*writeOffset=*/0, data.getSize());
+  data.submit();
+}
+
 void VertexArray::allocateInstanceVertexData(unsigned int size) {
   activate();
 
@@ -56,17 +86,10 @@ void VertexArray::loadInstanceVertexData(const void* data, unsigned int size) {
 }
 
 void VertexArray::loadElementData(const std::vector<unsigned int>& indices) {
-  activate();
-
-  if (!ebo_) glGenBuffers(1, &ebo_);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), &indices[0],
-               GL_STATIC_DRAW);
-  elementSize_ = indices.size();
+  loadElementData(indices.data(), indices.size() * sizeof(unsigned int));
 }
 
-void VertexArray::loadElementData(const unsigned int* indices,
-                                  unsigned int size) {
+void VertexArray::loadElementData(const void* indices, unsigned int size) {
   activate();
 
   if (!ebo_) glGenBuffers(1, &ebo_);
@@ -75,18 +98,27 @@ void VertexArray::loadElementData(const unsigned int* indices,
   elementSize_ = size;
 }
 
+void VertexArray::loadElementData(const StagingRing::Allocation& indices) {
+  loadElementData(nullptr, indices.getSize());
+  glCopyNamedBufferSubData(indices.getBuffer(), ebo_, indices.getOffset(),
+                           /*writeOffset=*/0, indices.getSize());
+  indices.submit();
+}
+
 void VertexArray::addVertexAttrib(unsigned int size, unsigned int type,
-                                  unsigned int instanceDivisor) {
+                                  unsigned int instanceDivisor,
+                                  bool normalized) {
   VertexAttrib attrib = {
       .layoutPosition = nextLayoutPosition_,
       .size = size,
       .type = type,
       .instanceDivisor = instanceDivisor,
+      .normalized = normalized,
+      .sizeBytes = getAttribSizeBytes(size, type),
   };
   attribs_.push_back(attrib);
   nextLayoutPosition_++;
-  // TODO: Support types other than float.
-  stride_ += size * sizeof(float);
+  stride_ += attrib.sizeBytes;
 }
 
 void VertexArray::finalizeVertexAttribs() {
@@ -96,14 +128,13 @@ void VertexArray::finalizeVertexAttribs() {
   for (const VertexAttrib& attrib : attribs_) {
     glVertexAttribPointer(
         attrib.layoutPosition, attrib.size, attrib.type,
-        /* normalized */ GL_FALSE, stride_,
-        // TODO: Support types other than float.
+        /* normalized */ attrib.normalized ? GL_TRUE : GL_FALSE, stride_,
         /* offset */ static_cast<const char*>(nullptr) + offset);
     glEnableVertexAttribArray(attrib.layoutPosition);
     if (attrib.instanceDivisor) {
       glVertexAttribDivisor(attrib.layoutPosition, attrib.instanceDivisor);
     }
-    offset += attrib.size * sizeof(float);
+    offset += attrib.sizeBytes;
   }
 
   // Clear state to support subsequent runs.
@@ -2,6 +2,7 @@
 #define QUARKGL_VERTEX_ARRAY_H_
 
 #include <glad/glad.h>
+#include <qrk/staging_ring.h>
 
 #include <vector>
 
@@ -20,13 +21,25 @@ class VertexArray {
   void deactivate();
   void loadVertexData(const std::vector<char>& data);
   void loadVertexData(const void* data, unsigned int size);
+  // Loads vertex data that was written to staging memory, with a copy on the
+  // GPU. Submits the allocation.
+  void loadVertexData(const StagingRing::Allocation& data);
   void allocateInstanceVertexData(unsigned int size);
   void loadInstanceVertexData(const std::vector<char>& data);
   void loadInstanceVertexData(const void* data, unsigned int size);
   void loadElementData(const std::vector<unsigned int>& indices);
-  void loadElementData(const unsigned int* indices, unsigned int size);
+  // Loads index data of any index type. The size is in bytes.
+  void loadElementData(const void* indices, unsigned int size);
+  // Loads index data that was written to staging memory, with a copy on the
+  // GPU. Submits the allocation.
+  void loadElementData(const StagingRing::Allocation& indices);
+  // Adds a vertex attribute with `size` components of the given GL type.
+  // Packed types (e.g. GL_INT_2_10_10_10_REV) take up a single 4-byte slot.
+  // Integer types are converted to floats in the shader, and are mapped to
+  // [0, 1] (or [-1, 1] for signed types) if normalized.
   void addVertexAttrib(unsigned int size, unsigned int type,
-                       unsigned int instanceDivisor = 0);
+                       unsigned int instanceDivisor = 0,
+                       bool normalized = false);
   void finalizeVertexAttribs();
 
  private:
@@ -35,6 +48,8 @@ class VertexArray {
     unsigned int size;
     unsigned int type;
     unsigned int instanceDivisor;
+    bool normalized;
+    unsigned int sizeBytes;
   };
 
   unsigned int vao_ = 0;
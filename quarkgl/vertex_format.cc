@@ -0,0 +1,102 @@
+#include <qrk/vertex_format.h>
+
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
+
+namespace qrk {
+namespace {
+constexpr float QUANTIZED_POSITION_MAX = 65535.0f;
+
+uint32_t packTexCoords(const glm::vec2& texCoords) {
+  return glm::packHalf2x16(texCoords);
+}
+
+template <typename T>
+void appendVertex(std::vector<char>& data, const T& vertex) {
+  const char* bytes = reinterpret_cast<const char*>(&vertex);
+  data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+}  // namespace
+
+uint32_t packNormal(const glm::vec3& normal) {
+  return glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+}
+
+glm::vec3 unpackNormal(uint32_t packed) {
+  return glm::vec3(glm::unpackSnorm3x10_1x2(packed));
+}
+
+unsigned int getVertexSizeBytes(ModelVertexFormat format) {
+  switch (format) {
+    case ModelVertexFormat::COMPACT:
+      return sizeof(CompactModelVertex);
+    case ModelVertexFormat::QUANTIZED:
+      return sizeof(QuantizedModelVertex);
+    case ModelVertexFormat::FULL:
+    default:
+      return sizeof(ModelVertex);
+  }
+}
+
+PackedVertices packVertices(std::span<const ModelVertex> vertices,
+                            ModelVertexFormat format) {
+  PackedVertices packed;
+  packed.data.reserve(vertices.size() * getVertexSizeBytes(format));
+
+  switch (format) {
+    case ModelVertexFormat::FULL: {
+      const char* bytes = reinterpret_cast<const char*>(vertices.data());
+      packed.data.assign(bytes, bytes + vertices.size_bytes());
+      break;
+    }
+    case ModelVertexFormat::COMPACT: {
+      for (const ModelVertex& vertex : vertices) {
+        CompactModelVertex out = {
+            .position = vertex.position,
+            .normal = packNormal(vertex.normal),
+            .tangent = packNormal(vertex.tangent),
+            .texCoords = packTexCoords(vertex.texCoords),
+        };
+        appendVertex(packed.data, out);
+      }
+      break;
+    }
+    case ModelVertexFormat::QUANTIZED: {
+      if (vertices.empty()) break;
+      glm::vec3 minPos = vertices[0].position;
+      glm::vec3 maxPos = vertices[0].position;
+      for (const ModelVertex& vertex : vertices) {
+        minPos = glm::min(minPos, vertex.position);
+        maxPos = glm::max(maxPos, vertex.position);
+      }
+      // Use the same scale on every axis, so that the dequantization
+      // transform doesn't distort normals.
+      const glm::vec3 size = maxPos - minPos;
+      float extent = std::max({size.x, size.y, size.z});
+      if (extent <= 0.0f) extent = 1.0f;
+
+      for (const ModelVertex& vertex : vertices) {
+        glm::vec3 q = glm::round((vertex.position - minPos) / extent *
+                                 QUANTIZED_POSITION_MAX);
+        q = glm::clamp(q, 0.0f, QUANTIZED_POSITION_MAX);
+        QuantizedModelVertex out = {
+            .position = {static_cast<uint16_t>(q.x),
+                         static_cast<uint16_t>(q.y),
+                         static_cast<uint16_t>(q.z), 0},
+            .normal = packNormal(vertex.normal),
+            .tangent = packNormal(vertex.tangent),
+            .texCoords = packTexCoords(vertex.texCoords),
+        };
+        appendVertex(packed.data, out);
+      }
+      packed.positionTransform = glm::scale(
+          glm::translate(glm::mat4(1.0f), minPos), glm::vec3(extent));
+      break;
+    }
+  }
+  return packed;
+}
+
+}  // namespace qrk
@@ -0,0 +1,71 @@
+#ifndef QUARKGL_VERTEX_FORMAT_H_
+#define QUARKGL_VERTEX_FORMAT_H_
+
+#include <qrk/model_data.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace qrk {
+
+// The GPU-side layout of a model's vertices. Models are always imported (and
+// cached) as full ModelVertex data; the layout only affects what gets
+// uploaded.
+enum class ModelVertexFormat {
+  // 32-bit floats for everything (ModelVertex, 44 bytes).
+  FULL = 0,
+  // Float positions, 10:10:10:2 normals and tangents, and half-float texture
+  // coordinates (CompactModelVertex, 24 bytes).
+  COMPACT,
+  // As COMPACT, but with positions quantized to 16 bits within the mesh's
+  // bounds (QuantizedModelVertex, 20 bytes). The dequantization transform
+  // is folded into the mesh's model transform, so shaders need no changes.
+  QUANTIZED,
+};
+
+struct CompactModelVertex {
+  glm::vec3 position;
+  // Signed normalized, as GL_INT_2_10_10_10_REV.
+  uint32_t normal;
+  uint32_t tangent;
+  // Two half-floats.
+  uint32_t texCoords;
+};
+
+struct QuantizedModelVertex {
+  // Unsigned normalized. The fourth component is padding, to keep the
+  // following attributes 4-byte aligned.
+  uint16_t position[4];
+  uint32_t normal;
+  uint32_t tangent;
+  uint32_t texCoords;
+};
+
+static_assert(sizeof(CompactModelVertex) == 24);
+static_assert(sizeof(QuantizedModelVertex) == 20);
+
+// Returns the size, in bytes, of a single vertex in the given format.
+unsigned int getVertexSizeBytes(ModelVertexFormat format);
+
+// Vertices that have been converted to a particular vertex format.
+struct PackedVertices {
+  std::vector<char> data;
+  // Maps the stored positions back to model space. The identity matrix,
+  // unless positions are quantized. Only ever includes a uniform scale, so
+  // that it doesn't skew normals.
+  glm::mat4 positionTransform = glm::mat4(1.0f);
+};
+
+// Converts vertices into the given format.
+PackedVertices packVertices(std::span<const ModelVertex> vertices,
+                            ModelVertexFormat format);
+
+// Packs a vector with components in [-1, 1] as GL_INT_2_10_10_10_REV.
+uint32_t packNormal(const glm::vec3& normal);
+glm::vec3 unpackNormal(uint32_t packed);
+
+}  // namespace qrk
+
+#endif
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <qrk/vertex_format.h>
+
+#include <cstring>
+#include <glm/packing.hpp>
+#include <vector>
+
+namespace {
+
+std::vector<qrk::ModelVertex> makeVertices() {
+  return {
+      {.position = glm::vec3(-1.0f, 2.0f, 0.5f),
+       .normal = glm::normalize(glm::vec3(1.0f, 2.0f, -3.0f)),
+       .tangent = glm::vec3(1.0f, 0.0f, 0.0f),
+       .texCoords = glm::vec2(0.25f, 0.75f)},
+      {.position = glm::vec3(3.0f, -4.0f, 0.5f),
+       .normal = glm::vec3(0.0f, -1.0f, 0.0f),
+       .tangent = glm::normalize(glm::vec3(-1.0f, 0.0f, 1.0f)),
+       .texCoords = glm::vec2(1.0f, 0.0f)},
+      {.position = glm::vec3(0.0f, 0.0f, 10.0f),
+       .normal = glm::vec3(0.0f),
+       .tangent = glm::vec3(0.0f, 0.0f, -1.0f),
+       .texCoords = glm::vec2(-2.5f, 3.0f)},
+  };
+}
+
+template <typename T>
+T getVertex(const qrk::PackedVertices& packed, size_t i) {
+  T vertex;
+  std::memcpy(&vertex, packed.data.data() + i * sizeof(T), sizeof(T));
+  return vertex;
+}
+
+void expectNear(const glm::vec3& actual, const glm::vec3& expected,
+                float tolerance) {
+  EXPECT_NEAR(actual.x, expected.x, tolerance);
+  EXPECT_NEAR(actual.y, expected.y, tolerance);
+  EXPECT_NEAR(actual.z, expected.z, tolerance);
+}
+
+TEST(VertexFormatTest, FullIsUnchanged) {
+  auto vertices = makeVertices();
+  auto packed = qrk::packVertices(vertices, qrk::ModelVertexFormat::FULL);
+  ASSERT_EQ(packed.data.size(), vertices.size() * sizeof(qrk::ModelVertex));
+  EXPECT_EQ(std::memcmp(packed.data.data(), vertices.data(),
+                        packed.data.size()),
+            0);
+  EXPECT_EQ(packed.positionTransform, glm::mat4(1.0f));
+}
+
+TEST(VertexFormatTest, CompactRoundTrips) {
+  auto vertices = makeVertices();
+  auto packed = qrk::packVertices(vertices, qrk::ModelVertexFormat::COMPACT);
+  ASSERT_EQ(packed.data.size(),
+            vertices.size() *
+                qrk::getVertexSizeBytes(qrk::ModelVertexFormat::COMPACT));
+  EXPECT_EQ(packed.positionTransform, glm::mat4(1.0f));
+
+  for (size_t i = 0; i < vertices.size(); i++) {
+    auto vertex = getVertex<qrk::CompactModelVertex>(packed, i);
+    EXPECT_EQ(vertex.position, vertices[i].position);
+    // 10-bit signed components have a step of 1/511.
+    expectNear(qrk::unpackNormal(vertex.normal), vertices[i].normal, 1e-3f);
+    expectNear(qrk::unpackNormal(vertex.tangent), vertices[i].tangent, 1e-3f);
+    glm::vec2 texCoords = glm::unpackHalf2x16(vertex.texCoords);
+    EXPECT_NEAR(texCoords.x, vertices[i].texCoords.x, 2e-3f);
+    EXPECT_NEAR(texCoords.y, vertices[i].texCoords.y, 2e-3f);
+  }
+}
+
+TEST(VertexFormatTest, QuantizedPositionsDequantize) {
+  auto vertices = makeVertices();
+  auto packed =
+      qrk::packVertices(vertices, qrk::ModelVertexFormat::QUANTIZED);
+  ASSERT_EQ(packed.data.size(),
+            vertices.size() *
+                qrk::getVertexSizeBytes(qrk::ModelVertexFormat::QUANTIZED));
+
+  // The largest extent is 10 units, so 16 bits gives a step of ~1.5e-4.
+  for (size_t i = 0; i < vertices.size(); i++) {
+    auto vertex = getVertex<qrk::QuantizedModelVertex>(packed, i);
+    // As the GPU would see the normalized attribute.
+    glm::vec4 normalized(vertex.position[0] / 65535.0f,
+                         vertex.position[1] / 65535.0f,
+                         vertex.position[2] / 65535.0f, 1.0f);
+    expectNear(glm::vec3(packed.positionTransform * normalized),
+               vertices[i].position, 1e-3f);
+    expectNear(qrk::unpackNormal(vertex.normal), vertices[i].normal, 1e-3f);
+  }
+}
+
+TEST(VertexFormatTest, QuantizedTransformHasUniformScale) {
+  auto vertices = makeVertices();
+  auto packed =
+      qrk::packVertices(vertices, qrk::ModelVertexFormat::QUANTIZED);
+  const glm::mat4& m = packed.positionTransform;
+  EXPECT_FLOAT_EQ(m[0][0], m[1][1]);
+  EXPECT_FLOAT_EQ(m[1][1], m[2][2]);
+}
+
+TEST(VertexFormatTest, QuantizedHandlesDegenerateBounds) {
+  std::vector<qrk::ModelVertex> vertices(2);
+  vertices[0].position = vertices[1].position = glm::vec3(5.0f);
+  auto packed =
+      qrk::packVertices(vertices, qrk::ModelVertexFormat::QUANTIZED);
+  auto vertex = getVertex<qrk::QuantizedModelVertex>(packed, 0);
+  glm::vec4 normalized(vertex.position[0] / 65535.0f,
+                       vertex.position[1] / 65535.0f,
+                       vertex.position[2] / 65535.0f, 1.0f);
+  expectNear(glm::vec3(packed.positionTransform * normalized), glm::vec3(5.0f),
+             1e-6f);
+}
+
+}  // namespace
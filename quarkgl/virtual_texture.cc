@@ -0,0 +1,704 @@
+#include <qrk/virtual_texture.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace qrk {
+namespace {
+constexpr char TILED_MAGIC[8] = {'Q', 'R', 'K', 'T', 'I', 'L', 'E', 'D'};
+constexpr char TILED_EXTENSION[] = ".qvt";
+
+struct TiledHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t width;
+  int32_t height;
+  int32_t pageSize;
+  int32_t border;
+  uint8_t isSRGB;
+  uint8_t padding[3];
+  int64_t modifiedTime;
+  // The source path immediately follows the header, and is used to detect
+  // hash collisions. The pages follow the path, in order.
+  uint32_t sourcePathLength;
+};
+
+// Reading pages is mostly waiting on the disk, so a couple of threads is
+// plenty.
+constexpr unsigned int NUM_LOAD_THREADS = 2;
+
+[[noreturn]] void throwInvalidFile(const std::string& path,
+                                   const std::string& reason) {
+  throw VirtualTextureException("ERROR::VIRTUAL_TEXTURE::INVALID_FILE\n" +
+                                path + ": " + reason);
+}
+
+int wrap(int value, int size) {
+  value %= size;
+  return value < 0 ? value + size : value;
+}
+
+// Copies a page of a mip level, along with its border, into RGBA8 texels.
+void copyPage(const unsigned char* pixels, int width, int height,
+              int numChannels, const VirtualTextureLayout& layout, int pageX,
+              int pageY, unsigned char* page) {
+  const int tileSize = layout.getTileSize();
+  const int originX = pageX * layout.pageSize - layout.border;
+  const int originY = pageY * layout.pageSize - layout.border;
+  for (int y = 0; y < tileSize; y++) {
+    const int srcY = wrap(originY + y, height);
+    for (int x = 0; x < tileSize; x++) {
+      const int srcX = wrap(originX + x, width);
+      const unsigned char* src =
+          pixels + (static_cast<size_t>(srcY) * width + srcX) * numChannels;
+      unsigned char* dst = page + (static_cast<size_t>(y) * tileSize + x) * 4;
+      for (int c = 0; c < 4; c++) {
+        dst[c] = c < numChannels ? src[c] : (c == 3 ? 255 : 0);
+      }
+    }
+  }
+}
+
+int64_t toTicks(std::filesystem::file_time_type time) {
+  return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+// 64-bit FNV-1a. Unlike std::hash, this is stable across runs and platforms.
+uint64_t hashString(const std::string& str) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+}  // namespace
+
+VirtualTextureLayout VirtualTextureLayout::create(int width, int height,
+                                                  int pageSize) {
+  if (width <= 0 || height <= 0 ||
+      !std::has_single_bit(static_cast<unsigned int>(width)) ||
+      !std::has_single_bit(static_cast<unsigned int>(height))) {
+    throw VirtualTextureException(
+        "ERROR::VIRTUAL_TEXTURE::SIZE_NOT_POWER_OF_TWO\n" +
+        std::to_string(width) + "x" + std::to_string(height));
+  }
+  if (pageSize <= 0 ||
+      !std::has_single_bit(static_cast<unsigned int>(pageSize))) {
+    throw VirtualTextureException(
+        "ERROR::VIRTUAL_TEXTURE::INVALID_PAGE_SIZE\n" +
+        std::to_string(pageSize));
+  }
+
+  VirtualTextureLayout layout;
+  layout.width = width;
+  layout.height = height;
+  layout.pageSize = pageSize;
+  const int numPagesX = layout.getNumPagesX(0);
+  const int numPagesY = layout.getNumPagesY(0);
+  if (numPagesX > MAX_VIRTUAL_PAGES || numPagesY > MAX_VIRTUAL_PAGES) {
+    throw VirtualTextureException("ERROR::VIRTUAL_TEXTURE::TOO_LARGE\n" +
+                                  std::to_string(width) + "x" +
+                                  std::to_string(height));
+  }
+  // Mips are halved until the largest side is a single page.
+  layout.numMips = std::bit_width(
+      static_cast<unsigned int>(std::max(numPagesX, numPagesY)));
+  return layout;
+}
+
+int VirtualTextureLayout::getNumPagesX(int mip) const {
+  return std::max((width >> mip) / pageSize, 1);
+}
+
+int VirtualTextureLayout::getNumPagesY(int mip) const {
+  return std::max((height >> mip) / pageSize, 1);
+}
+
+int VirtualTextureLayout::getNumPages() const {
+  int numPages = 0;
+  for (int mip = 0; mip < numMips; mip++) {
+    numPages += getNumPagesX(mip) * getNumPagesY(mip);
+  }
+  return numPages;
+}
+
+int VirtualTextureLayout::getPageIndex(int mip, int x, int y) const {
+  int index = 0;
+  for (int level = 0; level < mip; level++) {
+    index += getNumPagesX(level) * getNumPagesY(level);
+  }
+  return index + y * getNumPagesX(mip) + x;
+}
+
+std::vector<unsigned char> buildVirtualTexturePages(
+    const unsigned char* pixels, int numChannels, bool isSRGB,
+    const VirtualTextureLayout& layout, MipFilter mipFilter) {
+  std::vector<ImageMip> mips =
+      generateImageMips(pixels, layout.width, layout.height, numChannels,
+                        isSRGB, mipFilter, layout.numMips);
+
+  std::vector<unsigned char> pages(layout.getNumPages() *
+                                   layout.getTileSizeBytes());
+  unsigned char* page = pages.data();
+  for (int mip = 0; mip < layout.numMips; mip++) {
+    const unsigned char* mipPixels =
+        mip == 0 ? pixels : mips[mip - 1].pixels.data();
+    const int width = std::max(layout.width >> mip, 1);
+    const int height = std::max(layout.height >> mip, 1);
+    for (int y = 0; y < layout.getNumPagesY(mip); y++) {
+      for (int x = 0; x < layout.getNumPagesX(mip); x++) {
+        copyPage(mipPixels, width, height, numChannels, layout, x, y, page);
+        page += layout.getTileSizeBytes();
+      }
+    }
+  }
+  return pages;
+}
+
+TiledTexture::TiledTexture(const std::string& path) : file_(path) {
+  if (file_.getSize() < sizeof(TiledHeader)) {
+    throwInvalidFile(path, "file is truncated");
+  }
+  TiledHeader header;
+  std::memcpy(&header, file_.getData(), sizeof(header));
+  if (std::memcmp(header.magic, TILED_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != TILED_TEXTURE_VERSION) {
+    throwInvalidFile(path, "not a tiled texture, or an old version");
+  }
+  try {
+    layout_ = VirtualTextureLayout::create(header.width, header.height,
+                                           header.pageSize);
+  } catch (const VirtualTextureException&) {
+    throwInvalidFile(path, "invalid layout");
+  }
+  if (header.border < 0 || header.border > header.pageSize) {
+    throwInvalidFile(path, "invalid border");
+  }
+  layout_.border = header.border;
+
+  const size_t pagesOffset = sizeof(header) + header.sourcePathLength;
+  if (file_.getSize() < pagesOffset ||
+      file_.getSize() - pagesOffset !=
+          layout_.getNumPages() * layout_.getTileSizeBytes()) {
+    throwInvalidFile(path, "file is truncated");
+  }
+  sourcePath_.assign(file_.getData() + sizeof(header),
+                     header.sourcePathLength);
+  modifiedTime_ = header.modifiedTime;
+  isSRGB_ = header.isSRGB;
+  pages_ = reinterpret_cast<const unsigned char*>(file_.getData()) +
+           pagesOffset;
+}
+
+const unsigned char* TiledTexture::getPage(int mip, int x, int y) const {
+  return pages_ +
+         layout_.getPageIndex(mip, x, y) * layout_.getTileSizeBytes();
+}
+
+std::string TiledTextureCache::getDefaultDirectory() {
+  std::error_code ec;
+  std::filesystem::path tempDir = std::filesystem::temp_directory_path(ec);
+  if (ec) tempDir = ".";
+  return (tempDir / "quarkgl_tile_cache").string();
+}
+
+std::string TiledTextureCache::getEntryPath(
+    const CompressedTextureKey& key) const {
+  char name[40];
+  std::snprintf(name, sizeof(name), "%016llx%s%s",
+                static_cast<unsigned long long>(hashString(key.sourcePath)),
+                key.isSRGB ? "_srgb" : "", TILED_EXTENSION);
+  return (std::filesystem::path(directory_) / name).string();
+}
+
+std::unique_ptr<TiledTexture> TiledTextureCache::open(
+    const CompressedTextureKey& key) const {
+  std::string entryPath = getEntryPath(key);
+  std::error_code ec;
+  if (!std::filesystem::exists(entryPath, ec)) return nullptr;
+
+  std::unique_ptr<TiledTexture> texture;
+  try {
+    texture = std::make_unique<TiledTexture>(entryPath);
+  } catch (const QuarkException&) {
+    return nullptr;
+  }
+  // Validate that the entry matches the requested key.
+  if (texture->getSourcePath() != key.sourcePath ||
+      texture->getModifiedTime() != key.modifiedTime ||
+      texture->isSRGB() != key.isSRGB) {
+    return nullptr;
+  }
+  return texture;
+}
+
+bool TiledTextureCache::store(const CompressedTextureKey& key,
+                              const unsigned char* pixels, int width,
+                              int height, int numChannels, int pageSize,
+                              MipFilter mipFilter) {
+  const VirtualTextureLayout layout =
+      VirtualTextureLayout::create(width, height, pageSize);
+  std::vector<unsigned char> pages = buildVirtualTexturePages(
+      pixels, numChannels, key.isSRGB, layout, mipFilter);
+
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec) return false;
+
+  // Write to a temporary file first, and then move it into place, so that
+  // readers never observe a partially written entry.
+  std::string entryPath = getEntryPath(key);
+  std::string tempPath = entryPath + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    TiledHeader header = {};
+    std::memcpy(header.magic, TILED_MAGIC, sizeof(header.magic));
+    header.version = TILED_TEXTURE_VERSION;
+    header.width = layout.width;
+    header.height = layout.height;
+    header.pageSize = layout.pageSize;
+    header.border = layout.border;
+    header.isSRGB = key.isSRGB;
+    header.modifiedTime = key.modifiedTime;
+    header.sourcePathLength = static_cast<uint32_t>(key.sourcePath.size());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(key.sourcePath.data(), key.sourcePath.size());
+    out.write(reinterpret_cast<const char*>(pages.data()), pages.size());
+    if (!out) {
+      out.close();
+      std::filesystem::remove(tempPath, ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tempPath, entryPath, ec);
+  if (ec) {
+    std::filesystem::remove(tempPath, ec);
+    return false;
+  }
+  return true;
+}
+
+std::vector<VirtualPageRequest> analyzeFeedback(const uint32_t* texels,
+                                                size_t numTexels) {
+  // Neighboring texels usually request the same page, so runs are counted
+  // before they're hashed.
+  std::unordered_map<uint32_t, uint32_t> counts;
+  size_t i = 0;
+  while (i < numTexels) {
+    const uint32_t packed = texels[i];
+    size_t end = i + 1;
+    while (end < numTexels && texels[end] == packed) end++;
+    if (VirtualPageId::unpack(packed).texture != 0) {
+      counts[packed] += end - i;
+    }
+    i = end;
+  }
+
+  std::vector<VirtualPageRequest> requests;
+  requests.reserve(counts.size());
+  for (const auto& [packed, count] : counts) {
+    requests.push_back(
+        {.page = VirtualPageId::unpack(packed), .count = count});
+  }
+  std::sort(requests.begin(), requests.end(),
+            [](const VirtualPageRequest& a, const VirtualPageRequest& b) {
+              if (a.page.mip != b.page.mip) return a.page.mip > b.page.mip;
+              if (a.count != b.count) return a.count > b.count;
+              return a.page.pack() < b.page.pack();
+            });
+  return requests;
+}
+
+VirtualPageCache::VirtualPageCache(int sizePages) : sizePages_(sizePages) {
+  // Slots are handed out from the back, starting from the first.
+  freeSlots_.reserve(getNumSlots());
+  for (int y = sizePages - 1; y >= 0; y--) {
+    for (int x = sizePages - 1; x >= 0; x--) {
+      freeSlots_.push_back({x, y});
+    }
+  }
+}
+
+std::optional<VirtualPageCache::Slot> VirtualPageCache::find(
+    VirtualPageId page) const {
+  auto it = entries_.find(page.pack());
+  if (it == entries_.end()) return std::nullopt;
+  return it->second.slot;
+}
+
+void VirtualPageCache::touch(VirtualPageId page, uint64_t frame) {
+  auto it = entries_.find(page.pack());
+  if (it == entries_.end()) return;
+  Entry& entry = it->second;
+  entry.lastUsed = frame;
+  if (!entry.pinned) {
+    lru_.splice(lru_.begin(), lru_, entry.lruPosition);
+  }
+}
+
+std::optional<VirtualPageCache::Slot> VirtualPageCache::insert(
+    VirtualPageId page, uint64_t frame, bool pinned,
+    std::optional<VirtualPageId>* evicted) {
+  if (evicted) evicted->reset();
+  Slot slot;
+  if (!freeSlots_.empty()) {
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+  } else {
+    if (lru_.empty()) return std::nullopt;
+    auto it = entries_.find(lru_.back());
+    // Everything else was used more recently, so nothing can be evicted.
+    if (it->second.lastUsed >= frame) return std::nullopt;
+    slot = it->second.slot;
+    if (evicted) *evicted = VirtualPageId::unpack(it->first);
+    lru_.pop_back();
+    entries_.erase(it);
+  }
+
+  const uint32_t key = page.pack();
+  Entry entry = {
+      .slot = slot, .lastUsed = frame, .pinned = pinned, .lruPosition = {}};
+  if (!pinned) entry.lruPosition = lru_.insert(lru_.begin(), key);
+  entries_.emplace(key, entry);
+  return slot;
+}
+
+VirtualPageTable::VirtualPageTable(const VirtualTextureLayout& layout)
+    : layout_(layout), resident_(layout.getNumPages()) {
+  entries_.resize(layout_.numMips);
+  for (int mip = 0; mip < layout_.numMips; mip++) {
+    entries_[mip].resize(static_cast<size_t>(layout_.getNumPagesX(mip)) *
+                         layout_.getNumPagesY(mip) * 4);
+  }
+}
+
+void VirtualPageTable::map(int mip, int x, int y,
+                           VirtualPageCache::Slot slot) {
+  resident_[layout_.getPageIndex(mip, x, y)] = slot;
+  dirty_ = true;
+}
+
+void VirtualPageTable::unmap(int mip, int x, int y) {
+  resident_[layout_.getPageIndex(mip, x, y)].reset();
+  dirty_ = true;
+}
+
+void VirtualPageTable::update() {
+  // Go from the coarsest level down, so that each page can inherit its
+  // parent's entry.
+  int levelIndex = layout_.getNumPages();
+  for (int mip = layout_.numMips - 1; mip >= 0; mip--) {
+    const int numPagesX = layout_.getNumPagesX(mip);
+    const int numPagesY = layout_.getNumPagesY(mip);
+    levelIndex -= numPagesX * numPagesY;
+    for (int y = 0; y < numPagesY; y++) {
+      for (int x = 0; x < numPagesX; x++) {
+        unsigned char* entry = &entries_[mip][(y * numPagesX + x) * 4];
+        const std::optional<VirtualPageCache::Slot>& slot =
+            resident_[levelIndex + y * numPagesX + x];
+        if (slot) {
+          entry[0] = slot->x;
+          entry[1] = slot->y;
+          entry[2] = mip;
+          entry[3] = 255;
+        } else if (mip + 1 < layout_.numMips) {
+          const int parentPagesX = layout_.getNumPagesX(mip + 1);
+          std::memcpy(entry,
+                      &entries_[mip + 1][((y / 2) * parentPagesX + x / 2) * 4],
+                      4);
+        } else {
+          std::memset(entry, 0, 4);
+        }
+      }
+    }
+  }
+  dirty_ = false;
+}
+
+VirtualTextureUniforms::VirtualTextureUniforms(std::string_view name)
+    : pageTable(std::string(name) + ".pageTable"),
+      pageCache(std::string(name) + ".pageCache"),
+      width(std::string(name) + ".width"),
+      height(std::string(name) + ".height"),
+      numMips(std::string(name) + ".numMips"),
+      pageSize(std::string(name) + ".pageSize"),
+      pageBorder(std::string(name) + ".pageBorder"),
+      id(std::string(name) + ".id") {}
+
+VirtualTexture::VirtualTexture(uint8_t id, std::unique_ptr<TiledTexture> tiles,
+                               Texture pageCache)
+    : id_(id),
+      tiles_(std::move(tiles)),
+      pageCache_(pageCache),
+      table_(tiles_->getLayout()) {
+  const VirtualTextureLayout& layout = getLayout();
+  // Entries are fetched directly, one mip level per level of the texture, and
+  // are never filtered.
+  pageTable_ = Texture::create(layout.getNumPagesX(0), layout.getNumPagesY(0),
+                               GL_RGBA8,
+                               {.filtering = TextureFiltering::NEAREST,
+                                .wrapMode = TextureWrapMode::CLAMP_TO_EDGE,
+                                .generateMips = MipGeneration::ALWAYS});
+}
+
+VirtualTexture::~VirtualTexture() { pageTable_.free(); }
+
+void VirtualTexture::bind(Shader& shader,
+                          const VirtualTextureUniforms& uniforms,
+                          unsigned int pageTableUnit,
+                          unsigned int pageCacheUnit) {
+  pageTable_.bindToUnit(pageTableUnit, TextureBindType::TEXTURE_2D);
+  pageCache_.bindToUnit(pageCacheUnit, TextureBindType::TEXTURE_2D);
+  shader.setInt(uniforms.pageTable, pageTableUnit);
+  shader.setInt(uniforms.pageCache, pageCacheUnit);
+
+  const VirtualTextureLayout& layout = getLayout();
+  shader.setInt(uniforms.width, layout.width);
+  shader.setInt(uniforms.height, layout.height);
+  shader.setInt(uniforms.numMips, layout.numMips);
+  shader.setInt(uniforms.pageSize, layout.pageSize);
+  shader.setInt(uniforms.pageBorder, layout.border);
+  shader.setInt(uniforms.id, id_);
+}
+
+void VirtualTexture::updatePageTable() {
+  if (!table_.isDirty()) return;
+  table_.update();
+  const VirtualTextureLayout& layout = getLayout();
+  for (int mip = 0; mip < layout.numMips; mip++) {
+    glTextureSubImage2D(pageTable_.getId(), mip, /*xoffset=*/0,
+                        /*yoffset=*/0, layout.getNumPagesX(mip),
+                        layout.getNumPagesY(mip), GL_RGBA, GL_UNSIGNED_BYTE,
+                        table_.getEntries(mip));
+  }
+}
+
+VirtualTextureFeedbackShader::VirtualTextureFeedbackShader()
+    : Shader(ShaderPath("quarkgl/shaders/builtin/deferred.vert"),
+             ShaderPath(
+                 "quarkgl/shaders/builtin/virtual_texture_feedback.frag")) {}
+
+VirtualTextureSystem::VirtualTextureSystem(ImageSize screenSize,
+                                           const VirtualTextureParams& params)
+    : params_(params),
+      tileCache_(params.tileCacheDirectory.empty()
+                     ? TiledTextureCache::getDefaultDirectory()
+                     : params.tileCacheDirectory),
+      pageSlots_(params.cacheSizePages),
+      feedbackBuffer_(std::max(screenSize.width / params.feedbackDivisor, 1),
+                      std::max(screenSize.height / params.feedbackDivisor, 1)),
+      loadPool_(NUM_LOAD_THREADS) {
+  // Pages are sampled from the base level only, and their borders keep
+  // filtering from bleeding between them.
+  const int cacheSize =
+      params_.cacheSizePages * (params_.pageSize + 2 * VIRTUAL_PAGE_BORDER);
+  pageCache_ = Texture::create(
+      cacheSize, cacheSize, params_.isSRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8,
+      {.filtering = TextureFiltering::BILINEAR,
+       .wrapMode = TextureWrapMode::CLAMP_TO_EDGE,
+       .generateMips = MipGeneration::NEVER});
+  stats_.cachePages = pageSlots_.getNumSlots();
+
+  // Texels that don't sample any virtual texture are left cleared to 0, which
+  // is no page at all.
+  feedbackBuffer_.setClearColor(glm::vec4(0.0f));
+  feedbackBuffer_.attachTexture(BufferType::COLOR_ALPHA);
+  feedbackBuffer_.attachRenderbuffer(BufferType::DEPTH);
+
+  const ImageSize feedbackSize = feedbackBuffer_.getSize();
+  glCreateBuffers(1, &readbackBuffer_);
+  glNamedBufferStorage(
+      readbackBuffer_,
+      static_cast<size_t>(feedbackSize.width) * feedbackSize.height * 4,
+      nullptr, GL_MAP_READ_BIT);
+}
+
+VirtualTextureSystem::~VirtualTextureSystem() {
+  if (readbackFence_ != nullptr) glDeleteSync(readbackFence_);
+  glDeleteBuffers(1, &readbackBuffer_);
+  pageCache_.free();
+}
+
+std::shared_ptr<VirtualTexture> VirtualTextureSystem::open(
+    const std::string& sourcePath) {
+  auto it = texturesByPath_.find(sourcePath);
+  if (it != texturesByPath_.end()) return it->second;
+  if (textures_.size() >= MAX_VIRTUAL_TEXTURES) return nullptr;
+
+  std::unique_ptr<TiledTexture> tiles = tileCache_.open(
+      computeCompressedTextureKey(sourcePath, params_.isSRGB));
+  if (!tiles || tiles->getLayout().pageSize != params_.pageSize ||
+      tiles->getLayout().border != VIRTUAL_PAGE_BORDER) {
+    return nullptr;
+  }
+
+  const uint8_t id = static_cast<uint8_t>(textures_.size() + 1);
+  auto texture =
+      std::make_shared<VirtualTexture>(id, std::move(tiles), pageCache_);
+  textures_.push_back(texture);
+  // The coarsest page covers the whole texture, so it's kept around for
+  // everything else to fall back to.
+  const VirtualPageId coarsest = {
+      .mip = static_cast<uint8_t>(texture->getLayout().numMips - 1),
+      .texture = id};
+  if (!uploadPage(coarsest,
+                  texture->tiles_->getPage(coarsest.mip, /*x=*/0, /*y=*/0),
+                  /*pinned=*/true)) {
+    textures_.pop_back();
+    return nullptr;
+  }
+  texture->updatePageTable();
+
+  texturesByPath_.emplace(sourcePath, texture);
+  stats_.numTextures = textures_.size();
+  return texture;
+}
+
+void VirtualTextureSystem::beginFeedback() {
+  feedbackBuffer_.activate();
+  feedbackBuffer_.clear();
+  // The feedback buffer's derivatives are larger than the screen's, so bias
+  // mip selection back to what the screen samples.
+  feedbackShader_.setFloat(
+      "lodBias", -std::log2(static_cast<float>(params_.feedbackDivisor)));
+}
+
+void VirtualTextureSystem::endFeedback() {
+  // If the last readback hasn't arrived yet, this frame's feedback is dropped
+  // rather than waited on.
+  if (readbackFence_ == nullptr) {
+    const ImageSize size = feedbackBuffer_.getSize();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer_);
+    glReadPixels(0, 0, size.width, size.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readbackFence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  feedbackBuffer_.deactivate();
+}
+
+void VirtualTextureSystem::update() {
+  frame_++;
+  if (std::optional<std::vector<VirtualPageRequest>> requests =
+          readFeedback()) {
+    stats_.requestedPages = requests->size();
+    requestPages(*requests);
+  }
+  uploadPages();
+  for (const std::shared_ptr<VirtualTexture>& texture : textures_) {
+    texture->updatePageTable();
+  }
+  stats_.residentPages = pageSlots_.getNumResident();
+  stats_.loadingPages = pending_.size();
+}
+
+std::optional<std::vector<VirtualPageRequest>>
+VirtualTextureSystem::readFeedback() {
+  if (readbackFence_ == nullptr) return std::nullopt;
+  GLenum status = glClientWaitSync(readbackFence_, 0, /*timeout=*/0);
+  if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+    return std::nullopt;
+  }
+  glDeleteSync(readbackFence_);
+  readbackFence_ = nullptr;
+
+  // RGBA8 texels read as packed VirtualPageIds on little-endian machines.
+  const ImageSize size = feedbackBuffer_.getSize();
+  const size_t numTexels = static_cast<size_t>(size.width) * size.height;
+  const auto* texels = static_cast<const uint32_t*>(glMapNamedBufferRange(
+      readbackBuffer_, 0, numTexels * sizeof(uint32_t), GL_MAP_READ_BIT));
+  if (texels == nullptr) return std::nullopt;
+  std::vector<VirtualPageRequest> requests =
+      analyzeFeedback(texels, numTexels);
+  glUnmapNamedBuffer(readbackBuffer_);
+  return requests;
+}
+
+void VirtualTextureSystem::requestPages(
+    const std::vector<VirtualPageRequest>& requests) {
+  for (const VirtualPageRequest& request : requests) {
+    const VirtualPageId page = request.page;
+    // Stale or garbled feedback may name pages that don't exist.
+    if (page.texture > textures_.size()) continue;
+    VirtualTexture& texture = *textures_[page.texture - 1];
+    const VirtualTextureLayout& layout = texture.getLayout();
+    if (page.mip >= layout.numMips || page.x >= layout.getNumPagesX(page.mip) ||
+        page.y >= layout.getNumPagesY(page.mip)) {
+      continue;
+    }
+
+    if (pageSlots_.find(page)) {
+      pageSlots_.touch(page, frame_);
+      continue;
+    }
+    if (pending_.size() >= static_cast<size_t>(params_.maxPendingLoads) ||
+        !loading_.insert(page.pack()).second) {
+      continue;
+    }
+    const TiledTexture* tiles = texture.tiles_.get();
+    const size_t sizeBytes = layout.getTileSizeBytes();
+    pending_.push_back(
+        {.page = page, .pixels = loadPool_.submit([tiles, page, sizeBytes]() {
+           // Copying the page faults it in from disk here, rather than while
+           // uploading it on the GL thread.
+           const unsigned char* pixels =
+               tiles->getPage(page.mip, page.x, page.y);
+           return std::vector<unsigned char>(pixels, pixels + sizeBytes);
+         })});
+  }
+}
+
+void VirtualTextureSystem::uploadPages() {
+  // Pages are uploaded in the order they were requested, so that coarser pages
+  // arrive first.
+  int numUploads = 0;
+  while (!pending_.empty() && numUploads < params_.maxUploadsPerFrame) {
+    PendingPage& pending = pending_.front();
+    if (pending.pixels.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+      break;
+    }
+    std::vector<unsigned char> pixels = pending.pixels.get();
+    // If there's no room, the page is dropped, and is requested again by later
+    // feedback.
+    uploadPage(pending.page, pixels.data(), /*pinned=*/false);
+    loading_.erase(pending.page.pack());
+    pending_.pop_front();
+    numUploads++;
+  }
+}
+
+bool VirtualTextureSystem::uploadPage(VirtualPageId page,
+                                      const unsigned char* pixels,
+                                      bool pinned) {
+  std::optional<VirtualPageId> evicted;
+  std::optional<VirtualPageCache::Slot> slot =
+      pageSlots_.insert(page, frame_, pinned, &evicted);
+  if (!slot) return false;
+  if (evicted) {
+    textures_[evicted->texture - 1]->table_.unmap(evicted->mip, evicted->x,
+                                                  evicted->y);
+    stats_.evictedPages++;
+  }
+
+  const int tileSize = params_.pageSize + 2 * VIRTUAL_PAGE_BORDER;
+  glTextureSubImage2D(pageCache_.getId(), /*level=*/0, slot->x * tileSize,
+                      slot->y * tileSize, tileSize, tileSize, GL_RGBA,
+                      GL_UNSIGNED_BYTE, pixels);
+  textures_[page.texture - 1]->table_.map(page.mip, page.x, page.y, *slot);
+  stats_.uploadedPages++;
+  return true;
+}
+
+}  // namespace qrk
@@ -0,0 +1,423 @@
+#ifndef QUARKGL_VIRTUAL_TEXTURE_H_
+#define QUARKGL_VIRTUAL_TEXTURE_H_
+
+#include <qrk/compressed_texture.h>
+#include <qrk/exceptions.h>
+#include <qrk/framebuffer.h>
+#include <qrk/image_mips.h>
+#include <qrk/mapped_file.h>
+#include <qrk/screen.h>
+#include <qrk/shader.h>
+#include <qrk/texture.h>
+#include <qrk/thread_pool.h>
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace qrk {
+
+class VirtualTextureException : public QuarkException {
+  using QuarkException::QuarkException;
+};
+
+// The size of a page's content, in texels.
+constexpr int DEFAULT_VIRTUAL_PAGE_SIZE = 128;
+// The number of texels around each page that are copied from its neighbors, so
+// that filtering never reads past the page's edge in the page cache.
+constexpr int VIRTUAL_PAGE_BORDER = 4;
+// Pages and textures are identified by bytes in the feedback buffer, which
+// limits the number of pages along each side of a virtual texture's base
+// level, and the number of virtual textures (0 means no texture).
+constexpr int MAX_VIRTUAL_PAGES = 256;
+constexpr int MAX_VIRTUAL_TEXTURES = 255;
+
+// How a virtual texture is split into square pages. Every mip level is split
+// into pages of the same size, down to the first level that fits in a single
+// page, which is the last.
+struct VirtualTextureLayout {
+  int width = 0;
+  int height = 0;
+  int pageSize = DEFAULT_VIRTUAL_PAGE_SIZE;
+  int border = VIRTUAL_PAGE_BORDER;
+  int numMips = 0;
+
+  // Returns the layout of an image. The image's sides and the page size must
+  // be powers of two, so that every mip level divides evenly into pages.
+  static VirtualTextureLayout create(int width, int height,
+                                     int pageSize = DEFAULT_VIRTUAL_PAGE_SIZE);
+
+  // The size of a page, including its border.
+  int getTileSize() const { return pageSize + 2 * border; }
+  // The size of a page's RGBA8 texels, including its border.
+  size_t getTileSizeBytes() const {
+    return static_cast<size_t>(getTileSize()) * getTileSize() * 4;
+  }
+  int getNumPagesX(int mip) const;
+  int getNumPagesY(int mip) const;
+  // The number of pages in every mip level.
+  int getNumPages() const;
+  // The index of a page among all of the texture's pages, which are ordered by
+  // mip level, and then row by row.
+  int getPageIndex(int mip, int x, int y) const;
+};
+
+// Identifies a page of a virtual texture. Packs into 32 bits in the same
+// layout as the feedback buffer's RGBA8 texels.
+struct VirtualPageId {
+  uint8_t x = 0;
+  uint8_t y = 0;
+  uint8_t mip = 0;
+  // The virtual texture's ID, starting from 1. 0 means no page at all.
+  uint8_t texture = 0;
+
+  uint32_t pack() const {
+    return static_cast<uint32_t>(x) | (static_cast<uint32_t>(y) << 8) |
+           (static_cast<uint32_t>(mip) << 16) |
+           (static_cast<uint32_t>(texture) << 24);
+  }
+  static VirtualPageId unpack(uint32_t packed) {
+    return {
+        .x = static_cast<uint8_t>(packed),
+        .y = static_cast<uint8_t>(packed >> 8),
+        .mip = static_cast<uint8_t>(packed >> 16),
+        .texture = static_cast<uint8_t>(packed >> 24),
+    };
+  }
+  bool operator==(const VirtualPageId& other) const = default;
+};
+
+// Cuts an 8-bit image with 1 to 4 channels, and the mips generated from it,
+// into a virtual texture's pages. Pages are RGBA8 (with missing channels
+// filled in as GL would when sampling), ordered as in
+// VirtualTextureLayout::getPageIndex(), and have borders that wrap around the
+// image's edges, as repeating textures do.
+std::vector<unsigned char> buildVirtualTexturePages(
+    const unsigned char* pixels, int numChannels, bool isSRGB,
+    const VirtualTextureLayout& layout, MipFilter mipFilter = MipFilter::BOX);
+
+// Bump this whenever the layout of tiled texture files changes.
+constexpr uint32_t TILED_TEXTURE_VERSION = 1;
+
+// A virtual texture's pages, as stored in a tiled texture file. Pages are read
+// straight out of a memory mapping, so only the pages that are streamed in are
+// ever read from disk. Safe to read from any thread.
+class TiledTexture {
+ public:
+  // Opens a tiled texture file, throwing if it isn't valid.
+  explicit TiledTexture(const std::string& path);
+
+  const VirtualTextureLayout& getLayout() const { return layout_; }
+  const std::string& getSourcePath() const { return sourcePath_; }
+  int64_t getModifiedTime() const { return modifiedTime_; }
+  bool isSRGB() const { return isSRGB_; }
+
+  // Returns the page's RGBA8 texels, including its border.
+  const unsigned char* getPage(int mip, int x, int y) const;
+
+ private:
+  MappedFile file_;
+  VirtualTextureLayout layout_;
+  std::string sourcePath_;
+  int64_t modifiedTime_;
+  bool isSRGB_;
+  const unsigned char* pages_;
+};
+
+// An on-disk cache of tiled textures, which are built offline (see
+// //tools:texture_tiler) from the source images that models reference, and
+// which virtual textures stream their pages from. Like the compressed texture
+// cache, entries are keyed by the source image's path, modified time, and color
+// space, and stale or bad entries are treated as misses.
+class TiledTextureCache {
+ public:
+  explicit TiledTextureCache(std::string directory = getDefaultDirectory())
+      : directory_(std::move(directory)) {}
+
+  // Opens the entry for the given key. Returns nullptr on a cache miss.
+  std::unique_ptr<TiledTexture> open(const CompressedTextureKey& key) const;
+  // Tiles an image and writes it as the entry for the given key. Throws if the
+  // image can't be tiled (see VirtualTextureLayout::create()), and returns
+  // false if the entry couldn't be written.
+  bool store(const CompressedTextureKey& key, const unsigned char* pixels,
+             int width, int height, int numChannels,
+             int pageSize = DEFAULT_VIRTUAL_PAGE_SIZE,
+             MipFilter mipFilter = MipFilter::KAISER);
+
+  std::string getEntryPath(const CompressedTextureKey& key) const;
+  const std::string& getDirectory() const { return directory_; }
+
+  static std::string getDefaultDirectory();
+
+ private:
+  std::string directory_;
+};
+
+struct VirtualPageRequest {
+  VirtualPageId page;
+  // The number of feedback texels that requested the page.
+  uint32_t count;
+};
+
+// Collects the distinct pages requested by a feedback buffer of packed
+// VirtualPageIds, skipping texels that didn't request any. Requests are sorted
+// in the order that pages should be streamed in: coarser mips first, since
+// they stand in for finer ones until those arrive, and then by how much of the
+// screen needs them.
+std::vector<VirtualPageRequest> analyzeFeedback(const uint32_t* texels,
+                                                size_t numTexels);
+
+// Assigns pages to the slots of the physical page cache, which is shared by
+// every virtual texture, and evicts the least recently used pages when it
+// fills up. Doesn't touch any GL state.
+class VirtualPageCache {
+ public:
+  struct Slot {
+    int x;
+    int y;
+  };
+
+  // Creates a cache that's sizePages slots along each side.
+  explicit VirtualPageCache(int sizePages);
+
+  int getSizePages() const { return sizePages_; }
+  int getNumSlots() const { return sizePages_ * sizePages_; }
+  int getNumResident() const { return entries_.size(); }
+
+  std::optional<Slot> find(VirtualPageId page) const;
+  // Marks a resident page as used in the given frame.
+  void touch(VirtualPageId page, uint64_t frame);
+  // Assigns a slot to a page that isn't resident, evicting the least recently
+  // used page if the cache is full (which is returned through `evicted`).
+  // Pinned pages are never evicted, and neither are pages used in the current
+  // frame, so this returns nullopt if no slot can be spared.
+  std::optional<Slot> insert(VirtualPageId page, uint64_t frame, bool pinned,
+                             std::optional<VirtualPageId>* evicted);
+
+ private:
+  struct Entry {
+    Slot slot;
+    uint64_t lastUsed;
+    bool pinned;
+    // The entry's place in lru_, unless it's pinned.
+    std::list<uint32_t>::iterator lruPosition;
+  };
+
+  int sizePages_;
+  std::unordered_map<uint32_t, Entry> entries_;
+  // Unpinned pages, most recently used first.
+  std::list<uint32_t> lru_;
+  std::vector<Slot> freeSlots_;
+};
+
+// A CPU-side copy of a virtual texture's page table. The page table maps every
+// page, at every mip level, to the page that stands in for it: the page itself
+// if it's resident, or otherwise its nearest resident ancestor. Entries are
+// RGBA8, holding the physical slot's x and y, the mip level of the page that
+// stands in, and 255 if any page does. Doesn't touch any GL state.
+class VirtualPageTable {
+ public:
+  explicit VirtualPageTable(const VirtualTextureLayout& layout);
+
+  void map(int mip, int x, int y, VirtualPageCache::Slot slot);
+  void unmap(int mip, int x, int y);
+
+  // Whether pages have been mapped or unmapped since the last update().
+  bool isDirty() const { return dirty_; }
+  // Recomputes the entries from the resident pages.
+  void update();
+  // Returns the entries of a mip level, row by row.
+  const unsigned char* getEntries(int mip) const {
+    return entries_[mip].data();
+  }
+
+ private:
+  VirtualTextureLayout layout_;
+  // The slot of each resident page, by page index.
+  std::vector<std::optional<VirtualPageCache::Slot>> resident_;
+  std::vector<std::vector<unsigned char>> entries_;
+  bool dirty_ = true;
+};
+
+// The uniform names of a QrkVirtualTexture struct (see virtual_texture.glsl).
+struct VirtualTextureUniforms {
+  explicit VirtualTextureUniforms(std::string_view name);
+
+  UniformName pageTable;
+  UniformName pageCache;
+  UniformName width;
+  UniformName height;
+  UniformName numMips;
+  UniformName pageSize;
+  UniformName pageBorder;
+  UniformName id;
+};
+
+// A texture whose pages are streamed in as they're needed, and sampled through
+// a page table (see virtual_texture.glsl). Created and owned by a
+// VirtualTextureSystem.
+class VirtualTexture {
+ public:
+  VirtualTexture(uint8_t id, std::unique_ptr<TiledTexture> tiles,
+                 Texture pageCache);
+  ~VirtualTexture();
+  VirtualTexture(const VirtualTexture&) = delete;
+  VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+  uint8_t getId() const { return id_; }
+  const VirtualTextureLayout& getLayout() const { return tiles_->getLayout(); }
+  Texture getPageTable() const { return pageTable_; }
+
+  // Binds the page table and the page cache to the given texture units, and
+  // sets the rest of the QrkVirtualTexture struct.
+  void bind(Shader& shader, const VirtualTextureUniforms& uniforms,
+            unsigned int pageTableUnit, unsigned int pageCacheUnit);
+
+ private:
+  // Uploads the page table, if any pages have been mapped or unmapped.
+  void updatePageTable();
+
+  uint8_t id_;
+  std::unique_ptr<TiledTexture> tiles_;
+  Texture pageTable_;
+  Texture pageCache_;
+  VirtualPageTable table_;
+
+  friend class VirtualTextureSystem;
+};
+
+// Draws the pages that geometry samples into the feedback buffer, as packed
+// VirtualPageIds. Only meshes with virtual diffuse maps request any pages.
+class VirtualTextureFeedbackShader : public Shader {
+ public:
+  VirtualTextureFeedbackShader();
+};
+
+struct VirtualTextureParams {
+  // The number of pages along each side of the physical page cache.
+  int cacheSizePages = 32;
+  // The page size of every virtual texture. Tiled textures with any other
+  // page size aren't opened.
+  int pageSize = DEFAULT_VIRTUAL_PAGE_SIZE;
+  // Whether the pages are in sRGB. Virtual textures are only used as diffuse
+  // maps, so they usually are.
+  bool isSRGB = true;
+  // How many times smaller than the screen the feedback buffer is, along each
+  // side.
+  int feedbackDivisor = 4;
+  // The most pages to upload per frame.
+  int maxUploadsPerFrame = 32;
+  // The most pages to have loading at once.
+  int maxPendingLoads = 64;
+  // The directory of the tiled texture cache. If empty, uses a directory under
+  // the system's temp directory.
+  std::string tileCacheDirectory = "";
+};
+
+struct VirtualTextureStats {
+  unsigned int numTextures = 0;
+  unsigned int residentPages = 0;
+  unsigned int cachePages = 0;
+  // The number of distinct pages that the last feedback buffer requested.
+  unsigned int requestedPages = 0;
+  unsigned int loadingPages = 0;
+  // Totals since the system was created.
+  unsigned int uploadedPages = 0;
+  unsigned int evictedPages = 0;
+};
+
+// Streams in the pages of virtual textures as they're needed, so that only the
+// parts of large textures that are actually seen take up VRAM.
+//
+// Each frame, scene geometry is drawn into a small feedback buffer, recording
+// the page that each texel samples (see beginFeedback()). The feedback buffer
+// is read back asynchronously, and the pages that it requests are loaded from
+// tiled texture files on worker threads, and then uploaded into a physical
+// page cache that every virtual texture shares. Each virtual texture has a page
+// table that maps its pages into the page cache, and which lets pages that
+// aren't resident fall back to coarser ones.
+//
+// Should only be used from the GL thread.
+class VirtualTextureSystem {
+ public:
+  explicit VirtualTextureSystem(ImageSize screenSize,
+                                const VirtualTextureParams& params = {});
+  ~VirtualTextureSystem();
+  VirtualTextureSystem(const VirtualTextureSystem&) = delete;
+  VirtualTextureSystem& operator=(const VirtualTextureSystem&) = delete;
+
+  // Returns the virtual texture for a source image, opening it the first time.
+  // Returns nullptr if the image hasn't been tiled (or its tiles are stale),
+  // or if there are already MAX_VIRTUAL_TEXTURES. The texture's coarsest page
+  // is uploaded right away and is never evicted, so that there's always
+  // something to sample. Virtual textures must not outlive the system.
+  std::shared_ptr<VirtualTexture> open(const std::string& sourcePath);
+
+  // Activates and clears the feedback buffer. Geometry drawn with
+  // getFeedbackShader() until endFeedback() requests the pages it samples.
+  void beginFeedback();
+  // Deactivates the feedback buffer, and starts reading it back. Readbacks
+  // take a frame or two to arrive, so as not to stall.
+  void endFeedback();
+  VirtualTextureFeedbackShader& getFeedbackShader() { return feedbackShader_; }
+  Framebuffer& getFeedbackBuffer() { return feedbackBuffer_; }
+
+  // Requests the pages from the latest feedback readback, and uploads pages
+  // that have finished loading. Should be called once per frame.
+  void update();
+
+  Texture getPageCache() const { return pageCache_; }
+  const VirtualTextureStats& getStats() const { return stats_; }
+
+ private:
+  struct PendingPage {
+    VirtualPageId page;
+    std::future<std::vector<unsigned char>> pixels;
+  };
+
+  // Maps the feedback readback, if it has arrived, and returns its requests.
+  std::optional<std::vector<VirtualPageRequest>> readFeedback();
+  void requestPages(const std::vector<VirtualPageRequest>& requests);
+  void uploadPages();
+  // Copies a page into the page cache, and maps it. Returns false if the page
+  // cache had no slot to spare.
+  bool uploadPage(VirtualPageId page, const unsigned char* pixels,
+                  bool pinned);
+
+  VirtualTextureParams params_;
+  TiledTextureCache tileCache_;
+  Texture pageCache_;
+  VirtualPageCache pageSlots_;
+  // Virtual textures, by ID - 1.
+  std::vector<std::shared_ptr<VirtualTexture>> textures_;
+  std::unordered_map<std::string, std::shared_ptr<VirtualTexture>>
+      texturesByPath_;
+
+  Framebuffer feedbackBuffer_;
+  VirtualTextureFeedbackShader feedbackShader_;
+  // The pixel pack buffer that the feedback buffer is read back into, and a
+  // fence for when the read finishes.
+  unsigned int readbackBuffer_ = 0;
+  GLsync readbackFence_ = nullptr;
+
+  // Pages that are loading, in the order they were requested.
+  std::deque<PendingPage> pending_;
+  std::unordered_set<uint32_t> loading_;
+  uint64_t frame_ = 0;
+  VirtualTextureStats stats_;
+  // Declared last, so that pending loads finish before the tiled textures
+  // that they read from are closed.
+  ThreadPool loadPool_;
+};
+
+}  // namespace qrk
+
+#endif
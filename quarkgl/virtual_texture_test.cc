@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+#include <qrk/compressed_texture.h>
+#include <qrk/virtual_texture.h>
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+class VirtualTextureTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::path(testing::TempDir()) /
+                 testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::filesystem::remove_all(directory_);
+    std::filesystem::create_directories(directory_);
+  }
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  std::string writeSource(const std::string& name) {
+    std::string path = (directory_ / name).string();
+    std::ofstream(path) << "source";
+    return path;
+  }
+
+  std::filesystem::path directory_;
+};
+
+// Creates an RGB image whose texels hold their own coordinates.
+std::vector<unsigned char> makeImage(int width, int height) {
+  std::vector<unsigned char> pixels(width * height * 3);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      unsigned char* texel = &pixels[(y * width + x) * 3];
+      texel[0] = x;
+      texel[1] = y;
+      texel[2] = 7;
+    }
+  }
+  return pixels;
+}
+
+qrk::VirtualPageId page(int x, int y, int mip, int texture = 1) {
+  return {.x = static_cast<uint8_t>(x),
+          .y = static_cast<uint8_t>(y),
+          .mip = static_cast<uint8_t>(mip),
+          .texture = static_cast<uint8_t>(texture)};
+}
+
+TEST(VirtualTextureLayoutTest, SplitsMipsIntoPages) {
+  qrk::VirtualTextureLayout layout =
+      qrk::VirtualTextureLayout::create(512, 256, /*pageSize=*/128);
+  EXPECT_EQ(layout.numMips, 3);
+  EXPECT_EQ(layout.getNumPagesX(0), 4);
+  EXPECT_EQ(layout.getNumPagesY(0), 2);
+  EXPECT_EQ(layout.getNumPagesX(1), 2);
+  EXPECT_EQ(layout.getNumPagesY(1), 1);
+  EXPECT_EQ(layout.getNumPagesX(2), 1);
+  EXPECT_EQ(layout.getNumPagesY(2), 1);
+  EXPECT_EQ(layout.getNumPages(), 8 + 2 + 1);
+  EXPECT_EQ(layout.getPageIndex(0, 1, 1), 5);
+  EXPECT_EQ(layout.getPageIndex(1, 1, 0), 9);
+  EXPECT_EQ(layout.getPageIndex(2, 0, 0), 10);
+  EXPECT_EQ(layout.getTileSize(), 128 + 2 * qrk::VIRTUAL_PAGE_BORDER);
+
+  // Textures smaller than a page are a single page.
+  EXPECT_EQ(qrk::VirtualTextureLayout::create(64, 64, 128).numMips, 1);
+}
+
+TEST(VirtualTextureLayoutTest, RejectsInvalidSizes) {
+  EXPECT_THROW(qrk::VirtualTextureLayout::create(300, 256),
+               qrk::VirtualTextureException);
+  EXPECT_THROW(qrk::VirtualTextureLayout::create(256, 0),
+               qrk::VirtualTextureException);
+  EXPECT_THROW(qrk::VirtualTextureLayout::create(256, 256, /*pageSize=*/100),
+               qrk::VirtualTextureException);
+  EXPECT_THROW(qrk::VirtualTextureLayout::create(1 << 14, 1 << 14, 32),
+               qrk::VirtualTextureException);
+}
+
+TEST(VirtualPageIdTest, PacksLikeFeedbackTexels) {
+  qrk::VirtualPageId id = page(3, 200, 5, 9);
+  EXPECT_EQ(id.pack(), 0x0905c803u);
+  EXPECT_EQ(qrk::VirtualPageId::unpack(id.pack()), id);
+}
+
+TEST(VirtualTexturePagesTest, WrapsBordersAroundEdges) {
+  constexpr int kPageSize = 16;
+  std::vector<unsigned char> pixels = makeImage(32, 32);
+  qrk::VirtualTextureLayout layout =
+      qrk::VirtualTextureLayout::create(32, 32, kPageSize);
+  std::vector<unsigned char> pages = qrk::buildVirtualTexturePages(
+      pixels.data(), 3, /*isSRGB=*/false, layout);
+  ASSERT_EQ(pages.size(), layout.getNumPages() * layout.getTileSizeBytes());
+
+  const int tileSize = layout.getTileSize();
+  const int border = layout.border;
+  auto texel = [&](int index, int x, int y) {
+    return &pages[index * layout.getTileSizeBytes() +
+                  (y * tileSize + x) * 4];
+  };
+
+  // The first texel of page (1, 0)'s content.
+  const unsigned char* content = texel(1, border, border);
+  EXPECT_EQ(content[0], kPageSize);
+  EXPECT_EQ(content[1], 0);
+  EXPECT_EQ(content[2], 7);
+  // Missing channels are filled in as opaque.
+  EXPECT_EQ(content[3], 255);
+
+  // Page (0, 0)'s top-left border comes from the opposite corner.
+  const unsigned char* corner = texel(0, 0, 0);
+  EXPECT_EQ(corner[0], 32 - border);
+  EXPECT_EQ(corner[1], 32 - border);
+
+  // Page (1, 0)'s left border comes from page (0, 0).
+  const unsigned char* left = texel(1, border - 1, border);
+  EXPECT_EQ(left[0], kPageSize - 1);
+}
+
+TEST_F(VirtualTextureTest, CacheHitsOnlyMatchingKeys) {
+  std::string source = writeSource("albedo.png");
+  std::vector<unsigned char> pixels = makeImage(64, 32);
+
+  qrk::TiledTextureCache cache((directory_ / "cache").string());
+  qrk::CompressedTextureKey key =
+      qrk::computeCompressedTextureKey(source, /*isSRGB=*/true);
+  EXPECT_EQ(cache.open(key), nullptr);
+  ASSERT_TRUE(cache.store(key, pixels.data(), 64, 32, 3, /*pageSize=*/16));
+
+  std::unique_ptr<qrk::TiledTexture> tiles = cache.open(key);
+  ASSERT_NE(tiles, nullptr);
+  EXPECT_EQ(tiles->getSourcePath(), key.sourcePath);
+  EXPECT_TRUE(tiles->isSRGB());
+  const qrk::VirtualTextureLayout& layout = tiles->getLayout();
+  EXPECT_EQ(layout.width, 64);
+  EXPECT_EQ(layout.height, 32);
+  EXPECT_EQ(layout.pageSize, 16);
+  EXPECT_EQ(layout.numMips, 3);
+
+  std::vector<unsigned char> expected = qrk::buildVirtualTexturePages(
+      pixels.data(), 3, /*isSRGB=*/true, layout, qrk::MipFilter::KAISER);
+  const unsigned char* lastPage = tiles->getPage(2, 0, 0);
+  EXPECT_TRUE(std::equal(lastPage, lastPage + layout.getTileSizeBytes(),
+                         expected.end() - layout.getTileSizeBytes()));
+
+  // Linear and sRGB versions of a source are separate entries.
+  EXPECT_EQ(cache.open(qrk::computeCompressedTextureKey(source, false)),
+            nullptr);
+
+  qrk::CompressedTextureKey stale = key;
+  stale.modifiedTime++;
+  EXPECT_EQ(cache.open(stale), nullptr);
+}
+
+TEST_F(VirtualTextureTest, RejectsInvalidFiles) {
+  std::string path = writeSource("bad.qtiled");
+  EXPECT_THROW(qrk::TiledTexture texture(path), qrk::VirtualTextureException);
+}
+
+TEST(AnalyzeFeedbackTest, OrdersCoarsestAndMostRequestedFirst) {
+  const uint32_t a = page(0, 0, 0).pack();
+  const uint32_t b = page(1, 0, 0).pack();
+  const uint32_t coarse = page(0, 0, 2).pack();
+  const uint32_t other = page(0, 0, 0, /*texture=*/2).pack();
+  std::vector<uint32_t> texels = {0, a, a, b, b, b, 0, coarse, a, other, 0};
+
+  std::vector<qrk::VirtualPageRequest> requests =
+      qrk::analyzeFeedback(texels.data(), texels.size());
+  ASSERT_EQ(requests.size(), 4);
+  EXPECT_EQ(requests[0].page.pack(), coarse);
+  EXPECT_EQ(requests[0].count, 1);
+  EXPECT_EQ(requests[1].page.pack(), a);
+  EXPECT_EQ(requests[1].count, 3);
+  EXPECT_EQ(requests[2].page.pack(), b);
+  EXPECT_EQ(requests[2].count, 3);
+  EXPECT_EQ(requests[3].page.pack(), other);
+  EXPECT_EQ(requests[3].count, 1);
+
+  EXPECT_TRUE(qrk::analyzeFeedback(texels.data(), 1).empty());
+}
+
+TEST(VirtualPageCacheTest, EvictsLeastRecentlyUsedPages) {
+  qrk::VirtualPageCache cache(/*sizePages=*/2);
+  EXPECT_EQ(cache.getNumSlots(), 4);
+  std::optional<qrk::VirtualPageId> evicted;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(cache.insert(page(i, 0, 0), /*frame=*/i, false, &evicted));
+    EXPECT_FALSE(evicted.has_value());
+  }
+  EXPECT_EQ(cache.getNumResident(), 4);
+  std::optional<qrk::VirtualPageCache::Slot> first = cache.find(page(0, 0, 0));
+  ASSERT_TRUE(first.has_value());
+  EXPECT_EQ(first->x, 0);
+  EXPECT_EQ(first->y, 0);
+
+  // Using page 0 again makes page 1 the least recently used.
+  cache.touch(page(0, 0, 0), /*frame=*/4);
+  std::optional<qrk::VirtualPageCache::Slot> slot =
+      cache.insert(page(0, 0, 1), /*frame=*/5, false, &evicted);
+  ASSERT_TRUE(slot.has_value());
+  ASSERT_TRUE(evicted.has_value());
+  EXPECT_EQ(*evicted, page(1, 0, 0));
+  EXPECT_EQ(slot->x, 1);
+  EXPECT_EQ(slot->y, 0);
+  EXPECT_FALSE(cache.find(page(1, 0, 0)).has_value());
+  EXPECT_EQ(cache.getNumResident(), 4);
+}
+
+TEST(VirtualPageCacheTest, KeepsPinnedAndCurrentPages) {
+  qrk::VirtualPageCache cache(/*sizePages=*/1);
+  std::optional<qrk::VirtualPageId> evicted;
+  ASSERT_TRUE(cache.insert(page(0, 0, 2), /*frame=*/0, /*pinned=*/true,
+                           &evicted));
+  EXPECT_FALSE(cache.insert(page(0, 0, 0), /*frame=*/1, false, &evicted));
+
+  qrk::VirtualPageCache unpinned(/*sizePages=*/1);
+  ASSERT_TRUE(unpinned.insert(page(0, 0, 0), /*frame=*/3, false, &evicted));
+  // The page was used this frame, so it can't make way for another.
+  EXPECT_FALSE(unpinned.insert(page(1, 0, 0), /*frame=*/3, false, &evicted));
+  EXPECT_FALSE(evicted.has_value());
+  EXPECT_TRUE(unpinned.insert(page(1, 0, 0), /*frame=*/4, false, &evicted));
+  EXPECT_EQ(evicted, page(0, 0, 0));
+}
+
+TEST(VirtualPageTableTest, FallsBackToResidentAncestors) {
+  qrk::VirtualTextureLayout layout =
+      qrk::VirtualTextureLayout::create(64, 64, /*pageSize=*/16);
+  ASSERT_EQ(layout.numMips, 3);
+  qrk::VirtualPageTable table(layout);
+  EXPECT_TRUE(table.isDirty());
+  table.update();
+  EXPECT_FALSE(table.isDirty());
+  // Nothing is resident yet.
+  EXPECT_EQ(table.getEntries(0)[3], 0);
+
+  table.map(2, 0, 0, {.x = 5, .y = 6});
+  table.map(1, 1, 0, {.x = 1, .y = 2});
+  EXPECT_TRUE(table.isDirty());
+  table.update();
+
+  auto entry = [&](int mip, int x, int y) {
+    const unsigned char* e =
+        table.getEntries(mip) + (y * layout.getNumPagesX(mip) + x) * 4;
+    return std::vector<int>(e, e + 4);
+  };
+  EXPECT_EQ(entry(2, 0, 0), (std::vector<int>{5, 6, 2, 255}));
+  EXPECT_EQ(entry(1, 1, 0), (std::vector<int>{1, 2, 1, 255}));
+  EXPECT_EQ(entry(1, 0, 1), (std::vector<int>{5, 6, 2, 255}));
+  // Page (3, 1) at mip 0 is under page (1, 0) at mip 1.
+  EXPECT_EQ(entry(0, 3, 1), (std::vector<int>{1, 2, 1, 255}));
+  EXPECT_EQ(entry(0, 0, 3), (std::vector<int>{5, 6, 2, 255}));
+
+  table.unmap(1, 1, 0);
+  table.update();
+  EXPECT_EQ(entry(0, 3, 1), (std::vector<int>{5, 6, 2, 255}));
+}
+
+}  // namespace
@@ -1,5 +1,6 @@
 #include "window.h"
 
+#include <qrk/gl_state.h>
 #include <qrk/window.h>
 
 namespace qrk {
@@ -33,6 +34,9 @@ Window::Window(int width, int height, const char* title, bool fullscreen,
 
   qrk::initGlErrorLogging();
 
+  frameUniforms_ = std::make_unique<UniformBuffer>(FRAME_UNIFORM_BINDING,
+                                                   sizeof(FrameUniformData));
+
   // Allow us to refer to the object while accessing C APIs.
   glfwSetWindowUserPointer(window_, this);
 
@@ -60,12 +64,18 @@ Window::~Window() {
 
 void Window::activate() { glfwMakeContextCurrent(window_); }
 
-void Window::updateUniforms(Shader& shader) {
-  shader.setFloat("qrk_deltaTime", deltaTime_);
-
+void Window::updateFrameUniforms() {
+  FrameUniformData data;
+  if (boundCamera_ != nullptr) {
+    data.view = boundCamera_->getViewTransform();
+    data.projection = boundCamera_->getProjectionTransform();
+  }
+  data.time = qrk::time();
+  data.deltaTime = deltaTime_;
   ImageSize size = getSize();
-  shader.setInt("qrk_windowWidth", size.width);
-  shader.setInt("qrk_windowHeight", size.height);
+  data.windowWidth = size.width;
+  data.windowHeight = size.height;
+  frameUniforms_->update(&data, sizeof(data));
 }
 
 ImageSize Window::getSize() const {
@@ -345,6 +355,7 @@ void Window::loop(std::function<void(float)> callback) {
     lastTime_ = currentTime;
 
     updateFrameStats(deltaTime_);
+    GlState::current().beginFrame();
 
     // Clear the appropriate buffers.
     glClearColor(clearColor_.r, clearColor_.g, clearColor_.b, clearColor_.a);
@@ -360,6 +371,9 @@ void Window::loop(std::function<void(float)> callback) {
     // Process necessary input.
     processInput(deltaTime_);
 
+    // Camera movement is done, so shared per-frame uniforms can be written.
+    updateFrameUniforms();
+
     // Call the loop function.
     callback(deltaTime_);
 
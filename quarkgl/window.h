@@ -12,6 +12,7 @@
 #include <qrk/exceptions.h>
 #include <qrk/screen.h>
 #include <qrk/shader.h>
+#include <qrk/uniform_buffer.h>
 
 #include <functional>
 #include <glm/glm.hpp>
@@ -45,7 +46,7 @@ enum class MouseButtonBehavior {
   CAPTURE_MOUSE,
 };
 
-class Window : public UniformSource {
+class Window {
  public:
   Window(int width = DEFAULT_WIDTH, int height = DEFAULT_HEIGHT,
          const char* title = DEFAULT_TITLE, bool fullscreen = false,
@@ -126,7 +127,10 @@ class Window : public UniformSource {
   void cullFrontFaces() { glCullFace(GL_FRONT); }
   void cullBackFaces() { glCullFace(GL_BACK); }
 
-  void updateUniforms(Shader& shader);
+  // Writes the QrkFrame uniform block from the bound camera and the current
+  // frame timing. This is called every frame by loop(), before the callback,
+  // but can be called again if the camera changes during the frame.
+  void updateFrameUniforms();
 
   ImageSize getSize() const;
   void setSize(int width, int height);
@@ -196,6 +200,8 @@ class Window : public UniformSource {
   bool depthTestEnabled_ = false;
   bool stencilTestEnabled_ = false;
 
+  std::unique_ptr<UniformBuffer> frameUniforms_;
+
   float lastTime_ = 0.0f;
   float deltaTime_ = 0.0f;
   unsigned int frameCount_ = 0;
@@ -0,0 +1,163 @@
+// Builds block-compressed versions of a model's textures into the compressed
+// texture cache, which models then load from (see
+// ModelParams::useCompressedTextures). Prints the quality and size of each
+// texture, compared to its uncompressed version.
+//
+// Formats are picked per texture: BC5 for normal maps, BC4 for single-channel
+// images, BC1 for opaque color, and BC3 for color with alpha. Mips are
+// generated with a Kaiser filter, since there's no rush.
+
+#include <qrk/block_compression.h>
+#include <qrk/compressed_texture.h>
+#include <qrk/image_mips.h>
+#include <qrk/model.h>
+#include <qrk/texture.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(std::string, model,
+          "examples/assets/DamagedHelmet/DamagedHelmet.gltf",
+          "Path to the model whose textures to compress");
+ABSL_FLAG(std::string, cache_dir, "",
+          "The compressed texture cache directory. If empty, uses the same "
+          "default as models do");
+ABSL_FLAG(bool, force, false,
+          "Whether to rebuild textures that are already in the cache");
+
+namespace {
+
+bool isOpaque(const qrk::ImageData& image) {
+  if (image.numChannels != 4) return true;
+  const size_t numPixels = static_cast<size_t>(image.width) * image.height;
+  for (size_t i = 0; i < numPixels; i++) {
+    if (image.pixels.get()[i * 4 + 3] != 255) return false;
+  }
+  return true;
+}
+
+qrk::BlockFormat chooseBlockFormat(const qrk::ImageData& image,
+                                   bool isNormalMap) {
+  // Normal maps only need X and Y, since Z is reconstructed when sampling.
+  if (isNormalMap || image.numChannels == 2) return qrk::BlockFormat::BC5;
+  if (image.numChannels == 1) return qrk::BlockFormat::BC4;
+  return isOpaque(image) ? qrk::BlockFormat::BC1 : qrk::BlockFormat::BC3;
+}
+
+// Returns the size of an uncompressed texture, including its mips.
+size_t getUncompressedSizeBytes(const qrk::ImageData& image) {
+  size_t size = 0;
+  const int numMips = qrk::calculateNumMips(image.width, image.height);
+  for (int level = 0; level < numMips; level++) {
+    qrk::ImageSize mip =
+        qrk::calculateMipLevel(image.width, image.height, level);
+    size += static_cast<size_t>(mip.width) * mip.height * image.numChannels;
+  }
+  return size;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const std::string path = absl::GetFlag(FLAGS_model);
+  const std::string cacheDir = absl::GetFlag(FLAGS_cache_dir);
+  const bool force = absl::GetFlag(FLAGS_force);
+
+  qrk::CompressedTextureCache cache =
+      cacheDir.empty() ? qrk::CompressedTextureCache()
+                       : qrk::CompressedTextureCache(cacheDir);
+  std::printf("Model: %s\nCache: %s\n\n", path.c_str(),
+              cache.getDirectory().c_str());
+
+  // Texture paths are relative to the model's directory, as in Model.
+  const size_t slash = path.find_last_of('/');
+  const std::string directory =
+      slash != std::string::npos ? path.substr(0, slash) : "";
+
+  // Each texture is compressed once per color space that it's used in.
+  std::map<std::pair<std::string, bool>, std::set<qrk::TextureMapType>>
+      textures;
+  qrk::ModelData data = qrk::importModelData(path);
+  const qrk::ModelDataView view = data.view();
+  for (const qrk::ModelTextureBinding& binding : view.textureBindings) {
+    std::string fullPath =
+        directory + "/" + std::string(view.getTexturePath(binding));
+    if (qrk::isCompressedImagePath(fullPath)) continue;
+    textures[{fullPath, qrk::isSRGBTextureMapType(binding.type)}].insert(
+        binding.type);
+  }
+
+  std::printf("%-40s %-4s %8s %12s %12s %6s %9s\n", "Texture", "Fmt",
+              "PSNR", "Raw bytes", "BC bytes", "Ratio", "Encode");
+  size_t totalUncompressed = 0, totalCompressed = 0;
+  int numFailed = 0;
+  for (const auto& [key, types] : textures) {
+    const auto& [fullPath, isSRGB] = key;
+    const qrk::CompressedTextureKey cacheKey =
+        qrk::computeCompressedTextureKey(fullPath, isSRGB);
+    if (!force && cache.load(cacheKey)) {
+      std::printf("%-40s (cached)\n", fullPath.c_str());
+      continue;
+    }
+
+    qrk::ImageData image;
+    try {
+      // Decode flipped, like models do, so that loads don't need to flip.
+      image = qrk::decodeImage(fullPath.c_str());
+    } catch (const qrk::TextureException& e) {
+      std::fprintf(stderr, "%s\n", e.what());
+      numFailed++;
+      continue;
+    }
+
+    const qrk::BlockFormat format =
+        chooseBlockFormat(image, types.contains(qrk::TextureMapType::NORMAL));
+    const auto start = std::chrono::steady_clock::now();
+    qrk::CompressedImageData compressed = qrk::compressImage(
+        image.pixels.get(), image.width, image.height, image.numChannels,
+        format, isSRGB, /*generateMips=*/true, /*flippedVertically=*/true,
+        qrk::MipFilter::KAISER);
+    const auto end = std::chrono::steady_clock::now();
+
+    std::vector<unsigned char> decoded = qrk::decodeBlocks(
+        format, compressed.getMipData(0), image.width, image.height);
+    const double psnr = qrk::computePsnr(
+        image.pixels.get(), image.numChannels, decoded.data(), image.width,
+        image.height,
+        std::min(image.numChannels, qrk::getNumChannels(format)));
+
+    if (!cache.store(cacheKey, compressed)) {
+      std::fprintf(stderr, "Failed to write cache entry for %s\n",
+                   fullPath.c_str());
+      numFailed++;
+      continue;
+    }
+
+    const size_t uncompressedBytes = getUncompressedSizeBytes(image);
+    totalUncompressed += uncompressedBytes;
+    totalCompressed += compressed.getSizeBytes();
+    std::printf("%-40s %-4s %5.1f dB %12zu %12zu %5.1fx %6.0f ms\n",
+                fullPath.c_str(), qrk::blockFormatToString(format), psnr,
+                uncompressedBytes, compressed.getSizeBytes(),
+                static_cast<double>(uncompressedBytes) /
+                    compressed.getSizeBytes(),
+                std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  if (totalCompressed > 0) {
+    std::printf("\nTotal: %zu -> %zu bytes (%.1fx smaller in VRAM)\n",
+                totalUncompressed, totalCompressed,
+                static_cast<double>(totalUncompressed) / totalCompressed);
+  }
+  return numFailed == 0 ? 0 : 1;
+}
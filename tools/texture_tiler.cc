@@ -0,0 +1,129 @@
+// Cuts a model's diffuse textures into pages for the tiled texture cache,
+// which virtual textures stream their pages from (see
+// ModelParams::virtualTextures). Prints how many pages each texture is cut
+// into, and the size of each page in the page cache.
+//
+// Only textures with power-of-two sides can be tiled; others are skipped, and
+// are loaded as regular textures instead. Mips are generated with a Kaiser
+// filter, since there's no rush.
+
+#include <qrk/compressed_texture.h>
+#include <qrk/image_mips.h>
+#include <qrk/model.h>
+#include <qrk/texture.h>
+#include <qrk/virtual_texture.h>
+
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(std::string, model,
+          "examples/assets/DamagedHelmet/DamagedHelmet.gltf",
+          "Path to the model whose textures to tile");
+ABSL_FLAG(std::string, cache_dir, "",
+          "The tiled texture cache directory. If empty, uses the same "
+          "default as virtual textures do");
+ABSL_FLAG(int, page_size, qrk::DEFAULT_VIRTUAL_PAGE_SIZE,
+          "The size of each page's content, in texels. Must match "
+          "VirtualTextureParams::pageSize");
+ABSL_FLAG(bool, force, false,
+          "Whether to rebuild textures that are already in the cache");
+
+namespace {
+
+bool isPowerOfTwo(int value) {
+  return value > 0 && std::has_single_bit(static_cast<unsigned int>(value));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const std::string path = absl::GetFlag(FLAGS_model);
+  const std::string cacheDir = absl::GetFlag(FLAGS_cache_dir);
+  const int pageSize = absl::GetFlag(FLAGS_page_size);
+  const bool force = absl::GetFlag(FLAGS_force);
+
+  qrk::TiledTextureCache cache = cacheDir.empty()
+                                     ? qrk::TiledTextureCache()
+                                     : qrk::TiledTextureCache(cacheDir);
+  std::printf("Model: %s\nCache: %s\n\n", path.c_str(),
+              cache.getDirectory().c_str());
+
+  // Texture paths are relative to the model's directory, as in Model.
+  const size_t slash = path.find_last_of('/');
+  const std::string directory =
+      slash != std::string::npos ? path.substr(0, slash) : "";
+
+  // Only diffuse maps are virtual, and they're always in sRGB.
+  std::set<std::string> textures;
+  qrk::ModelData data = qrk::importModelData(path);
+  const qrk::ModelDataView view = data.view();
+  for (const qrk::ModelTextureBinding& binding : view.textureBindings) {
+    if (binding.type != qrk::TextureMapType::DIFFUSE) continue;
+    std::string fullPath =
+        directory + "/" + std::string(view.getTexturePath(binding));
+    if (qrk::isCompressedImagePath(fullPath)) continue;
+    textures.insert(fullPath);
+  }
+
+  std::printf("%-40s %11s %5s %6s %10s %9s\n", "Texture", "Size", "Mips",
+              "Pages", "Page bytes", "Time");
+  int numFailed = 0;
+  for (const std::string& fullPath : textures) {
+    const qrk::CompressedTextureKey cacheKey =
+        qrk::computeCompressedTextureKey(fullPath, /*isSRGB=*/true);
+    if (!force && cache.open(cacheKey)) {
+      std::printf("%-40s (cached)\n", fullPath.c_str());
+      continue;
+    }
+
+    qrk::ImageData image;
+    try {
+      // Decode flipped, like models do, so that pages match the texture
+      // coordinates that sample them.
+      image = qrk::decodeImage(fullPath.c_str());
+    } catch (const qrk::TextureException& e) {
+      std::fprintf(stderr, "%s\n", e.what());
+      numFailed++;
+      continue;
+    }
+    if (!isPowerOfTwo(image.width) || !isPowerOfTwo(image.height)) {
+      std::printf("%-40s (skipped: %dx%d isn't a power of two)\n",
+                  fullPath.c_str(), image.width, image.height);
+      continue;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    bool stored;
+    try {
+      stored = cache.store(cacheKey, image.pixels.get(), image.width,
+                           image.height, image.numChannels, pageSize,
+                           qrk::MipFilter::KAISER);
+    } catch (const qrk::VirtualTextureException& e) {
+      std::fprintf(stderr, "%s\n", e.what());
+      numFailed++;
+      continue;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    if (!stored) {
+      std::fprintf(stderr, "Failed to write cache entry for %s\n",
+                   fullPath.c_str());
+      numFailed++;
+      continue;
+    }
+
+    const qrk::VirtualTextureLayout layout =
+        qrk::VirtualTextureLayout::create(image.width, image.height, pageSize);
+    std::printf("%-40s %5dx%-5d %5d %6d %10zu %6.0f ms\n", fullPath.c_str(),
+                image.width, image.height, layout.numMips,
+                layout.getNumPages(), layout.getTileSizeBytes(),
+                std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  return numFailed == 0 ? 0 : 1;
+}